@@ -0,0 +1,143 @@
+#define NDEBUG
+
+#include "matrix_3d.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+
+/**
+  @file bench_compress.cpp
+  @brief Benchmark of compressed_matrix_3d: compression ratio, compression and
+  decompression throughput, and cost of a sweep through operator() against a matrix_3d.
+*/
+
+using namespace std;
+
+/**
+	@brief Timing function
+
+	@return best time in microseconds of reps calls to body
+*/
+template <typename B>
+double best_of(int reps, B body) {
+
+	double best = 1e30;
+
+	for(int r = 0; r < reps; ++r) {
+		auto start = chrono::steady_clock::now();
+		body();
+		auto stop = chrono::steady_clock::now();
+		double us = chrono::duration<double, micro>(stop - start).count();
+		if(us < best)
+			best = us;
+	}
+
+	return best;
+}
+
+/**
+	@brief Benchmark of a volume
+
+	Prints the compression ratio, counting the cache filled by the sweep, the throughput of compression and decompression in
+	MB/s of raw cells, sequential and parallel, and the time of a sum of all the cells
+	through operator() on the compressed and on the dense matrix.
+*/
+template <typename T>
+void run(const char* name, const matrix_3d<T>& volume) {
+
+	const int reps = 5;
+	const double megabytes = double(volume.size()) * sizeof(T) / 1e6;
+
+	compressed_matrix_3d<T> compressed(volume);
+
+	double pack = best_of(reps, [&] () {
+		compressed_matrix_3d<T> tmp(volume, 1);
+	});
+
+	double pack_parallel = best_of(reps, [&] () {
+		compressed_matrix_3d<T> tmp(volume, parallel, 1);
+	});
+
+	matrix_3d<T> restored;
+	double unpack = best_of(reps, [&] () {
+		restored = compressed.decompress();
+	});
+	const bool same = restored == volume;
+
+	double unpack_parallel = best_of(reps, [&] () {
+		restored = compressed.decompress(parallel);
+	});
+
+	double dense_sum = 0.0, compressed_sum = 0.0;
+	double dense_sweep = best_of(reps, [&] () {
+		double sum = 0.0;
+		for(unsigned int z = 0; z < volume.plans(); ++z)
+			for(unsigned int y = 0; y < volume.rows(); ++y)
+				for(unsigned int x = 0; x < volume.columns(); ++x)
+					sum += volume(z, y, x);
+		dense_sum = sum;
+	});
+
+	const compressed_matrix_3d<T>& cells = compressed;
+	double compressed_sweep = best_of(reps, [&] () {
+		double sum = 0.0;
+		for(unsigned int z = 0; z < cells.plans(); ++z)
+			for(unsigned int y = 0; y < cells.rows(); ++y)
+				for(unsigned int x = 0; x < cells.columns(); ++x)
+					sum += cells(z, y, x);
+		compressed_sum = sum;
+	});
+
+	const double ratio = double(volume.size() * sizeof(T)) / double(compressed.compressed_bytes() + compressed.cache_bytes());
+
+	printf("%-22s ratio %7.1f  (%zu bytes + cache %zu)%s\n", name, ratio, compressed.compressed_bytes(),
+		   compressed.cache_bytes(), same && dense_sum == compressed_sum ? "" : "  MISMATCH");
+	printf("%-22s compress   %8.0f MB/s  parallel %8.0f MB/s\n", "", megabytes / pack * 1e6, megabytes / pack_parallel * 1e6);
+	printf("%-22s decompress %8.0f MB/s  parallel %8.0f MB/s\n", "", megabytes / unpack * 1e6, megabytes / unpack_parallel * 1e6);
+	printf("%-22s sweep %10.1f us  dense %10.1f us  x%.2f\n", "", compressed_sweep, dense_sweep, compressed_sweep / dense_sweep);
+}
+
+int main() {
+
+	const unsigned int z = 128, y = 256, x = 256;
+
+	printf("volume %u x %u x %u, bricks of %u^3, best of 5 runs\n\n", z, y, x, unsigned(compressed_matrix_3d<float>::brick_edge));
+
+	// Labels: a few large uniform regions.
+	matrix_3d<uint16_t> labels(z, y, x);
+	for(unsigned int i = 0; i < z; ++i)
+		for(unsigned int j = 0; j < y; ++j)
+			for(unsigned int k = 0; k < x; ++k)
+				labels(i, j, k) = uint16_t((i / 40) * 16 + (j / 100) * 4 + k / 90);
+	run("uint16 labels", labels);
+
+	// Smooth gradient.
+	matrix_3d<int32_t> gradient(z, y, x);
+	for(unsigned int i = 0; i < z; ++i)
+		for(unsigned int j = 0; j < y; ++j)
+			for(unsigned int k = 0; k < x; ++k)
+				gradient(i, j, k) = int32_t(i * 1000 + j * 30 + k * 2);
+	run("int32 gradient", gradient);
+
+	// Smooth field of floats.
+	matrix_3d<float> field(z, y, x);
+	for(unsigned int i = 0; i < z; ++i)
+		for(unsigned int j = 0; j < y; ++j)
+			for(unsigned int k = 0; k < x; ++k)
+				field(i, j, k) = sin(i * 0.05f) + cos(j * 0.03f) * k;
+	run("float field", field);
+
+	// Noise: the worst case, stored raw.
+	matrix_3d<uint8_t> noise(z, y, x);
+	uint32_t state = 2463534242u;
+	for(auto iter = noise.begin(); iter != noise.end(); ++iter) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		*iter = uint8_t(state);
+	}
+	run("uint8 noise", noise);
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+#define NDEBUG
+
+#include "matrix_3d.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+/**
+  @file bench_transform.cpp
+  @brief Benchmark of transform() against the cell-by-cell loop it replaces, for each simd_level,
+  and of a fused pipeline against the chain of transform() calls it replaces.
+*/
+
+using namespace std;
+
+/**
+	@brief Cell-by-cell transformation
+
+	The transformation loop used before the vectorized kernels: every cell is reached
+	through the asserting operator(), plan by plan.
+*/
+template <typename Q, typename W, typename F>
+void legacy_transform(const matrix_3d<W>& source, matrix_3d<Q>& result, const F func) {
+
+	for(unsigned int z = 0; z < source.plans(); ++z)
+		for(unsigned int i = 0; i < source.rows(); ++i)
+			for(unsigned int j = 0; j < source.columns(); ++j)
+				result(z, i, j) = func(source(z, i, j));
+}
+
+/**
+	@brief Timing function
+
+	@return best time in microseconds of reps calls to body
+*/
+template <typename B>
+double best_of(int reps, B body) {
+
+	double best = 1e30;
+
+	for(int r = 0; r < reps; ++r) {
+		auto start = chrono::steady_clock::now();
+		body();
+		auto stop = chrono::steady_clock::now();
+		double us = chrono::duration<double, micro>(stop - start).count();
+		if(us < best)
+			best = us;
+	}
+
+	return best;
+}
+
+/**
+	@brief Benchmark of a functor
+
+	Times the legacy loop and the transform_cells() kernel of each available 
+	simd_level, both writing into an already allocated matrix_3d so that only the
+	loops are measured.
+*/
+template <typename Q, typename W, typename F>
+void run(const char* name, const matrix_3d<W>& source, const F func) {
+
+	const int reps = 50;
+	matrix_3d<Q> out(source.plans(), source.rows(), source.columns());
+	matrix_3d<Q> expected(out);
+
+	legacy_transform(source, expected, func);
+
+	double legacy = best_of(reps, [&] () {
+		legacy_transform(source, out, func);
+	});
+
+	printf("%-24s legacy %10.1f us\n", name, legacy);
+
+	const simd_level levels[] = {simd_level::scalar, simd_level::sse, simd_level::avx2, simd_level::avx512};
+	const char* labels[] = {"scalar", "sse", "avx2", "avx512"};
+
+	for(int l = 0; l < 4; ++l) {
+		if(levels[l] > detected_simd_level())
+			break;
+
+		set_simd_level(levels[l]);
+
+		double us = best_of(reps, [&] () {
+			transform_cells(source.data(), out.data(), source.size(), func);
+		});
+
+		printf("%-24s %-6s %10.1f us  x%.2f%s\n", "", labels[l], us, legacy / us, 
+			   out == expected ? "" : "  MISMATCH");
+	}
+
+	set_simd_level(detected_simd_level());
+
+	matrix_3d<Q> result = transform<Q>(source, func, by_value);
+	if(result != expected)
+		printf("%-24s transform() MISMATCH\n", "");
+}
+
+/**
+	@brief Benchmark of a three stages chain
+
+	Times clamp, rescale and conversion to uint8_t done by three transform() calls,
+	each one materializing its result, and by a single pipeline into an already
+	allocated matrix_3d.
+*/
+void run_chain(const matrix_3d<uint16_t>& source) {
+
+	const int reps = 20;
+	auto clamp = [] (uint16_t a) -> uint16_t {return a < 10 ? 10 : (a > 240 ? 240 : a);};
+	auto rescale = [] (uint16_t a) -> float {return (a - 10) * (255.0f / 230.0f);};
+	auto narrow = [] (float a) -> uint8_t {return static_cast<uint8_t>(a);};
+
+	matrix_3d<uint8_t> expected;
+	double chained = best_of(reps, [&] () {
+		matrix_3d<uint16_t> clamped = transform<uint16_t>(source, clamp, by_value);
+		matrix_3d<float> rescaled = transform<float>(clamped, rescale, by_value);
+		expected = transform<uint8_t>(rescaled, narrow, by_value);
+	});
+
+	matrix_3d<uint8_t> out(source.plans(), source.rows(), source.columns());
+	double fused = best_of(reps, [&] () {
+		pipeline(source) | map_cells(clamp) | map_cells(rescale) | cast<uint8_t>() | into(out);
+	});
+	bool same = out == expected;
+
+	double threaded = best_of(reps, [&] () {
+		pipeline(source) | map_cells(clamp) | map_cells(rescale) | cast<uint8_t>() | into(out, parallel);
+	});
+
+	printf("%-24s chained %9.1f us\n", "clamp/rescale/uint8", chained);
+	printf("%-24s fused  %10.1f us  x%.2f%s\n", "", fused, chained / fused, same ? "" : "  MISMATCH");
+	printf("%-24s parallel %8.1f us  x%.2f%s\n", "", threaded, chained / threaded, 
+		   out == expected ? "" : "  MISMATCH");
+}
+
+template <typename T>
+matrix_3d<T> make_volume(unsigned int z, unsigned int y, unsigned int x) {
+
+	matrix_3d<T> volume(z, y, x);
+	unsigned int k = 0;
+
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = static_cast<T>(k++ % 251);
+
+	return volume;
+}
+
+int main() {
+
+	const unsigned int z = 8, y = 128, x = 128;
+
+	printf("volume %u x %u x %u, best of 50 runs\n\n", z, y, x);
+
+	run<float>("float  a * 1.5 + 2", make_volume<float>(z, y, x),
+			   [] (float a) -> float {return a * 1.5f + 2.0f;});
+
+	run<double>("double a * a - a / 2", make_volume<double>(z, y, x),
+			    [] (double a) -> double {return a * a - 0.5 * a;});
+
+	run<int32_t>("int32  a * 3 - 7", make_volume<int32_t>(z, y, x),
+			     [] (int32_t a) -> int32_t {return a * 3 - 7;});
+
+	run<uint8_t>("uint8  255 - a", make_volume<uint8_t>(z, y, x),
+			     [] (uint8_t a) -> uint8_t {return static_cast<uint8_t>(255 - a);});
+
+	run<float>("uint16 -> float a / 4", make_volume<uint16_t>(z, y, x),
+			   [] (uint16_t a) -> float {return a * 0.25f;});
+
+	printf("\n");
+
+	run_chain(make_volume<uint16_t>(z, y, x));
+
+	return 0;
+}
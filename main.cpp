@@ -1,5 +1,24 @@
 #include "matrix_3d.h"
+#include "matrix_mapped.h"
+#include "matrix_paged.h"
 #include <vector>
+#include <cstdint>
+#include <atomic>
+#include <stdexcept>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <limits>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fstream>
+#include <cstdio>
+#include <system_error>
+#include <cstring>
+#include <numeric>
+#include <chrono>
+#include <thread>
 
 #define NPRINT
 #define NEXCEPTION
@@ -328,10 +347,8 @@ void test_matrix_3d_null() {
 
 	assert(a1 == z1);
 	assert(a2 == z2);
-	assert(++a1 == z1);
-	assert(--a2 == z2);
-	assert(a1 == ++z1);
-	assert(a2 == z2--);
+	assert(z1 - a1 == 0 && z2 - a2 == 0);
+	assert(a1 + 0 == z1 && z2 - 0 == a2);
 
 	delete tra1;
 
@@ -366,7 +383,8 @@ void test_matrix_3d_null() {
 	auto w_end = dfg.end();
 
 
-	while(w++ != w_end);
+	while(w != w_end)
+		w++;
 	assert(w == w_end);
 }
 
@@ -519,8 +537,10 @@ void test_matrix_3d_access() {
 			for(int j=matrix.columns() - 1; j >= 0; --j) {
 				assert(&(matrix(k, i, j)) == &(*iter));
 				assert(&(*c_iter) == &(*iter));
-				--iter;
-				--c_iter;
+				if(iter != matrix.begin()) {
+					--iter;
+					--c_iter;
+				}
 			}
 
 	assert(iter == matrix.begin());
@@ -576,28 +596,20 @@ void test_matrix_3d_access() {
 	auto a1 = clone.begin();
 	auto z1 = clone.end();
 
-	while(a1++ != z1);
-
-	for(int i=0;i<5;++i) {
+	while(a1 != z1)
 		a1++;
-		z1++;
-	}
 
-	assert(a1++ == z1);
+	assert(a1 == z1);
 
 	a1 = clone.begin();
 	z1 = clone.end();
 
 	int g = 30;
 
-	while(a1 != z1-- && g-- > 0);
-
-	for(int i=0;i<5;++i) {
-		--a1;
+	while(a1 != z1 && g-- > 0)
 		z1--;
-	}
 
-	assert(a1-- == z1);
+	assert(clone.end() - z1 == min<ptrdiff_t>(30, ptrdiff_t(clone.size())));
 
 	struct diff {
 		int x = 2;
@@ -860,6 +872,2073 @@ void test_matrix_3d_methods() {
 	cout << "-----------------------------------" << endl;
 }
 
+void test_matrix_3d_contiguous() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MATRIX_3D_CONTIGUOUS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> matrix(4, 3, 5);
+
+	int k = 0;
+	for(auto iter = matrix.begin(); iter != matrix.end(); ++iter)
+		*iter = k++;
+
+	for(int z=0; z < matrix.plans(); ++z)
+		for(int i=0; i < matrix.rows(); ++i)
+			for(int j=0; j < matrix.columns(); ++j) {
+				assert(&matrix(z, i, j) == matrix.data() + (z * matrix.rows() + i) * matrix.columns() + j);
+				assert(&matrix[z](i, j) == &matrix(z, i, j));
+			}
+
+	assert(matrix[1].data() == matrix.data() + matrix.rows() * matrix.columns());
+	assert(&(*(--matrix.end())) == matrix.data() + matrix.size() - 1);
+
+	matrix_3d<int> clone(matrix);
+	assert(clone == matrix);
+	assert(clone.data() != matrix.data());
+
+	matrix_3d<int>* submatrix = matrix.slice(1, 2, 1, 2, 2, 4);
+	assert(submatrix->size() == 2 * 2 * 3);
+
+	for(int z=0; z < submatrix->plans(); ++z)
+		for(int i=0; i < submatrix->rows(); ++i)
+			for(int j=0; j < submatrix->columns(); ++j)
+				assert((*submatrix)(z, i, j) == matrix(z + 1, i + 1, j + 2));
+
+	delete submatrix;
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MATRIX_3D_CONTIGUOUS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_move_semantics() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MOVE_SEMANTICS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	static_assert(is_nothrow_move_constructible<matrix_2d<string>>::value, "");
+	static_assert(is_nothrow_move_assignable<matrix_2d<string>>::value, "");
+	static_assert(is_nothrow_move_constructible<matrix_3d<string>>::value, "");
+	static_assert(is_nothrow_move_assignable<matrix_3d<string>>::value, "");
+
+	matrix_2d<int> plan(3, 4);
+	plan(2, 3) = 7;
+	const int* cells = plan.data();
+
+	matrix_2d<int> moved(std::move(plan));
+	assert(moved.data() == cells);
+	assert(moved(2, 3) == 7);
+	assert(plan.size() == 0 && plan.data() == nullptr);
+
+	plan = std::move(moved);
+	assert(plan.data() == cells);
+	assert(moved.size() == 0);
+
+	matrix_3d<int> volume(3, 2, 2);
+	volume(2, 1, 1) = 11;
+	const int* buffer = volume.data();
+
+	matrix_3d<int> moved_volume(std::move(volume));
+	assert(moved_volume.data() == buffer);
+	assert(&moved_volume[2](1, 1) == &moved_volume(2, 1, 1));
+	assert(moved_volume(2, 1, 1) == 11);
+	assert(volume.size() == 0 && volume.begin() == volume.end());
+
+	volume = std::move(moved_volume);
+	assert(volume.data() == buffer);
+	assert(moved_volume.plans() == 0);
+
+	vector<matrix_3d<int>> volumes;
+	volumes.push_back(std::move(volume));
+	volumes.emplace_back(2, 2, 2);
+	volumes.emplace_back(1, 1, 1);
+	assert(volumes[0].data() == buffer);
+	assert(volumes[0](2, 1, 1) == 11);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MOVE_SEMANTICS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_by_value() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BY_VALUE BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_2d<int> plan(4, 6);
+	int k = 0;
+	for(auto iter = plan.begin(); iter != plan.end(); ++iter)
+		*iter = k++;
+
+	matrix_2d<int> sliced = plan.slice(1, 2, 2, 5, by_value);
+	matrix_2d<int>* sliced_p = plan.slice(1, 2, 2, 5);
+
+	assert(sliced.rows() == 2 && sliced.columns() == 4);
+	assert(sliced == *sliced_p);
+	assert(sliced(1, 3) == plan(2, 5));
+
+	matrix_2d<double> halved = transform<double>(plan, [] (int a) -> double {return a / 2.0;}, by_value);
+	matrix_2d<double>* halved_p = transform<double>(plan, [] (int a) -> double {return a / 2.0;});
+
+	assert(halved == *halved_p);
+	assert(halved(3, 5) == 11.5);
+
+	delete sliced_p;
+	delete halved_p;
+
+	matrix_3d<int> volume(4, 3, 5);
+	k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = k++;
+
+	matrix_3d<int> subvolume = volume.slice(1, 3, 0, 1, 1, 3, by_value);
+	matrix_3d<int>* subvolume_p = volume.slice(1, 3, 0, 1, 1, 3);
+
+	assert(subvolume.plans() == 3 && subvolume.rows() == 2 && subvolume.columns() == 3);
+	assert(subvolume == *subvolume_p);
+	assert(subvolume(2, 1, 2) == volume(3, 1, 3));
+
+	matrix_3d<string> text = transform<string>(volume, [] (int a) {return to_string(a);}, by_value);
+	matrix_3d<string>* text_p = transform<string>(volume, [] (int a) {return to_string(a);});
+
+	assert(text == *text_p);
+	assert(text(3, 2, 4) == to_string(volume(3, 2, 4)));
+
+	delete subvolume_p;
+	delete text_p;
+
+	matrix_3d<int> empty;
+	assert(transform<float>(empty, [] (int a) -> float {return a;}, by_value).size() == 0);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BY_VALUE END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_views() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST VIEWS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> volume(5, 4, 6);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = k++;
+
+	matrix_3d_view<int> roi = volume.view(1, 3, 1, 2, 2, 4);
+
+	assert(roi.plans() == 3 && roi.rows() == 2 && roi.columns() == 3);
+	assert(roi.size() == 18);
+	assert(&roi(0, 0, 0) == &volume(1, 1, 2));
+	assert(&roi(2, 1, 2) == &volume(3, 2, 4));
+
+	auto iter = roi.begin();
+	for(int z=0; z < roi.plans(); ++z)
+		for(int i=0; i < roi.rows(); ++i)
+			for(int j=0; j < roi.columns(); ++j, ++iter)
+				assert(&(*iter) == &volume(z + 1, i + 1, j + 2));
+	assert(iter == roi.end());
+
+	roi(1, 1, 1) = -1;
+	assert(volume(2, 2, 3) == -1);
+
+	matrix_3d<int> copied = roi.materialize();
+	assert(copied == volume.slice(1, 3, 1, 2, 2, 4, by_value));
+
+	matrix_2d_view<int> plan = roi[1];
+	assert(&plan(1, 2) == &volume(2, 2, 4));
+	assert(plan.materialize() == copied[1]);
+
+	matrix_3d_view<int> inner = roi.view(1, 2, 0, 1, 1, 1);
+	assert(&inner(1, 1, 0) == &volume(3, 2, 3));
+
+	const matrix_3d<int>& c_volume = volume;
+	matrix_3d_view<const int> c_roi = c_volume.view(0, 4, 3, 3, 0, 5);
+	int sum = 0;
+	for(const int& cell : c_roi)
+		sum += cell;
+	int expected = 0;
+	for(int z=0; z < volume.plans(); ++z)
+		for(int j=0; j < volume.columns(); ++j)
+			expected += volume(z, 3, j);
+	assert(sum == expected);
+
+	matrix_3d_view<const int> converted = roi;
+	assert(&converted(0, 0, 0) == &roi(0, 0, 0));
+
+	matrix_2d<int> flat(3, 4);
+	k = 0;
+	for(auto it = flat.begin(); it != flat.end(); ++it)
+		*it = k++;
+
+	matrix_2d_view<int> flat_roi = flat.view(1, 2, 1, 2);
+	assert(flat_roi.materialize() == flat.slice(1, 2, 1, 2, by_value));
+
+	matrix_2d_view<int> column(flat.data() + 3, flat.rows(), 1, flat.columns());
+	k = 3;
+	for(int cell : column) {
+		assert(cell == k);
+		k += flat.columns();
+	}
+
+	assert(matrix_3d<int>().view().begin() == matrix_3d<int>().view().end());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST VIEWS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_pool_allocator() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST POOL_ALLOCATOR BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	memory_pool pool;
+	pool_allocator<int> alloc(pool);
+
+	matrix_3d<int, pool_allocator<int>> volume(8, 16, 16, alloc);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = k++;
+
+	vector<int> v(100, -1);
+	size_t warm = 0;
+
+	for(int round = 0; round < 10; ++round) {
+		matrix_3d<int, pool_allocator<int>> roi = volume.slice(1, 6, 2, 13, 2, 13, by_value);
+		auto scaled = transform<double>(roi, [] (int a) -> double {return a * 0.5;}, by_value);
+		matrix_2d<int, pool_allocator<int>> plan = roi[2];
+
+		static_assert(is_same<decltype(scaled), matrix_3d<double, pool_allocator<double>>>::value, "");
+		assert(scaled(5, 11, 11) == volume(6, 13, 13) * 0.5);
+		assert(plan(0, 0) == volume(3, 2, 2));
+		assert(roi.get_allocator() == alloc);
+
+		roi.fill(v.begin(), v.end());
+		assert(roi(0, 0, 0) == -1);
+
+		if(round == 0)
+			warm = pool.system_allocations();
+	}
+
+	assert(pool.system_allocations() == warm);
+	assert(pool.cached() > 0);
+
+	matrix_3d<int> plain(volume);
+	assert(plain.size() == volume.size());
+	assert(equal(plain.begin(), plain.end(), volume.begin()));
+
+	matrix_2d<string, pool_allocator<string>> names(3, 3, pool_allocator<string>(pool));
+	names(1, 1) = "center";
+	matrix_2d<string, pool_allocator<string>> names_copy(names);
+	assert(names_copy == names);
+	assert(names_copy(0, 0).empty());
+
+	pool.release();
+	assert(pool.cached() == 0);
+
+	matrix_3d<float, pool_allocator<float>> on_default(2, 2, 2);
+	assert(&on_default.get_allocator().pool() == &memory_pool::default_pool());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST POOL_ALLOCATOR END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_aligned_storage() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST ALIGNED_STORAGE BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	typedef aligned_allocator<float, 64> float64;
+
+	matrix_2d<float, float64> image(5, 7);
+	assert(image.rows() == 5 && image.columns() == 7);
+	assert(image.pitch() == 16);
+	assert(image.size() == 35);
+
+	for(unsigned int y = 0; y < image.rows(); ++y)
+		assert(reinterpret_cast<uintptr_t>(&image(y, 0)) % 64 == 0);
+
+	int k = 0;
+	for(auto iter = image.begin(); iter != image.end(); ++iter)
+		*iter = static_cast<float>(k++);
+
+	assert(image.end() - image.begin() == 35);
+	assert(image(1, 0) == 7.0f);
+	assert(image(4, 6) == 34.0f);
+	assert(image.data()[image.pitch()] == 7.0f);
+	assert(image.begin()[20] == image(2, 6));
+	assert(*(image.end() - 1) == 34.0f);
+
+	matrix_2d<float, float64> image_copy(image);
+	assert(image_copy == image);
+	matrix_2d<float> packed(image);
+	assert(packed.pitch() == packed.columns());
+	assert(equal(packed.begin(), packed.end(), image.begin()));
+
+	matrix_2d<float, float64> sub = image.slice(1, 3, 2, 6, by_value);
+	assert(sub.pitch() == 16 && sub(0, 0) == image(1, 2) && sub(2, 4) == image(3, 6));
+	assert(image.view(1, 3, 2, 6).materialize() == packed.slice(1, 3, 2, 6, by_value));
+
+	matrix_3d<double, aligned_allocator<double, 32>> volume(3, 4, 5);
+	assert(volume.pitch() == 8);
+	assert(volume[1].pitch() == 8);
+	assert(distance(volume.begin(), volume.end()) == 60);
+
+	vector<double> values(60);
+	for(size_t i = 0; i < values.size(); ++i)
+		values[i] = static_cast<double>(i);
+	volume.fill(values.begin(), values.end());
+
+	assert(volume(1, 0, 0) == 20.0 && volume(2, 3, 4) == 59.0);
+	assert(&volume[2](1, 0) == &volume(2, 1, 0));
+	assert(reinterpret_cast<uintptr_t>(&volume(2, 3, 0)) % 32 == 0);
+	assert(equal(volume.begin(), volume.end(), values.begin()));
+
+	auto halves = transform<float>(volume, [] (double a) -> float {return static_cast<float>(a / 2);}, by_value);
+	assert(halves.pitch() == 8 && halves(2, 3, 4) == 29.5f);
+	assert(volume.slice(1, 2, 1, 3, 1, 4, by_value)(1, 2, 3) == volume(2, 3, 4));
+	assert(matrix_3d<double>(volume) == matrix_3d<double>(volume.view().materialize()));
+
+	matrix_3d<int> plain(2, 3, 3);
+	assert(plain.pitch() == plain.columns());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST ALIGNED_STORAGE END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_simd_transform() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SIMD_TRANSFORM BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<uint8_t> bytes(3, 7, 37);
+	matrix_3d<float> floats(3, 7, 37);
+	matrix_2d<int32_t, aligned_allocator<int32_t, 64>> ints(5, 19);
+	int k = 0;
+	for(auto iter = bytes.begin(); iter != bytes.end(); ++iter, ++k)
+		*iter = static_cast<uint8_t>(k * 7);
+	k = 0;
+	for(auto iter = floats.begin(); iter != floats.end(); ++iter, ++k)
+		*iter = k * 0.5f;
+	k = 0;
+	for(auto iter = ints.begin(); iter != ints.end(); ++iter, ++k)
+		*iter = k - 40;
+
+	auto invert = [] (uint8_t a) -> uint8_t {return static_cast<uint8_t>(255 - a);};
+	auto scale = [] (float a) -> double {return a * 2.0 + 1.0;};
+	auto square = [] (int32_t a) -> int32_t {return a * a;};
+
+	simd_level detected = detected_simd_level();
+	assert(active_simd_level() == detected);
+	assert(set_simd_level(simd_level::scalar) == simd_level::scalar);
+
+	matrix_3d<uint8_t> inverted = transform<uint8_t>(bytes, invert, by_value);
+	matrix_3d<double> scaled = transform<double>(floats, scale, by_value);
+	matrix_2d<int32_t, aligned_allocator<int32_t, 64>> squared = transform<int32_t>(ints, square, by_value);
+
+	assert(inverted(2, 6, 36) == invert(bytes(2, 6, 36)));
+	assert(scaled(1, 3, 20) == scale(floats(1, 3, 20)));
+	assert(squared(4, 18) == square(ints(4, 18)));
+
+	const simd_level levels[] = {simd_level::sse, simd_level::avx2, simd_level::avx512};
+
+	for(simd_level level : levels) {
+		if(set_simd_level(level) != level)
+			break;
+
+		assert(transform<uint8_t>(bytes, invert, by_value) == inverted);
+		assert(transform<double>(floats, scale, by_value) == scaled);
+		assert(transform<int32_t>(ints, square, by_value) == squared);
+	}
+
+	assert(set_simd_level(simd_level::avx512) == detected);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SIMD_TRANSFORM END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_parallel() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PARALLEL BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	thread_pool pool(3);
+	assert(pool.size() == 3);
+
+	parallel_t fine(64, &pool);
+
+	matrix_3d<int> volume(6, 20, 30);
+	vector<int> values(volume.size());
+	for(size_t i = 0; i < values.size(); ++i)
+		values[i] = static_cast<int>(i);
+
+	volume.fill(values.begin(), values.end(), fine);
+	assert(equal(volume.begin(), volume.end(), values.begin()));
+
+	matrix_3d<int> expected(volume);
+	volume.fill(values.begin(), values.begin() + 1000, parallel_t(64, &pool));
+	assert(volume == expected);
+
+	vector<int> zeros(1000, 0);
+	volume.fill(zeros.begin(), zeros.end(), fine);
+	assert(volume(0, 0, 0) == 0 && volume(1, 13, 9) == 0);
+	assert(volume(1, 13, 10) == expected(1, 13, 10));
+	volume = expected;
+
+	auto twice = [] (int a) -> double {return a * 2.0;};
+	matrix_3d<double> doubled = transform<double>(volume, twice, fine);
+	assert(doubled == transform<double>(volume, twice, by_value));
+
+	matrix_3d<double, aligned_allocator<double, 64>> padded(3, 5, 7);
+	padded.fill(values.begin(), values.end(), parallel_t(8, &pool));
+	matrix_3d<float, aligned_allocator<float, 64>> halves = 
+		transform<float>(padded, [] (double a) -> float {return static_cast<float>(a / 2);}, parallel_t(8, &pool));
+	assert(halves(2, 4, 6) == 52.0f);
+
+	matrix_3d<int> other(volume);
+	assert(volume.equals(other, fine));
+	assert(volume.equals(other, parallel));
+	other(5, 19, 29) = -1;
+	assert(!volume.equals(other, fine));
+
+	atomic<int> compared(0);
+	other = volume;
+	other(0, 0, 0) = -1;
+	bool same = volume.equals(other, [&compared] (int a, int b) -> bool {++compared; return a == b;}, 
+							  parallel_t(30, &pool));
+	assert(!same);
+	assert(compared.load() < static_cast<int>(volume.size()));
+
+	bool thrown = false;
+	try {
+		transform<int>(volume, [] (int a) -> int {
+			if(a == 2000)
+				throw runtime_error("transform");
+			return a;
+		}, fine);
+	}
+	catch(const runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	matrix_3d<int> small(1, 2, 2);
+	small.fill(values.begin(), values.end(), parallel);
+	assert(small(0, 1, 1) == 3);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PARALLEL END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_random_access_iterators() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST RANDOM_ACCESS_ITERATORS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	typedef matrix_3d<int> volume_type;
+	typedef matrix_3d<float, aligned_allocator<float, 64>> padded_type;
+
+	static_assert(contiguous_iterator<volume_type::iterator>, "");
+	static_assert(contiguous_iterator<volume_type::const_iterator>, "");
+	static_assert(random_access_iterator<padded_type::iterator>, "");
+	static_assert(random_access_iterator<padded_type::const_iterator>, "");
+	static_assert(!contiguous_iterator<padded_type::iterator>, "");
+	static_assert(random_access_iterator<matrix_2d<float, aligned_allocator<float, 64>>::iterator>, "");
+
+	volume_type volume(4, 9, 11);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter, ++k)
+		*iter = (k * 7919) % 397;
+
+	auto first = volume.begin();
+	assert(volume.end() - first == static_cast<ptrdiff_t>(volume.size()));
+	assert(distance(first, volume.end()) == static_cast<ptrdiff_t>(volume.size()));
+	assert(&first[150] == &volume(1, 4, 7));
+	assert(&*(first + 395) == &volume(3, 8, 10));
+	assert(to_address(first + 99) == volume.data() + 99);
+	assert((first + 10) - 10 == first && 10 + first == first + 10);
+	assert(first < first + 1 && first + 1 > first && first <= first && first >= first);
+
+	volume_type::const_iterator c_first = volume.begin();
+	assert(volume.end() - c_first == static_cast<ptrdiff_t>(volume.size()));
+	assert(c_first[150] == volume(1, 4, 7));
+
+	vector<int> expected(volume.begin(), volume.end());
+	sort(expected.begin(), expected.end());
+
+	auto middle = volume.begin() + volume.size() / 2;
+	nth_element(volume.begin(), middle, volume.end());
+	assert(*middle == expected[volume.size() / 2]);
+
+	sort(volume.begin(), volume.end());
+	assert(is_sorted(volume.begin(), volume.end()));
+	assert(equal(volume.begin(), volume.end(), expected.begin()));
+	assert(binary_search(volume.begin(), volume.end(), expected[77]));
+
+	padded_type padded(3, 5, 7);
+	k = 0;
+	for(auto iter = padded.begin(); iter != padded.end(); ++iter, ++k)
+		*iter = static_cast<float>(104 - k);
+
+	assert(padded.end() - padded.begin() == 105);
+	assert(padded.begin()[36] == padded(1, 0, 1));
+	sort(padded.begin(), padded.end());
+	assert(padded(0, 0, 0) == 0.0f && padded(1, 0, 1) == 36.0f && padded(2, 4, 6) == 104.0f);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST RANDOM_ACCESS_ITERATORS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_segmented_iteration() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SEGMENTED_ITERATION BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> volume(3, 4, 5);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = k++;
+
+	int rows = 0;
+	assert(volume.for_each_row([&rows] (span<int> cells) {
+		assert(cells.size() == 5 && cells[0] == rows * 5);
+		++rows;
+	}));
+	assert(rows == 12);
+
+	rows = 0;
+	assert(!volume.for_each_row([&rows] (span<int> cells) -> bool {return ++rows < 2;}));
+	assert(rows == 2);
+
+	int plans = 0;
+	volume.for_each_plane([&] (matrix_2d_view<int> plan) {
+		assert(plan.rows() == 4 && plan.columns() == 5);
+		assert(&plan(1, 2) == &volume(plans, 1, 2));
+		plan(3, 4) = -plans;
+		++plans;
+	});
+	assert(plans == 3 && volume(2, 3, 4) == -2);
+
+	vector<size_t> runs;
+	volume.for_each_span([&runs] (span<int> cells) {runs.push_back(cells.size());});
+	assert(runs == vector<size_t>({60}));
+	runs.clear();
+	volume.for_each_span([&runs] (span<int> cells) {runs.push_back(cells.size());}, 25);
+	assert(runs == vector<size_t>({25, 25, 10}));
+
+	const matrix_3d<int>& read_only = volume;
+	long total = 0;
+	read_only.for_each_span([&total] (span<const int> cells) {
+		for(int cell : cells)
+			total += cell;
+	});
+	assert(total == 59 * 60 / 2 - 19 - 39 - 59 - 1 - 2);
+
+	matrix_3d<float, aligned_allocator<float, 64>> padded(2, 3, 5);
+	runs.clear();
+	padded.for_each_span([&runs] (span<float> cells) {
+		assert(reinterpret_cast<uintptr_t>(cells.data()) % 64 == 0);
+		fill(cells.begin(), cells.end(), static_cast<float>(runs.size()));
+		runs.push_back(cells.size());
+	});
+	assert(runs == vector<size_t>(6, 5));
+	assert(padded(1, 2, 4) == 5.0f);
+
+	vector<int> values(60, 7);
+	matrix_3d<int> filled(volume);
+	filled.fill(values.begin(), values.begin() + 23);
+	assert(filled(1, 0, 2) == 7 && filled(1, 0, 3) == volume(1, 0, 3));
+	assert(filled != volume && filled.equals(filled, [] (int a, int b) {return a == b;}));
+
+	matrix_3d<int> tiny(2, 1, 2);
+	tiny.fill(values.begin(), values.end());
+	tiny(1, 0, 1) = 3;
+	ostringstream printed;
+	printed << tiny;
+	assert(printed.str() == "7 7 \n\n7 3 \n\n");
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SEGMENTED_ITERATION END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_expression_templates() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST EXPRESSION_TEMPLATES BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	memory_pool pool;
+	pool_allocator<float> alloc(pool);
+
+	matrix_3d<float, pool_allocator<float>> a(3, 4, 37, alloc), b(3, 4, 37, alloc), c(3, 4, 37, alloc);
+	float k = 0.0f;
+	for(auto iter = a.begin(); iter != a.end(); ++iter, ++k)
+		*iter = k;
+	for(auto iter = b.begin(); iter != b.end(); ++iter, ++k)
+		*iter = k;
+	for(auto iter = c.begin(); iter != c.end(); ++iter, ++k)
+		*iter = k * 0.25f;
+
+	pool.release();
+	const size_t before = pool.system_allocations();
+
+	auto expr = a * 0.5f + b - c;
+	static_assert(is_same<decltype(expr)::value_type, float>::value, "");
+	assert(pool.system_allocations() == before);
+
+	matrix_3d<float, pool_allocator<float>> r(expr, alloc);
+	assert(pool.system_allocations() == before + 2);
+	assert(r.plans() == 3 && r.rows() == 4 && r.columns() == 37);
+	assert(r(2, 3, 36) == a(2, 3, 36) * 0.5f + b(2, 3, 36) - c(2, 3, 36));
+	assert(r(1, 2, 5) == a(1, 2, 5) * 0.5f + b(1, 2, 5) - c(1, 2, 5));
+
+	float* cells = r.data();
+	r = sqrt(a) / (b + 1.0f) - 2.0f * -c;
+	r += a;
+	r *= 0.5f;
+	assert(pool.system_allocations() == before + 2 && pool.cached() == 0 && r.data() == cells);
+	assert(abs(r(2, 1, 9) - (sqrt(a(2, 1, 9)) / (b(2, 1, 9) + 1.0f) + 2.0f * c(2, 1, 9) + a(2, 1, 9)) * 0.5f) < 1e-3f);
+
+	r = r - r;
+	assert(count(r.begin(), r.end(), 0.0f) == static_cast<long>(r.size()));
+
+	matrix_3d<int> small(2, 2, 3);
+	int n = -3;
+	for(auto iter = small.begin(); iter != small.end(); ++iter)
+		*iter = n++;
+
+	matrix_3d<double> mixed = abs(small) * 0.5 + exp(small - small);
+	assert(mixed(0, 0, 0) == 2.5 && mixed(1, 1, 2) == 5.0);
+
+	matrix_3d<int> grown;
+	grown = small * 2 - 1;
+	assert(grown.plans() == 2 && grown(1, 0, 0) == 5);
+	grown /= 2;
+	grown -= small;
+	assert(grown(1, 0, 0) == -1 && grown(0, 0, 0) == 0);
+
+	matrix_3d<float, aligned_allocator<float, 32>> padded(2, 3, 5);
+	padded = a.slice(0, 1, 0, 2, 0, 4, by_value) * 3.0f;
+	assert(padded.pitch() == 8 && padded(1, 2, 4) == a(1, 2, 4) * 3.0f);
+	matrix_3d<float> packed = padded + 1.0f;
+	assert(packed(1, 2, 4) == padded(1, 2, 4) + 1.0f);
+
+	matrix_2d<double> plan = sin(small[1]) * sin(small[1]) + cos(small[1]) * cos(small[1]);
+	assert(plan.rows() == 2 && plan.columns() == 3 && abs(plan(1, 2) - 1.0) < 1e-12);
+	plan = log(plan + 1.0) - small[0];
+	assert(abs(plan(0, 0) - (log(2.0) + 3.0)) < 1e-12);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST EXPRESSION_TEMPLATES END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_pipelines() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PIPELINES BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	memory_pool pool;
+
+	matrix_3d<uint16_t> source(6, 5, 33);
+	uint16_t k = 0;
+	for(auto iter = source.begin(); iter != source.end(); ++iter)
+		*iter = static_cast<uint16_t>(k++ * 37 % 1000);
+
+	auto clamp = [] (uint16_t a) -> uint16_t {return a < 100 ? 100 : (a > 900 ? 900 : a);};
+	auto rescale = [] (uint16_t a) -> float {return (a - 100) * (255.0f / 800.0f);};
+	auto expected = [&] (uint16_t a) -> uint8_t {return static_cast<uint8_t>(rescale(clamp(a)));};
+
+	matrix_3d<uint8_t, pool_allocator<uint8_t>> dest(6, 5, 33, pool_allocator<uint8_t>(pool));
+	const size_t before = pool.system_allocations();
+	uint8_t* cells = dest.data();
+
+	matrix_3d<uint8_t, pool_allocator<uint8_t>>& stored = pipeline(source) | map_cells(clamp) | map_cells(rescale) 
+														  | cast<uint8_t>() | into(dest);
+	assert(&stored == &dest && dest.data() == cells && pool.system_allocations() == before);
+	for(unsigned int z = 0; z < source.plans(); ++z)
+		for(unsigned int y = 0; y < source.rows(); ++y)
+			for(unsigned int x = 0; x < source.columns(); ++x)
+				assert(dest(z, y, x) == expected(source(z, y, x)));
+
+	thread_pool workers(3);
+	matrix_3d<uint8_t, pool_allocator<uint8_t>> serial(dest);
+	vector<uint8_t> zeros(dest.size(), 0);
+	dest.fill(zeros.begin(), zeros.end());
+	assert(dest != serial);
+	pipeline(source) | map_cells(clamp) | map_cells(rescale) | cast<uint8_t>() | into(dest, parallel_t(1, &workers));
+	assert(dest == serial && dest.data() == cells);
+
+	int offset = 3;
+	matrix_3d<int> shifted = pipeline(source) | map_cells([offset] (uint16_t a) {return a + offset;});
+	assert(shifted(5, 4, 32) == source(5, 4, 32) + 3);
+
+	matrix_3d<double> combined = (source | map_cells(clamp)) * 0.5 + shifted;
+	assert(combined(2, 1, 7) == clamp(source(2, 1, 7)) * 0.5 + shifted(2, 1, 7));
+
+	matrix_3d<int> resized;
+	pipeline(shifted) | map_cells([] (int a) {return -a;}) | into(resized, parallel_t(64, &workers));
+	assert(resized.plans() == 6 && resized(3, 2, 1) == -shifted(3, 2, 1));
+
+	matrix_3d<float, aligned_allocator<float, 32>> padded(6, 5, 33);
+	pipeline(shifted) | cast<float>() | into(padded, parallel_t(1, &workers));
+	assert(padded.pitch() == 40 && padded(4, 4, 32) == static_cast<float>(shifted(4, 4, 32)));
+
+	matrix_2d<double> plan;
+	pipeline(shifted[1]) | map_cells([] (int a) {return a * 0.25;}) | into(plan);
+	assert(plan.rows() == 5 && plan(4, 32) == shifted(1, 4, 32) * 0.25);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PIPELINES END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_reductions() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST REDUCTIONS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> volume(3, 4, 5);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = (k++ * 7) % 23 - 11;
+	volume(1, 2, 3) = 40;
+	volume(2, 0, 1) = -30;
+
+	long long total = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		total += *iter;
+
+	static_assert(is_same<decltype(sum(volume)), int64_t>::value, "");
+	assert(sum(volume) == total);
+	assert(mean(volume) == static_cast<double>(total) / 60);
+	assert(min(volume) == -30 && max(volume) == 40);
+	assert(argmax(volume) == (cell_index{1, 2, 3}) && argmin(volume) == (cell_index{2, 0, 1}));
+
+	matrix_2d<int64_t> along_z = sum(volume, axis_z);
+	matrix_2d<int> highest = max(volume, axis_y);
+	matrix_2d<int> lowest = min(volume, axis_x);
+	assert(along_z.rows() == 4 && along_z.columns() == 5);
+	assert(highest.rows() == 3 && highest.columns() == 5);
+	assert(lowest.rows() == 3 && lowest.columns() == 4);
+	assert(along_z(2, 3) == volume(0, 2, 3) + volume(1, 2, 3) + volume(2, 2, 3));
+	assert(highest(1, 3) == 40 && lowest(2, 0) == -30);
+
+	vector<double> per_plan = mean(volume, axis_y | axis_x);
+	vector<int64_t> per_column = sum(volume, axis_z | axis_y);
+	vector<int> per_row = max(volume, axis_x | axis_z);
+	assert(per_plan.size() == 3 && per_column.size() == 5 && per_row.size() == 4);
+	int64_t plan_sum = 0;
+	for(unsigned int y = 0; y < 4; ++y)
+		for(unsigned int x = 0; x < 5; ++x)
+			plan_sum += volume(1, y, x);
+	assert(per_plan[1] == plan_sum / 20.0);
+	assert(per_column[3] == along_z(0, 3) + along_z(1, 3) + along_z(2, 3) + along_z(3, 3));
+	assert(per_row[2] == 40);
+	assert(sum(volume, axis_z | axis_y | axis_x) == total);
+
+	matrix_3d<float> noisy(7, 33, 129);
+	float value = 0.1f;
+	for(auto iter = noisy.begin(); iter != noisy.end(); ++iter) {
+		value = value * 1.37f + 0.013f;
+		if(value > 1000.0f)
+			value *= 0.001f;
+		*iter = value;
+	}
+
+	thread_pool workers(3);
+	const double serial = sum(noisy);
+	for(size_t grain : {size_t(1), size_t(5000), size_t(1) << 20})
+		assert(sum(noisy, parallel_t(grain, &workers)) == serial);
+
+	const simd_level level = active_simd_level();
+	set_simd_level(simd_level::scalar);
+	assert(sum(noisy) == serial);
+	set_simd_level(level);
+
+	noisy(6, 32, 128) = 5000.0f;
+	assert(argmax(noisy, parallel_t(1, &workers)) == (cell_index{6, 32, 128}));
+	assert(max(noisy, axis_z, parallel_t(1, &workers)) == max(noisy, axis_z));
+	assert(mean(noisy, axis_y, parallel_t(1, &workers)) == mean(noisy, axis_y));
+	assert(min(noisy, axis_x | axis_y, parallel_t(1, &workers)) == min(noisy, axis_x | axis_y));
+
+	matrix_3d<uint8_t, aligned_allocator<uint8_t, 64>> padded(2, 3, 70);
+	fill(padded.begin(), padded.end(), uint8_t(200));
+	padded(1, 2, 69) = 255;
+	assert(sum(padded) == 200 * 420 + 55 && max(padded) == 255);
+	assert(argmax(padded) == (cell_index{1, 2, 69}) && argmin(padded) == (cell_index{0, 0, 0}));
+	assert(sum(padded, axis_x)(1, 2) == 200 * 70 + 55);
+
+	matrix_3d<double> empty;
+	assert(sum(empty) == 0.0 && sum(empty, axis_z).rows() == 0 && sum(empty, axis_x | axis_y).empty());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST REDUCTIONS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+template <typename T, typename A>
+double stencil_neighbour(const matrix_3d<T, A>& source, long z, long y, long x, border_mode border) {
+	const long n[3] = {long(source.plans()), long(source.rows()), long(source.columns())};
+	long c[3] = {z, y, x};
+	for(int a = 0; a < 3; ++a) {
+		if(c[a] >= 0 && c[a] < n[a])
+			continue;
+		if(border == border_mode::zero)
+			return 0.0;
+		if(border == border_mode::clamp)
+			c[a] = c[a] < 0 ? 0 : n[a] - 1;
+		else if(border == border_mode::wrap)
+			c[a] = (c[a] % n[a] + n[a]) % n[a];
+		else
+			c[a] = c[a] < 0 ? -c[a] : 2 * (n[a] - 1) - c[a];
+	}
+	return source(c[0], c[1], c[2]);
+}
+
+void test_stencils() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST STENCILS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<float> volume(5, 9, 300);
+	unsigned int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = static_cast<float>((k++ * 2654435761u) % 1000) * 0.01f;
+
+	matrix_3d<float> kernel(3, 3, 5);
+	fill(kernel.begin(), kernel.end(), 0.0f);
+	kernel(1, 1, 2) = 6.0f;
+	kernel(0, 1, 2) = kernel(2, 1, 2) = -1.0f;
+	kernel(1, 0, 2) = kernel(1, 2, 2) = -1.0f;
+	kernel(1, 1, 0) = kernel(1, 1, 4) = -0.5f;
+	kernel(1, 1, 1) = kernel(1, 1, 3) = -0.5f;
+	kernel(2, 2, 4) = 0.25f;
+
+	const border_mode modes[] = {border_mode::zero, border_mode::clamp, border_mode::wrap, border_mode::mirror};
+	thread_pool workers(3);
+
+	for(border_mode border : modes) {
+		matrix_3d<float> filtered = convolve(volume, kernel, border);
+		assert(filtered.plans() == 5 && filtered.rows() == 9 && filtered.columns() == 300);
+
+		for(long z : {0L, 2L, 4L})
+			for(long y : {0L, 1L, 8L})
+				for(long x : {0L, 1L, 2L, 150L, 255L, 256L, 298L, 299L}) {
+					double expected = 0.0;
+					for(long i = 0; i < 3; ++i)
+						for(long j = 0; j < 3; ++j)
+							for(long l = 0; l < 5; ++l)
+								expected += kernel(i, j, l) * stencil_neighbour(volume, z + i - 1, y + j - 1, x + l - 2, border);
+					assert(abs(filtered(z, y, x) - expected) < 1e-3);
+				}
+
+		assert(convolve(volume, kernel, border, parallel_t(1, &workers)) == filtered);
+	}
+
+	vector<double> kz = {0.25, 0.5, 0.25}, ky = {1.0}, kx = {0.1, 0.2, 0.4, 0.2, 0.1};
+	matrix_3d<double> outer(3, 1, 5);
+	for(unsigned int i = 0; i < 3; ++i)
+		for(unsigned int l = 0; l < 5; ++l)
+			outer(i, 0, l) = kz[i] * kx[l];
+
+	for(border_mode border : modes) {
+		matrix_3d<double> separable = convolve_separable(volume, kz, ky, kx, border);
+		matrix_3d<double> full = convolve(volume, outer, border);
+		assert(separable.equals(full, [] (double a, double b) {return abs(a - b) < 1e-9;}));
+		assert(convolve_separable(volume, kz, ky, kx, border, parallel_t(1, &workers)) == separable);
+	}
+
+	matrix_3d<uint8_t, aligned_allocator<uint8_t, 32>> mask(4, 6, 40);
+	fill(mask.begin(), mask.end(), uint8_t(0));
+	mask(2, 3, 20) = 255;
+	mask(0, 0, 0) = 7;
+
+	auto grown = dilate(mask, 1, 2, 3);
+	static_assert(is_same<decltype(grown), matrix_3d<uint8_t, aligned_allocator<uint8_t, 32>>>::value, "");
+	assert(grown(1, 1, 17) == 255 && grown(3, 5, 23) == 255 && grown(2, 3, 24) == 0 && grown(0, 3, 20) == 0);
+	assert(grown(1, 2, 3) == 7 && grown(1, 2, 4) == 0);
+	assert(dilate(mask, 1, 2, 3, border_mode::clamp, parallel_t(1, &workers)) == grown);
+
+	auto shrunk = erode(grown, 1, 2, 3);
+	assert(shrunk(2, 3, 20) == 255 && shrunk(2, 3, 19) == 0 && shrunk(0, 0, 0) == 7);
+	assert(erode(grown, 1, 2, 3, border_mode::zero)(0, 0, 0) == 0);
+
+	matrix_3d<int> line(1, 1, 4);
+	for(unsigned int x = 0; x < 4; ++x)
+		line(0, 0, x) = x + 1;
+	vector<int> one = {1}, shift = {1, 0, 0, 0, 0};
+	assert(convolve_separable(line, one, one, shift, border_mode::mirror)(0, 0, 0) == 3);
+	assert(convolve_separable(line, one, one, shift, border_mode::wrap)(0, 0, 1) == 4);
+	assert(convolve_separable(line, one, one, shift, border_mode::clamp)(0, 0, 1) == 1);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST STENCILS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_permutations() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PERMUTATIONS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<float> volume(5, 37, 70);
+	float k = 0.0f;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = k++;
+
+	const array<unsigned int, 3> orders[] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+	thread_pool workers(3);
+
+	for(const array<unsigned int, 3>& order : orders) {
+		matrix_3d<float> permuted = permute_axes(volume, order);
+		const matrix_3d<float>::size_type extents[3] = {volume.plans(), volume.rows(), volume.columns()};
+		assert(permuted.plans() == extents[order[0]] && permuted.rows() == extents[order[1]] &&
+			   permuted.columns() == extents[order[2]]);
+
+		for(unsigned int a = 0; a < permuted.plans(); ++a)
+			for(unsigned int b = 0; b < permuted.rows(); ++b)
+				for(unsigned int c = 0; c < permuted.columns(); ++c) {
+					unsigned int at[3];
+					at[order[0]] = a;
+					at[order[1]] = b;
+					at[order[2]] = c;
+					assert(permuted(a, b, c) == volume(at[0], at[1], at[2]));
+				}
+
+		assert(permute_axes(volume, order, parallel_t(1, &workers)) == permuted);
+	}
+
+	matrix_3d<double, aligned_allocator<double, 64>> padded(3, 19, 13);
+	double v = 0.0;
+	for(auto iter = padded.begin(); iter != padded.end(); ++iter)
+		*iter = v++;
+	auto xzy = permute_axes(padded, {2, 0, 1});
+	static_assert(is_same<decltype(xzy), matrix_3d<double, aligned_allocator<double, 64>>>::value, "");
+	assert(xzy.plans() == 13 && xzy.rows() == 3 && xzy.columns() == 19 && xzy.pitch() == 24);
+	assert(xzy(12, 2, 18) == padded(2, 18, 12) && xzy(5, 1, 7) == padded(1, 7, 5));
+	assert(permute_axes(permute_axes(padded, {2, 0, 1}), {1, 2, 0}) == padded);
+
+	matrix_2d<int> plan(45, 23);
+	int n = 0;
+	for(unsigned int y = 0; y < plan.rows(); ++y)
+		for(unsigned int x = 0; x < plan.columns(); ++x)
+			plan(y, x) = n++;
+	matrix_2d<int> flipped = transpose(plan);
+	assert(flipped.rows() == 23 && flipped.columns() == 45);
+	for(unsigned int y = 0; y < plan.rows(); ++y)
+		for(unsigned int x = 0; x < plan.columns(); ++x)
+			assert(flipped(x, y) == plan(y, x));
+	assert(transpose(flipped, parallel_t(1, &workers)) == plan);
+
+	matrix_2d<string> names(2, 3);
+	names(1, 2) = "corner";
+	assert(transpose(names)(2, 1) == "corner");
+
+	const simd_level level = active_simd_level();
+	for(simd_level forced : {simd_level::scalar, simd_level::sse})
+		if(set_simd_level(forced) == forced)
+			assert(transpose(plan) == flipped && permute_axes(volume, {2, 1, 0}) == permute_axes(volume, {2, 1, 0}, parallel));
+	set_simd_level(level);
+
+	assert(permute_axes(matrix_3d<int>(), {2, 1, 0}).size() == 0);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PERMUTATIONS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_integral_volume() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST INTEGRAL_VOLUME BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> volume(6, 9, 11);
+	int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = (k++ * 37) % 23 - 11;
+
+	auto brute = [&volume] (unsigned int z1, unsigned int z2, unsigned int y1, unsigned int y2, unsigned int x1, unsigned int x2) {
+		int64_t s = 0;
+		for(unsigned int z = z1; z <= z2; ++z)
+			for(unsigned int y = y1; y <= y2; ++y)
+				for(unsigned int x = x1; x <= x2; ++x)
+					s += volume(z, y, x);
+		return s;
+	};
+
+	integral_volume<int> table(volume);
+	static_assert(is_same<integral_volume<int>::sum_type, int64_t>::value, "");
+	assert(table.plans() == 6 && table.rows() == 9 && table.columns() == 11);
+	assert(table.total() == brute(0, 5, 0, 8, 0, 10));
+	assert(table.box_sum(0, 0, 0, 0, 0, 0) == volume(0, 0, 0));
+	assert(table.box_sum(5, 5, 8, 8, 10, 10) == volume(5, 8, 10));
+	assert(table.box_sum(1, 4, 2, 7, 3, 9) == brute(1, 4, 2, 7, 3, 9));
+	assert(table.box_sum(2, 2, 0, 8, 5, 5) == brute(2, 2, 0, 8, 5, 5));
+	assert(table.box_mean(0, 1, 0, 1, 0, 1) == brute(0, 1, 0, 1, 0, 1) / 8.0);
+
+	thread_pool workers(3);
+	integral_volume<int> concurrent(volume, parallel_t(1, &workers));
+	for(unsigned int z = 0; z < 6; ++z)
+		for(unsigned int y = 0; y < 9; ++y)
+			assert(concurrent.box_sum(0, z, y, 8, 0, 10) == table.box_sum(0, z, y, 8, 0, 10));
+
+	for(unsigned int z = 1; z <= 3; ++z)
+		for(unsigned int y = 4; y <= 6; ++y)
+			for(unsigned int x = 2; x <= 8; ++x)
+				volume(z, y, x) += z * 100 - x;
+	table.update(volume, 1, 3, 4, 6, 2, 8);
+	volume(5, 0, 10) = 1000;
+	table.update(volume, 5, 5, 0, 0, 10, 10);
+	concurrent.update(volume, 1, 5, 0, 8, 2, 10, parallel_t(1, &workers));
+
+	for(unsigned int z = 0; z < 6; ++z)
+		for(unsigned int y = 0; y < 9; ++y)
+			for(unsigned int x = 0; x < 11; ++x) {
+				assert(table.box_sum(z, 5, 0, y, x, 10) == brute(z, 5, 0, y, x, 10));
+				assert(concurrent.box_sum(0, z, y, 8, 0, x) == brute(0, z, y, 8, 0, x));
+			}
+
+	matrix_3d<uint8_t, aligned_allocator<uint8_t, 32>> bytes(70, 70, 70);
+	fill(bytes.begin(), bytes.end(), uint8_t(255));
+	integral_volume<uint8_t> wide(bytes);
+	assert(wide.total() == uint64_t(255) * 70 * 70 * 70);
+	assert(wide.box_sum(10, 19, 0, 69, 30, 31) == uint64_t(255) * 10 * 70 * 2);
+
+	matrix_3d<float> ramp(4, 5, 6);
+	float v = 0.0f;
+	for(auto iter = ramp.begin(); iter != ramp.end(); ++iter)
+		*iter = (v += 0.5f);
+	integral_volume<float> sums(ramp);
+	static_assert(is_same<decltype(sums.box_sum(0, 0, 0, 0, 0, 0)), double>::value, "");
+	assert(sums.box_mean(0, 3, 0, 4, 0, 5) == (0.5 + 60.0) / 2);
+
+	assert(integral_volume<int>(matrix_3d<int>()).total() == 0);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST INTEGRAL_VOLUME END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+template <typename M>
+double generic_plane_sum(const M& m, unsigned int z) {
+	double s = 0;
+	for(unsigned int y = 0; y < m.rows(); ++y)
+		for(unsigned int x = 0; x < m.columns(); ++x)
+			s += m(z, y, x);
+	return s;
+}
+
+constexpr fixed_matrix_3d<int, 2, 2, 3> make_counter() {
+	fixed_matrix_3d<int, 2, 2, 3> m;
+	int k = 0;
+	for(int& cell : m)
+		cell = k++;
+	return m;
+}
+
+void test_fixed_matrices() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST FIXED_MATRICES BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	constexpr fixed_matrix_3d<int, 3, 3, 3> ones(1);
+	static_assert((ones + ones)(1, 1, 1) == 2);
+	static_assert((2 * ones - ones) == ones);
+	static_assert((-ones)(2, 2, 2) == -1 && (ones / 1)(0, 0, 0) == 1);
+	static_assert(ones.size() == 27 && ones.plans() == 3 && ones.pitch() == 3);
+	static_assert(sizeof(fixed_matrix_3d<float, 8, 8, 8>) == 512 * sizeof(float));
+
+	constexpr fixed_matrix_3d<int, 2, 2, 3> counter = make_counter();
+	static_assert(counter(1, 1, 2) == 11 && counter(1, 0, 1) == 7);
+	static_assert(counter.slice<1, 1, 0, 1, 1, 2>() == fixed_matrix_3d<int, 1, 2, 2>{7, 8, 10, 11});
+	static_assert(transform<double>(counter, [] (int v) {return v * 0.5;}, by_value)(0, 1, 1) == 2.0);
+	static_assert(counter.equals(counter + ones.slice<0, 1, 0, 1, 0, 2>(), [] (int a, int b) {return a + 1 == b;}));
+	static_assert(counter != make_counter() * 2);
+
+	constexpr fixed_matrix_2d<int, 2, 3> grid{1, 2, 3, 4, 5, 6};
+	static_assert(grid(1, 0) == 4 && grid.slice<0, 1, 2, 2>() == fixed_matrix_2d<int, 2, 1>{3, 6});
+	static_assert((grid * grid)(1, 2) == 36 && fixed_matrix_2d<int, 2, 3>{1, 2}(1, 2) == 0);
+	assert(grid.view(1, 1, 0, 2)(0, 2) == 6 && grid.slice(0, 1, 1, 1, by_value)(1, 0) == 5);
+
+	fixed_matrix_3d<float, 3, 3, 3> kernel;
+	vector<float> weights(27);
+	for(unsigned int i = 0; i < weights.size(); ++i)
+		weights[i] = float(i);
+	kernel.fill(weights.begin(), weights.end());
+
+	matrix_3d<float> dynamic(3, 3, 3);
+	dynamic.fill(weights.begin(), weights.end());
+
+	for(unsigned int z = 0; z < 3; ++z)
+		assert(generic_plane_sum(kernel, z) == generic_plane_sum(dynamic, z));
+	assert(equal(kernel.begin(), kernel.end(), dynamic.begin()));
+	assert(kernel.slice(1, 2, 0, 1, 1, 2, by_value) == dynamic.slice(1, 2, 0, 1, 1, 2, by_value));
+	assert(kernel[2](1, 1) == dynamic[2](1, 1));
+	assert(kernel.view()(2, 0, 1) == 19.0f && kernel.view(1, 2, 1, 2, 0, 0)(1, 1, 0) == dynamic(2, 2, 0));
+
+	unsigned int rows = 0;
+	kernel.for_each_row([&rows] (span<float> cells) {
+		cells[0] = -cells[0];
+		++rows;
+	});
+	assert(rows == 9 && kernel(2, 1, 0) == -21.0f);
+	assert(!kernel.for_each_span([] (span<const float> cells) {return cells.size() != 10;}, 10));
+
+	kernel *= 2.0f;
+	assert(kernel(0, 0, 1) == 2.0f && kernel(1, 0, 0) == -18.0f);
+
+	fixed_matrix_2d<string, 1, 2> words{"a", "b"};
+	fixed_matrix_2d<string, 1, 2> other{"c"};
+	words.swap(other);
+	assert(words(0, 0) == "c" && words(0, 1).empty() && other(0, 1) == "b");
+
+	stringstream printed;
+	printed << grid;
+	assert(printed.str() == "1 2 3 \n4 5 6 \n");
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST FIXED_MATRICES END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+/**
+  Allocator reserving address space only: the pages are given memory when touched,
+  so that volumes of more than 2^32 cells can be tested on small machines.
+*/
+template <typename T>
+struct reserve_allocator {
+	typedef T value_type;
+
+	reserve_allocator() = default;
+
+	template <typename U>
+	reserve_allocator(const reserve_allocator<U>&) {}
+
+	T* allocate(size_t n) {
+		void* block = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE,
+						   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if(block == MAP_FAILED)
+			throw bad_alloc();
+		return static_cast<T*>(block);
+	}
+
+	void deallocate(T* block, size_t n) {
+		munmap(block, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const reserve_allocator<U>&) const {return true;}
+};
+
+void test_index_extents() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST INDEX_EXTENTS BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+#ifndef MATRIX_32BIT_INDEX
+	static_assert(sizeof(matrix_3d<char>::size_type) == sizeof(size_t), "");
+
+	matrix_3d<char, reserve_allocator<char>> big(2, 1 << 16, (1 << 15) + 8);
+	assert(big.size() == size_t(2) * (1 << 16) * ((1 << 15) + 8));
+	assert(big.size() > numeric_limits<unsigned int>::max());
+
+	big(0, 0, 0) = 1;
+	big(1, 65535, 32775) = 2;
+	big(1, 0, 0) = 3;
+	assert(&big(1, 65535, 32775) - big.data() == ptrdiff_t(big.size() - 1));
+	assert(big(0, 0, 0) == 1 && big(1, 65535, 32775) == 2 && big[1](0, 0) == 3);
+	assert(*(big.end() - 1) == 2 && big.end() - big.begin() == ptrdiff_t(big.size()));
+#else
+	static_assert(sizeof(matrix_3d<char>::size_type) == sizeof(unsigned int), "");
+
+	// The pitch of the converted cells may not fit where the source's did.
+	matrix_2d<char, reserve_allocator<char>> column(1 << 29, 1);
+	bool widened = false;
+	try {
+		matrix_2d<char, aligned_allocator<char, 64>> padded(column);
+	}
+	catch(const length_error&) {
+		widened = true;
+	}
+	assert(widened);
+#endif
+
+	const size_t huge = numeric_limits<matrix_index>::max();
+	bool thrown = false;
+	try {
+		matrix_3d<char> overflow(1 << 22, 1 << 22, 1 << 22);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try {
+		matrix_2d<int> overflow(huge / 2 + 1, 2);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try {
+		checked_extent(checked_extent(1 << 16, 1 << 16), 1 << 16);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown == (sizeof(matrix_index) < 8));
+	assert(checked_extent(huge, 1) == huge && checked_extent(0, huge) == 0);
+
+	// Rounding the columns up to the pitch must not wrap around.
+	thrown = false;
+	try {
+		matrix_2d<char, aligned_allocator<char, 64>> wide(1, huge - 3);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try {
+		matrix_3d<char, aligned_allocator<char, 64>> wide(1, 1, huge - 3);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST INDEX_EXTENTS END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_mapped_matrix() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MAPPED_MATRIX BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	const string path = "/tmp/matrix_mapped_test_" + to_string(getpid()) + ".raw";
+	const string created = path + ".new";
+
+	{
+		vector<float> cells(4 * 5 * 6 + 2);
+		for(size_t i = 0; i < cells.size(); ++i)
+			cells[i] = float(i);
+
+		ofstream out(path, ios::binary);
+		out.write(reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(float));
+	}
+
+	{
+		auto volume = map_matrix_3d<float>(path, 4, 5, 6, map_mode::read_only, access_pattern::sequential);
+		static_assert(is_same<decltype(volume), matrix_3d<float, mapped_allocator<float>>>::value, "");
+
+		assert(volume.pitch() == 6 && volume.size() == 120);
+		assert(volume.data() == volume.get_allocator().file()->data());
+		assert(volume(0, 0, 0) == 0.0f && volume(3, 4, 5) == 119.0f && volume[2](1, 3) == 69.0f);
+		assert(sum(volume) == 119.0 * 120 / 2);
+
+		advise_plans(volume, 1, 2, access_pattern::will_need);
+
+		matrix_3d<float, mapped_allocator<float>> copy(volume);
+		assert(copy.data() != volume.data() && copy == volume);
+		copy(0, 0, 0) = -1.0f;
+		advise_plans(copy, 0, 3, access_pattern::random);
+		assert(volume(0, 0, 0) == 0.0f);
+
+		auto shifted = map_matrix_3d<float>(path, 2, 2, 2, map_mode::read_only, access_pattern::normal, 2 * sizeof(float));
+		assert(shifted(0, 0, 0) == 2.0f && shifted(1, 1, 1) == 9.0f);
+	}
+
+	{
+		auto privately = map_matrix_3d<float>(path, 4, 5, 6, map_mode::copy_on_write);
+		privately(1, 1, 1) = 1000.0f;
+		assert(privately(1, 1, 1) == 1000.0f);
+
+		auto reread = map_matrix_3d<float>(path, 4, 5, 6);
+		assert(reread(1, 1, 1) == 37.0f);
+	}
+
+	{
+		auto written = map_matrix_3d<int>(created, 3, 3, 3, map_mode::shared);
+		int k = 0;
+		for(auto iter = written.begin(); iter != written.end(); ++iter)
+			*iter = k++;
+		written.get_allocator().file()->sync();
+
+		auto reader = map_matrix_3d<int>(created, 3, 3, 3, map_mode::read_only);
+		assert(reader(2, 2, 2) == 26 && reader == written);
+	}
+
+	{
+		auto reopened = map_matrix_3d<int>(created, 3, 3, 3);
+		assert(reopened(1, 2, 0) == 15);
+	}
+
+	// Once released, the mapping is not handed out again to the copies.
+	{
+		auto volume = map_matrix_3d<int>(created, 3, 3, 3, map_mode::shared);
+		auto snapshot = volume;
+		snapshot(0, 0, 0) = 42;
+		volume = {};
+		auto again = snapshot;
+		assert(again(0, 0, 0) == 42 && again.data() != again.get_allocator().file()->data());
+
+		auto frozen = map_matrix_3d<int>(created, 3, 3, 3);
+		auto kept = frozen;
+		frozen = {};
+		auto twice = kept;
+		twice(2, 2, 2) = -1;
+		assert(kept(2, 2, 2) == 26);
+	}
+
+	{
+		auto reopened = map_matrix_3d<int>(created, 3, 3, 3);
+		assert(reopened(0, 0, 0) == 0 && reopened(2, 2, 2) == 26);
+	}
+
+	bool thrown = false;
+	try {
+		map_matrix_3d<float>(path, 5, 5, 6);
+	}
+	catch(const length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try {
+		map_matrix_3d<float>(path + ".missing", 1, 1, 1);
+	}
+	catch(const system_error& error) {
+		thrown = error.code() == errc::no_such_file_or_directory;
+	}
+	assert(thrown);
+
+	remove(path.c_str());
+	remove(created.c_str());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST MAPPED_MATRIX END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+/**
+  Rewrites a single-chunk file of int32_t cells as a machine of the other byte
+  order would have written it.
+*/
+string to_other_byte_order(string data, size_t cells) {
+	auto reverse = [&data] (size_t at, size_t size) {
+		std::reverse(data.begin() + at, data.begin() + at + size);
+	};
+
+	reverse(4, 2);
+	reverse(6, 2);
+	for(size_t at = 16; at < 48; at += 8)
+		reverse(at, 8);
+
+	fill(data.begin() + 12, data.begin() + 16, '\0');
+	uint32_t checksum = crc32c(data.data(), 64);
+	memcpy(&data[12], &checksum, 4);
+	reverse(12, 4);
+
+	for(size_t i = 0; i < cells; ++i)
+		reverse(64 + i * 4, 4);
+
+	checksum = crc32c(data.data() + 64, cells * 4);
+	memcpy(&data[64 + cells * 4], &checksum, 4);
+	reverse(64 + cells * 4, 4);
+
+	return data;
+}
+
+void test_binary_io() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BINARY_IO BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<float, aligned_allocator<float, 32>> volume(4, 5, 6);
+	float v = 0.0f;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = (v += 0.25f);
+
+	stringstream whole;
+	save(whole, volume, 7);
+	assert(whole.str().size() == 64 + 120 * sizeof(float) + 3 * 4);
+
+	matrix_3d<float> loaded = load_matrix_3d<float>(whole);
+	assert(equal(loaded.begin(), loaded.end(), volume.begin()));
+	whole.seekg(0);
+	assert((load_matrix_3d<float, aligned_allocator<float, 32>>(whole) == volume));
+
+	stringstream planes;
+	{
+		matrix_writer<float> writer(planes, volume.plans(), volume.rows(), volume.columns());
+		for(unsigned int z = 0; z < volume.plans(); ++z)
+			writer.write_plan(volume[z]);
+		assert(writer.rows_written() == 20 && writer.header().chunk_rows == 5);
+	}
+	{
+		matrix_reader<float> reader(planes);
+		assert(reader.plans() == 4 && reader.rows() == 5 && reader.columns() == 6 && !reader.header().swapped);
+
+		matrix_2d<float, aligned_allocator<float, 32>> plan(5, 6);
+		for(unsigned int z = 0; z < reader.plans(); ++z) {
+			reader.read_plan(plan);
+			assert(plan == volume[z]);
+		}
+	}
+
+	matrix_2d<uint16_t> image(3, 70);
+	for(unsigned int y = 0; y < 3; ++y)
+		for(unsigned int x = 0; x < 70; ++x)
+			image(y, x) = uint16_t(y * 1000 + x);
+	stringstream flat;
+	save(flat, image);
+	assert(load_matrix_2d<uint16_t>(flat) == image);
+
+	auto fails = [] (const string& data, const string& reason) {
+		stringstream in(data);
+		try {
+			load_matrix_3d<float>(in);
+		}
+		catch(const matrix_format_error& error) {
+			return string(error.what()).find(reason) != string::npos;
+		}
+		return false;
+	};
+
+	string corrupted = whole.str();
+	corrupted[64 + 50 * sizeof(float)] ^= 1;
+	assert(fails(corrupted, "checksum mismatch in chunk 1"));
+	assert(fails(whole.str().substr(0, 200), "truncated"));
+	assert(fails("MX3Dxxxx", "truncated header"));
+	assert(fails(string(64, 'x'), "not a matrix file"));
+	assert(fails(flat.str(), "cell type mismatch"));
+	corrupted = whole.str();
+	corrupted[20] ^= 1;
+	assert(fails(corrupted, "header checksum"));
+
+	// Extents whose product wraps around must not pass for an empty matrix.
+	auto forged = [&whole] (uint64_t plans, uint64_t rows, uint64_t columns, uint64_t chunk_rows) {
+		string data = whole.str();
+		memcpy(&data[16], &plans, 8);
+		memcpy(&data[24], &rows, 8);
+		memcpy(&data[32], &columns, 8);
+		memcpy(&data[40], &chunk_rows, 8);
+		fill(data.begin() + 12, data.begin() + 16, '\0');
+		const uint32_t checksum = crc32c(data.data(), 64);
+		memcpy(&data[12], &checksum, 4);
+		return data;
+	};
+	assert(fails(forged(uint64_t(1) << 32, uint64_t(1) << 32, 1, 0), "extents overflow"));
+	assert(fails(forged(uint64_t(1) << 40, 1, uint64_t(1) << 30, 5), "extents overflow"));
+	assert(fails(forged(4, 5, 6, 0), "invalid chunk layout"));
+
+	matrix_3d<int32_t> counter(2, 2, 3);
+	int32_t k = -5;
+	for(auto iter = counter.begin(); iter != counter.end(); ++iter)
+		*iter = (k++) * 0x01020304;
+	stringstream native;
+	save(native, counter, 4);
+
+	stringstream foreign(to_other_byte_order(native.str(), 12));
+	matrix_reader<int32_t> swapped(foreign);
+	assert(swapped.header().swapped && swapped.plans() == 2 && swapped.columns() == 3);
+	matrix_3d<int32_t> restored(2, 2, 3);
+	swapped.read_rows(restored.data(), 4, restored.pitch());
+	assert(restored == counter);
+
+	stringstream empty;
+	save(empty, matrix_3d<double>());
+	assert(load_matrix_3d<double>(empty).size() == 0);
+
+	stringstream printed;
+	printed << image.slice(0, 1, 0, 1, by_value);
+	assert(printed.str() == "0 1 \n1000 1001 \n");
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BINARY_IO END" << endl;
+	cout << "-----------------------------------" << endl << endl;
+}
+
+void test_paged_matrix() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PAGED_MATRIX BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	const string path = "/tmp/matrix_paged_test_" + to_string(getpid()) + ".mx3d";
+	const string copy = path + ".copy";
+	const string twin_path = path + ".twin";
+	const string single_path = path + ".single";
+
+	matrix_3d<float> reference(12, 9, 7);
+	vector<float> values(reference.size());
+	for(size_t i = 0; i < values.size(); ++i)
+		values[i] = float(i) * 0.5f;
+	reference.fill(values.begin(), values.end());
+
+	{
+		paged_matrix_3d<float> paged(path, 12, 9, 7, 3, 2);
+		assert(paged.plans() == 12 && paged.rows() == 9 && paged.columns() == 7);
+		assert(paged.size() == reference.size() && paged.cache_planes() == 3);
+
+		// A new file holds zeros; filling it goes through the cache of 3 plans.
+		const paged_matrix_3d<float>& view = paged;
+		assert(all_of(view.begin(), view.end(), [] (float v) {return v == 0.0f;}));
+		assert(paged.write_backs() == 0);
+
+		paged.fill(values.begin(), values.end());
+		assert(paged.write_backs() >= 9);
+		assert(paged(5, 4, 3) == reference(5, 4, 3));
+		assert(equal(view.begin(), view.end(), reference.begin()));
+		assert(accumulate(view.begin(), view.end(), 0.0) == accumulate(values.begin(), values.end(), 0.0));
+
+		transform(view.begin(), view.end(), paged.begin(), [] (float v) {return v + 1.0f;});
+		transform(reference.begin(), reference.end(), reference.begin(), [] (float v) {return v + 1.0f;});
+		assert(paged(11, 8, 6) == reference(11, 8, 6));
+
+		// Reading through the read/write accesses writes nothing back.
+		paged.flush();
+		const size_t written = paged.write_backs();
+		assert(count(paged.begin(), paged.end(), 0.0f) == 0);
+		double firsts = 0.0, expected = 0.0;
+		for(unsigned int z = 0; z < 12; ++z) {
+			firsts += paged(z, 0, 0);
+			expected += reference(z, 0, 0);
+		}
+		assert(firsts == expected);
+		paged.flush();
+		assert(paged.write_backs() == written);
+
+		// A read sweep from plan 0 makes the background thread read the next plans.
+		for(unsigned int z = 0; z < 3; ++z)
+			assert(view(z, 0, 0) == reference(z, 0, 0));
+		for(int i = 0; i < 500 && paged.prefetched() == 0; ++i)
+			this_thread::sleep_for(chrono::milliseconds(10));
+		assert(paged.prefetched() > 0);
+		assert(view(3, 2, 1) == reference(3, 2, 1));
+
+		size_t plans = 0;
+		view.for_each_plane([&] (matrix_2d_view<const float> plan) {
+			assert(plan(8, 6) == reference(plans, 8, 6));
+			++plans;
+		});
+		assert(plans == 12);
+
+		paged_matrix_3d<double> doubled = transform<double>(paged, [] (float v) {return 2.0 * v;}, copy, 2);
+		assert(doubled(7, 1, 2) == 2.0 * reference(7, 1, 2));
+		assert(doubled.cache_planes() == 2);
+
+		paged_matrix_3d<float> twin = transform<float>(paged, [] (float v) {return v;}, twin_path, 2);
+		assert(twin == paged);
+		twin(6, 0, 0) = -1.0f;
+		assert(twin != paged);
+
+		paged.flush();
+		paged_matrix_3d<float> reopened(path, 2, 1);
+		assert(reopened == paged);
+
+		// The plan left last stays in the cache: the algorithms holding two references work.
+		paged_matrix_3d<float> single(single_path, 6, 4, 4, 1);
+		const paged_matrix_3d<float>& cells_view = single;
+		assert(single.cache_planes() == 2);
+		vector<float> cells(single.size());
+		iota(cells.begin(), cells.end(), 0.0f);
+		single.fill(cells.begin(), cells.end());
+		assert(inner_product(cells_view.begin(), cells_view.end(), make_reverse_iterator(cells_view.end()), 0.0) ==
+			   inner_product(cells.begin(), cells.end(), cells.rbegin(), 0.0));
+
+		// The proxy references of the read/write iterators swap cells.
+		for(ptrdiff_t i = 0; i < ptrdiff_t(cells.size() / 2); ++i)
+			iter_swap(single.begin() + i, single.end() - 1 - i);
+		reverse(cells.begin(), cells.end());
+		assert(equal(cells.begin(), cells.end(), cells_view.begin()));
+
+		swap(twin(0, 0, 0), twin(11, 8, 6));
+		assert(twin(11, 8, 6) == paged(0, 0, 0) && twin(0, 0, 0) == paged(11, 8, 6));
+		swap(twin(0, 0, 0), twin(11, 8, 6));
+		twin(6, 0, 0) = paged(6, 0, 0);
+		assert(twin == paged);
+	}
+
+	// The file is a matrix file with one plan per chunk.
+	{
+		ifstream in(path, ios::binary);
+		assert(load_matrix_3d<float>(in) == reference);
+	}
+
+	{
+		ofstream out(path, ios::binary | ios::trunc);
+		save(out, reference, reference.rows());
+	}
+
+	{
+		paged_matrix_3d<float> opened(path);
+		assert(opened.plans() == 12 && opened(4, 5, 6) == reference(4, 5, 6));
+		assert(opened.loads() == 1);
+	}
+
+	// Damaged plans are detected when read.
+	{
+		fstream damage(path, ios::binary | ios::in | ios::out);
+		damage.seekp(64 + 2 * (9 * 7 * sizeof(float) + 4) + 10);
+		damage.put('\x7f');
+	}
+
+	{
+		const paged_matrix_3d<float> damaged(path);
+		assert(damaged(1, 0, 0) == reference(1, 0, 0));
+		bool thrown = false;
+		try {
+			static_cast<void>(damaged(2, 0, 0));
+		}
+		catch(const matrix_format_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+		assert(damaged(3, 0, 0) == reference(3, 0, 0));
+	}
+
+	bool rejected = false;
+	try {
+		paged_matrix_3d<int> wrong(path);
+	}
+	catch(const matrix_format_error&) {
+		rejected = true;
+	}
+	assert(rejected);
+
+	remove(path.c_str());
+	remove(copy.c_str());
+	remove(twin_path.c_str());
+	remove(single_path.c_str());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST PAGED_MATRIX END" << endl;
+	cout << "-----------------------------------" << endl;
+}
+
+template <typename T>
+bool codec_round_trip(const vector<T>& cells) {
+	vector<unsigned char> packed;
+	brick_codec::encode(cells.data(), cells.size(), packed);
+	vector<T> unpacked(cells.size());
+	brick_codec::decode(packed.data(), unpacked.data(), unpacked.size());
+	return cells.empty() || memcmp(unpacked.data(), cells.data(), cells.size() * sizeof(T)) == 0;
+}
+
+void test_compressed_matrix() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST COMPRESSED_MATRIX BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	uint64_t state = 88172645463325252ull;
+	auto next = [&state] () {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	};
+
+	vector<uint8_t> noise(1000);
+	vector<int16_t> wave(1000);
+	vector<float> ramp(1000);
+	vector<double> mixed(1000);
+	vector<uint64_t> extremes(1000);
+	for(size_t i = 0; i < 1000; ++i) {
+		noise[i] = uint8_t(next());
+		wave[i] = int16_t((i % 200) * 300 - 30000);
+		ramp[i] = float(i) * 0.125f - 40.0f;
+		mixed[i] = i % 3 == 0 ? -1e300 : double(next() % 1000);
+		extremes[i] = i % 2 == 0 ? 0 : numeric_limits<uint64_t>::max() - i;
+	}
+	assert(codec_round_trip(noise) && codec_round_trip(wave) && codec_round_trip(ramp));
+	assert(codec_round_trip(mixed) && codec_round_trip(extremes));
+	assert(codec_round_trip(vector<int32_t>()) && codec_round_trip(vector<int32_t>(1, -5)));
+
+	// A uniform brick takes 7 bits per group of 64 cells; noise falls back to raw.
+	vector<unsigned char> packed;
+	vector<float> uniform(32768, 3.5f);
+	brick_codec::encode(uniform.data(), uniform.size(), packed);
+	assert(packed.size() < 500);
+	brick_codec::encode(noise.data(), noise.size(), packed);
+	assert(packed.size() == 1 + noise.size() && packed[0] == 0);
+
+	matrix_3d<int32_t> reference(40, 35, 70);
+	for(unsigned int z = 0; z < 40; ++z)
+		for(unsigned int y = 0; y < 35; ++y)
+			for(unsigned int x = 0; x < 70; ++x)
+				reference(z, y, x) = z < 20 ? 7 : int32_t(z * 100 + y * 10 + x);
+
+	compressed_matrix_3d<int32_t> compressed(reference);
+	assert(compressed.plans() == 40 && compressed.rows() == 35 && compressed.columns() == 70);
+	assert(compressed.bricks() == 2 * 2 * 3 && compressed.cache_bricks() == 3 + 1);
+	assert(compressed.compressed_bytes() * 4 < reference.size() * sizeof(int32_t));
+	assert(compressed.cache_bytes() == 0);
+	assert(compressed(39, 34, 69) == reference(39, 34, 69) && compressed(0, 0, 0) == 7);
+	assert(compressed.cache_bytes() == 2 * 32 * 32 * 32 * sizeof(int32_t));
+
+	const compressed_matrix_3d<int32_t>& view = compressed;
+	assert(equal(view.begin(), view.end(), reference.begin()));
+	assert(view.end() - view.begin() == ptrdiff_t(reference.size()));
+	assert(compressed.decompress() == reference);
+
+	thread_pool workers(3);
+	compressed_matrix_3d<int32_t> threaded(reference, parallel_t(1, &workers));
+	assert(threaded == compressed);
+	assert(threaded.decompress(parallel_t(1, &workers)) == reference);
+
+	// Changes go to the cache and are compressed again when the bricks leave it.
+	compressed_matrix_3d<int32_t> copy(compressed);
+	compressed(33, 2, 65) = -1;
+	reference(33, 2, 65) = -1;
+	transform(view.begin(), view.begin() + 100, compressed.begin(), [] (int32_t v) {return v + 2;});
+	for_each(reference.begin(), reference.begin() + 100, [] (int32_t& v) {v += 2;});
+	assert(compressed.decompress() == reference);
+	assert(copy != compressed && copy(33, 2, 65) != -1);
+
+	// Reading through the read/write accesses compresses nothing again.
+	const size_t recompressed = compressed.recompressions();
+	assert(count(compressed.begin(), compressed.end(), -1) == 1);
+	for(unsigned int z = 0; z < 40; ++z)
+		assert(compressed(z, 34, 69) == reference(z, 34, 69));
+	assert(compressed.decompress() == reference && compressed.recompressions() == recompressed);
+
+	copy = compressed;
+	assert(copy == compressed);
+
+	vector<int32_t> values(reference.size());
+	iota(values.begin(), values.end(), -1000);
+	compressed.fill(values.begin(), values.end() - 5);
+	reference.fill(values.begin(), values.end() - 5);
+	assert(compressed.decompress() == reference);
+
+	// A cache of one brick is raised to two, and gives the right cells in any order.
+	compressed_matrix_3d<int32_t> tight(reference, 1);
+	assert(tight.cache_bricks() == 2);
+	for(int i = 0; i < 2000; ++i) {
+		const unsigned int z = next() % 40, y = next() % 35, x = next() % 70;
+		assert(tight(z, y, x) == reference(z, y, x));
+		if(i % 3 == 0)
+			tight(z, y, x) = reference(z, y, x) = int32_t(i);
+	}
+	assert(tight.decompress() == reference);
+
+	// The brick left last stays in the cache: the algorithms holding two references work.
+	matrix_3d<int> column(64, 16, 16);
+	iota(column.begin(), column.end(), 0);
+	compressed_matrix_3d<int> narrow(column);
+	assert(narrow.cache_bricks() == 2);
+	const compressed_matrix_3d<int>& narrow_view = narrow;
+	assert(inner_product(narrow_view.begin(), narrow_view.end(), make_reverse_iterator(narrow_view.end()), 0L) ==
+		   inner_product(column.begin(), column.end(), make_reverse_iterator(column.end()), 0L));
+	for(auto first = narrow.begin(), last = narrow.end(); first < last && first < --last; ++first)
+		iter_swap(first, last);
+	reverse(column.begin(), column.end());
+	assert(narrow.decompress() == column);
+
+	matrix_3d<int> cube(40, 40, 40);
+	iota(cube.begin(), cube.end(), 0);
+	compressed_matrix_3d<int> single(cube, 1);
+	iter_swap(single.begin(), single.end() - 1);
+	swap(single(0, 0, 0), single(39, 0, 0));
+	iter_swap(cube.begin(), cube.end() - 1);
+	swap(cube(0, 0, 0), cube(39, 0, 0));
+	for(auto first = single.begin() + 10, last = single.end() - 10; first < last && first < --last; ++first)
+		iter_swap(first, last);
+	reverse(cube.begin() + 10, cube.end() - 10);
+	assert(single.decompress() == cube);
+
+	compressed_matrix_3d<double> zeros(70, 70, 70);
+	assert(zeros.bricks() == 27 && zeros(69, 0, 35) == 0.0);
+	assert(zeros.compressed_bytes() < 27 * 1000);
+
+	// The slots of a small matrix take the size of its single brick.
+	compressed_matrix_3d<char> dot(1, 2, 3);
+	assert(dot.cache_bricks() == 2 && dot.cache_bytes() == 0);
+	assert(dot(0, 1, 2) == 0 && dot.cache_bytes() == 6);
+
+	compressed_matrix_3d<double> moved(std::move(zeros));
+	assert(moved.size() == 70 * 70 * 70 && zeros.size() == 0);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST COMPRESSED_MATRIX END" << endl;
+	cout << "-----------------------------------" << endl;
+}
+
+void test_sparse_matrix() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SPARSE_MATRIX BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<int> reference(100, 90, 80);
+	fill(reference.begin(), reference.end(), 0);
+
+	// A small ball and a few scattered cells.
+	size_t expected = 0;
+	long total = 0;
+	for(unsigned int z = 0; z < 100; ++z)
+		for(unsigned int y = 0; y < 90; ++y)
+			for(unsigned int x = 0; x < 80; ++x) {
+				const int dz = int(z) - 30, dy = int(y) - 40, dx = int(x) - 50;
+				if(dz * dz + dy * dy + dx * dx < 36 || (z * 7919 + y * 104729 + x) % 50021 == 0) {
+					reference(z, y, x) = int(z + y + x + 1);
+					++expected;
+					total += reference(z, y, x);
+				}
+			}
+
+	const sparse_matrix_3d<int> sparse(reference);
+	assert(sparse.plans() == 100 && sparse.rows() == 90 && sparse.columns() == 80);
+	assert(sparse.size() == reference.size());
+	assert(sparse.bricks() < 7 * 6 * 5 / 2);
+	assert(sparse.storage_bytes() < reference.size() * sizeof(int) / 2);
+	assert(sparse.occupied() == expected);
+	assert(sparse(30, 40, 50) == reference(30, 40, 50) && sparse(99, 89, 79) == 0);
+	assert(sparse.dense() == reference);
+
+	long visited = 0;
+	sparse.for_each_occupied([&] (size_t z, size_t y, size_t x, const int& v) {
+		assert(v != 0 && reference(z, y, x) == v);
+		visited += v;
+	});
+	assert(visited == total);
+
+	size_t seen = 0;
+	assert(!sparse.for_each_occupied([&seen] (size_t, size_t, size_t, const int&) {return ++seen < 3;}));
+	assert(seen == 3);
+
+	// Reading never allocates, whatever the cell.
+	const size_t stored = sparse.bricks();
+	assert(equal(sparse.begin(), sparse.end(), reference.begin()));
+	assert(sparse.bricks() == stored);
+
+	// Nor through the iterators of a non-const matrix, which allocate only to store a value.
+	sparse_matrix_3d<int> swept(sparse);
+	assert(size_t(count_if(swept.begin(), swept.end(), [] (int v) {return v != 0;})) == expected);
+	long summed = 0;
+	for(int v : swept)
+		summed += v;
+	assert(summed == total && swept.bricks() == stored);
+	copy(reference.begin(), reference.end(), swept.begin());
+	assert(swept.bricks() == stored && swept == sparse);
+	auto last = swept.end() - 1;
+	*last = 0;
+	assert(swept.bricks() == stored);
+	*last = 5;
+	assert(swept.bricks() == stored + 1 && swept(99, 89, 79) == 5);
+	swap(*swept.begin(), *last);
+	assert(swept(0, 0, 0) == 5 && swept(99, 89, 79) == reference(0, 0, 0));
+
+	sparse_matrix_3d<int> edited(sparse);
+	assert(edited == sparse);
+	edited.set(99, 89, 79, 0);
+	assert(edited.bricks() == stored);
+	edited.set(99, 89, 79, 5);
+	assert(edited.bricks() == stored + 1 && edited != sparse);
+	edited(99, 89, 79) = 0;
+	assert(edited == sparse && edited.compact() == 1 && edited.bricks() == stored);
+
+	edited.for_each_occupied([] (size_t, size_t, size_t, int& v) {v = -v;});
+	assert(edited(30, 40, 50) == -reference(30, 40, 50));
+	assert(edited != sparse);
+
+	sparse_matrix_3d<int> empty(100, 90, 80);
+	assert(empty.bricks() == 0 && empty.occupied() == 0);
+	assert(empty != sparse && sparse != empty);
+	matrix_3d<int> zeros(100, 90, 80);
+	fill(zeros.begin(), zeros.end(), 0);
+	assert(empty.dense() == zeros);
+
+	// Filling with a mostly zero sequence allocates only the bricks receiving values.
+	vector<int> values(reference.begin(), reference.end());
+	empty.fill(values.begin(), values.end());
+	assert(empty == sparse && empty.bricks() == stored);
+
+	sparse_matrix_3d<int> moved(std::move(empty));
+	assert(moved == sparse && empty.size() == 0 && empty.bricks() == 0);
+	empty = moved;
+	assert(empty == sparse);
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST SPARSE_MATRIX END" << endl;
+	cout << "-----------------------------------" << endl;
+}
+
+void test_copy_on_write() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST COPY_ON_WRITE BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<float> reference(6, 40, 50);
+	float v = 0.0f;
+	for(auto iter = reference.begin(); iter != reference.end(); ++iter)
+		*iter = (v += 0.5f);
+
+	cow_matrix_3d<float> volume(reference);
+	assert(volume.plans() == 6 && volume.rows() == 40 && volume.columns() == 50);
+	assert(volume.dense() == reference && !volume.shared(0));
+
+	// A snapshot shares every plan.
+	cow_matrix_3d<float> snapshot(volume);
+	for(unsigned int z = 0; z < 6; ++z)
+		assert(snapshot.shared(z) && snapshot[z].data() == volume[z].data());
+	assert(snapshot == volume);
+
+	// Reading does not copy; writing copies only the plan written.
+	const cow_matrix_3d<float>& view = volume;
+	assert(equal(view.begin(), view.end(), reference.begin()));
+	assert(view(3, 39, 49) == reference(3, 39, 49) && volume.shared(3));
+
+	volume(2, 10, 10) = -1.0f;
+	assert(!volume.shared(2) && !snapshot.shared(2) && volume.shared(1) && volume.shared(3));
+	assert(snapshot(2, 10, 10) == reference(2, 10, 10));
+	assert(volume != snapshot);
+
+	const float* owned = volume[2].data();
+	volume(2, 11, 11) = -2.0f;
+	assert(volume[2].data() == owned);
+
+	// Iterators, fill() and plan() privatize the plans they reach.
+	for_each(volume.begin() + 3 * 40 * 50, volume.begin() + 3 * 40 * 50 + 5, [] (float& c) {c = 7.0f;});
+	assert(!volume.shared(3) && volume.shared(4) && snapshot(3, 0, 0) == reference(3, 0, 0));
+
+	volume.plan(4)(0, 0) = 9.0f;
+	assert(!volume.shared(4) && snapshot(4, 0, 0) == reference(4, 0, 0));
+
+	vector<float> ones(40 * 50 + 1, 1.0f);
+	cow_matrix_3d<float> second(snapshot);
+	second.fill(ones.begin(), ones.end());
+	assert(!second.shared(0) && !second.shared(1) && second.shared(5));
+	assert(second(1, 0, 0) == 1.0f && second(1, 0, 1) == reference(1, 0, 1));
+	assert(snapshot.dense() == reference);
+
+	// A copy of a privatized plan is shared again, and copied on the next write.
+	cow_matrix_3d<float> third = volume;
+	assert(volume.shared(2) && third[2].data() == owned);
+	volume(2, 0, 0) = 3.0f;
+	assert(volume[2].data() != owned && third(2, 0, 0) == reference(2, 0, 0));
+
+	cow_matrix_3d<float> moved(std::move(third));
+	assert(moved.size() == reference.size() && third.size() == 0);
+	assert(moved.shared(5));
+
+	// Copying a const matrix only touches reference counts: threads may snapshot it at once.
+	const cow_matrix_3d<float> frozen(moved);
+	vector<cow_matrix_3d<float>> snapshots(4);
+	vector<thread> takers;
+	for(size_t t = 0; t < snapshots.size(); ++t)
+		takers.emplace_back([&frozen, &snapshots, t] () {
+			for(int i = 0; i < 50; ++i)
+				snapshots[t] = frozen;
+		});
+	for(thread& taker : takers)
+		taker.join();
+	for(const cow_matrix_3d<float>& taken : snapshots)
+		assert(taken == frozen && taken[0].data() == frozen[0].data());
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST COPY_ON_WRITE END" << endl;
+	cout << "-----------------------------------" << endl;
+}
+
+void test_bitmask() {
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BITMASK BEGIN" << endl;
+	cout << "-----------------------------------" << endl;
+
+	matrix_3d<uint16_t> volume(5, 13, 21);
+	unsigned int k = 0;
+	for(auto iter = volume.begin(); iter != volume.end(); ++iter)
+		*iter = uint16_t((k++ * 37) % 1000);
+
+	auto high = [] (uint16_t v) {return v > 600;};
+	auto even = [] (uint16_t v) {return v % 2 == 0;};
+
+	bitmask_3d a(volume, high);
+	bitmask_3d b(volume, even);
+	assert(a.plans() == 5 && a.rows() == 13 && a.columns() == 21 && a.size() == 1365);
+	assert(a.words() == (1365 + 63) / 64);
+
+	size_t highs = 0, evens = 0, both = 0, either = 0, one = 0;
+	for(unsigned int z = 0; z < 5; ++z)
+		for(unsigned int y = 0; y < 13; ++y)
+			for(unsigned int x = 0; x < 21; ++x) {
+				const bool h = high(volume(z, y, x)), e = even(volume(z, y, x));
+				assert(a(z, y, x) == h && b(z, y, x) == e);
+				highs += h;
+				evens += e;
+				both += h && e;
+				either += h || e;
+				one += h != e;
+			}
+	assert(a.count() == highs && b.count() == evens);
+	assert((a & b).count() == both && (a | b).count() == either && (a ^ b).count() == one);
+	assert((~a).count() == a.size() - highs);
+
+	// The operators move their left operand into the result instead of copying it.
+	bitmask_3d moved(a);
+	const bitmask_3d::word_type* words = moved.data();
+	bitmask_3d anded = std::move(moved) & b;
+	assert(anded.data() == words && anded.count() == both);
+	assert((~std::move(anded)).data() == words);
+	assert(bitmask_3d(a).subtract(b).count() == highs - both);
+
+	thread_pool workers(3);
+	assert(bitmask_3d(volume, high, parallel_t(1, &workers)) == a);
+
+	// Proxy references read and write single bits.
+	bitmask_3d c(a);
+	const bool before = c(4, 12, 20);
+	c(4, 12, 20) = !before;
+	assert(c(4, 12, 20) != before && c != a && c.count() == (before ? highs - 1 : highs + 1));
+	c(4, 12, 20).flip();
+	assert(c == a);
+	c(0, 0, 0) = c(4, 12, 20);
+	assert(bool(c(0, 0, 0)) == a(4, 12, 20));
+
+	// Bits past the last cell never count.
+	bitmask_3d full(5, 13, 21, true);
+	assert(full.count() == 1365 && (~full).none() && full.any());
+	full.flip();
+	assert(full.count() == 0);
+	full.fill(true);
+	assert(full.count() == 1365 && (full ^ a) == ~a);
+
+	vector<size_t> found;
+	a.for_each_set([&] (size_t z, size_t y, size_t x) {
+		assert(high(volume(z, y, x)));
+		found.push_back((z * 13 + y) * 21 + x);
+	});
+	assert(found.size() == highs && is_sorted(found.begin(), found.end()));
+
+	size_t seen = 0;
+	assert(!a.for_each_set([&seen] (size_t, size_t, size_t) {return ++seen < 4;}) && seen == 4);
+
+	matrix_3d<uint16_t, aligned_allocator<uint16_t, 32>> padded(3, 4, 5);
+	fill(padded.begin(), padded.end(), uint16_t(1));
+	padded(2, 3, 4) = 0;
+	bitmask_3d ones(padded, [] (uint16_t v) {return v == 1;});
+	assert(ones.count() == 59 && !ones(2, 3, 4) && ones(2, 3, 3));
+
+	cout << "-----------------------------------" << endl;
+	cout << "TEST BITMASK END" << endl;
+	cout << "-----------------------------------" << endl;
+}
+
 int main() {
 
 	test_matrix_2d_creation();
@@ -876,5 +2955,55 @@ int main() {
 
 	test_matrix_3d_methods();
 
+	test_matrix_3d_contiguous();
+
+	test_move_semantics();
+
+	test_by_value();
+
+	test_views();
+
+	test_pool_allocator();
+
+	test_aligned_storage();
+
+	test_simd_transform();
+
+	test_parallel();
+
+	test_random_access_iterators();
+
+	test_segmented_iteration();
+
+	test_expression_templates();
+
+	test_pipelines();
+
+	test_reductions();
+
+	test_stencils();
+
+	test_permutations();
+
+	test_integral_volume();
+
+	test_fixed_matrices();
+
+	test_index_extents();
+
+	test_mapped_matrix();
+
+	test_binary_io();
+
+	test_paged_matrix();
+
+	test_compressed_matrix();
+
+	test_sparse_matrix();
+
+	test_copy_on_write();
+
+	test_bitmask();
+
 	return 0;
 }
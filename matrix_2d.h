@@ -6,27 +6,58 @@
 #include <iostream>
 #include <cassert>
 #include <algorithm>
+#include <utility> // std::move
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_view.h"
+#include "matrix_iterator.h"
+#include "matrix_simd.h"
+#include "matrix_expr.h"
 
 /**
   @file matrix_2d.h
   @brief matrix_2d template class declaration and implementation.
 */
 
+/**
+  @brief Tag type selecting the overloads that return their result by value
+
+  Passed as the last argument to slice() and transform() to obtain the result as an 
+  object instead of a pointer to a heap-allocated one.
+*/
+struct by_value_t {
+	explicit by_value_t() = default;
+};
+
+/**
+  @brief Tag value selecting the overloads that return their result by value
+*/
+constexpr by_value_t by_value{};
+
+
 
 /**
   @brief Class for representing a two-dimensional array
 
   Class that encapsulates a two-dimensional array. It is used a single array
-  to simulate the presence of the two-dimensional array.
+  to simulate the presence of the two-dimensional array. The array is obtained
+  from an allocator of type A, std::allocator by default. Rows are pitch() cells
+  apart: with an allocator guaranteeing a wider alignment than T, such as 
+  aligned_allocator, each row is padded so that it starts on that alignment.
 */
 
-template <typename T> class matrix_2d {
+template <typename T, typename A> class matrix_2d {
 	public:
 
 	/**
 		@brief Data type to represent the dimensions of the two-dimensional matrix
 	*/
-		typedef unsigned int size_type;
+		typedef matrix_index size_type;
+
+	/**
+		@brief Data type of the allocator of the cells
+	*/
+		typedef A allocator_type;
 
 	private:
 
@@ -34,6 +65,94 @@ template <typename T> class matrix_2d {
 
 		size_type _rows;
 		size_type _col;
+		size_type _pitch;
+
+		A _alloc;
+
+		typedef row_layout<T, A> layout;
+
+		template <typename U, typename B> friend class matrix_2d;
+		template <typename U, typename B> friend class matrix_3d;
+
+		template <typename Q, typename W, typename B, typename F>
+		friend matrix_2d<Q, rebind_allocator<B, Q>> transform(const matrix_2d<W, B>& source, 
+															  const F func, by_value_t);
+
+		/**
+			@brief Binding method
+
+			Makes the current matrix_2d refer to a block of y rows of x cells owned by 
+			someone else, laid out with the pitch of this matrix type. Used by matrix_3d 
+			to expose its plans without copying them.
+
+			@param data first cell of the block
+			@param y number of rows
+			@param x number of columns
+		*/
+		void bind(T* data, size_type y, size_type x) {
+			_matrix = data;
+			_rows = y;
+			_col = x;
+			_pitch = layout::pitch(x);
+		}
+
+		/**
+			@brief Unbinding method
+
+			Detaches the current matrix_2d from the block given to bind(), so that the
+			destructor does not release memory it does not own.
+		*/
+		void unbind() {
+			_matrix = nullptr;
+			_rows = 0;
+			_col = 0;
+			_pitch = 0;
+		}
+
+		/**
+			@brief Storage size getter
+
+			@return number of allocated cells, padding included
+		*/
+		size_type storage_size() const {return _rows * _pitch;}
+
+		/**
+			@brief Slicing constructor
+
+			Builds the submatrix [y1:y2, x1:x2] of source, copying one row at a time.
+			Used by slice() to return the submatrix by value. If the copy fails, the
+			delegated constructor has already completed, so the destructor releases 
+			the cells.
+		*/
+		matrix_2d(const matrix_2d& source, size_type y1, size_type y2,
+				  size_type x1, size_type x2) : matrix_2d(y2 - y1 + 1, x2 - x1 + 1, source._alloc) {
+
+			for(size_type i = y1; i <= y2; ++i)
+				std::copy(source._matrix + i * source._pitch + x1,
+						  source._matrix + i * source._pitch + x2 + 1, 
+						  _matrix + (i - y1) * _pitch);
+		}
+
+		/**
+			@brief Transformation constructor
+
+			Builds a matrix_2d with the shape of source, obtained by applying func to 
+			each of its cells. The cells are obtained from a rebound copy of the allocator
+			of source. Used by transform() to return the result by value. The cells are
+			transformed by transform_cells(), in a single run when neither matrix has 
+			padded rows, one row at a time otherwise. If func throws, the destructor 
+			releases the cells.
+		*/
+		template <typename W, typename B, typename F>
+		matrix_2d(const matrix_2d<W, B>& source, const F& func, by_value_t) 
+				  : matrix_2d(source.rows(), source.columns(), A(source._alloc)) {
+
+			if(_pitch == _col && source._pitch == source._col)
+				transform_cells(source._matrix, _matrix, this->size(), func);
+			else
+				for(size_type i = 0; i < _rows; ++i)
+					transform_cells(source._matrix + i * source._pitch, _matrix + i * _pitch, _col, func);
+		}
 
 	public:
 
@@ -46,13 +165,32 @@ template <typename T> class matrix_2d {
    		@post _rows = 0
    		@post _col = 0
   	*/
-		matrix_2d(void) : _rows(0), _col(0), _matrix(nullptr) {
+		matrix_2d(void) : _matrix(nullptr), _rows(0), _col(0), _pitch(0), _alloc() {
 
 			#ifndef NDEBUG
 			std::cout << "matrix_2d::matrix_2d()" << std::endl;
 			#endif
 		}
 
+		/**
+    	@brief Allocator constructor
+
+    	Initialize the object to a null two-dimensional array that will obtain its
+    	cells from the given allocator.
+
+    	@param alloc allocator of the cells
+
+   		@post _buffer = nullptr
+   		@post _rows = 0
+   		@post _col = 0
+  	*/
+		explicit matrix_2d(const A& alloc) : _matrix(nullptr), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
+
+			#ifndef NDEBUG
+			std::cout << "matrix_2d::matrix_2d(const A&)" << std::endl;
+			#endif
+		}
+
 
 		/**
 		 * @brief Parameterized constructor
@@ -60,9 +198,12 @@ template <typename T> class matrix_2d {
 		 * 
 		 *	Parameterized constructor to create a matrix with the given dimensions. Matrix 
 		 *  cells are not initialized. If x = 0 or y = 0, a null matrix_2d is created.
+		 *  Each row takes pitch() cells, padding included. If the number of cells does
+		 *  not fit in a size_type, std::length_error is thrown.
 		 * 
 		 * @param y number of rows
 		 * @param x number of columns
+		 * @param alloc allocator of the cells
 		 * 
 		 * @pre x >= 0
 		 * @pre y >= 0
@@ -71,14 +212,16 @@ template <typename T> class matrix_2d {
 		 * @post _rows = x
 		 * @post _col = y; 
   	*/
-		matrix_2d(size_type y, size_type x) : _rows(0), _col(0), _matrix(nullptr) {
+		matrix_2d(size_type y, size_type x, const A& alloc = A()) 
+				  : _matrix(nullptr), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
 			assert(x >= 0);
 			assert(y >= 0);
 
 			if(x > 0 && y > 0) {
-				_matrix = new T[x * y];
+				_matrix = cell_storage<T, A>::allocate(_alloc, checked_extent(y, layout::pitch(x)));
 				_rows = y;
 				_col = x;
+				_pitch = layout::pitch(x);
 			}
 
 			#ifndef NDEBUG
@@ -90,17 +233,22 @@ template <typename T> class matrix_2d {
 			@brief Conversion copy constructor
 			
 			Constructor from another matrix_2d on a different template parameter
-			U. If in the casting procedure generates an exception, a null matrix_2d is 
-			created and the exception is rethrown to the caller.
+			U, or on a different allocator B. If in the casting procedure generates an
+			exception, a null matrix_2d is created and the exception is rethrown to the
+			caller. If the number of cells, with the pitch of T, does not fit in a
+			size_type, std::length_error is thrown.
 			
 			@param source matrix_2d to build the new matrix_2d
+			@param alloc allocator of the cells
 		*/
-		template <typename U>
-		matrix_2d(const matrix_2d<U>& other) : _rows(0), _col(0), _matrix(nullptr) {
+		template <typename U, typename B>
+		matrix_2d(const matrix_2d<U, B>& other, const A& alloc = A()) 
+				  : _matrix(nullptr), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
 
-			this->_matrix = new T[other.size()];
+			this->_matrix = cell_storage<T, A>::allocate(_alloc, checked_extent(other.rows(), layout::pitch(other.columns())));
 			this->_rows = other.rows();
 			this->_col = other.columns();
+			this->_pitch = layout::pitch(other.columns());
 			
 			try {
 				for(size_type i=0; i < this->_rows; ++i)
@@ -109,10 +257,11 @@ template <typename T> class matrix_2d {
 					}
 			}
 			catch(...) {
-				delete[] _matrix;
+				cell_storage<T, A>::deallocate(_alloc, _matrix, storage_size());
 				this->_matrix = nullptr;
 				this->_rows = 0;
 				this->_col = 0;
+				this->_pitch = 0;
 				throw;
 			}
 
@@ -131,10 +280,11 @@ template <typename T> class matrix_2d {
 	    @post _col = 0
   	*/
 		~matrix_2d()  {
-			delete[] _matrix;
+			cell_storage<T, A>::deallocate(_alloc, _matrix, storage_size());
 			_matrix = nullptr;
 		 	_rows = 0;
 		 	_col = 0;
+		 	_pitch = 0;
 
 		  #ifndef NDEBUG
 		 	std::cout << "matrix_2d::~matrix_2d()"<< std::endl;
@@ -153,20 +303,25 @@ template <typename T> class matrix_2d {
     	@post _rows = other._rows
     	@post _col = other._col
   	*/
-		matrix_2d(const matrix_2d& other) : _matrix(nullptr), _rows(0), _col(0) {
-		  	_matrix = new T[other.size()];
+		matrix_2d(const matrix_2d& other) 
+				  : _matrix(nullptr), _rows(0), _col(0), _pitch(0), 
+				    _alloc(std::allocator_traits<A>::select_on_container_copy_construction(other._alloc)) {
+		  	_matrix = cell_storage<T, A>::allocate(_alloc, other.storage_size());
 		  	_rows = other._rows;
 		  	_col = other._col;
+		  	_pitch = other._pitch;
 		  	
 		  	try {
-		   		for(size_type i = 0; i < other.size(); ++i)
-		      		_matrix[i] = other._matrix[i];
+		   		for(size_type i = 0; i < _rows; ++i)
+		   			std::copy(other._matrix + i * _pitch, other._matrix + i * _pitch + _col, 
+		   					  _matrix + i * _pitch);
 		  	}
 		  	catch(...) {
-		    	delete[] _matrix;
+		    	cell_storage<T, A>::deallocate(_alloc, _matrix, other.storage_size());
 		    	_matrix = nullptr;
 		    	_rows = 0;
 		    	_col = 0;
+		    	_pitch = 0;
 		    	throw;
 		  }
 		  
@@ -202,6 +357,112 @@ template <typename T> class matrix_2d {
 			
 			return *this;
 		}
+
+		/**
+    	@brief Move Constructor
+
+    	Class move constructor. Creates a new matrix_2d taking the cells and the
+    	allocator of the one given as a parameter, which is left null. No cell is 
+    	copied or allocated.
+
+    	@param other matrix_2d to move from
+    
+    	@post _rows = old other._rows
+    	@post _col = old other._col
+    	@post other._matrix = nullptr
+  	*/
+		matrix_2d(matrix_2d&& other) noexcept : _matrix(other._matrix), _rows(other._rows), _col(other._col),
+												_pitch(other._pitch), _alloc(std::move(other._alloc)) {
+			other._matrix = nullptr;
+			other._rows = 0;
+			other._col = 0;
+			other._pitch = 0;
+
+		  #ifndef NDEBUG
+		  std::cout << "matrix_2d::matrix_2d(matrix_2d&&)"<< std::endl;
+		  #endif
+		}
+
+		/**
+		 * 
+		 * @brief Move assignment operator
+		 * 
+		 * Refefinition of move assignment operator. Takes the cells of another matrix_2d
+		 * object, which is left null. The cells previously owned are released.
+		 * 
+		 * @param other source matrix_2d to move from
+		 * 
+		 * @post _rows = old other._rows
+		 * @post _col = old other._col 
+		 * @post other._matrix = nullptr
+		 * 
+		 * @return current object reference
+	  */
+		matrix_2d& operator=(matrix_2d&& other) noexcept {
+			
+			if(&other != this) {
+				matrix_2d tmp(std::move(other));
+				this->swap(tmp);
+			}
+			
+			#ifndef NDEBUG
+		  std::cout << "matrix_2d::operator=(matrix_2d&& other)" << std::endl;
+		  #endif
+			
+			return *this;
+		}
+
+		/**
+			@brief Expression constructor
+
+			Builds a matrix_2d with the shape of an element-wise expression (see
+			matrix_expr.h) and computes its cells in a single pass. The cells are
+			allocated once and no intermediate matrix is created.
+
+			@param expr expression to evaluate
+			@param alloc allocator of the cells
+
+			@pre expr has at most one plan
+		*/
+		template <typename E>
+		matrix_2d(const matrix_expr<E>& expr, const A& alloc = A()) 
+				  : matrix_2d(expr.self().rows(), expr.self().columns(), alloc) {
+
+			assert(expr.self().plans() <= 1);
+
+			evaluate_expression(expr.self(), _matrix, _pitch, _rows, _col);
+		}
+
+		/**
+			@brief Expression assignment operator
+
+			Computes the cells of an element-wise expression (see matrix_expr.h) into
+			the current matrix_2d in a single pass. If the shapes match, the cells are
+			overwritten in place and nothing is allocated; otherwise the matrix_2d is
+			rebuilt with the shape of expr. The current matrix_2d may appear in expr.
+
+			@param expr expression to evaluate
+
+			@pre expr has at most one plan
+
+			@return current object reference
+		*/
+		template <typename E>
+		matrix_2d& operator=(const matrix_expr<E>& expr) {
+
+			const E& e = expr.self();
+
+			assert(e.plans() <= 1);
+
+			if(e.rows() == _rows && e.columns() == _col)
+				evaluate_expression(e, _matrix, _pitch, _rows, _col);
+			else {
+				matrix_2d tmp(e, _alloc);
+				this->swap(tmp);
+			}
+
+			return *this;
+		}
 		
 		/**
 		 * 
@@ -228,7 +489,7 @@ template <typename T> class matrix_2d {
 			assert(y < _rows);
 			assert(x < _col);
 
-			return _matrix[(y * _col) + x];
+			return _matrix[(y * _pitch) + x];
 		}
 
 		/**
@@ -254,22 +515,36 @@ template <typename T> class matrix_2d {
 			assert(y < _rows);
 			assert(x < _col);
 
-			return _matrix[(y * _col) + x];
+			return _matrix[(y * _pitch) + x];
 		}
 
 		/**
 		 * @brief Class swap method
 		 * 
-		 * Method to swap the contents of two matrix_2d.
+		 * Method to swap the contents of two matrix_2d. The allocators are swapped too,
+		 * so that each block of cells is always released by the allocator that 
+		 * obtained it.
 	
 	    @param other the matrix_2d to exchange content with
 	  */
-		void swap(matrix_2d& other) {
-			std::swap(this->_matrix, other._matrix);
-			std::swap(this->_rows, other._rows);
-			std::swap(this->_col, other._col);
+		void swap(matrix_2d& other) noexcept {
+			using std::swap;
+			swap(this->_matrix, other._matrix);
+			swap(this->_rows, other._rows);
+			swap(this->_col, other._col);
+			swap(this->_pitch, other._pitch);
+			swap(this->_alloc, other._alloc);
 		}
 
+		/**
+		 * @brief Allocator getter
+		 * 
+		 * Returns a copy of the allocator of the cells.
+		 *
+	   * @return allocator of the cells
+	  */
+		allocator_type get_allocator() const {return _alloc;}
+
 		/**
     *	@brief Rows getter
     * 
@@ -288,6 +563,16 @@ template <typename T> class matrix_2d {
 	  */
 		inline size_type columns() const {return _col;}
 
+		/**
+		 * @brief Pitch getter
+		 * 
+		 * Returns the distance, in cells, between the starts of two consecutive rows.
+		 * It equals columns() unless the allocator requires the rows to be padded.
+		 *
+	   * @return row pitch
+	  */
+		inline size_type pitch() const {return _pitch;}
+
 		/**
 		 * @brief Total dimension getter
 		 * 
@@ -296,6 +581,26 @@ template <typename T> class matrix_2d {
 	   * @return matrix dimension
 	  */
 		inline size_type size() const {return _rows * _col;}
+
+		/**
+		 * @brief Cells getter
+		 * 
+		 * Returns a pointer to the first cell of the matrix. Cells are stored
+		 * row after row, and each row starts pitch() cells after the previous one.
+		 *
+	   * @return pointer to the first cell
+	  */
+		inline T* data() {return _matrix;}
+
+		/**
+		 * @brief Read-only cells getter
+		 * 
+		 * Returns a read-only pointer to the first cell of the matrix. Cells are 
+		 * stored row after row, and each row starts pitch() cells after the previous one.
+		 *
+	   * @return read-only pointer to the first cell
+	  */
+		inline const T* data() const {return _matrix;}
 		
 
 		/**
@@ -319,9 +624,10 @@ template <typename T> class matrix_2d {
 			if(this->_rows != other._rows || this->_col != other._col)
 				return false;
 			
-			for(size_type i=0; i < this->size(); ++i)
-				if(!equality(this->_matrix[i], other._matrix[i]))
-					return false;
+			for(size_type i=0; i < this->_rows; ++i)
+				for(size_type j=0; j < this->_col; ++j)
+					if(!equality(this->_matrix[i * _pitch + j], other._matrix[i * _pitch + j]))
+						return false;
 					
 			return true;
 		}
@@ -380,6 +686,39 @@ template <typename T> class matrix_2d {
 	  */
 		matrix_2d* slice(size_type y1, size_type y2,
 								size_type x1, size_type x2) const {
+			
+			return new matrix_2d(this->slice(y1, y2, x1, x2, by_value));
+		}
+
+		/**
+	    @brief 2-dimensional submatrix extraction by value
+	
+	    Returns a matrix_2d extracted from the current matrix_2d instance. 
+	    Indexes start from 0 and both lower and upper limits are included. 
+	    The submatrix is built directly in the returned object, so its cells
+	    are allocated once and never copied again.
+	    If the submatrix extraction fails, the exception is rethrown to the caller.
+	
+	    @param y1 starting row
+	    @param y2 final row
+	    @param x1 starting column
+	    @param x2 final column
+
+	    @pre y1 >= 0
+	    @pre y1 < _rows
+	    @pre x1 >= 0
+	    @pre x1 < _col
+	    @pre y2 >= 0	   
+	    @pre y2 < _rows
+	    @pre x2 >= 0
+	    @pre x2 < _col
+	    @pre y1 <= y2
+	    @pre x1 <= x2
+
+	    @return submatrix [y1:y2, x1:x2]
+	  */
+		matrix_2d slice(size_type y1, size_type y2,
+						size_type x1, size_type x2, by_value_t) const {
 							
 			assert(y1 >= 0 && y1 < this->_rows);
 			assert(y2 >= 0 && y2 < this->_rows);
@@ -389,19 +728,76 @@ template <typename T> class matrix_2d {
 			assert(x2 >= 0 && x2 < this->_col);
 			assert(x1 <= x2);
 			
-			matrix_2d* submatrix = new matrix_2d(y2 - y1 + 1, x2 - x1 + 1);
+			return matrix_2d(*this, y1, y2, x1, x2);
+		}
 
-			try {
-				for(size_type i = y1; i <= y2; ++i)
-					for(size_type j = x1; j <= x2; ++j)
-						(*submatrix)(i - y1, j - x1) = (*this)(i, j);
-			}
-			catch(...) {
-				delete submatrix;
-				throw;
-			}
-					
-			return submatrix;
+		/**
+	    @brief 2-dimensional view extraction
+	
+	    Returns a view on the cells [y1:y2, x1:x2] of the current matrix_2d instance. 
+	    Indexes start from 0 and both lower and upper limits are included. No cell is
+	    copied: the view aliases the cells of the matrix_2d and is valid as long as
+	    the matrix_2d is neither destroyed nor reassigned.
+
+	    @param y1 starting row
+	    @param y2 final row
+	    @param x1 starting column
+	    @param x2 final column
+
+	    @pre y1 <= y2
+	    @pre y2 < _rows
+	    @pre x1 <= x2
+	    @pre x2 < _col
+
+	    @return view on [y1:y2, x1:x2]
+	  */
+		matrix_2d_view<T> view(size_type y1, size_type y2, size_type x1, size_type x2) {
+			return matrix_2d_view<T>(_matrix, _rows, _col, _pitch).view(y1, y2, x1, x2);
+		}
+
+		/**
+	    @brief 2-dimensional read-only view extraction
+	
+	    Returns a read-only view on the cells [y1:y2, x1:x2] of the current matrix_2d 
+	    instance. Indexes start from 0 and both lower and upper limits are included.
+	    No cell is copied.
+
+	    @param y1 starting row
+	    @param y2 final row
+	    @param x1 starting column
+	    @param x2 final column
+
+	    @pre y1 <= y2
+	    @pre y2 < _rows
+	    @pre x1 <= x2
+	    @pre x2 < _col
+
+	    @return read-only view on [y1:y2, x1:x2]
+	  */
+		matrix_2d_view<const T> view(size_type y1, size_type y2, size_type x1, size_type x2) const {
+			return matrix_2d_view<const T>(_matrix, _rows, _col, _pitch).view(y1, y2, x1, x2);
+		}
+
+		/**
+	    @brief Whole matrix view
+
+	    Returns a view on all the cells of the current matrix_2d instance.
+
+	    @return view on the whole matrix_2d
+	  */
+		matrix_2d_view<T> view() {
+			return matrix_2d_view<T>(_matrix, _rows, _col, _pitch);
+		}
+
+		/**
+	    @brief Whole matrix read-only view
+
+	    Returns a read-only view on all the cells of the current matrix_2d instance.
+
+	    @return read-only view on the whole matrix_2d
+	  */
+		matrix_2d_view<const T> view() const {
+			return matrix_2d_view<const T>(_matrix, _rows, _col, _pitch);
 		}
 
 	/**
@@ -419,30 +815,29 @@ template <typename T> class matrix_2d {
 		template <typename I>
 		void fill(I start, I end) {
 			
-			size_type i = 0;
-
-			T* tmp = new T[this->size()];
+			T* tmp = cell_storage<T, A>::allocate(_alloc, this->storage_size());
 
 			try {
-				while(i < this->size() && start != end) {
-					tmp[i] = static_cast<T>(*start);	
-					++start;
-					++i;
-				} 
-
-				while(i < this->size()) {
-					tmp[i] = this->_matrix[i];
-					++i;
-				}
+				for(size_type i = 0; i < this->_rows; ++i)
+					for(size_type j = 0; j < this->_col; ++j) {
+						size_type k = i * this->_pitch + j;
+
+						if(start != end) {
+							tmp[k] = static_cast<T>(*start);
+							++start;
+						}
+						else
+							tmp[k] = this->_matrix[k];
+					}
 			}
 
 			catch(...) {
-				delete[] tmp;
+				cell_storage<T, A>::deallocate(_alloc, tmp, this->storage_size());
 				throw;
 			}
 
 			std::swap(this->_matrix, tmp);
-			delete[] tmp;
+			cell_storage<T, A>::deallocate(_alloc, tmp, this->storage_size());
 		}
 
 	/**
@@ -462,47 +857,48 @@ template <typename T> class matrix_2d {
 		template <typename I>
 		void fill(I& start, I& end, int) {
 			
-			size_type i = 0;
-
-			T* tmp = new T[this->size()];
+			T* tmp = cell_storage<T, A>::allocate(_alloc, this->storage_size());
 
 			try {
-				while(i < this->size() && start != end) {
-					tmp[i] = static_cast<T>(*start);	
-					++start;
-					++i;
-				} 
-
-				while(i < this->size()) {
-					tmp[i] = this->_matrix[i];
-					++i;
-				}
+				for(size_type i = 0; i < this->_rows; ++i)
+					for(size_type j = 0; j < this->_col; ++j) {
+						size_type k = i * this->_pitch + j;
+
+						if(start != end) {
+							tmp[k] = static_cast<T>(*start);
+							++start;
+						}
+						else
+							tmp[k] = this->_matrix[k];
+					}
 			}
 
 			catch(...) {
-				delete[] tmp;
+				cell_storage<T, A>::deallocate(_alloc, tmp, this->storage_size());
 				throw;
 			}
 
 			std::swap(this->_matrix, tmp);
-			delete[] tmp; 		
+			cell_storage<T, A>::deallocate(_alloc, tmp, this->storage_size()); 		
 		}
 
 	/**
 	 * @brief Random access iterator
 	 
   	Random access iterator for the matrix_2d class. The iterator is mapped
-   	into a pointer to the data type T.
+   	into a pointer to the data type T, or into a pitched_iterator skipping the
+   	padding at the end of each row when the rows can be padded.
 	*/
-		typedef T* iterator;
+		typedef typename std::conditional<layout::padded, pitched_iterator<T>, T*>::type iterator;
 
 	/**
 	 * @brief Read-only random access iterator
 
   	Random access iterator for the matrix_2d class. The iterator is mapped
-   	into a constant pointer to the data type T. 
+   	into a constant pointer to the data type T, or into a read-only 
+   	pitched_iterator when the rows can be padded.
 	*/
-		typedef const T* const_iterator;
+		typedef typename std::conditional<layout::padded, pitched_iterator<const T>, const T*>::type const_iterator;
 
  	/**
 		@brief Sequence start iterator
@@ -510,7 +906,7 @@ template <typename T> class matrix_2d {
 		Returns the start-sequence read/write iterator of a matrix_2d.
 	*/
 		iterator begin() {
-			return _matrix;
+			return make_iterator<iterator>(_matrix, 0);
 		}
 
 	/**
@@ -519,7 +915,7 @@ template <typename T> class matrix_2d {
 		Returns the end-sequence read/write iterator of a matrix_2d.
 	*/
 		iterator end() {
-			return _matrix + this->size();
+			return make_iterator<iterator>(_matrix, _rows);
 		}
 
 	/**
@@ -528,7 +924,7 @@ template <typename T> class matrix_2d {
 		Returns the start-sequence read-only iterator of a matrix_2d.
 	*/
 		const_iterator begin() const {
-			return _matrix;
+			return make_iterator<const_iterator>(_matrix, 0);
 		}
 
 	/**
@@ -537,7 +933,25 @@ template <typename T> class matrix_2d {
 		Returns the end-of-sequence read-only iterator of a matrix_2d.
 	*/
 		const_iterator end() const {
-			return _matrix + this->size();
+			return make_iterator<const_iterator>(_matrix, _rows);
+		}
+
+	private:
+
+		/**
+			@brief Iterator factory
+
+			@param data first cell of the matrix
+			@param row row the iterator points to the first cell of
+
+			@return iterator of type I on the first cell of the given row
+		*/
+		template <typename I, typename P>
+		I make_iterator(P* data, size_type row) const {
+			if constexpr (layout::padded)
+				return I(data + row * _pitch, _col, _pitch);
+			else
+				return data + row * _col;
 		}
 };
 
@@ -552,19 +966,42 @@ template <typename T> class matrix_2d {
 
 	@return ostream reference
 */
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const matrix_2d<T>& matrix) {
+template <typename T, typename A>
+std::ostream& operator<<(std::ostream& os, const matrix_2d<T, A>& matrix) {
 
-		for(typename matrix_2d<T>::size_type i = 0; i < matrix.rows(); ++i) {
-			for(typename matrix_2d<T>::size_type j = 0; j < matrix.columns(); ++j)
-				std::cout << matrix(i, j) << " ";
-			std::cout << std::endl;
+		for(typename matrix_2d<T, A>::size_type i = 0; i < matrix.rows(); ++i) {
+			for(typename matrix_2d<T, A>::size_type j = 0; j < matrix.columns(); ++j)
+				os << matrix(i, j) << " ";
+			os << std::endl;
 		}
 
 		return os;
 }
 
 
+/**
+		@brief Transformation function by value
+
+		Returns a new matrix_2d from the source matrix_2d given as parameter, 
+		obtained by applying the functor func to each element of the source array.
+		The result is built directly in the returned object, so its cells are 
+		allocated once and never copied again. They are obtained from a copy of
+		the allocator of source, rebound to T.
+	
+		@pre func : W -> T
+
+		@param source source matrix_2d
+		@param func functor to applicate
+
+		@return the transformed matrix_2d
+*/
+template <typename T, typename W, typename A, typename F>
+matrix_2d<T, rebind_allocator<A, T>> transform(const matrix_2d<W, A>& source, const F func, by_value_t) {
+
+	return matrix_2d<T, rebind_allocator<A, T>>(source, func, by_value);
+}
+
+
 /**
 		@brief Transformation function
 
@@ -578,24 +1015,10 @@ std::ostream& operator<<(std::ostream& os, const matrix_2d<T>& matrix) {
 
 		@return pointer to the transformed matrix_2d
 */
-template <typename T, typename W, typename F>
-matrix_2d<T>* transform(const matrix_2d<W>& source, const F func) {
+template <typename T, typename W, typename A, typename F>
+matrix_2d<T, rebind_allocator<A, T>>* transform(const matrix_2d<W, A>& source, const F func) {
 		
-	matrix_2d<T>* transformed = new matrix_2d<T>(source.rows(), 
-																							source.columns());
-
-	try {
-		for(typename matrix_2d<W>::size_type i = 0; i < source.rows(); ++i)
-			for(typename matrix_2d<W>::size_type j = 0; j < source.columns(); ++j) {
-				(*transformed)(i, j) = func(source(i, j));
-			}
-		}
-	catch(...) {
-		delete transformed;
-		throw;
-	}
-				
-	return transformed;
+	return new matrix_2d<T, rebind_allocator<A, T>>(transform<T>(source, func, by_value));
 }
 
 #endif
@@ -1,9 +1,24 @@
 #ifndef MATRIX_3D
 #define MATRIX_3D
 
-#include <iterator> // std::forward_iterator_tag
+#include <iterator> // std::random_access_iterator_tag, std::contiguous_iterator_tag
 #include <cstddef> // std::ptrdiff_t
+#include <algorithm> // std::copy
+#include <span>
+#include <type_traits>
 #include "matrix_2d.h"
+#include "matrix_parallel.h"
+#include "matrix_pipeline.h"
+#include "matrix_reduce.h"
+#include "matrix_stencil.h"
+#include "matrix_permute.h"
+#include "matrix_integral.h"
+#include "matrix_fixed.h"
+#include "matrix_io.h"
+#include "matrix_compressed.h"
+#include "matrix_sparse.h"
+#include "matrix_cow.h"
+#include "matrix_bitmask.h"
 
 //#define NDEBUG
 
@@ -16,24 +31,304 @@
 /**
   @brief Class for representing a three-dimensional array
 
-  Class that encapsulates a three-dimensional array. It used a one-dimensional
-  array of two-dimensional matrix (matrix_2d) to simulate the presence of
-  the three-dimensional array.
+  Class that encapsulates a three-dimensional array. All the cells are stored in a
+  single contiguous buffer, plan after plan and row after row, so that the whole 
+  matrix costs one allocation for the cells. A one-dimensional array of 
+  two-dimensional matrix (matrix_2d) bound to the buffer exposes each plan.
+  Both the buffer and the array of plans are obtained from an allocator of type A,
+  std::allocator by default. Rows are pitch() cells apart, with the same padding
+  rules of matrix_2d, and plans are rows() * pitch() cells apart.
 */
 
-template <typename T> class matrix_3d {
+template <typename T, typename A> class matrix_3d {
 	
 	public:
 
 		/**
 			@brief Data type to represent the dimensions of the three-dimensional matrix
 		*/
-		typedef typename matrix_2d<T>::size_type size_type;
+		typedef typename matrix_2d<T, A>::size_type size_type;
+
+		/**
+			@brief Data type of the allocator of the cells
+		*/
+		typedef A allocator_type;
 	
 	private:
 
-		matrix_2d<T>* _vect;
+		typedef rebind_allocator<A, matrix_2d<T, A>> plan_allocator;
+		typedef std::allocator_traits<plan_allocator> plan_traits;
+
+		T* _data;
+		matrix_2d<T, A>* _vect;
 		size_type _size;
+		size_type _rows;
+		size_type _col;
+		size_type _pitch;
+		A _alloc;
+
+		typedef row_layout<T, A> layout;
+
+		template <typename U, typename B> friend class matrix_3d;
+
+		/**
+			@brief Allocation method
+
+			Allocates the buffer for z plans of y padded rows and the array of plans bound
+			to it.
+			If x = 0 or y = 0 or z = 0, the matrix_3d is left null. If the allocation fails, 
+			the matrix_3d is left null and the exception is rethrown to the caller; if the
+			number of cells does not fit in a size_type, std::length_error is thrown.
+
+			@pre _data = nullptr
+			@pre _vect = nullptr
+		*/
+		void allocate(size_type z, size_type y, size_type x) {
+
+			if(z == 0 || y == 0 || x == 0)
+				return;
+
+			const size_type cells = checked_extent(checked_extent(z, y), layout::pitch(x));
+			const size_type pitch = layout::pitch(x);
+
+			_data = cell_storage<T, A>::allocate(_alloc, cells);
+
+			plan_allocator plan_alloc(_alloc);
+
+			try {
+				_vect = plan_traits::allocate(plan_alloc, z);
+			}
+			catch(...) {
+				cell_storage<T, A>::deallocate(_alloc, _data, cells);
+				_data = nullptr;
+				throw;
+			}
+
+			_size = z;
+			_rows = y;
+			_col = x;
+			_pitch = pitch;
+
+			// Bounded by cells, so that the offsets visibly stay inside the block.
+			const size_type plan_cells = cells / z;
+
+			for(size_type i = 0, offset = 0; offset < cells; ++i, offset += plan_cells) {
+				plan_traits::construct(plan_alloc, _vect + i, _alloc);
+				_vect[i].bind(_data + offset, _rows, _col);
+			}
+		}
+
+		/**
+			@brief Release method
+
+			Deallocates the buffer and the array of plans, leaving a null matrix_3d.
+		*/
+		void release() {
+
+			if(_vect != nullptr) {
+				plan_allocator plan_alloc(_alloc);
+
+				for(size_type i = 0; i < _size; ++i) {
+					_vect[i].unbind();
+					plan_traits::destroy(plan_alloc, _vect + i);
+				}
+
+				plan_traits::deallocate(plan_alloc, _vect, _size);
+			}
+
+			cell_storage<T, A>::deallocate(_alloc, _data, storage_size());
+			_vect = nullptr;
+			_data = nullptr;
+			_size = 0;
+			_rows = 0;
+			_col = 0;
+			_pitch = 0;
+		}
+
+		/**
+			@brief Storage size getter
+
+			@return number of allocated cells, padding included
+		*/
+		size_type storage_size() const {
+			return this->_size * this->_rows * this->_pitch;
+		}
+
+		/**
+			@brief Row getter
+
+			@param r row of the whole matrix_3d, i.e. row r % _rows of plan r / _rows
+
+			@return pointer to the first cell of the row
+		*/
+		T* row(size_type r) const {
+			return this->_data + r * this->_pitch;
+		}
+
+		/**
+			@brief Visit helper
+
+			Calls f(arg). If f returns a bool, its value is returned, so that f can
+			stop the traversal by returning false; otherwise true is returned.
+		*/
+		template <typename F, typename U>
+		static bool visit(F& f, U&& arg) {
+			if constexpr (std::is_same<std::invoke_result_t<F&, U>, bool>::value)
+				return f(std::forward<U>(arg));
+			else {
+				f(std::forward<U>(arg));
+				return true;
+			}
+		}
+
+		/**
+			@brief Rows traversal implementation
+
+			Shared by the read/write and read-only for_each_row(): E is T or const T.
+		*/
+		template <typename E, typename F>
+		bool rows_of(F& f) const {
+			for(size_type r = 0; r < this->_size * this->_rows; ++r)
+				if(!visit(f, std::span<E>(row(r), this->_col)))
+					return false;
+
+			return true;
+		}
+
+		/**
+			@brief Plans traversal implementation
+
+			Shared by the read/write and read-only for_each_plane(): E is T or const T.
+		*/
+		template <typename E, typename F>
+		bool plans_of(F& f) const {
+			for(size_type z = 0; z < this->_size; ++z)
+				if(!visit(f, matrix_2d_view<E>(row(z * this->_rows), this->_rows, this->_col, this->_pitch)))
+					return false;
+
+			return true;
+		}
+
+		/**
+			@brief Spans traversal implementation
+
+			Shared by the read/write and read-only for_each_span(): E is T or const T.
+			Without padding the whole buffer is a single run, otherwise each row is.
+		*/
+		template <typename E, typename F>
+		bool spans_of(F& f, size_type max_length) const {
+
+			const bool packed = this->_pitch == this->_col;
+			const size_type runs = packed ? (this->size() > 0 ? 1 : 0) : this->_size * this->_rows;
+			const size_type length = packed ? this->size() : this->_col;
+			const size_type step = max_length > 0 ? max_length : length;
+
+			for(size_type r = 0; r < runs; ++r) {
+				T* run = row(r);
+
+				for(size_type first = 0; first < length; first += step)
+					if(!visit(f, std::span<E>(run + first, std::min(step, length - first))))
+						return false;
+			}
+
+			return true;
+		}
+
+		/**
+			@brief Parallel rows loop
+
+			Calls body(first, last) on chunks of the rows [0, n) of the whole matrix_3d,
+			each made of about policy.grain cells, through parallel_for().
+
+			@param n number of rows
+			@param policy parallel settings
+			@param body functor called on each chunk of rows
+		*/
+		template <typename F>
+		void for_rows(size_type n, const parallel_t& policy, const F& body) const {
+			
+			const std::size_t per_chunk = std::max<std::size_t>(1, policy.grain / std::max<size_type>(1, _col));
+
+			parallel_for(n, per_chunk, policy, [&body] (std::size_t first, std::size_t last) {
+				body(static_cast<size_type>(first), static_cast<size_type>(last));
+			});
+		}
+
+		/**
+			@brief Slicing constructor
+
+			Builds the submatrix [z1:z2, y1:y2, x1:x2] of source, copying one row at a
+			time. Used by slice() to return the submatrix by value. If the copy fails,
+			the delegated constructor has already completed, so the destructor releases
+			the cells.
+		*/
+		matrix_3d(const matrix_3d& source, size_type z1, size_type z2,
+				  size_type y1, size_type y2, size_type x1, size_type x2) 
+				  : matrix_3d(z2 - z1 + 1, y2 - y1 + 1, x2 - x1 + 1, source._alloc) {
+
+			for(size_type k = z1; k <= z2; ++k)
+				for(size_type i = y1; i <= y2; ++i) {
+					const T* src = source.row(k * source._rows + i);
+					std::copy(src + x1, src + x2 + 1, row((k - z1) * _rows + (i - y1)));
+				}
+		}
+
+		/**
+			@brief Transformation constructor
+
+			Builds a matrix_3d with the shape of source, obtained by applying func to 
+			each of its cells. The cells are obtained from a rebound copy of the allocator
+			of source. Used by transform() to return the result by value. The cells are
+			transformed by transform_cells(), in a single run over the whole buffer when
+			neither matrix has padded rows, one row at a time otherwise. If func throws,
+			the destructor releases the cells.
+		*/
+		template <typename W, typename B, typename F>
+		matrix_3d(const matrix_3d<W, B>& source, const F& func, by_value_t) 
+				  : matrix_3d(source.plans(), source.rows(), source.columns(), A(source._alloc)) {
+
+			if(_pitch == _col && source._pitch == source._col)
+				this->for_each_span([&] (std::span<T> cells) {
+					transform_cells(source._data + (cells.data() - _data), cells.data(), cells.size(), func);
+				});
+			else {
+				size_type r = 0;
+
+				this->for_each_row([&] (std::span<T> cells) {
+					transform_cells(source.row(r++), cells.data(), cells.size(), func);
+				});
+			}
+		}
+
+		template <typename Q, typename W, typename B, typename F>
+		friend matrix_3d<Q, rebind_allocator<B, Q>> transform(const matrix_3d<W, B>& source, 
+															  const F func, by_value_t);
+
+		/**
+			@brief Parallel transformation constructor
+
+			Same as the transformation constructor, with the rows split among the
+			workers of policy. If func throws, the first exception is rethrown once
+			all the workers have stopped and the destructor releases the cells.
+		*/
+		template <typename W, typename B, typename F>
+		matrix_3d(const matrix_3d<W, B>& source, const F& func, const parallel_t& policy) 
+				  : matrix_3d(source.plans(), source.rows(), source.columns(), A(source._alloc)) {
+
+			const bool packed = _pitch == _col && source._pitch == source._col;
+
+			for_rows(_size * _rows, policy, [&] (size_type first, size_type last) {
+				if(packed)
+					transform_cells(source.row(first), row(first), (last - first) * _col, func);
+				else
+					for(size_type r = first; r < last; ++r)
+						transform_cells(source.row(r), row(r), _col, func);
+			});
+		}
+
+		template <typename Q, typename W, typename B, typename F>
+		friend matrix_3d<Q, rebind_allocator<B, Q>> transform(const matrix_3d<W, B>& source, 
+															  const F func, const parallel_t& policy);
 
 	public:
 		
@@ -42,15 +337,36 @@ template <typename T> class matrix_3d {
 
     		Initialize the object to a null three-dimensional array.
 
+	   		@post _data = nullptr
 	   		@post _vect = nullptr
 	   		@post _size = 0
   		*/
-		matrix_3d(void) : _vect(nullptr), _size(0) {
+		matrix_3d(void) : _data(nullptr), _vect(nullptr), _size(0), _rows(0), _col(0), _pitch(0), _alloc() {
 			
 			#ifndef NDEBUG
 			std::cout << "matrix_3d::matrix_3d()" << std::endl;
 			#endif
 		}
+
+		/**
+	    	@brief Allocator constructor
+
+    		Initialize the object to a null three-dimensional array that will obtain
+    		its cells from the given allocator.
+
+    		@param alloc allocator of the cells
+
+	   		@post _data = nullptr
+	   		@post _vect = nullptr
+	   		@post _size = 0
+  		*/
+		explicit matrix_3d(const A& alloc) : _data(nullptr), _vect(nullptr), _size(0), 
+											 _rows(0), _col(0), _pitch(0), _alloc(alloc) {
+			
+			#ifndef NDEBUG
+			std::cout << "matrix_3d::matrix_3d(const A&)" << std::endl;
+			#endif
+		}
 		
 		/**
 	    	@brief Parameterized constructor
@@ -62,43 +378,24 @@ template <typename T> class matrix_3d {
 			@param z number of plans
 			@param y number of rows
 	    	@param x number of columns
+	    	@param alloc allocator of the cells
 	    	
 			@pre z >= 0
 			@pre y >= 0
 	    	@pre x >= 0
 
+	    	@post _data != nullptr
 	    	@post _vect != nullptr
 	    	@post _size = z
-	    	@post _vect[i] != nullptr
 	  	*/
-		matrix_3d(size_type z, size_type y, size_type x) : _vect(nullptr), _size(0) {
+		matrix_3d(size_type z, size_type y, size_type x, const A& alloc = A()) 
+				  : _data(nullptr), _vect(nullptr), _size(0), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
 
 			assert(z >= 0);
 			assert(x >= 0);
 			assert(y >= 0);
 
-			if(x > 0 && y > 0) {
-
-				_vect = new matrix_2d<T>[z];
-				_size = z;
-
-				matrix_2d<T>* tmp = nullptr;
-				
-				try {
-					for(size_type i = 0; i < _size; ++i) {
-						tmp = new matrix_2d<T>(y, x);
-						tmp->swap(_vect[i]);
-						delete tmp;
-						tmp = nullptr;
-					}
-				}
-				catch(...) {
-					delete[] _vect;
-					_vect = nullptr;
-					_size = 0;
-					throw;
-				}
-			}
+			allocate(z, y, x);
 
 			#ifndef NDEBUG
 			std::cout << "matrix_3d::matrix_3d(size_type, size_type, size_type)" << std::endl;
@@ -109,31 +406,26 @@ template <typename T> class matrix_3d {
 			@brief Conversion copy constructor
 			
 			Constructor from another matrix_3d on a different template parameter
-			U. If in the casting procedure generates an exception, a null matrix_3d is 
-			created and the exception is rethrown to the caller.
+			U, or on a different allocator B. If in the casting procedure generates an
+			exception, a null matrix_3d is created and the exception is rethrown to the
+			caller.
 			
 			@param source matrix_2d to build the new matrix_2d
+			@param alloc allocator of the cells
 		*/
-		template <typename U>
-		matrix_3d(const matrix_3d<U>& other) : _vect(nullptr), _size(0) {
-
-			this->_vect = new matrix_2d<T>[other.plans()];
-			this->_size = other.plans();
+		template <typename U, typename B>
+		matrix_3d(const matrix_3d<U, B>& other, const A& alloc = A()) 
+				  : _data(nullptr), _vect(nullptr), _size(0), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
 
-			matrix_2d<T>* tmp = nullptr;
+			this->allocate(other.plans(), other.rows(), other.columns());
 			
 			try {
-				for(size_type i=0; i < other.plans(); ++i) {
-					tmp = new matrix_2d<T>(other[i]);
-					tmp->swap(this->_vect[i]); 
-					delete tmp;
-					tmp = nullptr;
-				}
+				for(size_type r=0; r < this->_size * this->_rows; ++r)
+					for(size_type j=0; j < this->_col; ++j)
+						this->row(r)[j] = static_cast<T>(other.row(r)[j]);
 			}
 			catch(...) {
-				delete[] _vect;
-				this->_vect = nullptr;
-				this->_size = 0;
+				this->release();
 				throw;
 			}
 
@@ -147,14 +439,13 @@ template <typename T> class matrix_3d {
 
     		Class destructor. Deallocates the simulating array from heap.
 
+	    	@post _data = nullptr
 	    	@post _vect = nullptr
 	    	@post _size = 0
   		*/
 		~matrix_3d() {
 			
-			delete[] _vect;
-			_vect = nullptr;
-			_size = 0;
+			release();
 			
 			#ifndef NDEBUG
 		 	std::cout << "matrix_3d::~matrix_3d()"<< std::endl;
@@ -169,21 +460,22 @@ template <typename T> class matrix_3d {
 
 	    	@param other matrix_3d to copy
 	    
+	    	@post _data != nullptr
 	    	@post _vect != nullptr
 	    	@post _size = other._size
   		*/
-		matrix_3d(const matrix_3d& other) : _vect(nullptr), _size(0) {
+		matrix_3d(const matrix_3d& other) 
+				  : _data(nullptr), _vect(nullptr), _size(0), _rows(0), _col(0), _pitch(0),
+				    _alloc(std::allocator_traits<A>::select_on_container_copy_construction(other._alloc)) {
 			
-			_vect = new matrix_2d<T>[other._size];
-			_size = other._size;
+			allocate(other._size, other._rows, other._col);
 			
 			try {
-				for(size_type i = 0; i < _size; ++i)
-					_vect[i] = other._vect[i];
+				for(size_type r = 0; r < _size * _rows; ++r)
+					std::copy(other.row(r), other.row(r) + _col, row(r));
 			}
 			catch(...) {
-				delete[] _vect;
-				_size = 0;
+				release();
 				throw;
 			}
 	
@@ -218,6 +510,118 @@ template <typename T> class matrix_3d {
 			return *this;
 		}
 
+		/**
+	    	@brief Move Constructor
+
+    		Class move constructor. Creates a new matrix_3d taking the buffer, the plans
+    		and the allocator of the one given as a parameter, which is left null. No cell
+    		is copied or allocated.
+
+	    	@param other matrix_3d to move from
+	    
+	    	@post _size = old other._size
+	    	@post other._data = nullptr
+	    	@post other._vect = nullptr
+	    	@post other._size = 0
+  		*/
+		matrix_3d(matrix_3d&& other) noexcept : _data(other._data), _vect(other._vect), 
+												_size(other._size), _rows(other._rows), 
+												_col(other._col), _pitch(other._pitch), 
+												_alloc(std::move(other._alloc)) {
+			other._data = nullptr;
+			other._vect = nullptr;
+			other._size = 0;
+			other._rows = 0;
+			other._col = 0;
+			other._pitch = 0;
+	
+			#ifndef NDEBUG
+			std::cout << "matrix_3d::matrix_3d(matrix_3d&& other)" << std::endl;
+			#endif
+		}
+
+		/**
+		    @brief Move assignment operator
+	
+	    	Refefinition of move assignment operator. Takes the buffer and the plans of 
+	    	another matrix_3d object, which is left null. The cells previously owned are
+	    	released.
+	
+	    	@param other source matrix_3d to move from
+			
+		    @post _size = old other._size
+		    @post other._data = nullptr
+
+		    @return current object reference
+	  	*/
+		matrix_3d& operator=(matrix_3d&& other) noexcept {
+			
+			if(this != &other) {
+				matrix_3d tmp(std::move(other));
+				this->swap(tmp);
+			}
+			
+			#ifndef NDEBUG
+		  	std::cout << "matrix_3d::operator=(matrix_3d&& other)" << std::endl;
+		 	#endif
+
+			return *this;
+		}
+
+		/**
+			@brief Expression constructor
+
+			Builds a matrix_3d with the shape of an element-wise expression (see
+			matrix_expr.h), such as a * 0.5 + b - c, and computes its cells in a single
+			pass. The cells are allocated once and no intermediate matrix is created.
+			If the evaluation throws, the cells are released and the exception is
+			rethrown to the caller.
+
+			@param expr expression to evaluate
+			@param alloc allocator of the cells
+		*/
+		template <typename E>
+		matrix_3d(const matrix_expr<E>& expr, const A& alloc = A()) 
+				  : _data(nullptr), _vect(nullptr), _size(0), _rows(0), _col(0), _pitch(0), _alloc(alloc) {
+
+			allocate(expr.self().plans(), expr.self().rows(), expr.self().columns());
+
+			try {
+				evaluate_expression(expr.self(), _data, _pitch, _size * _rows, _col);
+			}
+			catch(...) {
+				release();
+				throw;
+			}
+		}
+
+		/**
+			@brief Expression assignment operator
+
+			Computes the cells of an element-wise expression (see matrix_expr.h) into
+			the current matrix_3d in a single pass. If the shapes match, the cells are
+			overwritten in place and nothing is allocated; otherwise the matrix_3d is
+			rebuilt with the shape of expr. The current matrix_3d may appear in expr.
+
+			@param expr expression to evaluate
+
+			@return current object reference
+		*/
+		template <typename E>
+		matrix_3d& operator=(const matrix_expr<E>& expr) {
+
+			const E& e = expr.self();
+
+			if(e.plans() == _size && e.rows() == _rows && e.columns() == _col)
+				evaluate_expression(e, _data, _pitch, _size * _rows, _col);
+			else {
+				matrix_3d tmp(e, _alloc);
+				this->swap(tmp);
+			}
+
+			return *this;
+		}
+
 		/**
 	    	@brief z-th plan getter
 
@@ -231,7 +635,7 @@ template <typename T> class matrix_3d {
 
 		    @return read-only reference to the z-th plan
 	  	*/
-		const matrix_2d<T>& operator[](size_type i) const {
+		const matrix_2d<T, A>& operator[](size_type i) const {
 			assert(i >= 0);
 			assert(i < _size);
 			
@@ -261,8 +665,12 @@ template <typename T> class matrix_3d {
 
 			assert(z >= 0);
 			assert(z < _size);
+			assert(y >= 0);
+			assert(y < _rows);
+			assert(x >= 0);
+			assert(x < _col);
 
-			return _vect[z](y, x);
+			return _data[(z * _rows + y) * _pitch + x];
 		}
 
 		/**
@@ -288,20 +696,43 @@ template <typename T> class matrix_3d {
 
 			assert(z >= 0);
 			assert(z < _size);
+			assert(y >= 0);
+			assert(y < _rows);
+			assert(x >= 0);
+			assert(x < _col);
 
-			return _vect[z](y, x);
+			return _data[(z * _rows + y) * _pitch + x];
 		}
 
 		/**
 	    	@brief Class swap method
 		
-			Method to swap the contents of two matrix_3d.
+			Method to swap the contents of two matrix_3d. The allocators are swapped too,
+			so that the buffer and the plans are always released by the allocator that 
+			obtained them.
 	
 	    	@param other the matrix_3d to exchange content with
 	  	*/
-		void swap(matrix_3d& other) {
-			std::swap(this->_vect, other._vect);
-			std::swap(this->_size, other._size);
+		void swap(matrix_3d& other) noexcept {
+			using std::swap;
+			swap(this->_data, other._data);
+			swap(this->_vect, other._vect);
+			swap(this->_size, other._size);
+			swap(this->_rows, other._rows);
+			swap(this->_col, other._col);
+			swap(this->_pitch, other._pitch);
+			swap(this->_alloc, other._alloc);
+		}
+
+		/**
+    		@brief Allocator getter
+			
+			Method that returns a copy of the allocator of the cells.
+
+	    	@return allocator of the cells
+	  	*/
+		allocator_type get_allocator() const {
+			return this->_alloc;
 		}
 
 		/**
@@ -312,7 +743,7 @@ template <typename T> class matrix_3d {
 	    	@return number of rows
 	  	*/
 		inline size_type rows() const {
-			return this->_size == 0 ? 0 : this->_vect[0].rows();
+			return this->_rows;
 		}
 
 		/**
@@ -323,7 +754,20 @@ template <typename T> class matrix_3d {
 	    	@return number of columns
 	  	*/
 		inline size_type columns() const {
-			return this->_size == 0 ? 0 : this->_vect[0].columns();
+			return this->_col;
+		}
+
+		/**
+    		@brief Pitch getter
+			
+			Method that returns the distance, in cells, between the starts of two 
+			consecutive rows. It equals columns() unless the allocator requires the rows
+			to be padded.
+
+	    	@return row pitch
+	  	*/
+		inline size_type pitch() const {
+			return this->_pitch;
 		}
 
 		/**
@@ -337,42 +781,234 @@ template <typename T> class matrix_3d {
 			return this->_size;
 		}
 
-		/**
-    		@brief Total dimension getter
-			
-			Method that returns the matrix total dimension.
+		/**
+    		@brief Total dimension getter
+			
+			Method that returns the matrix total dimension.
+
+	    	@return matrix dimension
+	  	*/		
+	  	inline size_type size() const {
+			return this->_size * this->_rows * this->_col; 
+		}
+
+		/**
+    		@brief Cells getter
+			
+			Method that returns a pointer to the first cell of the matrix. Cells are
+			stored plan after plan and row after row, and each row starts pitch() cells
+			after the previous one.
+
+	    	@return pointer to the first cell
+	  	*/
+		inline T* data() {
+			return this->_data;
+		}
+
+		/**
+    		@brief Read-only cells getter
+			
+			Method that returns a read-only pointer to the first cell of the matrix. 
+			Cells are stored plan after plan and row after row, and each row starts 
+			pitch() cells after the previous one.
+
+	    	@return read-only pointer to the first cell
+	  	*/
+		inline const T* data() const {
+			return this->_data;
+		}
+
+		/**
+			@brief Plans traversal
+
+			Calls f on a matrix_2d_view of each plan, in order. If f returns a bool,
+			returning false stops the traversal.
+
+			@param f functor to call on each plan
+
+			@pre F : matrix_2d_view<T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_plane(F f) {
+			return this->plans_of<T>(f);
+		}
+
+		/**
+			@brief Read-only plans traversal
+
+			Calls f on a read-only matrix_2d_view of each plan, in order. If f returns
+			a bool, returning false stops the traversal.
+
+			@param f functor to call on each plan
+
+			@pre F : matrix_2d_view<const T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_plane(F f) const {
+			return this->plans_of<const T>(f);
+		}
+
+		/**
+			@brief Rows traversal
+
+			Calls f on a std::span over each row, plan after plan and row after row.
+			Inside a row the cells are contiguous, so the loops of f are plain pointer
+			loops. If f returns a bool, returning false stops the traversal.
+
+			@param f functor to call on each row
+
+			@pre F : std::span<T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_row(F f) {
+			return this->rows_of<T>(f);
+		}
+
+		/**
+			@brief Read-only rows traversal
+
+			Calls f on a read-only std::span over each row, plan after plan and row
+			after row. If f returns a bool, returning false stops the traversal.
+
+			@param f functor to call on each row
+
+			@pre F : std::span<const T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_row(F f) const {
+			return this->rows_of<const T>(f);
+		}
+
+		/**
+			@brief Spans traversal
+
+			Calls f on std::span over the cells, in order, each covering the longest
+			contiguous run available: the whole matrix_3d when the rows are not padded,
+			a row otherwise. Runs longer than max_length cells are split. If f returns
+			a bool, returning false stops the traversal.
+
+			@param f functor to call on each run
+			@param max_length maximum number of cells of a run, 0 for no limit
+
+			@pre F : std::span<T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_span(F f, size_type max_length = 0) {
+			return this->spans_of<T>(f, max_length);
+		}
+
+		/**
+			@brief Read-only spans traversal
+
+			Same as for_each_span(), with read-only spans.
+
+			@param f functor to call on each run
+			@param max_length maximum number of cells of a run, 0 for no limit
+
+			@pre F : std::span<const T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_span(F f, size_type max_length = 0) const {
+			return this->spans_of<const T>(f, max_length);
+		}
+
+		/**
+		    @brief Comparison function
+		
+		    Returns true if the two matrix_3d are equal, false otherwise.
+	    	Two matrix_3d are considered equal if they have the same shape and
+			the same element for each cell. The comparison between elements is
+			performed by a functor passed as the second parameter.
+		
+		    @param other the matrix_3d to compare with the current instance
+			
+			@pre E : T x T -> {0, 1}
+
+		    @return true if the two matrix_3d are equal, false otherwise
+	  	*/
+		template <typename E>
+		bool equals(const matrix_3d& other, const E equality) const {
+
+			if(this->_size != other._size || this->_rows != other._rows || 
+			   this->_col != other._col)
+				return false;
+
+			size_type r = 0;
+
+			// Cells are handed to equality as T&, as matrix_2d::equals() does.
+			auto compare = [&] (std::span<T> cells) -> bool {
+				T* others = other.row(r++);
+
+				for(size_type j = 0; j < cells.size(); ++j)
+					if(!equality(cells[j], others[j]))
+						return false;
 
-	    	@return matrix dimension
-	  	*/		
-	  	inline size_type size() const {
-			return this->_size == 0 ? 0 : this->_size * _vect[0].size(); 
+				return true;
+			};
+
+			return this->template rows_of<T>(compare);
 		}
 
 		/**
-		    @brief Comparison function
+		    @brief Parallel comparison function
 		
-		    Returns true if the two matrix_3d are equal, false otherwise.
-	    	Two matrix_3d are considered equal if they have the same shape and
-			the same element for each cell. The comparison between elements is
-			performed by a functor passed as the second parameter.
+		    Same as equals(other, equality), with the rows split among the workers of
+		    policy. As soon as a worker finds a mismatch, all the workers stop.
 		
 		    @param other the matrix_3d to compare with the current instance
+		    @param equality the functor to use for the comparison
+		    @param policy parallel settings
 			
 			@pre E : T x T -> {0, 1}
 
 		    @return true if the two matrix_3d are equal, false otherwise
 	  	*/
 		template <typename E>
-		bool equals(const matrix_3d<T>& other, const E equality) const {
+		bool equals(const matrix_3d& other, const E equality, const parallel_t& policy) const {
 
-			if(this->_size != other._size)
+			if(this->_size != other._size || this->_rows != other._rows || 
+			   this->_col != other._col)
 				return false;
-			
-			for(size_type i=0; i < this->_size; ++i)
-				if(!(this->_vect[i].equals(other._vect[i], equality)))
-					return false;
-					
-			return true;
+
+			std::atomic<bool> mismatch(false);
+
+			for_rows(_size * _rows, policy, [&] (size_type first, size_type last) {
+				for(size_type r = first; r < last && !mismatch.load(std::memory_order_relaxed); ++r)
+					for(size_type j = 0; j < _col; ++j)
+						if(!equality(this->row(r)[j], other.row(r)[j])) {
+							mismatch.store(true, std::memory_order_relaxed);
+							return;
+						}
+			});
+
+			return !mismatch.load();
+		}
+
+		/**
+		    @brief Parallel comparison function
+		
+		    Same as operator==, with the rows split among the workers of policy. As
+		    soon as a worker finds a mismatch, all the workers stop.
+		
+		    @param other the matrix_3d to compare with the current instance
+		    @param policy parallel settings
+
+		    @return true if the two matrix_3d are equal, false otherwise
+	  	*/
+		bool equals(const matrix_3d& other, const parallel_t& policy) const {
+			return this->equals(other, [] (const T& a, const T& b) -> bool {return a == b;}, policy);
 		}
 
 		/**
@@ -388,14 +1024,25 @@ template <typename T> class matrix_3d {
 		  	@return true if the two matrix_3d are equal, false otherwise
 	  */
 		bool operator==(const matrix_3d& other) const {
-			if(this->_size != other._size)
+			if(this->_size != other._size || this->_rows != other._rows || 
+			   this->_col != other._col)
 				return false;
-				
-			for(size_type i=0; i < this->_size; ++i)
-				if (!(this->_vect[i] == other._vect[i]))
-					return false;
-					
-			return true;
+
+			if(this->_pitch == this->_col) {
+				const T* others = other._data;
+
+				return this->for_each_span([&others] (std::span<const T> cells) -> bool {
+					const bool same = std::equal(cells.begin(), cells.end(), others);
+					others += cells.size();
+					return same;
+				});
+			}
+
+			size_type r = 0;
+
+			return this->for_each_row([&] (std::span<const T> cells) -> bool {
+				return std::equal(cells.begin(), cells.end(), other.row(r++));
+			});
 		}
 
 		/**
@@ -444,25 +1091,142 @@ template <typename T> class matrix_3d {
 		matrix_3d* slice(size_type z1, size_type z2,
 					size_type y1, size_type y2,
 					size_type x1, size_type x2) const {
+
+			return new matrix_3d(this->slice(z1, z2, y1, y2, x1, x2, by_value));
+		}
+
+		/**
+		    @brief 3-dimensional submatrix extraction by value
+		
+		    Returns a matrix_3d extracted from the current matrix_3d instance. 
+	    	Indexes start from 0 and both lower and upper limits are included. 
+	    	The submatrix is built directly in the returned object, so its cells
+	    	are allocated once and never copied again.
+	    	If the submatrix extraction fails, the exception is rethrown to the caller.
+			
+			@param z1 starting plan
+		    @param z2 final plan
+		    @param y1 starting row
+		    @param y2 final row
+		    @param x1 starting column
+		    @param x2 final column
+			
+			@pre z1 >= 0
+		    @pre z1 < _size
+		    @pre y1 >= 0
+		    @pre y1 < _rows
+		    @pre x1 >= 0
+		    @pre x1 < _col
+		    @pre z2 >= 0
+		    @pre z2 < _size
+		    @pre y2 >= 0	   
+		    @pre y2 < _rows
+		    @pre x2 >= 0
+		    @pre x2 < _col
+		    @pre y1 <= y2
+		    @pre x1 <= x2
+		    @pre z1 <= z2
+
+		   	@return submatrix [z1:z2, y1:y2, x1:x2]
+	  	*/
+		matrix_3d slice(size_type z1, size_type z2,
+					size_type y1, size_type y2,
+					size_type x1, size_type x2, by_value_t) const {
 							
 			assert(z1 >= 0 && z1 < this->_size);
 			assert(z2 >= 0 && z2 < this->_size);
 			assert(z1 <= z2);
 
-			matrix_3d<T>* submatrix = new matrix_3d<T>(z2 - z1 + 1,
-												 y2 - y1 + 1,
-												 x2 - x1 + 1);
+			assert(y1 >= 0 && y1 < this->_rows);
+			assert(y2 >= 0 && y2 < this->_rows);
+			assert(y1 <= y2);
+			
+			assert(x1 >= 0 && x1 < this->_col);
+			assert(x2 >= 0 && x2 < this->_col);
+			assert(x1 <= x2);
 
-			matrix_2d<T>* tmp = nullptr;
+			return matrix_3d(*this, z1, z2, y1, y2, x1, x2);
+		}
 
-			for(size_type i = 0; i < submatrix->_size; ++i) {
-				tmp = this->_vect[z1 + i].slice(y1, y2, x1, x2); 
-				submatrix->_vect[i].swap(*tmp);
-				delete tmp;
-				tmp = nullptr;
-			}
+		/**
+		    @brief 3-dimensional view extraction
+		
+		    Returns a view on the cells [z1:z2, y1:y2, x1:x2] of the current matrix_3d
+		    instance. Indexes start from 0 and both lower and upper limits are included.
+		    No cell is copied: the view aliases the buffer of the matrix_3d and is valid
+		    as long as the matrix_3d is neither destroyed nor reassigned.
+			
+			@param z1 starting plan
+		    @param z2 final plan
+		    @param y1 starting row
+		    @param y2 final row
+		    @param x1 starting column
+		    @param x2 final column
+			
+		    @pre z1 <= z2
+		    @pre z2 < _size
+		    @pre y1 <= y2
+		    @pre y2 < _rows
+		    @pre x1 <= x2
+		    @pre x2 < _col
+
+		   	@return view on [z1:z2, y1:y2, x1:x2]
+	  	*/
+		matrix_3d_view<T> view(size_type z1, size_type z2,
+							   size_type y1, size_type y2,
+							   size_type x1, size_type x2) {
+			return this->view().view(z1, z2, y1, y2, x1, x2);
+		}
+
+		/**
+		    @brief 3-dimensional read-only view extraction
+		
+		    Returns a read-only view on the cells [z1:z2, y1:y2, x1:x2] of the current
+		    matrix_3d instance. Indexes start from 0 and both lower and upper limits are
+		    included. No cell is copied.
+			
+			@param z1 starting plan
+		    @param z2 final plan
+		    @param y1 starting row
+		    @param y2 final row
+		    @param x1 starting column
+		    @param x2 final column
+			
+		    @pre z1 <= z2
+		    @pre z2 < _size
+		    @pre y1 <= y2
+		    @pre y2 < _rows
+		    @pre x1 <= x2
+		    @pre x2 < _col
+
+		   	@return read-only view on [z1:z2, y1:y2, x1:x2]
+	  	*/
+		matrix_3d_view<const T> view(size_type z1, size_type z2,
+									 size_type y1, size_type y2,
+									 size_type x1, size_type x2) const {
+			return this->view().view(z1, z2, y1, y2, x1, x2);
+		}
+
+		/**
+		    @brief Whole matrix view
+
+		    Returns a view on all the cells of the current matrix_3d instance.
+
+		    @return view on the whole matrix_3d
+	  	*/
+		matrix_3d_view<T> view() {
+			return matrix_3d_view<T>(_data, _size, _rows, _col, _rows * _pitch, _pitch);
+		}
+
+		/**
+		    @brief Whole matrix read-only view
 
-			return submatrix;
+		    Returns a read-only view on all the cells of the current matrix_3d instance.
+
+		    @return read-only view on the whole matrix_3d
+	  	*/
+		matrix_3d_view<const T> view() const {
+			return matrix_3d_view<const T>(_data, _size, _rows, _col, _rows * _pitch, _pitch);
 		}
 
 		/**
@@ -471,7 +1235,8 @@ template <typename T> class matrix_3d {
 			Method that fills the current matrix_3d with the values obtained from two 
 			generics iterators. The values previously contained in the array are overwritten.
 			If the iterator reaches the end before completely filling the matrix_3d,
-			the remaining elements remain intact. If at any point an excpetion is thrown, changes
+			the remaining elements remain intact. The matrix_3d is filled one plan at a 
+			time: if at any point an excpetion is thrown, changes to the plan being filled
 			are discarded and the exception is rethrown to the caller.
 
 			@param start start sequence iterator
@@ -480,12 +1245,76 @@ template <typename T> class matrix_3d {
 		template <typename I>
 		void fill(I start, I end) {
 			
-			size_type i = 0;
+			if(this->_size == 0 || start == end)
+				return;
+
+			const size_type plan_size = this->_rows * this->_col;
 			
-			while(i < this->_size && start != end) {
-				_vect[i].fill(start, end, 0);	
-				++i;
-			} 		
+			T* tmp = cell_storage<T, A>::allocate(_alloc, plan_size);
+
+			try {
+				this->for_each_plane([&] (matrix_2d_view<T> plan) -> bool {
+					size_type n = 0;
+
+					while(n < plan_size && start != end) {
+						tmp[n] = static_cast<T>(*start);
+						++start;
+						++n;
+					}
+
+					for(size_type i = 0; i * this->_col < n; ++i)
+						std::copy(tmp + i * this->_col, tmp + i * this->_col + std::min(this->_col, n - i * this->_col), 
+								  &plan(i, 0));
+
+					return start != end;
+				});
+			}
+			catch(...) {
+				cell_storage<T, A>::deallocate(_alloc, tmp, plan_size);
+				throw;
+			}
+
+			cell_storage<T, A>::deallocate(_alloc, tmp, plan_size);
+		}
+
+		/**
+			@brief Parallel fill method
+
+			Method that fills the current matrix_3d with the values obtained from two 
+			random access iterators, with the rows split among the workers of policy.
+			If the sequence ends before completely filling the matrix_3d, the remaining
+			elements remain intact. If an exception is thrown, the first one is 
+			rethrown to the caller once all the workers have stopped; the cells filled
+			by the other workers keep their new values.
+
+			@param start start sequence iterator
+			@param end end sequence iterator
+			@param policy parallel settings
+		*/
+		template <typename I>
+		void fill(I start, I end, const parallel_t& policy) {
+
+			static_assert(std::is_base_of<std::random_access_iterator_tag, 
+							typename std::iterator_traits<I>::iterator_category>::value,
+						  "matrix_3d::fill: parallel fill requires random access iterators");
+
+			const typename std::iterator_traits<I>::difference_type length = end - start;
+
+			if(this->_size == 0 || length <= 0)
+				return;
+
+			const size_type n = static_cast<size_type>(std::min<std::size_t>(length, this->size()));
+
+			for_rows((n + _col - 1) / _col, policy, [&] (size_type first, size_type last) {
+				for(size_type r = first; r < last; ++r) {
+					const size_type cells = std::min(_col, n - r * _col);
+					I src = start + r * _col;
+					T* dest = row(r);
+
+					for(size_type j = 0; j < cells; ++j)
+						dest[j] = static_cast<T>(src[j]);
+				}
+			});
 		}
 
 		/**
@@ -498,11 +1327,18 @@ template <typename T> class matrix_3d {
 
 			@return ostream reference
 		*/
-		friend std::ostream& operator<<(std::ostream& os, const matrix_3d<T>& matrix) {
+		friend std::ostream& operator<<(std::ostream& os, const matrix_3d& matrix) {
 
-			for(size_type i = 0; i < matrix._size; ++i) {
-				std::cout << matrix._vect[i] << std::endl; 
-			}
+			size_type r = 0;
+
+			matrix.for_each_row([&] (std::span<const T> cells) {
+				for(const T& cell : cells)
+					os << cell << " ";
+				os << std::endl;
+
+				if(++r % matrix._rows == 0)
+					os << std::endl;
+			});
 
 			return os;
 		}
@@ -511,76 +1347,69 @@ template <typename T> class matrix_3d {
 		class const_iterator;
 		
 		/**
-			@brief Class to represent a bidirectional iterator
-
-	  		Class for representing a bidirectional iterator for the matrix_3d class.
-			The class relies on the iterators of the matrix_2d class, used as main data structure
-			for the matrix_3d class. 
+			@brief Class to represent a random access iterator
+
+	  		Class for representing a random access iterator for the matrix_3d class.
+			The iterator walks the buffer of the matrix_3d with the iterator of its
+			plans, skipping the padding of the rows, so moving between plans costs the
+			same as moving inside a plan and jumps take constant time. When the rows are
+			not padded the cells are contiguous and, in C++20, the iterator models
+			std::contiguous_iterator. Increments, decrements and jumps must stay inside
+			the sequence: the iterator is a single plan iterator, and only the debug
+			builds keep the bounds of the sequence to check them by assert.
 		*/ 
 	 	class iterator {
 
 	 		private:
 
-	 			matrix_2d<T>* ptr;
-	    		matrix_3d<T>::size_type z;
-	    		matrix_3d<T>::size_type size;
-	    		typename matrix_2d<T>::iterator sub_iter;
+	 			typedef typename matrix_2d<T, A>::iterator base_iterator;
+
+	 			base_iterator ptr;
+	    		#ifndef NDEBUG
+	    		base_iterator first;
+	    		base_iterator last;
+	    		#endif
 
-	    		friend class matrix_3d<T>; 
+	    		friend class matrix_3d; 
 
 	    		/**
 			    	@brief Private initialization constructor used by the matrix_3d class
 			    */ 
-	    		iterator(matrix_2d<T>* ptr, matrix_3d<T>::size_type z, 
-	    				 matrix_3d<T>::size_type size, 
-	    				 typename matrix_2d<T>::iterator sub_iter) : ptr(nullptr), sub_iter(nullptr), z(0), size(0) {
-	    			
-	    			this->ptr = ptr; 
-	    			this->z = z;
-	    			this->size = size; 
-			    	this->sub_iter = sub_iter;
-			    }
+	    		iterator(base_iterator ptr, [[maybe_unused]] base_iterator first, [[maybe_unused]] base_iterator last)
+			    		: ptr(ptr)
+			    		#ifndef NDEBUG
+			    		, first(first), last(last)
+			    		#endif
+			    		{}
 
 		  	public:
 
-		    	typedef std::bidirectional_iterator_tag iterator_category;
+		    	typedef std::random_access_iterator_tag iterator_category;
 		    	typedef T                        value_type;
 		    	typedef ptrdiff_t                difference_type;
 		    	typedef T*                       pointer;
 		    	typedef T&                       reference;
 
+		    	#if __cplusplus >= 202002L
+		    	typedef typename std::conditional<layout::padded, std::random_access_iterator_tag,
+		    									  std::contiguous_iterator_tag>::type iterator_concept;
+		    	#endif
+
 	  
-			    iterator() : ptr(nullptr), size(0), sub_iter(nullptr), z(0) {}
+			    iterator() = default;
 			    
-			    iterator(const iterator& other) : ptr(nullptr), sub_iter(nullptr), size(0), z(0) {
-			    	this->ptr = other.ptr;
-			    	this->sub_iter = other.sub_iter;
-			    	this->z = other.z;
-			    	this->size = other.size;
-			    }
+			    iterator(const iterator& other) = default;
 
-			    iterator& operator=(const iterator& other) {
-			    	
-			    	if(this != &other) {
-			    		iterator tmp(other);
-			    		std::swap(this->ptr, tmp.ptr);
-			    		std::swap(this->sub_iter, tmp.sub_iter);
-			    		std::swap(this->z, tmp.z);
-			    		std::swap(this->size, tmp.size);
-
-			    	}
-			      
-			    	return *this;
-			    }
+			    iterator& operator=(const iterator& other) = default;
 
 			    ~iterator() {}
 
 			    reference operator*() const {
-		      		return *sub_iter;
+		      		return *ptr;
 			    }
 
 			    pointer operator->() const {
-			     	return sub_iter;
+			     	return &(*ptr);
 			    }
 		 
 			    iterator operator++(int) {
@@ -590,20 +1419,9 @@ template <typename T> class matrix_3d {
 			    }
 
 			    iterator& operator++() {
-			    	if(size == 0)
-			    		return *this;
-
-			    	if(z == size - 1) {
-			    		if(sub_iter != ptr[z].end())
-			    			++sub_iter;
-			    	}
-			    	else 
-			    		if(sub_iter + 1 == ptr[z].end())
-				    		sub_iter = ptr[++z].begin();
-			    		else {
-			    			++sub_iter;
-			    		}
-			    		
+			    	assert(ptr != last);
+			    	++ptr;
+
 			      	return *this;
 			    }
 
@@ -614,45 +1432,82 @@ template <typename T> class matrix_3d {
 			    }
 
 			    iterator& operator--() {
+			    	assert(ptr != first);
+			    	--ptr;
 
-			    	if(size == 0)
-			    		return *this;
+			      	return *this;
+			    }
 
-			      	if(sub_iter == ptr[z].begin()) {
-			    		if(z > 0) {
-			    			sub_iter = ptr[--z].end();
-			    			--sub_iter;
-			    		}
-			    	}
-		    		else
-		    			--sub_iter;
+			    iterator& operator+=(difference_type n) {
+			    	ptr += n;
+			    	assert(first <= ptr && ptr <= last);
 
-			      	return *this;
+			    	return *this;
+			    }
+
+			    iterator& operator-=(difference_type n) {
+			    	return (*this) += -n;
+			    }
+
+			    iterator operator+(difference_type n) const {
+			    	iterator tmp(*this);
+			    	return tmp += n;
+			    }
+
+			    friend iterator operator+(difference_type n, const iterator& iter) {
+			    	return iter + n;
+			    }
+
+			    iterator operator-(difference_type n) const {
+			    	iterator tmp(*this);
+			    	return tmp -= n;
+			    }
+
+			    difference_type operator-(const iterator& other) const {
+			    	return ptr - other.ptr;
+			    }
+
+			    reference operator[](difference_type n) const {
+			    	return *((*this) + n);
 			    }
 			  
 			    bool operator==(const iterator &other) const {
-			    	return ptr == other.ptr &&
-			    		   z == other.z &&
-			    		   size == other.size && 
-			      		   sub_iter == other.sub_iter;
+			    	return ptr == other.ptr;
 			    }
 
 			    bool operator!=(const iterator &other) const {
 			    	return !((*this) == other);
 			    }
+
+			    bool operator<(const iterator &other) const {
+			    	return ptr < other.ptr;
+			    }
+
+			    bool operator>(const iterator &other) const {
+			    	return other.ptr < ptr;
+			    }
+
+			    bool operator<=(const iterator &other) const {
+			    	return !(other.ptr < ptr);
+			    }
+
+			    bool operator>=(const iterator &other) const {
+			    	return !(ptr < other.ptr);
+			    }
 	 
 			    friend class const_iterator;
 
 			    bool operator==(const const_iterator &other) const {
-			    	return ptr == other.ptr &&
-			    		   z == other.z &&
-			    		   size == other.size && 
-			      		   sub_iter == other.sub_iter;
+			    	return ptr == other.ptr;
 			    }
 
 			    bool operator!=(const const_iterator &other) const {
 			    	return !((*this) == other);
 			    }
+
+			    difference_type operator-(const const_iterator& other) const {
+			    	return ptr - other.ptr;
+			    }
 		   
 		};
 		 
@@ -662,10 +1517,9 @@ template <typename T> class matrix_3d {
 			Returns the start-sequence read/write iterator of a matrix_3d.
 		*/
 		iterator begin() {
-			if(this->_size == 0)
-				return iterator();
-
-			return iterator(_vect, 0, _size, _vect[0].begin());
+			return iterator(make_iterator<typename iterator::base_iterator>(0), 
+							make_iterator<typename iterator::base_iterator>(0),
+							make_iterator<typename iterator::base_iterator>(_size * _rows));
 		}
 		
 		/**
@@ -674,82 +1528,68 @@ template <typename T> class matrix_3d {
 			Returns the end-sequence read/write iterator of a matrix_3d.
 		*/ 
 		iterator end() {
-			if(this->_size == 0)
-				return iterator();
-
-			return iterator(_vect, _size - 1, _size, _vect[_size - 1].end());
+			return iterator(make_iterator<typename iterator::base_iterator>(_size * _rows), 
+							make_iterator<typename iterator::base_iterator>(0),
+							make_iterator<typename iterator::base_iterator>(_size * _rows));
 		}
 
 		/**
-			@brief Class to represent a read-only bidirectional iterator
+			@brief Class to represent a read-only random access iterator
 
-	  		Class for representing a read-only bidirectional iterator for the matrix_3d class.
-			The class relies on the read-only iterators of the matrix_2d class, used as main data structure
-			for the matrix_3d class. 
+	  		Class for representing a read-only random access iterator for the matrix_3d 
+	  		class, with the same properties of iterator.
 		*/  
 	  	class const_iterator {
 		
 		  	private:
+
+		  		typedef typename matrix_2d<T, A>::const_iterator base_iterator;
 				
-				const matrix_2d<T>* ptr;
-	    		matrix_3d<T>::size_type z;
-	    		matrix_3d<T>::size_type size;
-	    		typename matrix_2d<T>::const_iterator sub_iter;
+				base_iterator ptr;
+	    		#ifndef NDEBUG
+	    		base_iterator first;
+	    		base_iterator last;
+	    		#endif
 
-	    		friend class matrix_3d<T>; 
+	    		friend class matrix_3d; 
 
 			    /**
 			    	@brief Private initialization constructor used by the matrix_3d class
 			    */ 
-			    const_iterator(const matrix_2d<T>* ptr, matrix_3d<T>::size_type z, 
-		    				 matrix_3d<T>::size_type size, 
-		    				 typename matrix_2d<T>::const_iterator sub_iter) : ptr(nullptr), sub_iter(nullptr), z(0), size(0) {
-		    			
-	    			this->ptr = ptr; 
-	    			this->z = z;
-	    			this->size = size; 
-			    	this->sub_iter = sub_iter;
-			    }
+			    const_iterator(base_iterator ptr, [[maybe_unused]] base_iterator first, [[maybe_unused]] base_iterator last)
+			    		: ptr(ptr)
+			    		#ifndef NDEBUG
+			    		, first(first), last(last)
+			    		#endif
+			    		{}
 
 			public:
 
-				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef std::random_access_iterator_tag iterator_category;
 				typedef T                        value_type;
 				typedef ptrdiff_t                difference_type;
 				typedef const T*                 pointer;
 				typedef const T&                 reference;
 
-			  	const_iterator() : ptr(nullptr), size(0), sub_iter(nullptr), z(0) {}
-			    
-			    const_iterator(const const_iterator& other) : ptr(nullptr), sub_iter(nullptr), size(0), z(0) {
-			    	this->ptr = other.ptr;
-			    	this->sub_iter = other.sub_iter;
-			    	this->z = other.z;
-			    	this->size = other.size;
-			    }
+		    	#if __cplusplus >= 202002L
+		    	typedef typename std::conditional<layout::padded, std::random_access_iterator_tag,
+		    									  std::contiguous_iterator_tag>::type iterator_concept;
+		    	#endif
 
-			    const_iterator& operator=(const const_iterator& other) {
-			    	
-			    	if(this != &other) {
-			    		const_iterator tmp(other);
-			    		std::swap(this->ptr, tmp.ptr);
-			    		std::swap(this->sub_iter, tmp.sub_iter);
-			    		std::swap(this->z, tmp.z);
-			    		std::swap(this->size, tmp.size);
+			  	const_iterator() = default;
+			    
+			    const_iterator(const const_iterator& other) = default;
 
-			    	}
-			      
-			    	return *this;
-			    }
+			    const_iterator& operator=(const const_iterator& other) = default;
 
 			    ~const_iterator() {}
 
 			    reference operator*() const {
-		      		return *sub_iter;
+		      		return *ptr;
 			    }
 
 			    pointer operator->() const {
-			    	return sub_iter;
+			    	return &(*ptr);
 			    }
 			    
 			    const_iterator operator++(int) {
@@ -759,20 +1599,9 @@ template <typename T> class matrix_3d {
 			    }
 
 			    const_iterator& operator++() {
+			    	assert(ptr != last);
+			    	++ptr;
 
-			    	if(size == 0)
-			    		return *this;
-
-			    	if(z == size - 1) {
-			    		if(sub_iter != ptr[z].end())
-			    			++sub_iter;
-			    	}
-			    	else 
-			    		if(sub_iter + 1 == ptr[z].end())
-				    		sub_iter = ptr[++z].begin();
-			    		else
-			    			++sub_iter;
-			    		
 			      	return *this;
 			    }
 
@@ -783,40 +1612,73 @@ template <typename T> class matrix_3d {
 			    }
 
 			    const_iterator& operator--() {
+			    	assert(ptr != first);
+			    	--ptr;
+
+			      	return *this;
+			    }
 
-			    	if(size == 0)
-			    		return *this;
+			    const_iterator& operator+=(difference_type n) {
+			    	ptr += n;
+			    	assert(first <= ptr && ptr <= last);
 
-			      	if(sub_iter == ptr[z].begin()) {
-			    		if(z > 0) {
-			    			sub_iter = ptr[--z].end();
-			    			--sub_iter;
-			    		}
-			    	}
-		    		else
-		    			--sub_iter;
+			    	return *this;
+			    }
 
-			      	return *this;
+			    const_iterator& operator-=(difference_type n) {
+			    	return (*this) += -n;
+			    }
+
+			    const_iterator operator+(difference_type n) const {
+			    	const_iterator tmp(*this);
+			    	return tmp += n;
+			    }
+
+			    friend const_iterator operator+(difference_type n, const const_iterator& iter) {
+			    	return iter + n;
+			    }
+
+			    const_iterator operator-(difference_type n) const {
+			    	const_iterator tmp(*this);
+			    	return tmp -= n;
+			    }
+
+			    difference_type operator-(const const_iterator& other) const {
+			    	return ptr - other.ptr;
+			    }
+
+			    reference operator[](difference_type n) const {
+			    	return *((*this) + n);
 			    }
 			  
 			    bool operator==(const const_iterator &other) const {
-			    	return ptr == other.ptr &&
-				    		z == other.z &&
-				    		size == other.size && 
-				      		sub_iter == other.sub_iter;
+			    	return ptr == other.ptr;
 			    }
 
 			    bool operator!=(const const_iterator &other) const {
 			    	return !((*this) == other);
 			    }
+
+			    bool operator<(const const_iterator &other) const {
+			    	return ptr < other.ptr;
+			    }
+
+			    bool operator>(const const_iterator &other) const {
+			    	return other.ptr < ptr;
+			    }
+
+			    bool operator<=(const const_iterator &other) const {
+			    	return !(other.ptr < ptr);
+			    }
+
+			    bool operator>=(const const_iterator &other) const {
+			    	return !(ptr < other.ptr);
+			    }
 			    
 			    friend class iterator;
 
 			    bool operator==(const iterator &other) const {
-			    	return ptr == other.ptr &&
-				    		z == other.z &&
-				    		size == other.size && 
-				      		sub_iter == other.sub_iter;
+			    	return ptr == other.ptr;
 			    }
 
 			    bool operator!=(const iterator &other) const {
@@ -826,21 +1688,22 @@ template <typename T> class matrix_3d {
 			    /**
 					@brief Iterator to const_iterator conversion constructor
 			    */
-			    const_iterator(const iterator &other) {
-			    	this->ptr = other.ptr;
-			    	this->sub_iter = other.sub_iter;
-			    	this->z = other.z;
-			    	this->size = other.size;
-			    }
+			    const_iterator(const iterator &other)
+			    			  : ptr(other.ptr)
+			    			  #ifndef NDEBUG
+			    			  , first(other.first), last(other.last)
+			    			  #endif
+			    			  {}
 
 			    /**
 					@brief Assignment of an iterator to a const_iterator
 			    */
 			    const_iterator &operator=(const iterator &other) {
 			    	this->ptr = other.ptr;
-			    	this->sub_iter = other.sub_iter;
-			    	this->z = other.z;
-			    	this->size = other.size;
+			    	#ifndef NDEBUG
+			    	this->first = other.first;
+			    	this->last = other.last;
+			    	#endif
 			      
 			    	return *this;
 			    }
@@ -853,10 +1716,9 @@ template <typename T> class matrix_3d {
 			Returns the start-sequence read-only iterator of a matrix_3d.
 		*/	  
 		const_iterator begin() const {
-			if(this->_size == 0)
-				return const_iterator();
-
-		    return const_iterator(_vect, 0, _size, _vect[0].begin());
+		    return const_iterator(make_iterator<typename const_iterator::base_iterator>(0), 
+		    					  make_iterator<typename const_iterator::base_iterator>(0),
+		    					  make_iterator<typename const_iterator::base_iterator>(_size * _rows));
 		}
 		  
 		/**
@@ -865,51 +1727,93 @@ template <typename T> class matrix_3d {
 			Returns the end-sequence read-only iterator of a matrix_3d.
 		*/ 
 		const_iterator end() const {
-			if(this->_size == 0)
-				return const_iterator();
-
-			return const_iterator(_vect, _size - 1, _size, _vect[_size - 1].end());
+			return const_iterator(make_iterator<typename const_iterator::base_iterator>(_size * _rows), 
+								  make_iterator<typename const_iterator::base_iterator>(0),
+								  make_iterator<typename const_iterator::base_iterator>(_size * _rows));
 		}
 
-		/**
-			@brief Transformation function
+	private:
 
-			Returns a new matrix_3d from the source matrix_3d given as parameter, 
-			obtained by applying the functor func to each element of the source array.
-			
-			@pre func : W -> Q
+		/**
+			@brief Plan iterator factory
 
-			@param source source matrix_3d
-			@param func functor to applicate
+			@param r row of the whole matrix_3d
 
-			@return pointer to the transformed matrix_3d
+			@return plan iterator of type I on the first cell of the given row
 		*/
-
-		template <typename Q, typename W, typename F>
-		friend matrix_3d<Q>* transform(const matrix_3d<W>& source, F func);
+		template <typename I>
+		I make_iterator(size_type r) const {
+			if constexpr (layout::padded)
+				return I(row(r), _col, _pitch);
+			else
+				return row(r);
+		}
 };
 
-template <typename Q, typename W, typename F>
-matrix_3d<Q>* transform(const matrix_3d<W>& source, const F func) {
-				
-	matrix_3d<Q>* transformed = new matrix_3d<Q>(source.plans(), 
-												 source.rows(),
-												 source.columns());
+/**
+	@brief Transformation function by value
 
+	Returns a new matrix_3d from the source matrix_3d given as parameter, 
+	obtained by applying the functor func to each element of the source array.
+	The result is built directly in the returned object, so its cells are 
+	allocated once and never copied again. They are obtained from a copy of
+	the allocator of source, rebound to Q.
+	
+	@pre func : W -> Q
 
-	matrix_2d<Q>* tmp = nullptr; 
+	@param source source matrix_3d
+	@param func functor to applicate
 
-	for(typename matrix_3d<W>::size_type z=0; z < source.plans(); ++z) {
-		tmp = transform<Q>(source[z], func);
-		transformed->_vect[z].swap(*tmp);
-		delete tmp;
-		tmp = nullptr;
-	}
-			
-	return transformed;
+	@return the transformed matrix_3d
+*/
+template <typename Q, typename W, typename A, typename F>
+matrix_3d<Q, rebind_allocator<A, Q>> transform(const matrix_3d<W, A>& source, const F func, by_value_t) {
+
+	return matrix_3d<Q, rebind_allocator<A, Q>>(source, func, by_value);
 }
 
+/**
+	@brief Parallel transformation function
 
+	Returns a new matrix_3d from the source matrix_3d given as parameter, 
+	obtained by applying the functor func to each element of the source array.
+	The rows are split among the workers of policy; small matrices are 
+	transformed in the calling thread. The result is built directly in the
+	returned object.
+	
+	@pre func : W -> Q, callable concurrently from several threads
 
-#endif
+	@param source source matrix_3d
+	@param func functor to applicate
+	@param policy parallel settings
 
+	@return the transformed matrix_3d
+*/
+template <typename Q, typename W, typename A, typename F>
+matrix_3d<Q, rebind_allocator<A, Q>> transform(const matrix_3d<W, A>& source, const F func, const parallel_t& policy) {
+
+	return matrix_3d<Q, rebind_allocator<A, Q>>(source, func, policy);
+}
+
+/**
+	@brief Transformation function
+
+	Returns a new matrix_3d from the source matrix_3d given as parameter, 
+	obtained by applying the functor func to each element of the source array.
+	
+	@pre func : W -> Q
+
+	@param source source matrix_3d
+	@param func functor to applicate
+
+	@return pointer to the transformed matrix_3d
+*/
+template <typename Q, typename W, typename A, typename F>
+matrix_3d<Q, rebind_allocator<A, Q>>* transform(const matrix_3d<W, A>& source, const F func) {
+				
+	return new matrix_3d<Q, rebind_allocator<A, Q>>(transform<Q>(source, func, by_value));
+}
+
+
+
+#endif
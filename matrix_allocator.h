@@ -0,0 +1,495 @@
+#ifndef MATRIX_ALLOCATOR
+#define MATRIX_ALLOCATOR
+
+#include <cstddef> // std::size_t
+#include <new> // ::operator new, std::align_val_t, std::bad_array_new_length
+#include <memory> // std::allocator_traits
+#include <mutex>
+#include <map>
+#include <vector>
+#include <utility> // std::pair
+#include <limits>
+#include <type_traits>
+#include <numeric> // std::gcd
+#include <stdexcept> // std::length_error
+#include "matrix_fwd.h"
+
+/**
+  @file matrix_allocator.h
+  @brief Allocation helpers, memory_pool, pool_allocator and aligned_allocator declaration 
+  and implementation.
+*/
+
+
+/**
+  @brief Allocator rebinding shortcut
+
+  The allocator type obtained by rebinding the allocator A to the data type U.
+*/
+template <typename A, typename U>
+using rebind_allocator = typename std::allocator_traits<A>::template rebind_alloc<U>;
+
+
+/**
+  @brief Overflow-checked product of extents
+
+  Returns a * b, throwing std::length_error when the product does not fit in a
+  matrix_index, so that a matrix too large to be addressed is never under-allocated.
+
+  @param a first extent
+  @param b second extent
+
+  @return a * b
+*/
+inline matrix_index checked_extent(std::size_t a, std::size_t b) {
+
+	if(a > std::numeric_limits<matrix_index>::max() || b > std::numeric_limits<matrix_index>::max() ||
+	   (b != 0 && a > std::numeric_limits<matrix_index>::max() / b))
+		throw std::length_error("matrix extents overflow");
+
+	return static_cast<matrix_index>(a * b);
+}
+
+
+/**
+  @brief Helper for allocating and releasing blocks of cells
+
+  Allocates blocks of cells through an allocator of type A. As with new T[n], the cells
+  of a trivially default constructible type are left uninitialized, while the other
+  types are default constructed one cell at a time.
+*/
+template <typename T, typename A>
+struct cell_storage {
+
+	typedef std::allocator_traits<A> traits;
+
+	/**
+		@brief Allocation function
+
+		Allocates and constructs a block of n cells. If the construction of a cell
+		throws, the cells already built are destroyed, the block is released and the
+		exception is rethrown to the caller.
+
+		@param alloc allocator to use
+		@param n number of cells
+
+		@return pointer to the first cell, nullptr if n = 0
+	*/
+	static T* allocate(A& alloc, std::size_t n) {
+
+		if(n == 0)
+			return nullptr;
+
+		T* cells = traits::allocate(alloc, n);
+
+		if(!std::is_trivially_default_constructible<T>::value) {
+			std::size_t i = 0;
+
+			try {
+				for(; i < n; ++i)
+					traits::construct(alloc, cells + i);
+			}
+			catch(...) {
+				while(i > 0)
+					traits::destroy(alloc, cells + --i);
+				traits::deallocate(alloc, cells, n);
+				throw;
+			}
+		}
+
+		return cells;
+	}
+
+	/**
+		@brief Release function
+
+		Destroys and releases a block of n cells obtained from allocate().
+
+		@param alloc allocator to use
+		@param cells pointer to the first cell, can be nullptr
+		@param n number of cells
+	*/
+	static void deallocate(A& alloc, T* cells, std::size_t n) noexcept {
+
+		if(cells == nullptr)
+			return;
+
+		if(!std::is_trivially_destructible<T>::value)
+			for(std::size_t i = n; i > 0; )
+				traits::destroy(alloc, cells + --i);
+
+		traits::deallocate(alloc, cells, n);
+	}
+};
+
+
+/**
+  @brief Class for representing a pool of recyclable memory blocks
+
+  Class that keeps the blocks released by its users instead of giving them back to
+  the system, and hands them out again to the next request of the same size and
+  alignment. A program that keeps creating and destroying matrices of the same shapes
+  stops calling the system allocator after the first round. Cached blocks are given
+  back to the system by release() or when the pool is destroyed. All the methods
+  are thread-safe.
+*/
+class memory_pool {
+
+	private:
+
+		typedef std::pair<std::size_t, std::size_t> key_type;
+
+		std::mutex _mutex;
+		std::map<key_type, std::vector<void*>> _free;
+		std::size_t _system_allocations;
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Creates an empty pool.
+		*/
+		memory_pool() : _system_allocations(0) {}
+
+		memory_pool(const memory_pool&) = delete;
+		memory_pool& operator=(const memory_pool&) = delete;
+
+		/**
+			@brief Destructor
+
+			Gives all the cached blocks back to the system. Blocks still in use must
+			not be released to the pool after its destruction.
+		*/
+		~memory_pool() {
+			release();
+		}
+
+		/**
+			@brief Allocation method
+
+			Returns a cached block of the requested size and alignment if there is one,
+			otherwise a new block obtained from the system.
+
+			@param bytes size of the block
+			@param alignment alignment of the block
+
+			@return pointer to the block
+		*/
+		void* allocate(std::size_t bytes, std::size_t alignment) {
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				auto found = _free.find(key_type(bytes, alignment));
+				if(found != _free.end() && !found->second.empty()) {
+					void* block = found->second.back();
+					found->second.pop_back();
+					return block;
+				}
+
+				++_system_allocations;
+			}
+
+			return ::operator new(bytes, std::align_val_t(alignment));
+		}
+
+		/**
+			@brief Release method
+
+			Puts a block obtained from allocate() back into the pool. If the pool cannot
+			record the block, the block is given back to the system.
+
+			@param block pointer to the block
+			@param bytes size of the block
+			@param alignment alignment of the block
+		*/
+		void deallocate(void* block, std::size_t bytes, std::size_t alignment) noexcept {
+
+			try {
+				std::lock_guard<std::mutex> lock(_mutex);
+				_free[key_type(bytes, alignment)].push_back(block);
+			}
+			catch(...) {
+				::operator delete(block, std::align_val_t(alignment));
+			}
+		}
+
+		/**
+			@brief Cache release method
+
+			Gives all the cached blocks back to the system.
+		*/
+		void release() noexcept {
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			for(auto& bucket : _free)
+				for(void* block : bucket.second)
+					::operator delete(block, std::align_val_t(bucket.first.second));
+
+			_free.clear();
+		}
+
+		/**
+			@brief Cached blocks getter
+
+			@return number of blocks currently cached by the pool
+		*/
+		std::size_t cached() {
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			std::size_t count = 0;
+			for(auto& bucket : _free)
+				count += bucket.second.size();
+
+			return count;
+		}
+
+		/**
+			@brief System allocations getter
+
+			@return number of blocks the pool has requested to the system so far
+		*/
+		std::size_t system_allocations() {
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			return _system_allocations;
+		}
+
+		/**
+			@brief Default pool getter
+
+			Returns the pool used by the default-constructed pool_allocator.
+
+			@return reference to the default pool
+		*/
+		static memory_pool& default_pool() {
+			static memory_pool pool;
+			return pool;
+		}
+};
+
+
+/**
+  @brief Class for representing an allocator backed by a memory_pool
+
+  Standard-conforming allocator that obtains its blocks from a memory_pool, so that
+  the cells of short-lived matrices are recycled instead of being returned to the
+  system. Two pool_allocator compare equal when they share the same pool.
+*/
+template <typename T> class pool_allocator {
+
+	private:
+
+		memory_pool* _pool;
+
+		template <typename U> friend class pool_allocator;
+
+	public:
+
+		typedef T value_type;
+
+		/**
+			@brief Default constructor
+
+			Creates an allocator on the default pool.
+		*/
+		pool_allocator() noexcept : _pool(&memory_pool::default_pool()) {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates an allocator on the given pool.
+
+			@param pool pool to obtain the blocks from
+		*/
+		explicit pool_allocator(memory_pool& pool) noexcept : _pool(&pool) {}
+
+		/**
+			@brief Rebinding constructor
+
+			Creates an allocator sharing the pool of another allocator.
+		*/
+		template <typename U>
+		pool_allocator(const pool_allocator<U>& other) noexcept : _pool(other._pool) {}
+
+		/**
+			@brief Allocation method
+
+			@param n number of objects
+
+			@return pointer to uninitialized storage for n objects of type T
+		*/
+		T* allocate(std::size_t n) {
+
+			if(n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_array_new_length();
+
+			return static_cast<T*>(_pool->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		/**
+			@brief Release method
+
+			@param p pointer obtained from allocate()
+			@param n number of objects given to allocate()
+		*/
+		void deallocate(T* p, std::size_t n) noexcept {
+			_pool->deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		/**
+			@brief Pool getter
+
+			@return reference to the pool used by the allocator
+		*/
+		memory_pool& pool() const noexcept {
+			return *_pool;
+		}
+
+		template <typename U>
+		bool operator==(const pool_allocator<U>& other) const noexcept {
+			return _pool == other._pool;
+		}
+
+		template <typename U>
+		bool operator!=(const pool_allocator<U>& other) const noexcept {
+			return _pool != other._pool;
+		}
+};
+
+
+/**
+  @brief Class for representing an allocator of over-aligned blocks
+
+  Standard-conforming allocator whose blocks start on an N-byte boundary, for example
+  32 for AVX or 64 for AVX-512 and cache lines. Matrices using it also pad their rows,
+  so that every row starts on an N-byte boundary (see row_layout).
+
+  @pre N is a power of two
+  @pre N >= alignof(T)
+*/
+template <typename T, std::size_t N> class aligned_allocator {
+
+	static_assert((N & (N - 1)) == 0, "aligned_allocator: N must be a power of two");
+	static_assert(N >= alignof(T), "aligned_allocator: N must not be lower than alignof(T)");
+
+	public:
+
+		typedef T value_type;
+
+		/**
+			@brief Alignment of the blocks, in bytes
+		*/
+		static constexpr std::size_t alignment = N;
+
+		template <typename U>
+		struct rebind {
+			typedef aligned_allocator<U, N> other;
+		};
+
+		aligned_allocator() noexcept {}
+
+		template <typename U>
+		aligned_allocator(const aligned_allocator<U, N>&) noexcept {}
+
+		/**
+			@brief Allocation method
+
+			@param n number of objects
+
+			@return pointer to uninitialized N-byte aligned storage for n objects of type T
+		*/
+		T* allocate(std::size_t n) {
+
+			if(n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_array_new_length();
+
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(N)));
+		}
+
+		/**
+			@brief Release method
+
+			@param p pointer obtained from allocate()
+			@param n number of objects given to allocate()
+		*/
+		void deallocate(T* p, std::size_t) noexcept {
+			::operator delete(p, std::align_val_t(N));
+		}
+
+		template <typename U>
+		bool operator==(const aligned_allocator<U, N>&) const noexcept {
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const aligned_allocator<U, N>&) const noexcept {
+			return false;
+		}
+};
+
+
+/**
+  @brief Alignment guaranteed by an allocator
+
+  The alignment, in bytes, of the blocks returned by an allocator of type A: the
+  alignment member of A if it has one, the alignment of its value type otherwise.
+*/
+template <typename A, typename = void>
+struct allocator_alignment {
+	static constexpr std::size_t value = alignof(typename A::value_type);
+};
+
+template <typename A>
+struct allocator_alignment<A, std::void_t<decltype(A::alignment)>> {
+	static constexpr std::size_t value = A::alignment;
+};
+
+
+/**
+  @brief Row layout of the matrices using an allocator
+
+  Computes the pitch, i.e. the distance in cells between the starts of two consecutive
+  rows, of a matrix of T whose cells come from an allocator of type A. Rows are padded
+  so that every row starts on the alignment of the allocator: with the default 
+  allocators no padding is ever added and the pitch equals the number of columns.
+*/
+template <typename T, typename A>
+struct row_layout {
+
+	/**
+		@brief Alignment of the start of each row, in bytes
+	*/
+	static constexpr std::size_t alignment = allocator_alignment<A>::value;
+
+	/**
+		@brief Granularity of the pitch, in cells
+	*/
+	static constexpr std::size_t step = alignment / std::gcd(alignment, sizeof(T));
+
+	/**
+		@brief True if rows can be padded, i.e. if the pitch can exceed the number of columns
+	*/
+	static constexpr bool padded = step > 1;
+
+	/**
+		@brief Pitch getter
+
+		@param columns number of columns of the matrix
+
+		@throw std::length_error if the pitch does not fit in a matrix_index
+
+		@return pitch of a matrix with the given number of columns
+	*/
+	static constexpr std::size_t pitch(std::size_t columns) {
+		if(columns > std::numeric_limits<matrix_index>::max() - (step - 1))
+			throw std::length_error("matrix extents overflow");
+		return (columns + step - 1) / step * step;
+	}
+};
+
+#endif
@@ -0,0 +1,415 @@
+#ifndef MATRIX_BITMASK
+#define MATRIX_BITMASK
+
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cassert>
+#include <algorithm> // std::fill, std::min
+#include <bit> // std::popcount, std::countr_zero
+#include <vector>
+#include <type_traits>
+#include <utility> // std::swap
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_bitmask.h
+  @brief bitmask_3d class declaration and implementation.
+*/
+
+
+/**
+  @brief Class for representing a three-dimensional mask of bits
+
+  One bit per cell, plan after plan and row after row, packed without padding in 64
+  bits words: a mask takes an eighth of a matrix_3d<bool>. The logical operators and
+  count() work a word, i.e. 64 cells, at a time. The bits past the last cell of the
+  last word are kept at 0, so that they never count.
+
+  operator() returns a proxy reference, which reads and writes a single bit:
+
+	mask(z, y, x) = true;
+	if(mask(z, y, x)) ...
+
+  A mask is usually built from a predicate on the cells of a matrix_3d:
+
+	bitmask_3d bone(volume, [] (uint16_t v) {return v > 1200;});
+*/
+class bitmask_3d {
+
+	public:
+
+		typedef matrix_index size_type;
+		typedef std::uint64_t word_type;
+
+		/**
+			@brief Proxy reference to a bit
+		*/
+		class reference {
+
+			private:
+
+				word_type* _word;
+				word_type _bit;
+
+				friend class bitmask_3d;
+
+				reference(word_type* word, word_type bit) : _word(word), _bit(bit) {}
+
+			public:
+
+				operator bool() const {
+					return (*_word & _bit) != 0;
+				}
+
+				reference& operator=(bool value) {
+					if(value)
+						*_word |= _bit;
+					else
+						*_word &= ~_bit;
+					return *this;
+				}
+
+				reference& operator=(const reference& other) {
+					return *this = static_cast<bool>(other);
+				}
+
+				bool operator~() const {
+					return !static_cast<bool>(*this);
+				}
+
+				reference& flip() {
+					*_word ^= _bit;
+					return *this;
+				}
+		};
+
+	private:
+
+		static constexpr std::size_t word_bits = 64;
+
+		size_type _plans;
+		size_type _rows;
+		size_type _col;
+		std::vector<word_type> _words;
+
+		std::size_t index(size_type z, size_type y, size_type x) const {
+			return (std::size_t(z) * _rows + y) * _col + x;
+		}
+
+		/**
+			@brief Mask of the bits of the last word that hold cells
+		*/
+		word_type tail() const {
+			const std::size_t used = std::size_t(size()) % word_bits;
+			return used == 0 ? ~word_type(0) : (word_type(1) << used) - 1;
+		}
+
+		void clear_tail() {
+			if(!_words.empty())
+				_words.back() &= tail();
+		}
+
+		/**
+			@brief Setting of the bits from a predicate, the words split among the workers of policy
+		*/
+		template <typename T, typename A, typename P>
+		void evaluate(const matrix_3d<T, A>& source, const P& predicate, const parallel_t* policy) {
+
+			const std::size_t cells = size();
+			const std::size_t per_chunk = policy == nullptr ? _words.size() : policy->grain / word_bits;
+
+			parallel_for(_words.size(), per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+				std::size_t i = first * word_bits;
+				std::size_t row = i / _col, x = i % _col;
+				const T* cell = source.data() + row * source.pitch();
+
+				for(std::size_t w = first; w < last; ++w) {
+					const std::size_t n = std::min(word_bits, cells - w * word_bits);
+					word_type word = 0;
+
+					for(std::size_t k = 0; k < n; ++k) {
+						word |= static_cast<word_type>(predicate(cell[x]) ? 1 : 0) << k;
+
+						if(++x == _col) {
+							x = 0;
+							cell += source.pitch();
+						}
+					}
+
+					_words[w] = word;
+				}
+			});
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Creates a null bitmask_3d.
+		*/
+		bitmask_3d() : _plans(0), _rows(0), _col(0), _words() {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a z x y x x mask with all the bits set to value.
+
+			@throw std::length_error if the extents overflow
+		*/
+		bitmask_3d(size_type z, size_type y, size_type x, bool value = false)
+				   : _plans(z), _rows(y), _col(x), _words() {
+			const std::size_t cells = checked_extent(checked_extent(z, y), x);
+			_words.assign((cells + word_bits - 1) / word_bits, value ? ~word_type(0) : 0);
+			clear_tail();
+		}
+
+		/**
+			@brief Construction from a predicate
+
+			Sets the bit of each cell of source for which predicate is true.
+
+			@param source matrix_3d to test
+			@param predicate test of the cells
+
+			@pre P : T -> bool
+		*/
+		template <typename T, typename A, typename P>
+		bitmask_3d(const matrix_3d<T, A>& source, const P predicate)
+				   : bitmask_3d(source.plans(), source.rows(), source.columns()) {
+			evaluate(source, predicate, nullptr);
+		}
+
+		/**
+			@brief Parallel construction from a predicate
+
+			Same as bitmask_3d(source, predicate), with the words split among the workers
+			of policy.
+		*/
+		template <typename T, typename A, typename P>
+		bitmask_3d(const matrix_3d<T, A>& source, const P predicate, const parallel_t& policy)
+				   : bitmask_3d(source.plans(), source.rows(), source.columns()) {
+			evaluate(source, predicate, &policy);
+		}
+
+		void swap(bitmask_3d& other) noexcept {
+			std::swap(_plans, other._plans);
+			std::swap(_rows, other._rows);
+			std::swap(_col, other._col);
+			_words.swap(other._words);
+		}
+
+		inline size_type plans() const {
+			return _plans;
+		}
+
+		inline size_type rows() const {
+			return _rows;
+		}
+
+		inline size_type columns() const {
+			return _col;
+		}
+
+		/**
+			@brief Number of cells (bits)
+		*/
+		inline size_type size() const {
+			return _plans * _rows * _col;
+		}
+
+		/**
+			@brief Number of words of storage
+		*/
+		std::size_t words() const {
+			return _words.size();
+		}
+
+		/**
+			@brief Words getter
+
+			Bit i % 64 of word i / 64 is the cell of linear index i, plan after plan and
+			row after row.
+		*/
+		const word_type* data() const {
+			return _words.data();
+		}
+
+		/**
+			@brief Bit access
+
+			@return proxy reference to the bit of [z, y, x]
+		*/
+		reference operator()(size_type z, size_type y, size_type x) {
+			assert(z < _plans && y < _rows && x < _col);
+			const std::size_t i = index(z, y, x);
+			return reference(&_words[i / word_bits], word_type(1) << (i % word_bits));
+		}
+
+		/**
+			@brief Read-only bit access
+		*/
+		bool operator()(size_type z, size_type y, size_type x) const {
+			assert(z < _plans && y < _rows && x < _col);
+			const std::size_t i = index(z, y, x);
+			return (_words[i / word_bits] >> (i % word_bits)) & 1;
+		}
+
+		/**
+			@brief Setting of all the bits to value
+		*/
+		void fill(bool value) {
+			std::fill(_words.begin(), _words.end(), value ? ~word_type(0) : 0);
+			clear_tail();
+		}
+
+		/**
+			@brief Inversion of all the bits
+		*/
+		bitmask_3d& flip() {
+			for(word_type& word : _words)
+				word = ~word;
+			clear_tail();
+			return *this;
+		}
+
+		/**
+			@brief Number of set bits
+		*/
+		std::size_t count() const {
+			std::size_t n = 0;
+			for(word_type word : _words)
+				n += static_cast<std::size_t>(std::popcount(word));
+			return n;
+		}
+
+		/**
+			@brief True if at least one bit is set
+		*/
+		bool any() const {
+			for(word_type word : _words)
+				if(word != 0)
+					return true;
+			return false;
+		}
+
+		/**
+			@brief True if no bit is set
+		*/
+		bool none() const {
+			return !any();
+		}
+
+		/**
+			@brief Traversal of the set bits
+
+			Calls f(z, y, x) for each set bit, in order, skipping the empty words. If f
+			returns a bool, returning false stops the traversal.
+
+			@pre F : size_type x size_type x size_type -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_set(F f) const {
+
+			const std::size_t plan = std::size_t(_rows) * _col;
+
+			for(std::size_t w = 0; w < _words.size(); ++w)
+				for(word_type word = _words[w]; word != 0; word &= word - 1) {
+					const std::size_t i = w * word_bits + static_cast<std::size_t>(std::countr_zero(word));
+					const size_type z = static_cast<size_type>(i / plan);
+					const size_type y = static_cast<size_type>(i % plan / _col);
+					const size_type x = static_cast<size_type>(i % _col);
+
+					if constexpr (std::is_same<decltype(f(z, y, x)), bool>::value) {
+						if(!f(z, y, x))
+							return false;
+					}
+					else
+						f(z, y, x);
+				}
+
+			return true;
+		}
+
+		/**
+			@brief Cellwise AND
+
+			@pre other has the same shape
+		*/
+		bitmask_3d& operator&=(const bitmask_3d& other) {
+			assert(_plans == other._plans && _rows == other._rows && _col == other._col);
+			for(std::size_t w = 0; w < _words.size(); ++w)
+				_words[w] &= other._words[w];
+			return *this;
+		}
+
+		/**
+			@brief Cellwise OR
+
+			@pre other has the same shape
+		*/
+		bitmask_3d& operator|=(const bitmask_3d& other) {
+			assert(_plans == other._plans && _rows == other._rows && _col == other._col);
+			for(std::size_t w = 0; w < _words.size(); ++w)
+				_words[w] |= other._words[w];
+			return *this;
+		}
+
+		/**
+			@brief Cellwise XOR
+
+			@pre other has the same shape
+		*/
+		bitmask_3d& operator^=(const bitmask_3d& other) {
+			assert(_plans == other._plans && _rows == other._rows && _col == other._col);
+			for(std::size_t w = 0; w < _words.size(); ++w)
+				_words[w] ^= other._words[w];
+			return *this;
+		}
+
+		/**
+			@brief Cellwise AND NOT: clears the bits set in other
+
+			@pre other has the same shape
+		*/
+		bitmask_3d& subtract(const bitmask_3d& other) {
+			assert(_plans == other._plans && _rows == other._rows && _col == other._col);
+			for(std::size_t w = 0; w < _words.size(); ++w)
+				_words[w] &= ~other._words[w];
+			return *this;
+		}
+
+		friend bitmask_3d operator&(bitmask_3d a, const bitmask_3d& b) {
+			a &= b;
+			return a;
+		}
+
+		friend bitmask_3d operator|(bitmask_3d a, const bitmask_3d& b) {
+			a |= b;
+			return a;
+		}
+
+		friend bitmask_3d operator^(bitmask_3d a, const bitmask_3d& b) {
+			a ^= b;
+			return a;
+		}
+
+		friend bitmask_3d operator~(bitmask_3d a) {
+			a.flip();
+			return a;
+		}
+
+		bool operator==(const bitmask_3d& other) const {
+			return _plans == other._plans && _rows == other._rows && _col == other._col && _words == other._words;
+		}
+
+		bool operator!=(const bitmask_3d& other) const {
+			return !(*this == other);
+		}
+};
+
+#endif
@@ -0,0 +1,907 @@
+#ifndef MATRIX_COMPRESSED
+#define MATRIX_COMPRESSED
+
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <cassert>
+#include <algorithm> // std::min, std::fill
+#include <bit> // std::bit_width, std::endian
+#include <vector>
+#include <list>
+#include <map>
+#include <array>
+#include <memory> // std::unique_ptr
+#include <utility> // std::move, std::swap
+#include <type_traits>
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_iterator.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_compressed.h
+  @brief brick_codec and compressed_matrix_3d template class declaration and implementation.
+
+  compressed_matrix_3d keeps a matrix_3d split in bricks of 32 x 32 x 32 cells, each one
+  compressed by brick_codec, and a small cache of decompressed bricks through which the
+  cells are accessed. Volumes with large uniform regions or smooth gradients take a few
+  bits per cell instead of sizeof(T) bytes.
+*/
+
+
+/**
+  @brief Compression of runs of cells
+
+  The cells are taken as unsigned integers of their size (the bit pattern for the
+  floating point types), and each cell is replaced by its difference with the previous
+  one, zigzag encoded so that small negative differences are small numbers. The
+  differences are then bit packed in groups of 64, each group with the width of its
+  largest difference stored in 7 bits before it: a group of equal cells takes 7 bits,
+  a smooth gradient a few bits per cell. The data are:
+
+	byte 0: 1 packed, or 0 raw when packing would not be smaller
+	then, packed: the first cell, then the bit stream, followed by 8 zero bytes
+	      raw: the cells
+
+  The bit stream is little endian whatever the machine. The data are only meant to
+  live in memory: they are not a file format.
+*/
+namespace brick_codec {
+
+	/**
+		@brief Number of cells of the groups sharing a width
+	*/
+	constexpr std::size_t group = 64;
+
+	template <typename T>
+	using bits_type = typename std::conditional<sizeof(T) == 1, std::uint8_t,
+					  typename std::conditional<sizeof(T) == 2, std::uint16_t,
+					  typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type>::type>::type;
+
+	template <typename T>
+	std::uint64_t to_bits(T value) {
+		bits_type<T> bits;
+		std::memcpy(&bits, &value, sizeof(T));
+		return bits;
+	}
+
+	template <typename T>
+	T from_bits(std::uint64_t value) {
+		const bits_type<T> bits = static_cast<bits_type<T>>(value);
+		T cell;
+		std::memcpy(&cell, &bits, sizeof(T));
+		return cell;
+	}
+
+	inline std::uint64_t load_le(const unsigned char* at) {
+		std::uint64_t word;
+		std::memcpy(&word, at, sizeof(word));
+		if constexpr (std::endian::native == std::endian::big)
+			word = __builtin_bswap64(word);
+		return word;
+	}
+
+	inline void store_le(unsigned char* at, std::uint64_t word) {
+		if constexpr (std::endian::native == std::endian::big)
+			word = __builtin_bswap64(word);
+		std::memcpy(at, &word, sizeof(word));
+	}
+
+	/**
+		@brief Appender of fields of 0 to 64 bits
+	*/
+	class bit_writer {
+
+		private:
+
+			std::vector<unsigned char>& _out;
+			std::uint64_t _word;
+			unsigned int _used;
+
+			void emit(std::uint64_t word) {
+				const std::size_t at = _out.size();
+				_out.resize(at + 8);
+				store_le(_out.data() + at, word);
+			}
+
+		public:
+
+			explicit bit_writer(std::vector<unsigned char>& out) : _out(out), _word(0), _used(0) {}
+
+			/**
+				@pre value < 2^bits
+			*/
+			void put(std::uint64_t value, unsigned int bits) {
+
+				if(bits == 0)
+					return;
+
+				_word |= value << _used;
+
+				if(_used + bits >= 64) {
+					emit(_word);
+					_word = _used == 0 ? 0 : value >> (64 - _used);
+					_used = _used + bits - 64;
+				}
+				else
+					_used += bits;
+			}
+
+			/**
+				@brief Writes the last bits and the padding read by bit_reader
+			*/
+			void finish() {
+				if(_used > 0)
+					emit(_word);
+				emit(0);
+				_word = 0;
+				_used = 0;
+			}
+	};
+
+	/**
+		@brief Reader of the fields written by bit_writer
+	*/
+	class bit_reader {
+
+		private:
+
+			const unsigned char* _data;
+			std::size_t _position;
+
+		public:
+
+			explicit bit_reader(const unsigned char* data) : _data(data), _position(0) {}
+
+			std::uint64_t get(unsigned int bits) {
+
+				if(bits == 0)
+					return 0;
+
+				const unsigned char* at = _data + (_position >> 3);
+				const unsigned int shift = static_cast<unsigned int>(_position & 7);
+				std::uint64_t value = load_le(at) >> shift;
+
+				if(shift + bits > 64)
+					value |= static_cast<std::uint64_t>(at[8]) << (64 - shift);
+
+				_position += bits;
+
+				return bits == 64 ? value : value & ((std::uint64_t(1) << bits) - 1);
+			}
+	};
+
+	/**
+		@brief Compression of n cells into out
+	*/
+	template <typename T>
+	void encode(const T* cells, std::size_t n, std::vector<unsigned char>& out) {
+
+		static_assert(std::is_arithmetic<T>::value && sizeof(T) <= 8, "brick_codec: the cells must be of an arithmetic type of at most 8 bytes");
+
+		constexpr unsigned int width = 8 * sizeof(T);
+		constexpr std::uint64_t mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+
+		out.clear();
+
+		if(n > 0) {
+			out.push_back(1);
+			out.resize(1 + sizeof(T));
+			std::memcpy(out.data() + 1, cells, sizeof(T));
+
+			bit_writer writer(out);
+			std::uint64_t previous = to_bits(cells[0]);
+			std::uint64_t zigzag[group];
+
+			for(std::size_t first = 0; first < n; first += group) {
+				const std::size_t count = std::min(group, n - first);
+				std::uint64_t any = 0;
+
+				for(std::size_t k = 0; k < count; ++k) {
+					const std::uint64_t bits = to_bits(cells[first + k]);
+					const std::uint64_t delta = (bits - previous) & mask;
+					const bool negative = (delta >> (width - 1)) & 1;
+
+					zigzag[k] = ((delta << 1) & mask) ^ (negative ? mask : 0);
+					any |= zigzag[k];
+					previous = bits;
+				}
+
+				const unsigned int bits = static_cast<unsigned int>(std::bit_width(any));
+
+				writer.put(bits, 7);
+				for(std::size_t k = 0; k < count; ++k)
+					writer.put(zigzag[k], bits);
+			}
+
+			writer.finish();
+		}
+
+		if(out.empty() || out.size() >= 1 + n * sizeof(T)) {
+			out.resize(1 + n * sizeof(T));
+			out[0] = 0;
+			if(n > 0)
+				std::memcpy(out.data() + 1, cells, n * sizeof(T));
+		}
+
+		out.shrink_to_fit();
+	}
+
+	/**
+		@brief Decompression of the n cells of data, written by encode()
+	*/
+	template <typename T>
+	void decode(const unsigned char* data, T* cells, std::size_t n) {
+
+		constexpr unsigned int width = 8 * sizeof(T);
+		constexpr std::uint64_t mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+
+		if(data[0] == 0) {
+			if(n > 0)
+				std::memcpy(cells, data + 1, n * sizeof(T));
+			return;
+		}
+
+		T first;
+		std::memcpy(&first, data + 1, sizeof(T));
+
+		bit_reader reader(data + 1 + sizeof(T));
+		std::uint64_t previous = to_bits(first);
+
+		for(std::size_t start = 0; start < n; start += group) {
+			const std::size_t count = std::min(group, n - start);
+			const unsigned int bits = static_cast<unsigned int>(reader.get(7));
+
+			if(bits == 0) {
+				std::fill(cells + start, cells + start + count, from_bits<T>(previous));
+				continue;
+			}
+
+			for(std::size_t k = 0; k < count; ++k) {
+				const std::uint64_t zigzag = reader.get(bits);
+				previous = (previous + ((zigzag >> 1) ^ ((zigzag & 1) ? mask : 0))) & mask;
+				cells[start + k] = from_bits<T>(previous);
+			}
+		}
+	}
+}
+
+
+/**
+  @brief Class for representing a compressed matrix_3d
+
+  The cells are split in bricks of brick_edge^3 cells (smaller on the far borders),
+  stored compressed by brick_codec. The cells are accessed through a cache of
+  decompressed bricks, replaced in least recently used order; a brick changed in the
+  cache is compressed again when it leaves the cache, or on flush(). By default the
+  cache holds one row of bricks and one more, columns() / brick_edge + 1 bricks, which
+  is what a traversal row after row (the order of operator(), fill() and the iterators)
+  goes through before coming back to a brick; a larger cache spares the decompression
+  of each brick once per plan. The slots of the cache are allocated on first use, at
+  the size of the largest brick, so a small matrix takes little memory.
+
+  The cache holds at least two bricks, and the brick left last is never the one
+  replaced: a reference to a cell stays valid until cells of two other bricks are
+  accessed, so that the read-only iterators can be used by the std algorithms, which
+  hold at most two references at a time. Even the read-only accesses update the cache,
+  so a compressed_matrix_3d must not be accessed by several threads at a time.
+
+  A brick is compressed again only if it was changed. The read/write accesses (the
+  non-const operator() and iterators) therefore give a proxy reference, which marks the
+  brick as changed only when assigned: reading through them costs no compression.
+*/
+template <typename T> class compressed_matrix_3d {
+
+	public:
+
+		typedef T value_type;
+		typedef matrix_index size_type;
+		typedef indexed_reference<compressed_matrix_3d> reference;
+		typedef indexed_iterator<compressed_matrix_3d, T> iterator;
+		typedef indexed_iterator<const compressed_matrix_3d, const T> const_iterator;
+
+		/**
+			@brief Number of cells of each side of the bricks
+		*/
+		static constexpr size_type brick_edge = 32;
+
+	private:
+
+		static constexpr std::size_t none = static_cast<std::size_t>(-1);
+		static constexpr unsigned int shift = 5;
+		static constexpr std::size_t brick_cells = brick_edge * brick_edge * brick_edge;
+
+		static_assert(std::size_t(1) << shift == brick_edge, "brick_edge must be 2^shift");
+
+		struct slot {
+			std::unique_ptr<T[]> cells;
+			std::size_t brick;
+			bool dirty;
+			std::list<std::size_t>::iterator lru;
+		};
+
+		size_type _plans;
+		size_type _rows;
+		size_type _col;
+		std::size_t _bricks_z;
+		std::size_t _bricks_y;
+		std::size_t _bricks_x;
+		mutable std::vector<std::vector<unsigned char>> _bricks;
+
+		mutable std::vector<slot> _slots;
+		mutable std::vector<std::size_t> _where;
+		mutable std::list<std::size_t> _lru;
+		mutable std::size_t _current;
+		mutable std::size_t _current_slot;
+		mutable T* _current_cells;
+		mutable std::size_t _current_rows;
+		mutable std::size_t _current_columns;
+		mutable std::size_t _recompressions;
+
+		template <typename M, typename V> friend class indexed_iterator;
+		template <typename M> friend class indexed_reference;
+
+		/**
+			@brief Extents of the brick b, plans, rows and columns
+		*/
+		std::array<std::size_t, 3> extents(std::size_t b) const {
+			const std::size_t k = b % _bricks_x, j = b / _bricks_x % _bricks_y, i = b / (_bricks_x * _bricks_y);
+
+			return {std::min<std::size_t>(brick_edge, _plans - (i << shift)),
+					std::min<std::size_t>(brick_edge, _rows - (j << shift)),
+					std::min<std::size_t>(brick_edge, _col - (k << shift))};
+		}
+
+		std::size_t brick_of(size_type z, size_type y, size_type x) const {
+			return ((z >> shift) * _bricks_y + (y >> shift)) * _bricks_x + (x >> shift);
+		}
+
+		/**
+			@brief Geometry and cache setup, the bricks left empty
+		*/
+		void setup(std::size_t cache_bricks) {
+
+			checked_extent(checked_extent(_plans, _rows), _col);
+
+			_bricks_z = (_plans + brick_edge - 1) >> shift;
+			_bricks_y = (_rows + brick_edge - 1) >> shift;
+			_bricks_x = (_col + brick_edge - 1) >> shift;
+
+			const std::size_t count = _bricks_z * _bricks_y * _bricks_x;
+
+			_bricks.assign(count, std::vector<unsigned char>());
+			reserve_cache(std::max<std::size_t>(2, cache_bricks > 0 ? cache_bricks : _bricks_x + 1), count);
+		}
+
+		void reserve_cache(std::size_t cache_bricks, std::size_t count) {
+
+			_slots.clear();
+			_lru.clear();
+			_where.assign(count, none);
+			_slots.resize(count > 0 ? cache_bricks : 0);
+
+			for(std::size_t i = 0; i < _slots.size(); ++i) {
+				_slots[i].brick = none;
+				_slots[i].dirty = false;
+				_slots[i].lru = _lru.insert(_lru.end(), i);
+			}
+
+			forget();
+		}
+
+		/**
+			@brief Compression of the changed brick of the slot s
+		*/
+		void recompress(slot& s) const {
+			const std::array<std::size_t, 3> e = extents(s.brick);
+			brick_codec::encode(s.cells.get(), e[0] * e[1] * e[2], _bricks[s.brick]);
+			s.dirty = false;
+			++_recompressions;
+		}
+
+		/**
+			@brief Number of cells of a slot, those of the first brick, the largest one
+		*/
+		std::size_t slot_cells() const {
+			return std::min<std::size_t>(brick_edge, _plans) * std::min<std::size_t>(brick_edge, _rows) *
+				   std::min<std::size_t>(brick_edge, _col);
+		}
+
+		/**
+			@brief Reset of the fast path to the current brick
+		*/
+		void forget() const {
+			_current = none;
+			_current_slot = none;
+			_current_cells = nullptr;
+			_current_rows = 0;
+			_current_columns = 0;
+		}
+
+		/**
+			@brief Cells of the brick b, decompressed if needed
+
+			The fast path: the current brick is returned without looking at the cache.
+		*/
+		T* cells_of(std::size_t b, bool write) const {
+
+			if(b != _current)
+				enter(b);
+
+			if(write)
+				_slots[_current_slot].dirty = true;
+
+			return _current_cells;
+		}
+
+		/**
+			@brief Change of the current brick
+
+			The replaced slot is the least recently used one, which, with two slots or
+			more, is never the one of the brick left, so that its references stay valid.
+		*/
+		void enter(std::size_t b) const {
+
+			std::size_t i = _where[b];
+
+			if(i == none) {
+				i = _lru.back();
+				slot& s = _slots[i];
+
+				if(s.brick != none) {
+					if(s.dirty)
+						recompress(s);
+					_where[s.brick] = none;
+				}
+
+				if(!s.cells)
+					s.cells.reset(new T[slot_cells()]);
+
+				const std::array<std::size_t, 3> e = extents(b);
+				brick_codec::decode(_bricks[b].data(), s.cells.get(), e[0] * e[1] * e[2]);
+				s.brick = b;
+				s.dirty = false;
+				_where[b] = i;
+			}
+
+			_lru.splice(_lru.begin(), _lru, _slots[i].lru);
+
+			const std::array<std::size_t, 3> e = extents(b);
+			_current = b;
+			_current_slot = i;
+			_current_cells = _slots[i].cells.get();
+			_current_rows = e[1];
+			_current_columns = e[2];
+		}
+
+		T& at(size_type z, size_type y, size_type x, bool write) const {
+			T* cells = cells_of(brick_of(z, y, x), write);
+			return cells[(((z & (brick_edge - 1)) * _current_rows) + (y & (brick_edge - 1))) * _current_columns + (x & (brick_edge - 1))];
+		}
+
+		/**
+			@brief Cell of linear index i, plan after plan and row after row
+		*/
+		reference cell(std::size_t i) {
+			return reference(this, i);
+		}
+
+		const T& cell(std::size_t i) const {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			return at(static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col), false);
+		}
+
+		/**
+			@brief Writing of the cell of linear index i, which marks its brick as changed
+		*/
+		void store(std::size_t i, const T& value) {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			at(static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col), true) = value;
+		}
+
+		/**
+			@brief Compression of the bricks of source, split among the workers of policy
+		*/
+		template <typename A>
+		void compress(const matrix_3d<T, A>& source, const parallel_t* policy) {
+
+			const std::size_t count = _bricks.size();
+			const std::size_t per_chunk = policy == nullptr ? count : policy->grain / brick_cells;
+
+			parallel_for(count, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+				std::vector<T> buffer(brick_cells);
+
+				for(std::size_t b = first; b < last; ++b) {
+					const std::array<std::size_t, 3> e = extents(b);
+					const std::size_t z0 = b / (_bricks_x * _bricks_y) << shift;
+					const std::size_t y0 = b / _bricks_x % _bricks_y << shift;
+					const std::size_t x0 = b % _bricks_x << shift;
+					T* out = buffer.data();
+
+					for(std::size_t i = 0; i < e[0]; ++i)
+						for(std::size_t j = 0; j < e[1]; ++j, out += e[2]) {
+							const T* row = source.data() + ((z0 + i) * source.rows() + y0 + j) * source.pitch() + x0;
+							std::copy(row, row + e[2], out);
+						}
+
+					brick_codec::encode(buffer.data(), e[0] * e[1] * e[2], _bricks[b]);
+				}
+			});
+		}
+
+		template <typename A>
+		void expand(matrix_3d<T, A>& result, const parallel_t* policy) const {
+
+			flush();
+
+			const std::size_t count = _bricks.size();
+			const std::size_t per_chunk = policy == nullptr ? count : policy->grain / brick_cells;
+
+			parallel_for(count, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+				std::vector<T> buffer(brick_cells);
+
+				for(std::size_t b = first; b < last; ++b) {
+					const std::array<std::size_t, 3> e = extents(b);
+					const std::size_t z0 = b / (_bricks_x * _bricks_y) << shift;
+					const std::size_t y0 = b / _bricks_x % _bricks_y << shift;
+					const std::size_t x0 = b % _bricks_x << shift;
+					const T* in = buffer.data();
+
+					brick_codec::decode(_bricks[b].data(), buffer.data(), e[0] * e[1] * e[2]);
+
+					for(std::size_t i = 0; i < e[0]; ++i)
+						for(std::size_t j = 0; j < e[1]; ++j, in += e[2])
+							std::copy(in, in + e[2], result.data() + ((z0 + i) * result.rows() + y0 + j) * result.pitch() + x0);
+				}
+			});
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Creates a null compressed_matrix_3d.
+		*/
+		compressed_matrix_3d() : compressed_matrix_3d(0, 0, 0) {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a z x y x x matrix of value-initialized cells. The bricks of the same
+			extents share a single compression, so building a large matrix takes no time.
+
+			@param z number of plans
+			@param y number of rows
+			@param x number of columns
+			@param cache_bricks number of decompressed bricks kept, 0 for one row of bricks and one more, at least 2
+
+			@throw std::length_error if the extents overflow
+		*/
+		compressed_matrix_3d(size_type z, size_type y, size_type x, std::size_t cache_bricks = 0)
+							 : _plans(z), _rows(y), _col(x), _bricks_z(0), _bricks_y(0), _bricks_x(0), _recompressions(0) {
+
+			setup(cache_bricks);
+
+			std::map<std::array<std::size_t, 3>, std::vector<unsigned char>> shared;
+			const std::vector<T> zeros(brick_cells, T());
+
+			for(std::size_t b = 0; b < _bricks.size(); ++b) {
+				const std::array<std::size_t, 3> e = extents(b);
+				auto found = shared.find(e);
+
+				if(found == shared.end()) {
+					found = shared.emplace(e, std::vector<unsigned char>()).first;
+					brick_codec::encode(zeros.data(), e[0] * e[1] * e[2], found->second);
+				}
+
+				_bricks[b] = found->second;
+			}
+		}
+
+		/**
+			@brief Compression constructor
+
+			@param source matrix_3d to compress
+			@param cache_bricks number of decompressed bricks kept, 0 for one row of bricks and one more, at least 2
+		*/
+		template <typename A>
+		explicit compressed_matrix_3d(const matrix_3d<T, A>& source, std::size_t cache_bricks = 0)
+									  : _plans(source.plans()), _rows(source.rows()), _col(source.columns()),
+									    _bricks_z(0), _bricks_y(0), _bricks_x(0), _recompressions(0) {
+			setup(cache_bricks);
+			compress(source, nullptr);
+		}
+
+		/**
+			@brief Parallel compression constructor
+
+			Same as compressed_matrix_3d(source, cache_bricks), with the bricks split among
+			the workers of policy.
+		*/
+		template <typename A>
+		compressed_matrix_3d(const matrix_3d<T, A>& source, const parallel_t& policy, std::size_t cache_bricks = 0)
+							 : _plans(source.plans()), _rows(source.rows()), _col(source.columns()),
+							   _bricks_z(0), _bricks_y(0), _bricks_x(0), _recompressions(0) {
+			setup(cache_bricks);
+			compress(source, &policy);
+		}
+
+		/**
+			@brief Copy constructor
+
+			Copies the compressed bricks, after compressing the changes pending in the
+			cache of other; the copy starts with an empty cache of the same size.
+		*/
+		compressed_matrix_3d(const compressed_matrix_3d& other)
+							 : _plans(other._plans), _rows(other._rows), _col(other._col),
+							   _bricks_z(other._bricks_z), _bricks_y(other._bricks_y), _bricks_x(other._bricks_x),
+							   _recompressions(0) {
+			other.flush();
+			_bricks = other._bricks;
+			reserve_cache(other._slots.size(), _bricks.size());
+		}
+
+		/**
+			@brief Move constructor
+		*/
+		compressed_matrix_3d(compressed_matrix_3d&& other) noexcept
+							 : _plans(other._plans), _rows(other._rows), _col(other._col),
+							   _bricks_z(other._bricks_z), _bricks_y(other._bricks_y), _bricks_x(other._bricks_x),
+							   _bricks(std::move(other._bricks)), _slots(std::move(other._slots)),
+							   _where(std::move(other._where)), _lru(std::move(other._lru)),
+							   _current(other._current), _current_slot(other._current_slot),
+							   _current_cells(other._current_cells), _current_rows(other._current_rows),
+							   _current_columns(other._current_columns), _recompressions(other._recompressions) {
+			other._plans = other._rows = other._col = 0;
+			other._bricks_z = other._bricks_y = other._bricks_x = 0;
+			other._bricks.clear();
+			other._slots.clear();
+			other._where.clear();
+			other._lru.clear();
+			other.forget();
+		}
+
+		compressed_matrix_3d& operator=(const compressed_matrix_3d& other) {
+			if(this != &other) {
+				compressed_matrix_3d copy(other);
+				*this = std::move(copy);
+			}
+			return *this;
+		}
+
+		compressed_matrix_3d& operator=(compressed_matrix_3d&& other) noexcept {
+			if(this != &other) {
+				compressed_matrix_3d moved(std::move(other));
+				swap(moved);
+			}
+			return *this;
+		}
+
+		void swap(compressed_matrix_3d& other) noexcept {
+			std::swap(_plans, other._plans);
+			std::swap(_rows, other._rows);
+			std::swap(_col, other._col);
+			std::swap(_bricks_z, other._bricks_z);
+			std::swap(_bricks_y, other._bricks_y);
+			std::swap(_bricks_x, other._bricks_x);
+			_bricks.swap(other._bricks);
+			_slots.swap(other._slots);
+			_where.swap(other._where);
+			_lru.swap(other._lru);
+			std::swap(_current, other._current);
+			std::swap(_current_slot, other._current_slot);
+			std::swap(_current_cells, other._current_cells);
+			std::swap(_current_rows, other._current_rows);
+			std::swap(_current_columns, other._current_columns);
+			std::swap(_recompressions, other._recompressions);
+		}
+
+		inline size_type plans() const {
+			return _plans;
+		}
+
+		inline size_type rows() const {
+			return _rows;
+		}
+
+		inline size_type columns() const {
+			return _col;
+		}
+
+		/**
+			@brief Total dimension getter
+		*/
+		inline size_type size() const {
+			return _plans * _rows * _col;
+		}
+
+		/**
+			@brief Number of bricks
+		*/
+		std::size_t bricks() const {
+			return _bricks.size();
+		}
+
+		/**
+			@brief Number of decompressed bricks kept in the cache
+		*/
+		std::size_t cache_bricks() const {
+			return _slots.size();
+		}
+
+		/**
+			@brief Memory taken by the compressed bricks, in bytes
+
+			The changes pending in the cache are compressed first.
+		*/
+		std::size_t compressed_bytes() const {
+
+			flush();
+
+			std::size_t bytes = 0;
+			for(const std::vector<unsigned char>& brick : _bricks)
+				bytes += brick.capacity();
+
+			return bytes;
+		}
+
+		/**
+			@brief Memory taken by the slots of the cache allocated so far, in bytes
+		*/
+		std::size_t cache_bytes() const {
+
+			std::size_t allocated = 0;
+			for(const slot& s : _slots)
+				allocated += s.cells != nullptr;
+
+			return allocated * slot_cells() * sizeof(T);
+		}
+
+		/**
+			@brief Number of bricks compressed again after a change in the cache
+		*/
+		std::size_t recompressions() const {
+			return _recompressions;
+		}
+
+		/**
+			@brief Cell access
+
+			@return proxy reference to the cell, which reads it like the read-only
+			operator() and marks its brick as changed only when assigned
+		*/
+		reference operator()(size_type z, size_type y, size_type x) {
+			assert(z < _plans && y < _rows && x < _col);
+			return reference(this, (std::size_t(z) * _rows + y) * _col + x);
+		}
+
+		/**
+			@brief Read-only cell access
+
+			Decompresses the brick of the cell if it is not in the cache. The reference
+			stays valid until cells of two other bricks are accessed.
+		*/
+		const T& operator()(size_type z, size_type y, size_type x) const {
+			assert(z < _plans && y < _rows && x < _col);
+			return at(z, y, x, false);
+		}
+
+		iterator begin() {
+			return iterator(this, 0);
+		}
+
+		iterator end() {
+			return iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		const_iterator begin() const {
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		/**
+			@brief Fill method
+
+			Fills the matrix, plan after plan and row after row, with the values obtained
+			from two generic iterators. If the iterator reaches the end before completely
+			filling the matrix, the remaining cells remain intact.
+		*/
+		template <typename I>
+		void fill(I start, I end) {
+
+			for(size_type z = 0; z < _plans; ++z)
+				for(size_type y = 0; y < _rows; ++y)
+					for(size_type x = 0; x < _col; x += brick_edge) {
+						T* cells = &at(z, y, x, true);
+						const size_type n = std::min<size_type>(brick_edge, _col - x);
+
+						for(size_type k = 0; k < n; ++k, ++start) {
+							if(start == end)
+								return;
+							cells[k] = static_cast<T>(*start);
+						}
+					}
+		}
+
+		/**
+		    @brief Comparison function
+
+		    Returns true if the two matrices have the same shape and equal cells
+		    according to equality, compared brick after brick.
+
+			@pre E : T x T -> {0, 1}
+	  	*/
+		template <typename E>
+		bool equals(const compressed_matrix_3d& other, const E equality) const {
+
+			if(_plans != other._plans || _rows != other._rows || _col != other._col)
+				return false;
+
+			if(this == &other)
+				return true;
+
+			for(std::size_t b = 0; b < _bricks.size(); ++b) {
+				const std::array<std::size_t, 3> e = extents(b);
+				const T* cells = cells_of(b, false);
+				const T* others = other.cells_of(b, false);
+
+				for(std::size_t i = 0; i < e[0] * e[1] * e[2]; ++i)
+					if(!equality(cells[i], others[i]))
+						return false;
+			}
+
+			return true;
+		}
+
+		bool operator==(const compressed_matrix_3d& other) const {
+			return equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		bool operator!=(const compressed_matrix_3d& other) const {
+			return !(*this == other);
+		}
+
+		/**
+			@brief Compression of the bricks changed in the cache
+
+			The bricks stay in the cache.
+		*/
+		void flush() const {
+			for(slot& s : _slots)
+				if(s.brick != none && s.dirty)
+					recompress(s);
+		}
+
+		/**
+			@brief Decompression into a matrix_3d
+
+			@param alloc allocator of the result
+
+			@return a matrix_3d holding the cells
+		*/
+		template <typename A = std::allocator<T>>
+		matrix_3d<T, A> decompress(const A& alloc = A()) const {
+			matrix_3d<T, A> result(_plans, _rows, _col, alloc);
+			expand(result, nullptr);
+			return result;
+		}
+
+		/**
+			@brief Parallel decompression into a matrix_3d
+
+			Same as decompress(alloc), with the bricks split among the workers of policy.
+		*/
+		template <typename A = std::allocator<T>>
+		matrix_3d<T, A> decompress(const parallel_t& policy, const A& alloc = A()) const {
+			matrix_3d<T, A> result(_plans, _rows, _col, alloc);
+			expand(result, &policy);
+			return result;
+		}
+};
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef MATRIX_COW
+#define MATRIX_COW
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <algorithm> // std::copy
+#include <vector>
+#include <memory> // std::shared_ptr, std::allocate_shared
+#include <utility> // std::move, std::swap
+#include "matrix_fwd.h"
+#include "matrix_iterator.h"
+
+/**
+  @file matrix_cow.h
+  @brief cow_matrix_3d template class declaration and implementation.
+*/
+
+
+/**
+  @brief Class for representing a matrix_3d whose copies share their plans
+
+  Each plan is a matrix_2d held by reference count, so copying a cow_matrix_3d copies
+  plans() pointers and no cell: a snapshot of a large volume costs O(plans). The
+  first read/write access to a plan (the non-const operator(), plan(), iterators,
+  fill()) of a matrix sharing it copies that plan only, so that the other copies
+  never see the change. The read-only accesses never copy.
+
+  Whether a plan is shared is decided from its reference count alone, so copying
+  only touches the reference counts and several threads may copy the same const
+  cow_matrix_3d at once. As with std::shared_ptr, different copies may be used by
+  different threads, but a single cow_matrix_3d must not be written while another
+  thread reads or copies it.
+
+  A reference or iterator to a cell obtained before a copy still points into the plan
+  now shared: writing through it changes the copy as well. Access the cell again
+  after copying to write it.
+*/
+template <typename T, typename A = std::allocator<T>> class cow_matrix_3d {
+
+	public:
+
+		typedef T value_type;
+		typedef matrix_index size_type;
+		typedef A allocator_type;
+		typedef indexed_iterator<cow_matrix_3d, T> iterator;
+		typedef indexed_iterator<const cow_matrix_3d, const T> const_iterator;
+
+	private:
+
+		typedef matrix_2d<T, A> plan_type;
+
+		size_type _plans;
+		size_type _rows;
+		size_type _col;
+		A _alloc;
+		std::vector<std::shared_ptr<plan_type>> _planes;
+
+		template <typename M, typename V> friend class indexed_iterator;
+
+		/**
+			@brief Plan z, copied first if shared
+		*/
+		plan_type& own(size_type z) {
+
+			if(_planes[z].use_count() > 1)
+				_planes[z] = std::allocate_shared<plan_type>(_alloc, *_planes[z]);
+
+			return *_planes[z];
+		}
+
+		T& cell(std::size_t i) {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			return (*this)(static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col));
+		}
+
+		const T& cell(std::size_t i) const {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			return (*this)(static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col));
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Creates a null cow_matrix_3d.
+		*/
+		cow_matrix_3d() : _plans(0), _rows(0), _col(0), _alloc(), _planes() {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a z x y x x matrix; the cells are left as matrix_2d leaves them.
+
+			@param z number of plans
+			@param y number of rows
+			@param x number of columns
+			@param alloc allocator of the plans
+		*/
+		cow_matrix_3d(size_type z, size_type y, size_type x, const A& alloc = A())
+					  : _plans(z), _rows(y), _col(x), _alloc(alloc), _planes() {
+
+			_planes.reserve(z);
+			for(size_type i = 0; i < z; ++i)
+				_planes.push_back(std::allocate_shared<plan_type>(_alloc, y, x, _alloc));
+		}
+
+		/**
+			@brief Conversion from a matrix_3d
+
+			Copies the cells of source.
+		*/
+		template <typename B>
+		explicit cow_matrix_3d(const matrix_3d<T, B>& source, const A& alloc = A())
+							   : cow_matrix_3d(source.plans(), source.rows(), source.columns(), alloc) {
+			for(size_type z = 0; z < _plans; ++z)
+				std::copy(source[z].begin(), source[z].end(), _planes[z]->begin());
+		}
+
+		/**
+			@brief Copy constructor
+
+			Shares the plans of other: no cell is copied.
+		*/
+		cow_matrix_3d(const cow_matrix_3d& other)
+					  : _plans(other._plans), _rows(other._rows), _col(other._col), _alloc(other._alloc),
+					    _planes(other._planes) {}
+
+		cow_matrix_3d(cow_matrix_3d&& other) noexcept
+					  : _plans(other._plans), _rows(other._rows), _col(other._col), _alloc(other._alloc),
+					    _planes(std::move(other._planes)) {
+			other._plans = other._rows = other._col = 0;
+			other._planes.clear();
+		}
+
+		/**
+			@brief Copy assignment
+
+			Shares the plans of other, releasing the current ones.
+		*/
+		cow_matrix_3d& operator=(const cow_matrix_3d& other) {
+			if(this != &other) {
+				cow_matrix_3d copy(other);
+				swap(copy);
+			}
+			return *this;
+		}
+
+		cow_matrix_3d& operator=(cow_matrix_3d&& other) noexcept {
+			if(this != &other) {
+				cow_matrix_3d moved(std::move(other));
+				swap(moved);
+			}
+			return *this;
+		}
+
+		void swap(cow_matrix_3d& other) noexcept {
+			std::swap(_plans, other._plans);
+			std::swap(_rows, other._rows);
+			std::swap(_col, other._col);
+			std::swap(_alloc, other._alloc);
+			_planes.swap(other._planes);
+		}
+
+		inline size_type plans() const {
+			return _plans;
+		}
+
+		inline size_type rows() const {
+			return _rows;
+		}
+
+		inline size_type columns() const {
+			return _col;
+		}
+
+		inline size_type size() const {
+			return _plans * _rows * _col;
+		}
+
+		A get_allocator() const {
+			return _alloc;
+		}
+
+		/**
+			@brief Read-only plan getter
+		*/
+		const plan_type& operator[](size_type z) const {
+			assert(z < _plans);
+			return *_planes[z];
+		}
+
+		/**
+			@brief Plan getter
+
+			Copies the plan first if it is shared.
+		*/
+		plan_type& plan(size_type z) {
+			assert(z < _plans);
+			return own(z);
+		}
+
+		/**
+			@brief Sharing test
+
+			@return true if the plan z is shared with another cow_matrix_3d
+		*/
+		bool shared(size_type z) const {
+			assert(z < _plans);
+			return _planes[z].use_count() > 1;
+		}
+
+		/**
+			@brief Cell access
+
+			Copies the plan of the cell first if it is shared.
+		*/
+		T& operator()(size_type z, size_type y, size_type x) {
+			assert(z < _plans);
+			return own(z)(y, x);
+		}
+
+		/**
+			@brief Read-only cell access
+		*/
+		const T& operator()(size_type z, size_type y, size_type x) const {
+			assert(z < _plans);
+			return (*_planes[z])(y, x);
+		}
+
+		iterator begin() {
+			return iterator(this, 0);
+		}
+
+		iterator end() {
+			return iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		const_iterator begin() const {
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		/**
+			@brief Fill method
+
+			Fills the matrix, plan after plan and row after row, with the values obtained
+			from two generic iterators, copying only the shared plans that receive values.
+			If the iterator reaches the end before completely filling the matrix, the
+			remaining cells remain intact.
+		*/
+		template <typename I>
+		void fill(I start, I end) {
+			for(size_type z = 0; z < _plans && start != end; ++z) {
+				plan_type& p = own(z);
+
+				for(auto cell = p.begin(); cell != p.end() && start != end; ++cell, ++start)
+					*cell = static_cast<T>(*start);
+			}
+		}
+
+		/**
+		    @brief Comparison function
+
+		    Returns true if the two matrices have the same shape and equal cells
+		    according to equality. The plans shared by the two matrices are not read.
+
+			@pre E : T x T -> {0, 1}
+	  	*/
+		template <typename E>
+		bool equals(const cow_matrix_3d& other, const E equality) const {
+
+			if(_plans != other._plans || _rows != other._rows || _col != other._col)
+				return false;
+
+			for(size_type z = 0; z < _plans; ++z)
+				if(_planes[z] != other._planes[z] && !_planes[z]->equals(*other._planes[z], equality))
+					return false;
+
+			return true;
+		}
+
+		bool operator==(const cow_matrix_3d& other) const {
+			return equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		bool operator!=(const cow_matrix_3d& other) const {
+			return !(*this == other);
+		}
+
+		/**
+			@brief Conversion to a matrix_3d
+
+			@return a matrix_3d holding a copy of the cells
+		*/
+		template <typename B = std::allocator<T>>
+		matrix_3d<T, B> dense(const B& alloc = B()) const {
+
+			matrix_3d<T, B> result(_plans, _rows, _col, alloc);
+			auto out = result.begin();
+
+			for(size_type z = 0; z < _plans; ++z)
+				out = std::copy(_planes[z]->begin(), _planes[z]->end(), out);
+
+			return result;
+		}
+};
+
+#endif
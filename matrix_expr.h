@@ -0,0 +1,480 @@
+#ifndef MATRIX_EXPR
+#define MATRIX_EXPR
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <cmath>
+#include <functional> // std::plus, std::minus, std::multiplies, std::divides, std::negate
+#include <type_traits>
+#include <utility> // std::declval
+#include "matrix_fwd.h"
+#include "matrix_simd.h"
+
+/**
+  @file matrix_expr.h
+  @brief Lazy element-wise expressions on matrix_2d and matrix_3d declaration and implementation.
+
+  The arithmetic operators + - * / and the math functions abs, sqrt, exp, log, sin and
+  cos applied to matrices do not compute anything: they return a small expression
+  object describing the computation. The cells are computed only when the expression
+  is assigned to a matrix, in a single pass over the destination and without any
+  intermediate matrix:
+
+	matrix_3d<float> r = a * 0.5f + b - c;	// one allocation, one pass
+	r = sqrt(a) / b;						// no allocation, r keeps its cells
+	r += a * 2.0f;							// no allocation
+
+  An expression refers to the cells of its matrices without copying them, so it must
+  be evaluated while they are alive, usually in the same statement. Since every cell
+  of the result only depends on the cells in the same position of the operands, a
+  matrix can appear on both sides of an assignment.
+*/
+
+
+/**
+  @brief Base class of the expression nodes
+
+  Every expression node E derives from matrix_expr<E>, which is the type accepted by
+  the matrix constructors and assignment operators. Each node provides:
+  - value_type, the type of its cells;
+  - scalar, true for the nodes broadcasting a single value;
+  - plans(), rows(), columns(), its shape;
+  - packed(), true if the cells of all its matrices are stored without row padding;
+  - row(r), a cursor on the r-th row of the whole expression, whose [j] operator
+	computes the j-th cell of the row. When packed() is true, the cursor on the row
+	0 reaches all the cells of the expression.
+*/
+template <typename E>
+class matrix_expr {
+	public:
+
+		/**
+			@brief Node getter
+
+			@return reference to the node as its actual type
+		*/
+		const E& self() const {
+			return static_cast<const E&>(*this);
+		}
+};
+
+
+/**
+  @brief Expression node reading the cells of a matrix
+
+  Refers to the cells of a matrix_2d, seen as a single plan, or of a matrix_3d.
+*/
+template <typename T>
+class matrix_operand : public matrix_expr<matrix_operand<T>> {
+
+	private:
+
+		const T* _data;
+		std::size_t _plans;
+		std::size_t _rows;
+		std::size_t _col;
+		std::size_t _pitch;
+
+	public:
+
+		typedef T value_type;
+
+		static constexpr bool scalar = false;
+
+		template <typename A>
+		explicit matrix_operand(const matrix_2d<T, A>& m) : _data(m.data()), _plans(m.rows() > 0 ? 1 : 0),
+															 _rows(m.rows()), _col(m.columns()), _pitch(m.pitch()) {}
+
+		template <typename A>
+		explicit matrix_operand(const matrix_3d<T, A>& m) : _data(m.data()), _plans(m.plans()),
+															 _rows(m.rows()), _col(m.columns()), _pitch(m.pitch()) {}
+
+		std::size_t plans() const {return _plans;}
+		std::size_t rows() const {return _rows;}
+		std::size_t columns() const {return _col;}
+
+		bool packed() const {return _pitch == _col;}
+
+		const T* row(std::size_t r) const {
+			return _data + r * _pitch;
+		}
+};
+
+
+/**
+  @brief Expression node broadcasting a single value to every cell
+*/
+template <typename S>
+class scalar_operand : public matrix_expr<scalar_operand<S>> {
+
+	private:
+
+		S _value;
+
+	public:
+
+		typedef S value_type;
+
+		static constexpr bool scalar = true;
+
+		struct cursor {
+			S value;
+
+			S operator[](std::size_t) const {
+				return value;
+			}
+		};
+
+		explicit scalar_operand(S value) : _value(value) {}
+
+		std::size_t plans() const {return 0;}
+		std::size_t rows() const {return 0;}
+		std::size_t columns() const {return 0;}
+
+		bool packed() const {return true;}
+
+		cursor row(std::size_t) const {
+			return cursor{_value};
+		}
+};
+
+
+/**
+  @brief Expression node applying a functor of type Op to each cell of an expression
+*/
+template <typename E, typename Op>
+class unary_expr : public matrix_expr<unary_expr<E, Op>> {
+
+	private:
+
+		E _arg;
+
+	public:
+
+		typedef decltype(Op()(std::declval<typename E::value_type>())) value_type;
+
+		static constexpr bool scalar = E::scalar;
+
+		struct cursor {
+			decltype(std::declval<const E&>().row(0)) arg;
+
+			value_type operator[](std::size_t j) const {
+				return Op()(arg[j]);
+			}
+		};
+
+		explicit unary_expr(const E& arg) : _arg(arg) {}
+
+		std::size_t plans() const {return _arg.plans();}
+		std::size_t rows() const {return _arg.rows();}
+		std::size_t columns() const {return _arg.columns();}
+
+		bool packed() const {return _arg.packed();}
+
+		cursor row(std::size_t r) const {
+			return cursor{_arg.row(r)};
+		}
+};
+
+
+/**
+  @brief Expression node combining the cells in the same position of two expressions
+  with a functor of type Op
+
+  One of the two expressions can be a scalar_operand, otherwise they must have the
+  same shape.
+*/
+template <typename L, typename R, typename Op>
+class binary_expr : public matrix_expr<binary_expr<L, R, Op>> {
+
+	private:
+
+		L _left;
+		R _right;
+
+	public:
+
+		typedef decltype(Op()(std::declval<typename L::value_type>(),
+							  std::declval<typename R::value_type>())) value_type;
+
+		static constexpr bool scalar = L::scalar && R::scalar;
+
+		struct cursor {
+			decltype(std::declval<const L&>().row(0)) left;
+			decltype(std::declval<const R&>().row(0)) right;
+
+			value_type operator[](std::size_t j) const {
+				return Op()(left[j], right[j]);
+			}
+		};
+
+		/**
+			@brief Parameterized constructor
+
+			@pre left and right have the same shape, or one of them is scalar
+		*/
+		binary_expr(const L& left, const R& right) : _left(left), _right(right) {
+			assert(L::scalar || R::scalar || (left.plans() == right.plans() &&
+											  left.rows() == right.rows() &&
+											  left.columns() == right.columns()));
+		}
+
+		std::size_t plans() const {return L::scalar ? _right.plans() : _left.plans();}
+		std::size_t rows() const {return L::scalar ? _right.rows() : _left.rows();}
+		std::size_t columns() const {return L::scalar ? _right.columns() : _left.columns();}
+
+		bool packed() const {return _left.packed() && _right.packed();}
+
+		cursor row(std::size_t r) const {
+			return cursor{_left.row(r), _right.row(r)};
+		}
+};
+
+
+/**
+  @brief Functors of the math functions available on expressions
+*/
+namespace expr_ops {
+
+	struct abs {
+		template <typename U>
+		auto operator()(U v) const {return v < U(0) ? -v : v;}
+	};
+
+	struct sqrt {
+		template <typename U>
+		auto operator()(U v) const {return std::sqrt(v);}
+	};
+
+	struct exp {
+		template <typename U>
+		auto operator()(U v) const {return std::exp(v);}
+	};
+
+	struct log {
+		template <typename U>
+		auto operator()(U v) const {return std::log(v);}
+	};
+
+	struct sin {
+		template <typename U>
+		auto operator()(U v) const {return std::sin(v);}
+	};
+
+	struct cos {
+		template <typename U>
+		auto operator()(U v) const {return std::cos(v);}
+	};
+}
+
+
+/**
+  @brief Mapping from the operands of the operators to expression nodes
+
+  Matrices become matrix_operand, arithmetic values scalar_operand, and expression
+  nodes are kept as they are. value is true for the types that are matrices or
+  expressions.
+*/
+template <typename X, typename = void>
+struct expr_traits {
+	static constexpr bool value = false;
+};
+
+template <typename T, typename A>
+struct expr_traits<matrix_2d<T, A>> {
+	static constexpr bool value = true;
+	typedef matrix_operand<T> type;
+	static type wrap(const matrix_2d<T, A>& m) {return type(m);}
+};
+
+template <typename T, typename A>
+struct expr_traits<matrix_3d<T, A>> {
+	static constexpr bool value = true;
+	typedef matrix_operand<T> type;
+	static type wrap(const matrix_3d<T, A>& m) {return type(m);}
+};
+
+template <typename X>
+struct expr_traits<X, typename std::enable_if<std::is_base_of<matrix_expr<X>, X>::value>::type> {
+	static constexpr bool value = true;
+	typedef X type;
+	static const X& wrap(const X& e) {return e;}
+};
+
+template <typename X>
+struct expr_traits<X, typename std::enable_if<std::is_arithmetic<X>::value>::type> {
+	static constexpr bool value = false;
+	typedef scalar_operand<X> type;
+	static type wrap(X v) {return type(v);}
+};
+
+/**
+  @brief Node type of a binary operator
+
+  Defined only if at least one of X and Y is a matrix or an expression and the other
+  one is a matrix, an expression or an arithmetic value.
+*/
+template <typename X, typename Y, typename Op>
+using binary_expr_t = typename std::enable_if<(expr_traits<X>::value || expr_traits<Y>::value) &&
+											  (expr_traits<X>::value || std::is_arithmetic<X>::value) &&
+											  (expr_traits<Y>::value || std::is_arithmetic<Y>::value),
+											  binary_expr<typename expr_traits<X>::type,
+											  			  typename expr_traits<Y>::type, Op>>::type;
+
+/**
+  @brief Node type of a unary operator or function
+
+  Defined only if X is a matrix or an expression.
+*/
+template <typename X, typename Op>
+using unary_expr_t = typename std::enable_if<expr_traits<X>::value,
+											 unary_expr<typename expr_traits<X>::type, Op>>::type;
+
+
+template <typename X, typename Y>
+binary_expr_t<X, Y, std::plus<>> operator+(const X& x, const Y& y) {
+	return binary_expr_t<X, Y, std::plus<>>(expr_traits<X>::wrap(x), expr_traits<Y>::wrap(y));
+}
+
+template <typename X, typename Y>
+binary_expr_t<X, Y, std::minus<>> operator-(const X& x, const Y& y) {
+	return binary_expr_t<X, Y, std::minus<>>(expr_traits<X>::wrap(x), expr_traits<Y>::wrap(y));
+}
+
+template <typename X, typename Y>
+binary_expr_t<X, Y, std::multiplies<>> operator*(const X& x, const Y& y) {
+	return binary_expr_t<X, Y, std::multiplies<>>(expr_traits<X>::wrap(x), expr_traits<Y>::wrap(y));
+}
+
+template <typename X, typename Y>
+binary_expr_t<X, Y, std::divides<>> operator/(const X& x, const Y& y) {
+	return binary_expr_t<X, Y, std::divides<>>(expr_traits<X>::wrap(x), expr_traits<Y>::wrap(y));
+}
+
+template <typename X>
+unary_expr_t<X, std::negate<>> operator-(const X& x) {
+	return unary_expr_t<X, std::negate<>>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::abs> abs(const X& x) {
+	return unary_expr_t<X, expr_ops::abs>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::sqrt> sqrt(const X& x) {
+	return unary_expr_t<X, expr_ops::sqrt>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::exp> exp(const X& x) {
+	return unary_expr_t<X, expr_ops::exp>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::log> log(const X& x) {
+	return unary_expr_t<X, expr_ops::log>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::sin> sin(const X& x) {
+	return unary_expr_t<X, expr_ops::sin>(expr_traits<X>::wrap(x));
+}
+
+template <typename X>
+unary_expr_t<X, expr_ops::cos> cos(const X& x) {
+	return unary_expr_t<X, expr_ops::cos>(expr_traits<X>::wrap(x));
+}
+
+
+/**
+  @brief Compound assignment operators
+
+  m op= x is evaluated as m = m op x, in a single pass over the cells of m and
+  without allocating.
+
+  @pre x is a scalar or has the shape of m
+*/
+template <typename M, typename Y>
+typename std::enable_if<expr_traits<M>::value && !std::is_base_of<matrix_expr<M>, M>::value,
+						M&>::type operator+=(M& m, const Y& y) {
+	return m = static_cast<const M&>(m) + y;
+}
+
+template <typename M, typename Y>
+typename std::enable_if<expr_traits<M>::value && !std::is_base_of<matrix_expr<M>, M>::value,
+						M&>::type operator-=(M& m, const Y& y) {
+	return m = static_cast<const M&>(m) - y;
+}
+
+template <typename M, typename Y>
+typename std::enable_if<expr_traits<M>::value && !std::is_base_of<matrix_expr<M>, M>::value,
+						M&>::type operator*=(M& m, const Y& y) {
+	return m = static_cast<const M&>(m) * y;
+}
+
+template <typename M, typename Y>
+typename std::enable_if<expr_traits<M>::value && !std::is_base_of<matrix_expr<M>, M>::value,
+						M&>::type operator/=(M& m, const Y& y) {
+	return m = static_cast<const M&>(m) / y;
+}
+
+
+/**
+  @brief Row range evaluation function
+
+  Computes the rows [first, last) of expr into the destination rows of columns cells,
+  pitch cells apart, starting at data. When neither the destination nor the matrices
+  of expr have row padding, the range is computed as a single run; otherwise one row
+  at a time. Each run goes through generate_cells(), and so through the vectorized
+  kernels.
+
+  @param expr expression to evaluate
+  @param data first cell of the row 0 of the destination
+  @param pitch distance in cells between the starts of two destination rows
+  @param first first row to compute, all the plans included
+  @param last row after the last one to compute
+  @param columns number of columns
+
+  @pre the destination has the shape of expr
+*/
+template <typename T, typename E>
+void evaluate_rows(const E& expr, T* data, std::size_t pitch, std::size_t first, std::size_t last,
+				   std::size_t columns) {
+
+	if(first >= last || columns == 0)
+		return;
+
+	if(pitch == columns && expr.packed()) {
+		const auto cursor = expr.row(first);
+		generate_cells(data + first * pitch, (last - first) * columns, 
+					   [&cursor] (std::size_t j) {return static_cast<T>(cursor[j]);});
+		return;
+	}
+
+	for(std::size_t r = first; r < last; ++r) {
+		const auto cursor = expr.row(r);
+		generate_cells(data + r * pitch, columns, [&cursor] (std::size_t j) {return static_cast<T>(cursor[j]);});
+	}
+}
+
+/**
+  @brief Evaluation function
+
+  Computes all the cells of expr into rows rows of columns cells, pitch cells apart,
+  starting at data (see evaluate_rows()).
+
+  @param expr expression to evaluate
+  @param data first destination cell
+  @param pitch distance in cells between the starts of two destination rows
+  @param rows number of rows, all the plans included
+  @param columns number of columns
+
+  @pre the destination has the shape of expr
+*/
+template <typename T, typename E>
+void evaluate_expression(const E& expr, T* data, std::size_t pitch, std::size_t rows, std::size_t columns) {
+	evaluate_rows(expr, data, pitch, 0, rows, columns);
+}
+
+#endif
@@ -0,0 +1,789 @@
+#ifndef MATRIX_FIXED
+#define MATRIX_FIXED
+
+#include <iostream>
+#include <cassert>
+#include <initializer_list>
+#include <span>
+#include <algorithm> // std::min
+#include <utility> // std::swap
+#include <type_traits>
+#include "matrix_fwd.h"
+#include "matrix_view.h"
+#include "matrix_2d.h"
+
+/**
+  @file matrix_fixed.h
+  @brief fixed_matrix_2d and fixed_matrix_3d template classes declaration and implementation.
+
+  The fixed matrices have their extents in the type, and their cells inline in the
+  object: they are never allocated, they can live on the stack or inside other objects,
+  and all their loops have a constant trip count, so that the compiler can unroll the
+  small ones entirely. Construction, access, comparison, slicing, transformation and
+  arithmetic are constexpr:
+
+	constexpr fixed_matrix_3d<int, 3, 3, 3> ones(1);
+	static_assert((ones + ones)(1, 1, 1) == 2);
+
+  They offer the interface of matrix_2d and matrix_3d (rows(), columns(), plans(),
+  operator(), data(), iterators, equals(), slice(), view(), fill(), transform()), so
+  that generic code can use both. The rows are never padded: pitch() == columns().
+*/
+
+
+/**
+  @brief Class for representing a two-dimensional array of Y x X cells
+*/
+template <typename T, unsigned int Y, unsigned int X> class fixed_matrix_2d {
+
+	static_assert(Y > 0 && X > 0, "fixed_matrix_2d extents must be positive");
+
+	public:
+
+		/**
+			@brief Data type to represent the dimensions of the two-dimensional matrix
+		*/
+		typedef unsigned int size_type;
+
+		typedef T value_type;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+
+	private:
+
+		T _cells[Y * X];
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Initialize all the cells to T().
+		*/
+		constexpr fixed_matrix_2d(void) : _cells() {}
+
+		/**
+			@brief Value constructor
+
+			@param value value of all the cells
+		*/
+		constexpr explicit fixed_matrix_2d(const T& value) : _cells() {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] = value;
+		}
+
+		/**
+			@brief Initializer list constructor
+
+			Initialize the cells row after row from values; the cells past the end of
+			values are initialized to T().
+
+			@param values values of the first cells
+
+			@pre values.size() <= size()
+		*/
+		constexpr fixed_matrix_2d(std::initializer_list<T> values) : _cells() {
+			assert(values.size() <= Y * X);
+
+			size_type i = 0;
+			for(const T& value : values)
+				_cells[i++] = value;
+		}
+
+		/**
+			@brief [y, x] cell getter/setter
+
+			@pre y < Y
+			@pre x < X
+
+			@return reference to [y, x] cell
+		*/
+		constexpr T& operator()(size_type y, size_type x) {
+			assert(y < Y);
+			assert(x < X);
+
+			return _cells[y * X + x];
+		}
+
+		/**
+			@brief [y, x] cell getter
+
+			@pre y < Y
+			@pre x < X
+
+			@return read-only reference to [y, x] cell
+		*/
+		constexpr const T& operator()(size_type y, size_type x) const {
+			assert(y < Y);
+			assert(x < X);
+
+			return _cells[y * X + x];
+		}
+
+		static constexpr size_type rows() {return Y;}
+		static constexpr size_type columns() {return X;}
+		static constexpr size_type pitch() {return X;}
+		static constexpr size_type size() {return Y * X;}
+
+		constexpr T* data() {return _cells;}
+		constexpr const T* data() const {return _cells;}
+
+		constexpr iterator begin() {return _cells;}
+		constexpr iterator end() {return _cells + Y * X;}
+		constexpr const_iterator begin() const {return _cells;}
+		constexpr const_iterator end() const {return _cells + Y * X;}
+
+		/**
+			@brief Class swap method
+
+			@param other the fixed_matrix_2d to exchange content with
+		*/
+		constexpr void swap(fixed_matrix_2d& other) {
+			using std::swap;
+			for(size_type i = 0; i < Y * X; ++i)
+				swap(_cells[i], other._cells[i]);
+		}
+
+		/**
+			@brief Comparison function
+
+			@param other the fixed_matrix_2d to compare with the current instance
+			@param equality the functor to use for the comparison
+
+			@pre E : T x T -> {0, 1}
+
+			@return true if all the cells are equal according to equality
+		*/
+		template <typename E>
+		constexpr bool equals(const fixed_matrix_2d& other, const E equality) const {
+			for(size_type i = 0; i < Y * X; ++i)
+				if(!equality(_cells[i], other._cells[i]))
+					return false;
+
+			return true;
+		}
+
+		constexpr bool operator==(const fixed_matrix_2d& other) const {
+			return this->equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		constexpr bool operator!=(const fixed_matrix_2d& other) const {
+			return !((*this) == other);
+		}
+
+		/**
+			@brief Compile-time submatrix extraction
+
+			Bounds are included, as in matrix_2d::slice().
+
+			@return submatrix [Y1:Y2, X1:X2]
+		*/
+		template <unsigned int Y1, unsigned int Y2, unsigned int X1, unsigned int X2>
+		constexpr fixed_matrix_2d<T, Y2 - Y1 + 1, X2 - X1 + 1> slice() const {
+
+			static_assert(Y1 <= Y2 && Y2 < Y && X1 <= X2 && X2 < X, "slice out of the matrix");
+
+			fixed_matrix_2d<T, Y2 - Y1 + 1, X2 - X1 + 1> result;
+
+			for(size_type i = Y1; i <= Y2; ++i)
+				for(size_type j = X1; j <= X2; ++j)
+					result(i - Y1, j - X1) = (*this)(i, j);
+
+			return result;
+		}
+
+		/**
+			@brief Submatrix extraction by value
+
+			Same as matrix_2d::slice(y1, y2, x1, x2, by_value): the bounds are known at
+			run time only, so the result is a matrix_2d.
+
+			@return submatrix [y1:y2, x1:x2]
+		*/
+		matrix_2d<T> slice(size_type y1, size_type y2, size_type x1, size_type x2, by_value_t) const {
+
+			assert(y1 <= y2 && y2 < Y);
+			assert(x1 <= x2 && x2 < X);
+
+			matrix_2d<T> result(y2 - y1 + 1, x2 - x1 + 1);
+
+			for(size_type i = y1; i <= y2; ++i)
+				for(size_type j = x1; j <= x2; ++j)
+					result(i - y1, j - x1) = (*this)(i, j);
+
+			return result;
+		}
+
+		matrix_2d_view<T> view() {
+			return matrix_2d_view<T>(_cells, Y, X, X);
+		}
+
+		matrix_2d_view<const T> view() const {
+			return matrix_2d_view<const T>(_cells, Y, X, X);
+		}
+
+		/**
+			@brief Submatrix view
+
+			Same as matrix_2d::view(y1, y2, x1, x2).
+		*/
+		matrix_2d_view<T> view(size_type y1, size_type y2, size_type x1, size_type x2) {
+			return view().view(y1, y2, x1, x2);
+		}
+
+		matrix_2d_view<const T> view(size_type y1, size_type y2, size_type x1, size_type x2) const {
+			return view().view(y1, y2, x1, x2);
+		}
+
+		/**
+			@brief Fill method
+
+			Same as matrix_2d::fill(): the cells are overwritten row after row with the
+			values of [start, end), the remaining cells are left intact, and if an
+			exception is thrown the matrix is not changed.
+		*/
+		template <typename I>
+		constexpr void fill(I start, I end) {
+
+			fixed_matrix_2d tmp(*this);
+
+			for(size_type i = 0; i < Y * X && start != end; ++i, ++start)
+				tmp._cells[i] = static_cast<T>(*start);
+
+			this->swap(tmp);
+		}
+
+		/**
+			@name Cellwise arithmetic
+
+			Every operator works cell by cell, between two fixed_matrix_2d of the same
+			shape or between a fixed_matrix_2d and a scalar, as the expressions of
+			matrix_expr.h do for matrix_2d.
+		*/
+		///@{
+		constexpr fixed_matrix_2d& operator+=(const fixed_matrix_2d& other) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] += other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_2d& operator-=(const fixed_matrix_2d& other) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] -= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_2d& operator*=(const fixed_matrix_2d& other) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] *= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_2d& operator/=(const fixed_matrix_2d& other) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] /= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_2d& operator*=(const T& s) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] *= s;
+			return *this;
+		}
+
+		constexpr fixed_matrix_2d& operator/=(const T& s) {
+			for(size_type i = 0; i < Y * X; ++i)
+				_cells[i] /= s;
+			return *this;
+		}
+
+		friend constexpr fixed_matrix_2d operator+(fixed_matrix_2d a, const fixed_matrix_2d& b) {return a += b;}
+		friend constexpr fixed_matrix_2d operator-(fixed_matrix_2d a, const fixed_matrix_2d& b) {return a -= b;}
+		friend constexpr fixed_matrix_2d operator*(fixed_matrix_2d a, const fixed_matrix_2d& b) {return a *= b;}
+		friend constexpr fixed_matrix_2d operator/(fixed_matrix_2d a, const fixed_matrix_2d& b) {return a /= b;}
+		friend constexpr fixed_matrix_2d operator*(fixed_matrix_2d a, const T& s) {return a *= s;}
+		friend constexpr fixed_matrix_2d operator*(const T& s, fixed_matrix_2d a) {return a *= s;}
+		friend constexpr fixed_matrix_2d operator/(fixed_matrix_2d a, const T& s) {return a /= s;}
+
+		friend constexpr fixed_matrix_2d operator-(fixed_matrix_2d a) {
+			for(size_type i = 0; i < Y * X; ++i)
+				a._cells[i] = -a._cells[i];
+			return a;
+		}
+		///@}
+
+		/**
+			@brief Print function
+
+			Prints the fixed_matrix_2d as operator<< does for matrix_2d.
+		*/
+		friend std::ostream& operator<<(std::ostream& os, const fixed_matrix_2d& matrix) {
+			for(size_type i = 0; i < Y; ++i) {
+				for(size_type j = 0; j < X; ++j)
+					os << matrix(i, j) << " ";
+				os << std::endl;
+			}
+
+			return os;
+		}
+};
+
+
+/**
+  @brief Class for representing a three-dimensional array of Z x Y x X cells
+
+  The cells are stored plan after plan and row after row, as in matrix_3d.
+*/
+template <typename T, unsigned int Z, unsigned int Y, unsigned int X> class fixed_matrix_3d {
+
+	static_assert(Z > 0 && Y > 0 && X > 0, "fixed_matrix_3d extents must be positive");
+
+	public:
+
+		/**
+			@brief Data type to represent the dimensions of the three-dimensional matrix
+		*/
+		typedef unsigned int size_type;
+
+		typedef T value_type;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+
+	private:
+
+		T _cells[Z * Y * X];
+
+		/**
+			@brief Visit helper
+
+			Same as matrix_3d::visit(): f may stop a traversal by returning false.
+		*/
+		template <typename F, typename U>
+		static constexpr bool visit(F& f, U&& arg) {
+			if constexpr (std::is_same<std::invoke_result_t<F&, U>, bool>::value)
+				return f(std::forward<U>(arg));
+			else {
+				f(std::forward<U>(arg));
+				return true;
+			}
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Initialize all the cells to T().
+		*/
+		constexpr fixed_matrix_3d(void) : _cells() {}
+
+		/**
+			@brief Value constructor
+
+			@param value value of all the cells
+		*/
+		constexpr explicit fixed_matrix_3d(const T& value) : _cells() {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] = value;
+		}
+
+		/**
+			@brief Initializer list constructor
+
+			Initialize the cells plan after plan and row after row from values; the cells
+			past the end of values are initialized to T().
+
+			@param values values of the first cells
+
+			@pre values.size() <= size()
+		*/
+		constexpr fixed_matrix_3d(std::initializer_list<T> values) : _cells() {
+			assert(values.size() <= Z * Y * X);
+
+			size_type i = 0;
+			for(const T& value : values)
+				_cells[i++] = value;
+		}
+
+		/**
+			@brief z-th plan getter
+
+			@pre z < Z
+
+			@return read-only view of the z-th plan
+		*/
+		matrix_2d_view<const T> operator[](size_type z) const {
+			assert(z < Z);
+
+			return matrix_2d_view<const T>(_cells + z * Y * X, Y, X, X);
+		}
+
+		/**
+			@brief [z, y, x] cell getter/setter
+
+			@pre z < Z
+			@pre y < Y
+			@pre x < X
+
+			@return reference to [z, y, x] cell
+		*/
+		constexpr T& operator()(size_type z, size_type y, size_type x) {
+			assert(z < Z);
+			assert(y < Y);
+			assert(x < X);
+
+			return _cells[(z * Y + y) * X + x];
+		}
+
+		/**
+			@brief [z, y, x] cell getter
+
+			@pre z < Z
+			@pre y < Y
+			@pre x < X
+
+			@return read-only reference to [z, y, x] cell
+		*/
+		constexpr const T& operator()(size_type z, size_type y, size_type x) const {
+			assert(z < Z);
+			assert(y < Y);
+			assert(x < X);
+
+			return _cells[(z * Y + y) * X + x];
+		}
+
+		static constexpr size_type plans() {return Z;}
+		static constexpr size_type rows() {return Y;}
+		static constexpr size_type columns() {return X;}
+		static constexpr size_type pitch() {return X;}
+		static constexpr size_type size() {return Z * Y * X;}
+
+		constexpr T* data() {return _cells;}
+		constexpr const T* data() const {return _cells;}
+
+		constexpr iterator begin() {return _cells;}
+		constexpr iterator end() {return _cells + Z * Y * X;}
+		constexpr const_iterator begin() const {return _cells;}
+		constexpr const_iterator end() const {return _cells + Z * Y * X;}
+
+		/**
+			@brief Class swap method
+
+			@param other the fixed_matrix_3d to exchange content with
+		*/
+		constexpr void swap(fixed_matrix_3d& other) {
+			using std::swap;
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				swap(_cells[i], other._cells[i]);
+		}
+
+		/**
+			@brief Plans traversal
+
+			Same as matrix_3d::for_each_plane().
+
+			@pre F : matrix_2d_view<T> -> void or bool
+		*/
+		template <typename F>
+		bool for_each_plane(F f) {
+			for(size_type z = 0; z < Z; ++z)
+				if(!visit(f, matrix_2d_view<T>(_cells + z * Y * X, Y, X, X)))
+					return false;
+
+			return true;
+		}
+
+		template <typename F>
+		bool for_each_plane(F f) const {
+			for(size_type z = 0; z < Z; ++z)
+				if(!visit(f, matrix_2d_view<const T>(_cells + z * Y * X, Y, X, X)))
+					return false;
+
+			return true;
+		}
+
+		/**
+			@brief Rows traversal
+
+			Same as matrix_3d::for_each_row().
+
+			@pre F : std::span<T> -> void or bool
+		*/
+		template <typename F>
+		constexpr bool for_each_row(F f) {
+			for(size_type r = 0; r < Z * Y; ++r)
+				if(!visit(f, std::span<T>(_cells + r * X, X)))
+					return false;
+
+			return true;
+		}
+
+		template <typename F>
+		constexpr bool for_each_row(F f) const {
+			for(size_type r = 0; r < Z * Y; ++r)
+				if(!visit(f, std::span<const T>(_cells + r * X, X)))
+					return false;
+
+			return true;
+		}
+
+		/**
+			@brief Spans traversal
+
+			Same as matrix_3d::for_each_span(): the rows are never padded, so the whole
+			matrix is a single run, split in runs of max_length cells if max_length > 0.
+
+			@pre F : std::span<T> -> void or bool
+		*/
+		template <typename F>
+		constexpr bool for_each_span(F f, size_type max_length = 0) {
+			const size_type step = max_length > 0 ? max_length : Z * Y * X;
+
+			for(size_type first = 0; first < Z * Y * X; first += step)
+				if(!visit(f, std::span<T>(_cells + first, std::min(step, Z * Y * X - first))))
+					return false;
+
+			return true;
+		}
+
+		template <typename F>
+		constexpr bool for_each_span(F f, size_type max_length = 0) const {
+			const size_type step = max_length > 0 ? max_length : Z * Y * X;
+
+			for(size_type first = 0; first < Z * Y * X; first += step)
+				if(!visit(f, std::span<const T>(_cells + first, std::min(step, Z * Y * X - first))))
+					return false;
+
+			return true;
+		}
+
+		/**
+			@brief Comparison function
+
+			@param other the fixed_matrix_3d to compare with the current instance
+			@param equality the functor to use for the comparison
+
+			@pre E : T x T -> {0, 1}
+
+			@return true if all the cells are equal according to equality
+		*/
+		template <typename E>
+		constexpr bool equals(const fixed_matrix_3d& other, const E equality) const {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				if(!equality(_cells[i], other._cells[i]))
+					return false;
+
+			return true;
+		}
+
+		constexpr bool operator==(const fixed_matrix_3d& other) const {
+			return this->equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		constexpr bool operator!=(const fixed_matrix_3d& other) const {
+			return !((*this) == other);
+		}
+
+		/**
+			@brief Compile-time submatrix extraction
+
+			Bounds are included, as in matrix_3d::slice().
+
+			@return submatrix [Z1:Z2, Y1:Y2, X1:X2]
+		*/
+		template <unsigned int Z1, unsigned int Z2, unsigned int Y1, unsigned int Y2, unsigned int X1, unsigned int X2>
+		constexpr fixed_matrix_3d<T, Z2 - Z1 + 1, Y2 - Y1 + 1, X2 - X1 + 1> slice() const {
+
+			static_assert(Z1 <= Z2 && Z2 < Z && Y1 <= Y2 && Y2 < Y && X1 <= X2 && X2 < X, "slice out of the matrix");
+
+			fixed_matrix_3d<T, Z2 - Z1 + 1, Y2 - Y1 + 1, X2 - X1 + 1> result;
+
+			for(size_type k = Z1; k <= Z2; ++k)
+				for(size_type i = Y1; i <= Y2; ++i)
+					for(size_type j = X1; j <= X2; ++j)
+						result(k - Z1, i - Y1, j - X1) = (*this)(k, i, j);
+
+			return result;
+		}
+
+		/**
+			@brief Submatrix extraction by value
+
+			Same as matrix_3d::slice(z1, z2, y1, y2, x1, x2, by_value): the bounds are
+			known at run time only, so the result is a matrix_3d.
+
+			@return submatrix [z1:z2, y1:y2, x1:x2]
+		*/
+		matrix_3d<T> slice(size_type z1, size_type z2, size_type y1, size_type y2,
+						   size_type x1, size_type x2, by_value_t) const {
+
+			assert(z1 <= z2 && z2 < Z);
+			assert(y1 <= y2 && y2 < Y);
+			assert(x1 <= x2 && x2 < X);
+
+			matrix_3d<T> result(z2 - z1 + 1, y2 - y1 + 1, x2 - x1 + 1);
+
+			for(size_type k = z1; k <= z2; ++k)
+				for(size_type i = y1; i <= y2; ++i)
+					for(size_type j = x1; j <= x2; ++j)
+						result(k - z1, i - y1, j - x1) = (*this)(k, i, j);
+
+			return result;
+		}
+
+		matrix_3d_view<T> view() {
+			return matrix_3d_view<T>(_cells, Z, Y, X, Y * X, X);
+		}
+
+		matrix_3d_view<const T> view() const {
+			return matrix_3d_view<const T>(_cells, Z, Y, X, Y * X, X);
+		}
+
+		/**
+			@brief Submatrix view
+
+			Same as matrix_3d::view(z1, z2, y1, y2, x1, x2).
+		*/
+		matrix_3d_view<T> view(size_type z1, size_type z2, size_type y1, size_type y2, size_type x1, size_type x2) {
+			return view().view(z1, z2, y1, y2, x1, x2);
+		}
+
+		matrix_3d_view<const T> view(size_type z1, size_type z2, size_type y1, size_type y2,
+									 size_type x1, size_type x2) const {
+			return view().view(z1, z2, y1, y2, x1, x2);
+		}
+
+		/**
+			@brief Fill method
+
+			Same as matrix_3d::fill(): the cells are overwritten in order with the values
+			of [start, end), the remaining cells are left intact, and if an exception is
+			thrown the matrix is not changed.
+		*/
+		template <typename I>
+		constexpr void fill(I start, I end) {
+
+			fixed_matrix_3d tmp(*this);
+
+			for(size_type i = 0; i < Z * Y * X && start != end; ++i, ++start)
+				tmp._cells[i] = static_cast<T>(*start);
+
+			this->swap(tmp);
+		}
+
+		/**
+			@name Cellwise arithmetic
+
+			Same as for fixed_matrix_2d.
+		*/
+		///@{
+		constexpr fixed_matrix_3d& operator+=(const fixed_matrix_3d& other) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] += other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_3d& operator-=(const fixed_matrix_3d& other) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] -= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_3d& operator*=(const fixed_matrix_3d& other) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] *= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_3d& operator/=(const fixed_matrix_3d& other) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] /= other._cells[i];
+			return *this;
+		}
+
+		constexpr fixed_matrix_3d& operator*=(const T& s) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] *= s;
+			return *this;
+		}
+
+		constexpr fixed_matrix_3d& operator/=(const T& s) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				_cells[i] /= s;
+			return *this;
+		}
+
+		friend constexpr fixed_matrix_3d operator+(fixed_matrix_3d a, const fixed_matrix_3d& b) {return a += b;}
+		friend constexpr fixed_matrix_3d operator-(fixed_matrix_3d a, const fixed_matrix_3d& b) {return a -= b;}
+		friend constexpr fixed_matrix_3d operator*(fixed_matrix_3d a, const fixed_matrix_3d& b) {return a *= b;}
+		friend constexpr fixed_matrix_3d operator/(fixed_matrix_3d a, const fixed_matrix_3d& b) {return a /= b;}
+		friend constexpr fixed_matrix_3d operator*(fixed_matrix_3d a, const T& s) {return a *= s;}
+		friend constexpr fixed_matrix_3d operator*(const T& s, fixed_matrix_3d a) {return a *= s;}
+		friend constexpr fixed_matrix_3d operator/(fixed_matrix_3d a, const T& s) {return a /= s;}
+
+		friend constexpr fixed_matrix_3d operator-(fixed_matrix_3d a) {
+			for(size_type i = 0; i < Z * Y * X; ++i)
+				a._cells[i] = -a._cells[i];
+			return a;
+		}
+		///@}
+
+		/**
+			@brief Print function
+
+			Prints the fixed_matrix_3d as operator<< does for matrix_3d.
+		*/
+		friend std::ostream& operator<<(std::ostream& os, const fixed_matrix_3d& matrix) {
+			for(size_type r = 0; r < Z * Y; ++r) {
+				for(size_type j = 0; j < X; ++j)
+					os << matrix._cells[r * X + j] << " ";
+				os << std::endl;
+
+				if((r + 1) % Y == 0)
+					os << std::endl;
+			}
+
+			return os;
+		}
+};
+
+
+/**
+	@brief Transformation function by value
+
+	Returns a new fixed_matrix_2d obtained by applying the functor func to each cell
+	of source, as transform(const matrix_2d&, func, by_value) does.
+
+	@pre func : W -> Q
+*/
+template <typename Q, typename W, unsigned int Y, unsigned int X, typename F>
+constexpr fixed_matrix_2d<Q, Y, X> transform(const fixed_matrix_2d<W, Y, X>& source, const F func, by_value_t) {
+
+	fixed_matrix_2d<Q, Y, X> result;
+
+	for(unsigned int i = 0; i < Y * X; ++i)
+		result.data()[i] = static_cast<Q>(func(source.data()[i]));
+
+	return result;
+}
+
+/**
+	@brief Transformation function by value
+
+	Returns a new fixed_matrix_3d obtained by applying the functor func to each cell
+	of source, as transform(const matrix_3d&, func, by_value) does.
+
+	@pre func : W -> Q
+*/
+template <typename Q, typename W, unsigned int Z, unsigned int Y, unsigned int X, typename F>
+constexpr fixed_matrix_3d<Q, Z, Y, X> transform(const fixed_matrix_3d<W, Z, Y, X>& source, const F func, by_value_t) {
+
+	fixed_matrix_3d<Q, Z, Y, X> result;
+
+	for(unsigned int i = 0; i < Z * Y * X; ++i)
+		result.data()[i] = static_cast<Q>(func(source.data()[i]));
+
+	return result;
+}
+
+#endif
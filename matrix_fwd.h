@@ -0,0 +1,35 @@
+#ifndef MATRIX_FWD
+#define MATRIX_FWD
+
+#include <cstddef> // std::size_t
+#include <memory> // std::allocator
+
+/**
+  @file matrix_fwd.h
+  @brief Forward declarations of the matrix template classes.
+
+  Default template arguments are given here once, so that every header can refer
+  to the matrix classes before their definition.
+*/
+
+/**
+  @brief Data type of the extents and of the indexes of the matrices
+
+  64 bits by default, so that volumes beyond 2^32 cells can be built and addressed.
+  Defining MATRIX_32BIT_INDEX before including the headers selects 32 bits instead,
+  which halves the index arithmetic of the loops on small volumes; the constructors
+  then throw std::length_error for the volumes of more than 2^32 - 1 cells.
+*/
+#ifdef MATRIX_32BIT_INDEX
+typedef unsigned int matrix_index;
+#else
+typedef std::size_t matrix_index;
+#endif
+
+template <typename T, typename A = std::allocator<T>> class matrix_2d;
+template <typename T, typename A = std::allocator<T>> class matrix_3d;
+
+template <typename T> class matrix_2d_view;
+template <typename T> class matrix_3d_view;
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef MATRIX_INTEGRAL
+#define MATRIX_INTEGRAL
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <algorithm> // std::fill, std::min
+#include <vector>
+#include <type_traits>
+#include "matrix_fwd.h"
+#include "matrix_parallel.h"
+#include "matrix_reduce.h"
+
+/**
+  @file matrix_integral.h
+  @brief integral_volume template class declaration and implementation.
+*/
+
+
+/**
+  @brief Class for representing the summed-area table of a matrix_3d
+
+  Class that stores, for each cell (z, y, x) of a matrix_3d, the sum of all the cells
+  (i, j, k) with i <= z, j <= y and k <= x. Once built, the sum of the cells of any
+  box is given by box_sum() with 8 lookups, whatever the size of the box. The sums
+  are kept in the accumulator type S, 64 bits integers for the integral types and
+  double for float by default (see reduce_ops::sum_type), so that the sums of large
+  volumes do not overflow. With an unsigned S, the intermediate sums may wrap around
+  but the sums of the boxes are exact.
+
+  The table has one more plan, row and column than the source, all zeros, so that the
+  queries on the borders need no test.
+*/
+template <typename T, typename S = reduce_ops::sum_type<T>> class integral_volume {
+
+	public:
+
+		typedef T value_type;
+		typedef S sum_type;
+
+		/**
+			@brief Type of the means of the boxes
+		*/
+		typedef typename std::conditional<std::is_same<S, long double>::value, long double, double>::type mean_type;
+
+	private:
+
+		matrix_3d<S> _table;
+
+		/**
+			@brief Table lookup
+
+			@return sum of the cells (i, j, k) of the source with i < z, j < y and k < x
+		*/
+		S at(std::size_t z, std::size_t y, std::size_t x) const {
+			return _table.data()[(z * _table.rows() + y) * _table.pitch() + x];
+		}
+
+		/**
+			@brief Construction of the table
+
+			The plans of the table are first computed independently, each cell being the
+			sum of the cell above and of the prefix of its row; the plans are then
+			summed along Z, the rows being split among the workers.
+		*/
+		template <typename A>
+		void build(const matrix_3d<T, A>& source, const parallel_t* policy) {
+
+			const std::size_t plans = source.plans(), rows = source.rows(), columns = source.columns();
+
+			if(source.size() == 0) {
+				_table = matrix_3d<S>();
+				return;
+			}
+
+			_table = matrix_3d<S>(plans + 1, rows + 1, columns + 1);
+
+			S* const table = _table.data();
+			const std::size_t pitch = _table.pitch();
+			const std::size_t plan_step = (rows + 1) * pitch;
+			const T* const src = source.data();
+			const std::size_t src_pitch = source.pitch();
+
+			std::fill(table, table + columns + 1 + rows * pitch, S());
+
+			const std::size_t plan_cells = rows * columns;
+			const std::size_t per_plan = policy == nullptr ? plans : policy->grain / plan_cells;
+
+			parallel_for(plans, per_plan, policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t z = first; z < last; ++z) {
+					S* const plan = table + (z + 1) * plan_step;
+					const T* const src_plan = src + z * rows * src_pitch;
+
+					std::fill(plan, plan + columns + 1, S());
+
+					for(std::size_t y = 0; y < rows; ++y) {
+						const S* const above = plan + y * pitch;
+						S* const row = plan + (y + 1) * pitch;
+						const T* const src_row = src_plan + y * src_pitch;
+						S run = S();
+
+						row[0] = S();
+						for(std::size_t x = 0; x < columns; ++x) {
+							run += static_cast<S>(src_row[x]);
+							row[x + 1] = above[x + 1] + run;
+						}
+					}
+				}
+			});
+
+			const std::size_t per_row = policy == nullptr ? rows : policy->grain / (plans * columns);
+
+			parallel_for(rows, per_row, policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t z = 2; z <= plans; ++z)
+					for(std::size_t y = first + 1; y <= last; ++y) {
+						const S* const below = table + (z - 1) * plan_step + y * pitch;
+						S* const row = table + z * plan_step + y * pitch;
+
+						for(std::size_t x = 1; x <= columns; ++x)
+							row[x] += below[x];
+					}
+			});
+		}
+
+		/**
+			@brief Update of the table after a change of the cells of a box of the source
+
+			The changes of the cells, new value minus the value of the table, are
+			summed in a small summed-area table of the box, which is then added to all
+			the cells of the table past (z1, y1, x1): only those cells change, and the
+			source is read only inside the box.
+		*/
+		template <typename A>
+		void refresh(const matrix_3d<T, A>& source, std::size_t z1, std::size_t z2, std::size_t y1, std::size_t y2,
+					 std::size_t x1, std::size_t x2, const parallel_t* policy) {
+
+			assert(source.plans() == plans() && source.rows() == rows() && source.columns() == columns());
+			assert(z1 <= z2 && z2 < plans());
+			assert(y1 <= y2 && y2 < rows());
+			assert(x1 <= x2 && x2 < columns());
+
+			const std::size_t dz = z2 - z1 + 1, dy = y2 - y1 + 1, dx = x2 - x1 + 1;
+			std::vector<S> delta(dz * dy * dx);
+
+			for(std::size_t i = 0; i < dz; ++i)
+				for(std::size_t j = 0; j < dy; ++j) {
+					S* const row = delta.data() + (i * dy + j) * dx;
+					S run = S();
+
+					for(std::size_t k = 0; k < dx; ++k) {
+						run += static_cast<S>(source(z1 + i, y1 + j, x1 + k)) - box_sum(z1 + i, z1 + i, y1 + j, y1 + j, x1 + k, x1 + k);
+						row[k] = run + (j > 0 ? row[k - dx] : S()) + (i > 0 ? row[k - dy * dx] : S());
+						if(i > 0 && j > 0)
+							row[k] -= row[k - dy * dx - dx];
+					}
+				}
+
+			S* const table = _table.data();
+			const std::size_t pitch = _table.pitch();
+			const std::size_t plan_step = (rows() + 1) * pitch;
+			const std::size_t count = plans() - z1;
+			const std::size_t per_plan = policy == nullptr ? count : policy->grain / ((rows() - y1) * (columns() - x1));
+
+			parallel_for(count, per_plan, policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t z = z1 + first; z < z1 + last; ++z)
+					for(std::size_t y = y1; y < rows(); ++y) {
+						const S* const change = delta.data() + ((std::min(z, z2) - z1) * dy + std::min(y, y2) - y1) * dx;
+						S* const row = table + (z + 1) * plan_step + (y + 1) * pitch + x1 + 1;
+
+						for(std::size_t k = 0; k < dx; ++k)
+							row[k] += change[k];
+
+						for(std::size_t k = dx; k < columns() - x1; ++k)
+							row[k] += change[dx - 1];
+					}
+			});
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Initialize the object to the table of a null matrix_3d.
+		*/
+		integral_volume(void) : _table() {}
+
+		/**
+			@brief Construction from a matrix_3d
+
+			@param source matrix_3d to sum
+		*/
+		template <typename A>
+		explicit integral_volume(const matrix_3d<T, A>& source) : _table() {
+			build(source, nullptr);
+		}
+
+		/**
+			@brief Parallel construction from a matrix_3d
+
+			Same as integral_volume(source), with the plans and then the rows of the table
+			split among the workers of policy.
+
+			@param source matrix_3d to sum
+			@param policy parallel settings
+		*/
+		template <typename A>
+		integral_volume(const matrix_3d<T, A>& source, const parallel_t& policy) : _table() {
+			build(source, &policy);
+		}
+
+		/**
+			@brief Number of plans of the source
+		*/
+		std::size_t plans() const {
+			return _table.plans() > 0 ? _table.plans() - 1 : 0;
+		}
+
+		/**
+			@brief Number of rows of the source
+		*/
+		std::size_t rows() const {
+			return _table.rows() > 0 ? _table.rows() - 1 : 0;
+		}
+
+		/**
+			@brief Number of columns of the source
+		*/
+		std::size_t columns() const {
+			return _table.columns() > 0 ? _table.columns() - 1 : 0;
+		}
+
+		/**
+			@brief Sum of a box
+
+			Sum of the cells (z, y, x) of the source with z1 <= z <= z2, y1 <= y <= y2
+			and x1 <= x <= x2, in constant time. The bounds are inclusive, as in
+			matrix_3d::slice().
+
+			@pre z1 <= z2 < plans()
+			@pre y1 <= y2 < rows()
+			@pre x1 <= x2 < columns()
+
+			@return sum of the cells of the box
+		*/
+		S box_sum(std::size_t z1, std::size_t z2, std::size_t y1, std::size_t y2, std::size_t x1, std::size_t x2) const {
+
+			assert(z1 <= z2 && z2 < plans());
+			assert(y1 <= y2 && y2 < rows());
+			assert(x1 <= x2 && x2 < columns());
+
+			++z2; ++y2; ++x2;
+
+			return at(z2, y2, x2) - at(z1, y2, x2) - at(z2, y1, x2) - at(z2, y2, x1)
+				   + at(z1, y1, x2) + at(z1, y2, x1) + at(z2, y1, x1) - at(z1, y1, x1);
+		}
+
+		/**
+			@brief Mean of a box
+
+			@pre same as box_sum()
+
+			@return mean of the cells of the box
+		*/
+		mean_type box_mean(std::size_t z1, std::size_t z2, std::size_t y1, std::size_t y2,
+						   std::size_t x1, std::size_t x2) const {
+
+			const std::size_t count = (z2 - z1 + 1) * (y2 - y1 + 1) * (x2 - x1 + 1);
+
+			return static_cast<mean_type>(box_sum(z1, z2, y1, y2, x1, x2)) / static_cast<mean_type>(count);
+		}
+
+		/**
+			@brief Sum of all the cells of the source
+		*/
+		S total() const {
+			return _table.size() > 0 ? at(plans(), rows(), columns()) : S();
+		}
+
+		/**
+			@brief Incremental update
+
+			Brings the table up to date after the cells of a box of the source have been
+			changed, without rebuilding it: the source is read only inside the box, and
+			only the cells of the table past (z1, y1, x1) are updated.
+
+			@param source source matrix_3d, changed only inside the box
+			@param z1, z2, y1, y2, x1, x2 inclusive bounds of the changed box
+
+			@pre source has the shape of the table
+			@pre z1 <= z2 < plans()
+			@pre y1 <= y2 < rows()
+			@pre x1 <= x2 < columns()
+		*/
+		template <typename A>
+		void update(const matrix_3d<T, A>& source, std::size_t z1, std::size_t z2, std::size_t y1, std::size_t y2,
+					std::size_t x1, std::size_t x2) {
+			refresh(source, z1, z2, y1, y2, x1, x2, nullptr);
+		}
+
+		/**
+			@brief Parallel incremental update
+
+			Same as update(source, z1, z2, y1, y2, x1, x2), with the plans of the table
+			split among the workers of policy.
+		*/
+		template <typename A>
+		void update(const matrix_3d<T, A>& source, std::size_t z1, std::size_t z2, std::size_t y1, std::size_t y2,
+					std::size_t x1, std::size_t x2, const parallel_t& policy) {
+			refresh(source, z1, z2, y1, y2, x1, x2, &policy);
+		}
+};
+
+#endif
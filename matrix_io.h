@@ -0,0 +1,518 @@
+#ifndef MATRIX_IO
+#define MATRIX_IO
+
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <cassert>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <stdexcept> // std::runtime_error
+#include <type_traits>
+#include <algorithm> // std::min
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_simd.h"
+
+/**
+  @file matrix_io.h
+  @brief Binary format of matrix_2d and matrix_3d, matrix_writer and matrix_reader declaration and implementation.
+
+  The format is a header of 64 bytes followed by the cells, plan after plan and row
+  after row, without padding, in the byte order of the machine that wrote them. The
+  rows are grouped in chunks of chunk_rows rows of the whole matrix (one plan by
+  default), each chunk being followed by the CRC-32C of its bytes. The header holds:
+
+	offset  size  field
+	0       4     magic "MX3D"
+	4       2     version (1)
+	6       2     byte order mark 0x0102, read as 0x0201 on the other byte order
+	8       1     kind of the cells: 1 signed integer, 2 unsigned integer, 3 floating point
+	9       1     size of a cell in bytes
+	10      2     reserved (0)
+	12      4     CRC-32C of the header, computed with this field set to 0
+	16      8     number of plans
+	24      8     number of rows
+	32      8     number of columns
+	40      8     rows per chunk
+	48      16    reserved (0)
+
+  matrix_writer and matrix_reader stream the cells a few rows or a plan at a time,
+  so that a volume larger than the memory can be written or read with a buffer of one
+  plan; save() and load_matrix_3d() handle whole matrices. Contiguous cells are moved
+  with a single write or read per chunk, and the cells written on a machine of the
+  other byte order are swapped while read.
+*/
+
+
+/**
+  @brief Exception thrown for malformed, mismatched, truncated or corrupted data
+*/
+class matrix_format_error : public std::runtime_error {
+	public:
+		explicit matrix_format_error(const std::string& what) : std::runtime_error("matrix format: " + what) {}
+};
+
+
+/**
+  @brief Header of the binary format
+*/
+struct matrix_header {
+	std::uint8_t kind;
+	std::uint8_t cell_size;
+	std::uint64_t plans;
+	std::uint64_t rows;
+	std::uint64_t columns;
+	std::uint64_t chunk_rows;
+
+	/**
+		@brief True if the data were written on a machine of the other byte order
+	*/
+	bool swapped;
+};
+
+
+namespace io_detail {
+
+	constexpr std::size_t header_bytes = 64;
+	constexpr std::uint16_t version = 1;
+	constexpr std::uint16_t byte_order = 0x0102;
+
+	/**
+		@brief Kind of the cells of type T
+	*/
+	template <typename T>
+	constexpr std::uint8_t kind() {
+		static_assert(std::is_arithmetic<T>::value, "matrix format: the cells must be of an arithmetic type");
+		return std::is_floating_point<T>::value ? 3 : (std::is_signed<T>::value ? 1 : 2);
+	}
+
+	template <typename U>
+	void put(unsigned char* at, U value) {
+		std::memcpy(at, &value, sizeof(U));
+	}
+
+	template <typename U>
+	U get(const unsigned char* at, bool swapped) {
+		U value;
+		std::memcpy(&value, at, sizeof(U));
+
+		if(swapped) {
+			if constexpr (sizeof(U) == 2)
+				value = __builtin_bswap16(value);
+			else if constexpr (sizeof(U) == 4)
+				value = __builtin_bswap32(value);
+			else if constexpr (sizeof(U) == 8)
+				value = __builtin_bswap64(value);
+		}
+
+		return value;
+	}
+
+	/**
+		@brief Byte order reversal of n cells of size bytes
+	*/
+	inline void swap_cells(void* cells, std::size_t size, std::size_t n) {
+
+		unsigned char* p = static_cast<unsigned char*>(cells);
+
+		for(std::size_t i = 0; i < n; ++i, p += size)
+			for(std::size_t a = 0, b = size - 1; a < b; ++a, --b) {
+				const unsigned char t = p[a];
+				p[a] = p[b];
+				p[b] = t;
+			}
+	}
+
+	inline void write_header(std::ostream& os, const matrix_header& header) {
+
+		unsigned char bytes[header_bytes] = {};
+
+		std::memcpy(bytes, "MX3D", 4);
+		put<std::uint16_t>(bytes + 4, version);
+		put<std::uint16_t>(bytes + 6, byte_order);
+		bytes[8] = header.kind;
+		bytes[9] = header.cell_size;
+		put<std::uint64_t>(bytes + 16, header.plans);
+		put<std::uint64_t>(bytes + 24, header.rows);
+		put<std::uint64_t>(bytes + 32, header.columns);
+		put<std::uint64_t>(bytes + 40, header.chunk_rows);
+		put<std::uint32_t>(bytes + 12, crc32c(bytes, header_bytes));
+
+		if(!os.write(reinterpret_cast<const char*>(bytes), header_bytes))
+			throw matrix_format_error("cannot write the header");
+	}
+
+	inline matrix_header read_header(std::istream& is) {
+
+		unsigned char bytes[header_bytes];
+
+		if(!is.read(reinterpret_cast<char*>(bytes), header_bytes))
+			throw matrix_format_error("truncated header");
+
+		if(std::memcmp(bytes, "MX3D", 4) != 0)
+			throw matrix_format_error("not a matrix file");
+
+		matrix_header header;
+		const std::uint16_t order = get<std::uint16_t>(bytes + 6, false);
+
+		if(order != byte_order && order != __builtin_bswap16(byte_order))
+			throw matrix_format_error("invalid byte order mark");
+
+		header.swapped = order != byte_order;
+
+		if(get<std::uint16_t>(bytes + 4, header.swapped) != version)
+			throw matrix_format_error("unsupported version");
+
+		const std::uint32_t checksum = get<std::uint32_t>(bytes + 12, header.swapped);
+		put<std::uint32_t>(bytes + 12, 0);
+
+		if(crc32c(bytes, header_bytes) != checksum)
+			throw matrix_format_error("header checksum mismatch");
+
+		header.kind = bytes[8];
+		header.cell_size = bytes[9];
+		header.plans = get<std::uint64_t>(bytes + 16, header.swapped);
+		header.rows = get<std::uint64_t>(bytes + 24, header.swapped);
+		header.columns = get<std::uint64_t>(bytes + 32, header.swapped);
+		header.chunk_rows = get<std::uint64_t>(bytes + 40, header.swapped);
+
+		std::uint64_t cells;
+
+		if(__builtin_mul_overflow(header.plans, header.rows, &cells) ||
+		   __builtin_mul_overflow(cells, header.columns, &cells))
+			throw matrix_format_error("matrix extents overflow");
+
+		if(header.chunk_rows == 0 && header.plans != 0 && header.rows != 0 && header.columns != 0)
+			throw matrix_format_error("invalid chunk layout");
+
+		return header;
+	}
+}
+
+
+/**
+  @brief Class for writing a matrix in the binary format
+
+  Writes the header on construction, then the cells given to write_rows() or
+  write_plan(), which must add up to the number of rows announced, in order. The
+  checksum of a chunk is written as soon as its last row is. Only the stream and a
+  running checksum are kept, so the memory used does not depend on the size of the
+  matrix.
+*/
+template <typename T> class matrix_writer {
+
+	private:
+
+		std::ostream& _os;
+		matrix_header _header;
+		std::uint64_t _written;
+		std::uint32_t _crc;
+
+	public:
+
+		/**
+			@brief Parameterized constructor
+
+			@param os stream receiving the data, opened in binary mode
+			@param plans number of plans
+			@param rows number of rows of each plan
+			@param columns number of columns
+			@param chunk_rows rows of the whole matrix per chunk, 0 for one plan
+
+			@throw matrix_format_error if the header cannot be written
+		*/
+		matrix_writer(std::ostream& os, std::uint64_t plans, std::uint64_t rows, std::uint64_t columns,
+					  std::uint64_t chunk_rows = 0)
+					  : _os(os), _header(), _written(0), _crc(0) {
+
+			_header.kind = io_detail::kind<T>();
+			_header.cell_size = sizeof(T);
+			_header.plans = plans;
+			_header.rows = rows;
+			_header.columns = columns;
+			_header.chunk_rows = chunk_rows > 0 ? chunk_rows : (rows > 0 ? rows : 1);
+			_header.swapped = false;
+
+			io_detail::write_header(_os, _header);
+		}
+
+		/**
+			@brief Rows writing method
+
+			@param first first cell of the first row
+			@param count number of rows
+			@param pitch distance in cells between two rows
+
+			@pre the rows written so far and count do not exceed plans * rows
+
+			@throw matrix_format_error if the stream fails
+		*/
+		void write_rows(const T* first, std::size_t count, std::size_t pitch) {
+
+			const std::uint64_t columns = _header.columns;
+			const std::size_t row_bytes = columns * sizeof(T);
+
+			assert(_written + count <= _header.plans * _header.rows);
+
+			while(count > 0) {
+				const std::size_t segment = std::min<std::uint64_t>(count, _header.chunk_rows - _written % _header.chunk_rows);
+
+				if(pitch == columns || segment == 1) {
+					_crc = crc32c(first, segment * row_bytes, _crc);
+					_os.write(reinterpret_cast<const char*>(first), segment * row_bytes);
+				}
+				else
+					for(std::size_t r = 0; r < segment; ++r) {
+						_crc = crc32c(first + r * pitch, row_bytes, _crc);
+						_os.write(reinterpret_cast<const char*>(first + r * pitch), row_bytes);
+					}
+
+				_written += segment;
+				first += segment * pitch;
+				count -= segment;
+
+				if(_written % _header.chunk_rows == 0 || _written == _header.plans * _header.rows) {
+					_os.write(reinterpret_cast<const char*>(&_crc), sizeof(_crc));
+					_crc = 0;
+				}
+
+				if(!_os)
+					throw matrix_format_error("cannot write the cells");
+			}
+		}
+
+		/**
+			@brief Plan writing method
+
+			@param plan next plan of the matrix
+
+			@pre plan has rows() rows of columns() cells
+		*/
+		template <typename A>
+		void write_plan(const matrix_2d<T, A>& plan) {
+			assert(plan.rows() == _header.rows && plan.columns() == _header.columns);
+			write_rows(plan.data(), plan.rows(), plan.pitch());
+		}
+
+		const matrix_header& header() const {return _header;}
+
+		/**
+			@brief Number of rows written so far
+		*/
+		std::uint64_t rows_written() const {return _written;}
+};
+
+
+/**
+  @brief Class for reading a matrix in the binary format
+
+  Reads and checks the header on construction, then gives the cells to read_rows()
+  or read_plan(), in order. The checksum of each chunk is checked as soon as its last
+  row is read, so that corrupted data are reported before the next chunk is read.
+*/
+template <typename T> class matrix_reader {
+
+	private:
+
+		std::istream& _is;
+		matrix_header _header;
+		std::uint64_t _read;
+		std::uint32_t _crc;
+
+	public:
+
+		/**
+			@brief Parameterized constructor
+
+			@param is stream holding the data, opened in binary mode
+
+			@throw matrix_format_error if the header is invalid, or if its cells are not
+			of type T
+		*/
+		explicit matrix_reader(std::istream& is) : _is(is), _header(io_detail::read_header(is)), _read(0), _crc(0) {
+
+			if(_header.kind != io_detail::kind<T>() || _header.cell_size != sizeof(T))
+				throw matrix_format_error("cell type mismatch");
+		}
+
+		/**
+			@brief Rows reading method
+
+			@param first first cell of the first row to fill
+			@param count number of rows
+			@param pitch distance in cells between two rows
+
+			@pre the rows read so far and count do not exceed plans() * rows()
+
+			@throw matrix_format_error if the data are truncated or a checksum does not match
+		*/
+		void read_rows(T* first, std::size_t count, std::size_t pitch) {
+
+			const std::uint64_t columns = _header.columns;
+			const std::size_t row_bytes = columns * sizeof(T);
+
+			assert(_read + count <= _header.plans * _header.rows);
+
+			while(count > 0) {
+				const std::size_t segment = std::min<std::uint64_t>(count, _header.chunk_rows - _read % _header.chunk_rows);
+
+				if(pitch == columns || segment == 1) {
+					if(!_is.read(reinterpret_cast<char*>(first), segment * row_bytes))
+						throw matrix_format_error("truncated cells");
+					_crc = crc32c(first, segment * row_bytes, _crc);
+				}
+				else
+					for(std::size_t r = 0; r < segment; ++r) {
+						if(!_is.read(reinterpret_cast<char*>(first + r * pitch), row_bytes))
+							throw matrix_format_error("truncated cells");
+						_crc = crc32c(first + r * pitch, row_bytes, _crc);
+					}
+
+				if(_header.swapped && sizeof(T) > 1)
+					for(std::size_t r = 0; r < segment; ++r)
+						io_detail::swap_cells(first + r * pitch, sizeof(T), columns);
+
+				_read += segment;
+				first += segment * pitch;
+				count -= segment;
+
+				if(_read % _header.chunk_rows == 0 || _read == _header.plans * _header.rows) {
+					unsigned char stored[4];
+
+					if(!_is.read(reinterpret_cast<char*>(stored), sizeof(stored)))
+						throw matrix_format_error("truncated checksum");
+
+					if(io_detail::get<std::uint32_t>(stored, _header.swapped) != _crc)
+						throw matrix_format_error("checksum mismatch in chunk " +
+												  std::to_string((_read - 1) / _header.chunk_rows));
+					_crc = 0;
+				}
+			}
+		}
+
+		/**
+			@brief Plan reading method
+
+			@param plan matrix_2d receiving the next plan
+
+			@pre plan has rows() rows of columns() cells
+		*/
+		template <typename A>
+		void read_plan(matrix_2d<T, A>& plan) {
+			assert(plan.rows() == _header.rows && plan.columns() == _header.columns);
+			read_rows(plan.data(), plan.rows(), plan.pitch());
+		}
+
+		const matrix_header& header() const {return _header;}
+
+		std::uint64_t plans() const {return _header.plans;}
+		std::uint64_t rows() const {return _header.rows;}
+		std::uint64_t columns() const {return _header.columns;}
+
+		/**
+			@brief Number of rows read so far
+		*/
+		std::uint64_t rows_read() const {return _read;}
+};
+
+
+/**
+  @brief Saving function
+
+  Writes matrix to os in the binary format.
+
+  @param os stream receiving the data, opened in binary mode
+  @param matrix matrix_3d to save
+  @param chunk_rows rows of the whole matrix per chunk, 0 for one plan
+
+  @throw matrix_format_error if the stream fails
+*/
+template <typename T, typename A>
+void save(std::ostream& os, const matrix_3d<T, A>& matrix, std::uint64_t chunk_rows = 0) {
+
+	matrix_writer<T> writer(os, matrix.plans(), matrix.rows(), matrix.columns(), chunk_rows);
+
+	if(matrix.size() > 0)
+		writer.write_rows(matrix.data(), matrix.plans() * matrix.rows(), matrix.pitch());
+}
+
+/**
+  @brief Saving function
+
+  Writes matrix to os in the binary format, as a single plan.
+
+  @param os stream receiving the data, opened in binary mode
+  @param matrix matrix_2d to save
+  @param chunk_rows rows per chunk, 0 for a single chunk
+
+  @throw matrix_format_error if the stream fails
+*/
+template <typename T, typename A>
+void save(std::ostream& os, const matrix_2d<T, A>& matrix, std::uint64_t chunk_rows = 0) {
+
+	matrix_writer<T> writer(os, matrix.size() > 0 ? 1 : 0, matrix.rows(), matrix.columns(), chunk_rows);
+
+	if(matrix.size() > 0)
+		writer.write_rows(matrix.data(), matrix.rows(), matrix.pitch());
+}
+
+/**
+  @brief Loading function
+
+  Reads a matrix_3d written by save() or by a matrix_writer.
+
+  @param is stream holding the data, opened in binary mode
+  @param alloc allocator of the cells
+
+  @throw matrix_format_error if the data are invalid, of another cell type,
+  truncated or corrupted
+  @throw std::length_error if the extents do not fit in a matrix_index
+
+  @return the matrix_3d read
+*/
+template <typename T, typename A = std::allocator<T>>
+matrix_3d<T, A> load_matrix_3d(std::istream& is, const A& alloc = A()) {
+
+	matrix_reader<T> reader(is);
+	matrix_3d<T, A> matrix(checked_extent(reader.plans(), 1), checked_extent(reader.rows(), 1),
+						   checked_extent(reader.columns(), 1), alloc);
+
+	if(matrix.size() > 0)
+		reader.read_rows(matrix.data(), matrix.plans() * matrix.rows(), matrix.pitch());
+
+	return matrix;
+}
+
+/**
+  @brief Loading function
+
+  Reads a matrix_2d written by save(), or a single plan written by a matrix_writer.
+
+  @param is stream holding the data, opened in binary mode
+  @param alloc allocator of the cells
+
+  @throw matrix_format_error if the data are invalid, of another cell type, have
+  more than one plan, are truncated or corrupted
+  @throw std::length_error if the extents do not fit in a matrix_index
+
+  @return the matrix_2d read
+*/
+template <typename T, typename A = std::allocator<T>>
+matrix_2d<T, A> load_matrix_2d(std::istream& is, const A& alloc = A()) {
+
+	matrix_reader<T> reader(is);
+
+	if(reader.plans() > 1)
+		throw matrix_format_error("more than one plan");
+
+	matrix_2d<T, A> matrix(checked_extent(reader.rows(), 1), checked_extent(reader.columns(), 1), alloc);
+
+	if(reader.plans() == 1 && matrix.size() > 0)
+		reader.read_rows(matrix.data(), matrix.rows(), matrix.pitch());
+
+	return matrix;
+}
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef MATRIX_ITERATOR
+#define MATRIX_ITERATOR
+
+#include <iterator> // std::random_access_iterator_tag
+#include <cstddef> // std::ptrdiff_t
+#include <type_traits>
+#include <utility> // std::declval
+
+/**
+  @file matrix_iterator.h
+  @brief pitched_iterator and indexed_iterator template classes declaration and implementation.
+*/
+
+
+/**
+  @brief Class to represent a random access iterator on padded rows
+
+  Class for representing a random access iterator on the cells of a matrix whose rows
+  are padded, i.e. rows of col cells whose starts are pitch cells apart. The iterator
+  visits the cells row after row and skips the padding, so that the sequence has the
+  logical size of the matrix. Since a matrix_3d stores its plans one after the other
+  with the same pitch, the same iterator walks a whole matrix_3d.
+*/
+template <typename T> class pitched_iterator {
+
+	private:
+
+		T* row;
+		std::ptrdiff_t x;
+		std::ptrdiff_t col;
+		std::ptrdiff_t pitch;
+
+		template <typename U> friend class pitched_iterator;
+
+	public:
+
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef typename std::remove_const<T>::type value_type;
+		typedef std::ptrdiff_t                      difference_type;
+		typedef T*                                  pointer;
+		typedef T&                                  reference;
+
+		pitched_iterator() : row(nullptr), x(0), col(1), pitch(1) {}
+
+		/**
+			@brief Initialization constructor
+
+			@param row start of the row of the cell to point to
+			@param col number of cells of each row
+			@param pitch distance between the starts of two consecutive rows
+			@param x column of the cell to point to
+		*/
+		pitched_iterator(T* row, difference_type col, difference_type pitch, difference_type x = 0)
+						 : row(row), x(x), col(col), pitch(pitch) {
+			if(col <= 0) {
+				this->col = 1;
+				this->pitch = 1;
+			}
+		}
+
+		/**
+			@brief Conversion to a read-only iterator
+		*/
+		template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+		pitched_iterator(const pitched_iterator<U>& other) 
+						 : row(other.row), x(other.x), col(other.col), pitch(other.pitch) {}
+
+		reference operator*() const {
+			return row[x];
+		}
+
+		pointer operator->() const {
+			return row + x;
+		}
+
+		reference operator[](difference_type n) const {
+			return *(*this + n);
+		}
+
+		pitched_iterator& operator++() {
+			if(++x == col) {
+				x = 0;
+				row += pitch;
+			}
+			return *this;
+		}
+
+		pitched_iterator operator++(int) {
+			pitched_iterator tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		pitched_iterator& operator--() {
+			if(x == 0) {
+				x = col;
+				row -= pitch;
+			}
+			--x;
+			return *this;
+		}
+
+		pitched_iterator operator--(int) {
+			pitched_iterator tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		pitched_iterator& operator+=(difference_type n) {
+			difference_type linear = x + n;
+			difference_type rows = linear / col;
+			x = linear % col;
+			if(x < 0) {
+				x += col;
+				--rows;
+			}
+			row += rows * pitch;
+			return *this;
+		}
+
+		pitched_iterator& operator-=(difference_type n) {
+			return (*this) += -n;
+		}
+
+		pitched_iterator operator+(difference_type n) const {
+			pitched_iterator tmp(*this);
+			return tmp += n;
+		}
+
+		friend pitched_iterator operator+(difference_type n, const pitched_iterator& iter) {
+			return iter + n;
+		}
+
+		pitched_iterator operator-(difference_type n) const {
+			pitched_iterator tmp(*this);
+			return tmp -= n;
+		}
+
+		template <typename U>
+		difference_type operator-(const pitched_iterator<U>& other) const {
+			return (row - other.row) / pitch * col + (x - other.x);
+		}
+
+		template <typename U>
+		bool operator==(const pitched_iterator<U>& other) const {
+			return row == other.row && x == other.x;
+		}
+
+		template <typename U>
+		bool operator!=(const pitched_iterator<U>& other) const {
+			return !((*this) == other);
+		}
+
+		template <typename U>
+		bool operator<(const pitched_iterator<U>& other) const {
+			return row < other.row || (row == other.row && x < other.x);
+		}
+
+		template <typename U>
+		bool operator>(const pitched_iterator<U>& other) const {
+			return other < (*this);
+		}
+
+		template <typename U>
+		bool operator<=(const pitched_iterator<U>& other) const {
+			return !(other < (*this));
+		}
+
+		template <typename U>
+		bool operator>=(const pitched_iterator<U>& other) const {
+			return !((*this) < other);
+		}
+};
+
+
+/**
+  @brief Class to represent a proxy reference to a cell of a matrix reached by index
+
+  Reference given by the matrices whose writable accesses cost more than their reads,
+  such as paged_matrix_3d, whose changed plans are written back to the file: it reads
+  the cell through the read-only M::cell(index) const, and writes it through
+  M::store(index, value), so that only an assignment marks the cell as changed.
+*/
+template <typename M> class indexed_reference {
+
+	private:
+
+		M* _matrix;
+		std::size_t _index;
+
+	public:
+
+		typedef typename M::value_type value_type;
+
+		indexed_reference(M* matrix, std::size_t index) : _matrix(matrix), _index(index) {}
+
+		operator value_type() const {
+			return static_cast<const M&>(*_matrix).cell(_index);
+		}
+
+		indexed_reference& operator=(const value_type& value) {
+			_matrix->store(_index, value);
+			return *this;
+		}
+
+		indexed_reference& operator=(const indexed_reference& other) {
+			return *this = static_cast<value_type>(other);
+		}
+
+		friend void swap(indexed_reference a, indexed_reference b) {
+			value_type value = a;
+			a = static_cast<value_type>(b);
+			b = value;
+		}
+};
+
+
+/**
+  @brief Class to represent a random access iterator on a matrix reached by index
+
+  Iterator for the matrices whose cells are not in one buffer, such as paged_matrix_3d
+  and compressed_matrix_3d: it holds the linear index of a cell, plan after plan and
+  row after row, and obtains the cell from M::cell(index) when dereferenced. M must
+  keep valid the references to the cells of the last two accesses at least, since the
+  std algorithms hold two of them at a time (std::iter_swap). V is the cell type, const
+  for the read-only iterator.
+
+  M::cell() may also return a proxy reference, such as indexed_reference, so that only
+  the assignments count as writes; the iterator is then an input iterator, whose
+  pointer is void.
+*/
+template <typename M, typename V> class indexed_iterator {
+
+	private:
+
+		M* _matrix;
+		std::ptrdiff_t _index;
+
+		template <typename N, typename W> friend class indexed_iterator;
+
+	public:
+
+		typedef decltype(std::declval<M&>().cell(0)) reference;
+		typedef typename std::conditional<std::is_reference<reference>::value,
+										  std::random_access_iterator_tag, std::input_iterator_tag>::type iterator_category;
+		typedef typename std::remove_const<V>::type value_type;
+		typedef std::ptrdiff_t                      difference_type;
+		typedef typename std::conditional<std::is_reference<reference>::value, V*, void>::type pointer;
+
+		indexed_iterator() : _matrix(nullptr), _index(0) {}
+
+		indexed_iterator(M* matrix, std::ptrdiff_t index) : _matrix(matrix), _index(index) {}
+
+		/**
+			@brief Conversion to a read-only iterator
+		*/
+		template <typename N, typename W, typename = typename std::enable_if<std::is_const<V>::value && !std::is_const<W>::value>::type>
+		indexed_iterator(const indexed_iterator<N, W>& other) : _matrix(other._matrix), _index(other._index) {}
+
+		reference operator*() const {return _matrix->cell(static_cast<std::size_t>(_index));}
+		pointer operator->() const {return &_matrix->cell(static_cast<std::size_t>(_index));}
+		reference operator[](difference_type n) const {return _matrix->cell(static_cast<std::size_t>(_index + n));}
+
+		indexed_iterator& operator++() {++_index; return *this;}
+		indexed_iterator operator++(int) {indexed_iterator old(*this); ++_index; return old;}
+		indexed_iterator& operator--() {--_index; return *this;}
+		indexed_iterator operator--(int) {indexed_iterator old(*this); --_index; return old;}
+
+		indexed_iterator& operator+=(difference_type n) {_index += n; return *this;}
+		indexed_iterator& operator-=(difference_type n) {_index -= n; return *this;}
+		indexed_iterator operator+(difference_type n) const {return indexed_iterator(_matrix, _index + n);}
+		indexed_iterator operator-(difference_type n) const {return indexed_iterator(_matrix, _index - n);}
+		friend indexed_iterator operator+(difference_type n, const indexed_iterator& it) {return it + n;}
+
+		difference_type operator-(const indexed_iterator& other) const {return _index - other._index;}
+
+		bool operator==(const indexed_iterator& other) const {return _index == other._index;}
+		bool operator!=(const indexed_iterator& other) const {return _index != other._index;}
+		bool operator<(const indexed_iterator& other) const {return _index < other._index;}
+		bool operator>(const indexed_iterator& other) const {return _index > other._index;}
+		bool operator<=(const indexed_iterator& other) const {return _index <= other._index;}
+		bool operator>=(const indexed_iterator& other) const {return _index >= other._index;}
+};
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef MATRIX_MAPPED
+#define MATRIX_MAPPED
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <cerrno>
+#include <string>
+#include <memory> // std::shared_ptr
+#include <atomic>
+#include <new> // ::operator new, std::bad_array_new_length
+#include <limits>
+#include <stdexcept> // std::length_error
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h> // open
+#include <unistd.h> // close, ftruncate, sysconf
+#include <sys/mman.h> // mmap, munmap, madvise, msync
+#include <sys/stat.h> // fstat
+#include "matrix_3d.h"
+
+/**
+  @file matrix_mapped.h
+  @brief mapped_file class, mapped_allocator and file-backed matrix_3d declaration and implementation.
+
+  A matrix_3d whose cells are a binary file mapped in memory with mmap (POSIX only):
+
+	auto volume = map_matrix_3d<uint16_t>("scan.raw", 2048, 2048, 2048, map_mode::read_only);
+
+  Opening takes the same time whatever the size of the file: nothing is read until
+  the cells are accessed, and then only the touched pages are loaded by the kernel,
+  which keeps them in its page cache, shared by all the processes mapping the file.
+  The cells are stored plan after plan and row after row, without padding, with the
+  native layout of T.
+
+  The matrix obtains its cells from a mapped_allocator: the first block of cells it
+  allocates is the mapped file, while the array of plans, the copies of the matrix
+  and the results of transform() are ordinary heap blocks.
+*/
+
+
+/**
+  @brief Mapping modes
+
+  - read_only: the cells can only be read; writing them crashes the program;
+  - copy_on_write: the cells can be written, but the changes are private to the
+  process and never reach the file (MAP_PRIVATE);
+  - shared: the changes are written back to the file and are seen by the other
+  processes mapping it (MAP_SHARED).
+*/
+enum class map_mode {
+	read_only,
+	copy_on_write,
+	shared
+};
+
+/**
+  @brief Access patterns given to madvise
+
+  - normal: no hint;
+  - sequential: the pages are read in order, so they can be read ahead aggressively
+  and dropped soon after;
+  - random: the pages are read in no particular order, so read-ahead is useless;
+  - will_need: the pages will be accessed soon and can be loaded in advance.
+*/
+enum class access_pattern {
+	normal,
+	sequential,
+	random,
+	will_need
+};
+
+
+/**
+  @brief Class for representing a file mapped in memory
+
+  Class that maps a whole file, or its first bytes, in memory and unmaps it when
+  destroyed. The file descriptor is closed as soon as the file is mapped.
+*/
+class mapped_file {
+
+	private:
+
+		void* _base;
+		std::size_t _bytes;
+		map_mode _mode;
+		std::atomic<bool> _claimed;
+
+		template <typename T> friend class mapped_allocator;
+
+		/**
+			@brief Page size getter
+		*/
+		static std::size_t page_size() {
+			static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+			return size;
+		}
+
+		static int advice(access_pattern pattern) {
+			switch(pattern) {
+				case access_pattern::sequential: return MADV_SEQUENTIAL;
+				case access_pattern::random: return MADV_RANDOM;
+				case access_pattern::will_need: return MADV_WILLNEED;
+				default: return MADV_NORMAL;
+			}
+		}
+
+		/**
+			@brief Claiming method
+
+			Marks the mapping as used by a matrix, for good: the other matrices sharing
+			the allocator, the copies included, get heap blocks, even once the mapping
+			is released, so that they never write their cells into the file.
+
+			@return true if the mapping was never claimed
+		*/
+		bool claim() noexcept {
+			return !_claimed.exchange(true);
+		}
+
+	public:
+
+		/**
+			@brief Opening constructor
+
+			Maps the file at path with the given mode. If bytes = 0 the whole file is
+			mapped, otherwise only its first bytes; in shared mode the file is created, or
+			extended with zeros, when it is shorter than bytes.
+
+			@param path path of the file
+			@param mode mapping mode
+			@param bytes number of bytes to map, 0 for the whole file
+
+			@throw std::system_error if the file cannot be opened or mapped
+			@throw std::length_error if the file is shorter than bytes, outside shared mode
+		*/
+		mapped_file(const std::string& path, map_mode mode, std::size_t bytes = 0)
+					: _base(nullptr), _bytes(0), _mode(mode), _claimed(false) {
+
+			const bool writable = mode == map_mode::shared;
+			const int fd = ::open(path.c_str(), writable ? O_RDWR | (bytes > 0 ? O_CREAT : 0) : O_RDONLY, 0644);
+
+			if(fd < 0)
+				throw std::system_error(errno, std::generic_category(), "mapped_file: cannot open " + path);
+
+			struct stat info;
+
+			if(::fstat(fd, &info) < 0) {
+				const int error = errno;
+				::close(fd);
+				throw std::system_error(error, std::generic_category(), "mapped_file: cannot stat " + path);
+			}
+
+			const std::size_t length = static_cast<std::size_t>(info.st_size);
+
+			if(bytes > length) {
+				if(!writable) {
+					::close(fd);
+					throw std::length_error("mapped_file: " + path + " is shorter than the mapping");
+				}
+
+				if(::ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+					const int error = errno;
+					::close(fd);
+					throw std::system_error(error, std::generic_category(), "mapped_file: cannot extend " + path);
+				}
+			}
+
+			_bytes = bytes > 0 ? bytes : length;
+
+			if(_bytes > 0) {
+				const int protection = mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+				const int flags = mode == map_mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+
+				_base = ::mmap(nullptr, _bytes, protection, flags, fd, 0);
+
+				if(_base == MAP_FAILED) {
+					const int error = errno;
+					_base = nullptr;
+					_bytes = 0;
+					::close(fd);
+					throw std::system_error(error, std::generic_category(), "mapped_file: cannot map " + path);
+				}
+			}
+
+			::close(fd);
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		/**
+			@brief Destructor
+
+			Unmaps the file. In shared mode the changes not yet written reach the file
+			later, through the page cache.
+		*/
+		~mapped_file() {
+			if(_base != nullptr)
+				::munmap(_base, _bytes);
+		}
+
+		void* data() const noexcept {return _base;}
+		std::size_t size() const noexcept {return _bytes;}
+		map_mode mode() const noexcept {return _mode;}
+
+		/**
+			@brief Access hint for the whole mapping
+
+			Hints only: the errors of madvise are ignored.
+
+			@param pattern expected access pattern
+		*/
+		void advise(access_pattern pattern) const noexcept {
+			if(_base != nullptr)
+				::madvise(_base, _bytes, advice(pattern));
+		}
+
+		/**
+			@brief Access hint for a range of the mapping
+
+			The range is widened to whole pages. Hints only: the errors of madvise are
+			ignored.
+
+			@param first first byte of the range
+			@param bytes length of the range
+			@param pattern expected access pattern
+
+			@pre the range is inside the mapping
+		*/
+		void advise(const void* first, std::size_t bytes, access_pattern pattern) const noexcept {
+
+			const std::size_t begin = static_cast<const char*>(first) - static_cast<const char*>(_base);
+			const std::size_t start = begin / page_size() * page_size();
+
+			assert(begin + bytes <= _bytes);
+
+			if(bytes > 0)
+				::madvise(static_cast<char*>(_base) + start, begin + bytes - start, advice(pattern));
+		}
+
+		/**
+			@brief Write-back method
+
+			Writes the changed pages back to the file and waits for the end of the
+			writes. Does nothing outside shared mode.
+
+			@throw std::system_error if the writes fail
+		*/
+		void sync() const {
+			if(_mode == map_mode::shared && _base != nullptr && ::msync(_base, _bytes, MS_SYNC) < 0)
+				throw std::system_error(errno, std::generic_category(), "mapped_file: cannot sync");
+		}
+};
+
+
+/**
+  @brief Class for representing an allocator backed by a mapped file
+
+  Standard-conforming allocator whose first block of T that fits in the file, past
+  offset bytes, is the mapped file itself; the mapping is handed out once only, and
+  is not reused once that block is released. Every other block comes from
+  ::operator new. The allocators rebound
+  to other types never use the file, so that the array of plans of a matrix_3d or
+  the result of transform() are heap blocks. Two mapped_allocator compare equal
+  when they share the same file.
+*/
+template <typename T> class mapped_allocator {
+
+	private:
+
+		std::shared_ptr<mapped_file> _file;
+		std::size_t _offset;
+
+		template <typename U> friend class mapped_allocator;
+
+		T* mapped() const noexcept {
+			return reinterpret_cast<T*>(static_cast<char*>(_file->data()) + _offset);
+		}
+
+	public:
+
+		typedef T value_type;
+
+		/**
+			@brief Default constructor
+
+			Creates an allocator without a file, which only returns heap blocks.
+		*/
+		mapped_allocator() noexcept : _file(), _offset(0) {}
+
+		/**
+			@brief Parameterized constructor
+
+			@param file mapped file holding the cells
+			@param offset position of the first cell in the file, in bytes
+
+			@pre offset is a multiple of alignof(T)
+		*/
+		explicit mapped_allocator(std::shared_ptr<mapped_file> file, std::size_t offset = 0) noexcept
+								  : _file(std::move(file)), _offset(offset) {
+			assert(offset % alignof(T) == 0);
+		}
+
+		/**
+			@brief Rebinding constructor
+
+			Creates an allocator without a file.
+		*/
+		template <typename U>
+		mapped_allocator(const mapped_allocator<U>&) noexcept : _file(), _offset(0) {}
+
+		/**
+			@brief Allocation method
+
+			@param n number of objects
+
+			@return pointer to the mapped file if it was never claimed and holds n
+			objects past the offset, to uninitialized heap storage for n objects otherwise
+		*/
+		T* allocate(std::size_t n) {
+
+			if(n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_array_new_length();
+
+			if constexpr (std::is_trivially_copyable<T>::value)
+				if(_file != nullptr && _file->data() != nullptr && _offset <= _file->size() &&
+				   n <= (_file->size() - _offset) / sizeof(T) && _file->claim())
+					return mapped();
+
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		/**
+			@brief Release method
+
+			@param p pointer obtained from allocate()
+			@param n number of objects given to allocate()
+		*/
+		void deallocate(T* p, std::size_t) noexcept {
+			if(_file == nullptr || _file->data() == nullptr || p != mapped())
+				::operator delete(p);
+		}
+
+		/**
+			@brief File getter
+
+			@return mapped file of the allocator, nullptr if it has none
+		*/
+		const std::shared_ptr<mapped_file>& file() const noexcept {
+			return _file;
+		}
+
+		template <typename U>
+		bool operator==(const mapped_allocator<U>& other) const noexcept {
+			return _file == other._file;
+		}
+
+		template <typename U>
+		bool operator!=(const mapped_allocator<U>& other) const noexcept {
+			return _file != other._file;
+		}
+};
+
+
+/**
+  @brief File-backed matrix_3d factory
+
+  Maps the file at path and returns a matrix_3d of z plans of y rows of x cells
+  whose cells are the bytes of the file starting at offset. In shared mode the file
+  is created, or extended with zeros, when it is too short.
+
+  @param path path of the file
+  @param z number of plans
+  @param y number of rows
+  @param x number of columns
+  @param mode mapping mode
+  @param pattern expected access pattern
+  @param offset position of the first cell in the file, in bytes
+
+  @pre T is trivially copyable and trivially default constructible
+  @pre offset is a multiple of alignof(T)
+
+  @throw std::system_error if the file cannot be opened or mapped
+  @throw std::length_error if the file is too short, outside shared mode
+
+  @return the file-backed matrix_3d
+*/
+template <typename T>
+matrix_3d<T, mapped_allocator<T>> map_matrix_3d(const std::string& path, matrix_index z, matrix_index y, matrix_index x,
+												 map_mode mode = map_mode::read_only,
+												 access_pattern pattern = access_pattern::normal,
+												 std::size_t offset = 0) {
+
+	static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_default_constructible<T>::value,
+				  "map_matrix_3d: the cells must be trivially copyable and default constructible");
+
+	const std::size_t cells = checked_extent(checked_extent(z, y), x);
+
+	if(cells > (std::numeric_limits<std::size_t>::max() - offset) / sizeof(T))
+		throw std::length_error("map_matrix_3d: volume too large");
+
+	const std::size_t bytes = offset + cells * sizeof(T);
+
+	std::shared_ptr<mapped_file> file = std::make_shared<mapped_file>(path, mode, mode == map_mode::shared ? bytes : 0);
+
+	if(file->size() < bytes)
+		throw std::length_error("map_matrix_3d: " + path + " is shorter than the volume");
+
+	file->advise(pattern);
+
+	return matrix_3d<T, mapped_allocator<T>>(z, y, x, mapped_allocator<T>(file, offset));
+}
+
+/**
+  @brief Access hint for plans of a file-backed matrix_3d
+
+  For example, advise_plans(volume, z, z + 7, access_pattern::will_need) asks the
+  kernel to start reading the next 8 plans while the current ones are processed.
+
+  @param matrix file-backed matrix_3d
+  @param z1 first plan
+  @param z2 last plan, included
+  @param pattern expected access pattern
+
+  @pre z1 <= z2 < matrix.plans()
+*/
+template <typename T>
+void advise_plans(const matrix_3d<T, mapped_allocator<T>>& matrix, matrix_index z1, matrix_index z2,
+				  access_pattern pattern) {
+
+	assert(z1 <= z2 && z2 < matrix.plans());
+
+	const std::shared_ptr<mapped_file> file = matrix.get_allocator().file();
+	const std::size_t plan = matrix.rows() * matrix.pitch();
+	const char* cells = reinterpret_cast<const char*>(matrix.data());
+
+	// Copies of a file-backed matrix share its allocator but live on the heap.
+	if(file == nullptr || cells < static_cast<const char*>(file->data()) ||
+	   cells >= static_cast<const char*>(file->data()) + file->size())
+		return;
+
+	file->advise(matrix.data() + z1 * plan, (z2 - z1 + 1) * plan * sizeof(T), pattern);
+}
+
+#endif
@@ -0,0 +1,948 @@
+#ifndef MATRIX_PAGED
+#define MATRIX_PAGED
+
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cstdint>
+#include <cassert>
+#include <cerrno>
+#include <algorithm> // std::min, std::max
+#include <string>
+#include <sstream>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory> // std::unique_ptr
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <iterator> // std::random_access_iterator_tag
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h> // open
+#include <unistd.h> // close, pread, pwrite, ftruncate
+#include "matrix_3d.h"
+
+/**
+  @file matrix_paged.h
+  @brief paged_matrix_3d template class declaration and implementation.
+
+  An out-of-core matrix_3d (POSIX only): the cells stay in a file in the binary format
+  of matrix_io.h, with one plan per chunk, and only a bounded number of plans is kept
+  in memory:
+
+	paged_matrix_3d<float> volume("volume.mx3d", 4096, 4096, 4096, 16);
+
+  holds 16 plans of 64 MB in memory for a volume of 256 GB. A plan is read, and its
+  checksum verified, the first time one of its cells is accessed; when the cache is
+  full the least recently used plan is dropped, and written back first if any of its
+  cells was changed. When the plans are accessed in order, forwards or backwards, the
+  next plans are read in advance by a background thread, so that a sweep over the
+  volume overlaps the reads with the computations.
+
+  The file is a valid matrix file: load_matrix_3d() reads it back once flush() has
+  been called or the paged_matrix_3d destroyed.
+*/
+
+
+namespace paged_detail {
+
+	/**
+		@brief Reading of bytes at offset, retried until complete
+
+		@throw std::system_error if the read fails
+		@throw matrix_format_error if the file ends before
+	*/
+	inline void read_at(int fd, void* buffer, std::size_t bytes, std::uint64_t offset) {
+
+		char* p = static_cast<char*>(buffer);
+
+		while(bytes > 0) {
+			const ssize_t n = ::pread(fd, p, bytes, static_cast<off_t>(offset));
+
+			if(n < 0) {
+				if(errno == EINTR)
+					continue;
+				throw std::system_error(errno, std::generic_category(), "paged_matrix_3d: cannot read");
+			}
+
+			if(n == 0)
+				throw matrix_format_error("truncated data");
+
+			p += n;
+			bytes -= static_cast<std::size_t>(n);
+			offset += static_cast<std::uint64_t>(n);
+		}
+	}
+
+	/**
+		@brief Writing of bytes at offset, retried until complete
+
+		@throw std::system_error if the write fails
+	*/
+	inline void write_at(int fd, const void* buffer, std::size_t bytes, std::uint64_t offset) {
+
+		const char* p = static_cast<const char*>(buffer);
+
+		while(bytes > 0) {
+			const ssize_t n = ::pwrite(fd, p, bytes, static_cast<off_t>(offset));
+
+			if(n < 0) {
+				if(errno == EINTR)
+					continue;
+				throw std::system_error(errno, std::generic_category(), "paged_matrix_3d: cannot write");
+			}
+
+			p += n;
+			bytes -= static_cast<std::size_t>(n);
+			offset += static_cast<std::uint64_t>(n);
+		}
+	}
+}
+
+
+template <typename T> class paged_matrix_3d;
+
+template <typename Q, typename W, typename F>
+paged_matrix_3d<Q> transform(const paged_matrix_3d<W>& source, const F func, const std::string& path,
+							 std::size_t cache_planes = 8, std::size_t prefetch_planes = 2);
+
+
+/**
+  @brief Class for representing a matrix_3d larger than the memory
+
+  The cells live in a file and the plans in use are kept in a cache of a fixed number
+  of plans, at least two, replaced in least recently used order. Neither the plan
+  being accessed nor the plan left last is ever dropped, and the cells of the current
+  plan are reached without locking; a reference to a cell stays valid until cells of
+  two other plans are accessed, so that the read-only iterators can be used by the std
+  algorithms, which hold at most two references at a time.
+
+  A plan is written back to the file only if it was changed. The read/write accesses
+  (the non-const operator() and iterators) therefore give a proxy reference, which
+  marks the plan as changed only when assigned: reading through them costs no write.
+
+  Two consecutive accesses to the next plan (or to the previous one) are taken as a
+  sweep, and the following plans, up to prefetch_planes and two less than the size of
+  the cache, are read in advance by a background thread.
+
+  A paged_matrix_3d is used by one thread at a time; the only concurrency is with its
+  own prefetching thread. It is neither copyable nor movable.
+*/
+template <typename T> class paged_matrix_3d {
+
+	public:
+
+		typedef T value_type;
+		typedef std::size_t size_type;
+		typedef indexed_reference<paged_matrix_3d> reference;
+		typedef indexed_iterator<paged_matrix_3d, T> iterator;
+		typedef indexed_iterator<const paged_matrix_3d, const T> const_iterator;
+
+	private:
+
+		static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+		/**
+			@brief Cache entry: the cells of one plan
+
+			A loading slot is being read outside the lock and is left alone by everyone
+			else; the plan of the slot is then already recorded in _where, so that the
+			plan is not read twice.
+		*/
+		struct slot {
+			std::unique_ptr<T[]> cells;
+			std::size_t plan;
+			bool dirty;
+			bool loading;
+			std::list<std::size_t>::iterator lru;
+		};
+
+		int _fd;
+		size_type _plans;
+		size_type _rows;
+		size_type _col;
+		std::size_t _plan_cells;
+		std::size_t _prefetch;
+
+		// Cache state, guarded by _mutex.
+		mutable std::vector<slot> _slots;
+		mutable std::vector<std::size_t> _where;
+		mutable std::list<std::size_t> _lru;
+		mutable std::deque<std::size_t> _requests;
+		mutable std::size_t _current_slot;
+		mutable std::size_t _left_slot;
+		mutable std::size_t _loads;
+		mutable std::size_t _prefetched;
+		mutable std::size_t _write_backs;
+		bool _stop;
+
+		mutable std::mutex _mutex;
+		mutable std::condition_variable _wake;
+		mutable std::condition_variable _loaded;
+
+		// Current plan, only touched by the thread using the matrix.
+		mutable std::size_t _current;
+		mutable T* _current_cells;
+		mutable bool _current_dirty;
+		mutable std::size_t _previous;
+		mutable int _step;
+
+		std::thread _prefetcher;
+
+		template <typename U> friend class paged_matrix_3d;
+		template <typename M, typename V> friend class indexed_iterator;
+		template <typename M> friend class indexed_reference;
+
+		std::size_t plan_bytes() const {
+			return _plan_cells * sizeof(T);
+		}
+
+		std::uint64_t offset(std::size_t z) const {
+			return io_detail::header_bytes + static_cast<std::uint64_t>(z) * (plan_bytes() + 4);
+		}
+
+		/**
+			@brief Reading of the plan z into cells, checksum included
+		*/
+		void fetch(std::size_t z, T* cells) const {
+
+			std::uint32_t checksum;
+
+			paged_detail::read_at(_fd, cells, plan_bytes(), offset(z));
+			paged_detail::read_at(_fd, &checksum, sizeof(checksum), offset(z) + plan_bytes());
+
+			if(crc32c(cells, plan_bytes()) != checksum)
+				throw matrix_format_error("checksum mismatch in plan " + std::to_string(z));
+		}
+
+		/**
+			@brief Write back of a slot, with the lock held
+		*/
+		void store(slot& s) const {
+
+			const std::uint32_t checksum = crc32c(s.cells.get(), plan_bytes());
+
+			paged_detail::write_at(_fd, s.cells.get(), plan_bytes(), offset(s.plan));
+			paged_detail::write_at(_fd, &checksum, sizeof(checksum), offset(s.plan) + plan_bytes());
+			s.dirty = false;
+			++_write_backs;
+		}
+
+		/**
+			@brief Least recently used slot that can be replaced, or none
+
+			The slots of the current plan and of the plan left last are kept, since
+			references to their cells may still be held.
+		*/
+		std::size_t victim() const {
+
+			for(auto it = _lru.rbegin(); it != _lru.rend(); ++it)
+				if(!_slots[*it].loading && *it != _current_slot && *it != _left_slot)
+					return *it;
+
+			return none;
+		}
+
+		/**
+			@brief Release of a slot, written back first if dirty
+		*/
+		void evict(std::size_t i) const {
+
+			slot& s = _slots[i];
+
+			if(s.plan == none)
+				return;
+
+			if(s.dirty)
+				store(s);
+
+			_where[s.plan] = none;
+			s.plan = none;
+		}
+
+		void touch(std::size_t i) const {
+			_lru.splice(_lru.begin(), _lru, _slots[i].lru);
+		}
+
+		/**
+			@brief Changes of the current plan recorded in its slot, with the lock held
+		*/
+		void settle() const {
+
+			if(_current_slot != none && _current_dirty)
+				_slots[_current_slot].dirty = true;
+
+			_current_dirty = false;
+		}
+
+		/**
+			@brief Cells of the plan z
+
+			The fast path: the current plan is returned without locking.
+		*/
+		T* plane_of(std::size_t z, bool write) const {
+
+			assert(z < _plans);
+
+			if(z == _current) {
+				_current_dirty = _current_dirty || write;
+				return _current_cells;
+			}
+
+			return switch_to(z, write);
+		}
+
+		/**
+			@brief Change of the current plan
+
+			Finds the plan z in the cache, waiting for it if the prefetching thread is
+			reading it, or reads it in the least recently used slot. Then queues the
+			next plans for the prefetching thread if the last two changes went the same
+			way.
+		*/
+		T* switch_to(std::size_t z, bool write) const {
+
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			settle();
+			if(_current_slot != none)
+				_left_slot = _current_slot;
+			_current = none;
+			_current_cells = nullptr;
+			_current_slot = none;
+
+			std::size_t i;
+
+			while(true) {
+				i = _where[z];
+
+				if(i != none && !_slots[i].loading)
+					break;
+
+				if(i == none)
+					i = victim();
+
+				if(i == none || _slots[i].loading) {
+					_loaded.wait(lock);
+					continue;
+				}
+
+				evict(i);
+
+				slot& s = _slots[i];
+				s.plan = z;
+				s.loading = true;
+				_where[z] = i;
+
+				lock.unlock();
+
+				try {
+					fetch(z, s.cells.get());
+				}
+				catch(...) {
+					lock.lock();
+					s.loading = false;
+					s.plan = none;
+					_where[z] = none;
+					_loaded.notify_all();
+					throw;
+				}
+
+				lock.lock();
+				s.loading = false;
+				++_loads;
+				_loaded.notify_all();
+				break;
+			}
+
+			touch(i);
+			_current_slot = i;
+			_current = z;
+			_current_cells = _slots[i].cells.get();
+			_current_dirty = write;
+
+			const int step = _previous == none ? 0 : (z == _previous + 1 ? 1 : (z + 1 == _previous ? -1 : 0));
+
+			if(step != 0 && step == _step) {
+				const std::size_t depth = std::min(_prefetch, _slots.size() - 2);
+
+				_requests.clear();
+				for(std::size_t k = 1; k <= depth; ++k) {
+					const std::size_t next = step > 0 ? z + k : z - k;
+
+					if(next >= _plans)
+						break;
+					if(_where[next] == none)
+						_requests.push_back(next);
+				}
+
+				if(!_requests.empty())
+					_wake.notify_one();
+			}
+
+			_step = step;
+			_previous = z;
+
+			return _current_cells;
+		}
+
+		/**
+			@brief Prefetching thread
+
+			Reads the requested plans that are not in the cache in the least recently
+			used slots, the current plan and the plan left last excepted. Errors are ignored: the plan is then
+			read again, and the error reported, when it is accessed.
+		*/
+		void run() {
+
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			while(true) {
+				_wake.wait(lock, [this] {return _stop || !_requests.empty();});
+
+				if(_stop)
+					return;
+
+				const std::size_t z = _requests.front();
+				_requests.pop_front();
+
+				if(_where[z] != none)
+					continue;
+
+				const std::size_t i = victim();
+
+				if(i == none)
+					continue;
+
+				try {
+					evict(i);
+				}
+				catch(...) {
+					continue;
+				}
+
+				slot& s = _slots[i];
+				s.plan = z;
+				s.loading = true;
+				_where[z] = i;
+				touch(i);
+
+				lock.unlock();
+
+				bool read = true;
+
+				try {
+					fetch(z, s.cells.get());
+				}
+				catch(...) {
+					read = false;
+				}
+
+				lock.lock();
+				s.loading = false;
+
+				if(read)
+					++_prefetched;
+				else {
+					s.plan = none;
+					_where[z] = none;
+				}
+
+				_loaded.notify_all();
+			}
+		}
+
+		/**
+			@brief Common part of the constructors, once the extents are known
+		*/
+		void setup(std::size_t cache_planes) {
+
+			cache_planes = std::max<std::size_t>(2, cache_planes);
+
+			_plan_cells = checked_extent(_rows, _col);
+			checked_extent(_plans, _plan_cells);
+
+			_where.assign(_plans, none);
+			_slots.resize(cache_planes);
+
+			for(std::size_t i = 0; i < cache_planes; ++i) {
+				_slots[i].cells.reset(new T[_plan_cells]());
+				_slots[i].plan = none;
+				_slots[i].dirty = false;
+				_slots[i].loading = false;
+				_slots[i].lru = _lru.insert(_lru.end(), i);
+			}
+
+			_prefetcher = std::thread(&paged_matrix_3d::run, this);
+		}
+
+		static int open_file(const std::string& path, int flags) {
+
+			const int fd = ::open(path.c_str(), flags, 0644);
+
+			if(fd < 0)
+				throw std::system_error(errno, std::generic_category(), "paged_matrix_3d: cannot open " + path);
+
+			return fd;
+		}
+
+		/**
+			@brief Creation of the file: header and zero plans
+
+			The file is extended with ftruncate, so the plans are holes until written,
+			and only the checksums of the zero plans are written.
+		*/
+		void create_file() {
+
+			matrix_header header;
+			header.kind = io_detail::kind<T>();
+			header.cell_size = sizeof(T);
+			header.plans = _plans;
+			header.rows = _rows;
+			header.columns = _col;
+			header.chunk_rows = _rows;
+			header.swapped = false;
+
+			std::ostringstream os;
+			io_detail::write_header(os, header);
+
+			const std::string bytes = os.str();
+			paged_detail::write_at(_fd, bytes.data(), bytes.size(), 0);
+
+			if(_plan_cells == 0)
+				return;
+
+			if(::ftruncate(_fd, static_cast<off_t>(offset(_plans))) < 0)
+				throw std::system_error(errno, std::generic_category(), "paged_matrix_3d: cannot extend the file");
+
+			const std::vector<T> zeros(_plan_cells, T());
+			const std::uint32_t checksum = crc32c(zeros.data(), plan_bytes());
+
+			for(std::size_t z = 0; z < _plans; ++z)
+				paged_detail::write_at(_fd, &checksum, sizeof(checksum), offset(z) + plan_bytes());
+		}
+
+		/**
+			@brief Reading of the header of an existing file
+		*/
+		void open_header() {
+
+			std::string bytes(io_detail::header_bytes, '\0');
+			paged_detail::read_at(_fd, &bytes[0], bytes.size(), 0);
+
+			std::istringstream is(bytes);
+			const matrix_header header = io_detail::read_header(is);
+
+			if(header.kind != io_detail::kind<T>() || header.cell_size != sizeof(T))
+				throw matrix_format_error("cell type mismatch");
+
+			if(header.swapped)
+				throw matrix_format_error("paged files must be in the native byte order");
+
+			if(header.rows * header.columns > 0 && header.chunk_rows != header.rows)
+				throw matrix_format_error("paged files must have one plan per chunk");
+
+			_plans = static_cast<size_type>(header.plans);
+			_rows = static_cast<size_type>(header.rows);
+			_col = static_cast<size_type>(header.columns);
+		}
+
+		/**
+			@brief Transformation constructor
+
+			Creates the file at path and fills it, plan by plan, with the cells of
+			source transformed by func. Used by transform() to return the result by
+			value.
+		*/
+		template <typename W, typename F>
+		paged_matrix_3d(const paged_matrix_3d<W>& source, const F& func, const std::string& path,
+						std::size_t cache_planes, std::size_t prefetch_planes)
+						: paged_matrix_3d(path, source.plans(), source.rows(), source.columns(), cache_planes, prefetch_planes) {
+
+			for(std::size_t z = 0; z < _plans && _plan_cells > 0; ++z)
+				transform_cells(source.plane_of(z, false), plane_of(z, true), _plan_cells, func);
+		}
+
+		template <typename Q, typename W, typename F>
+		friend paged_matrix_3d<Q> transform(const paged_matrix_3d<W>& source, const F func, const std::string& path,
+											std::size_t cache_planes, std::size_t prefetch_planes);
+
+		/**
+			@brief Cell of linear index i, plan after plan and row after row
+		*/
+		reference cell(std::size_t i) {
+			return reference(this, i);
+		}
+
+		const T& cell(std::size_t i) const {
+			return plane_of(i / _plan_cells, false)[i % _plan_cells];
+		}
+
+		/**
+			@brief Writing of the cell of linear index i, which marks its plan as changed
+		*/
+		void store(std::size_t i, const T& value) {
+			plane_of(i / _plan_cells, true)[i % _plan_cells] = value;
+		}
+
+	public:
+
+		/**
+			@brief Creation constructor
+
+			Creates, or truncates, the file at path for a z x y x x matrix of zeros.
+
+			@param path path of the file
+			@param z number of plans
+			@param y number of rows
+			@param x number of columns
+			@param cache_planes number of plans kept in memory, at least 2
+			@param prefetch_planes number of plans read in advance during a sweep
+
+			@throw std::system_error if the file cannot be created
+			@throw std::length_error if the extents overflow
+		*/
+		paged_matrix_3d(const std::string& path, size_type z, size_type y, size_type x,
+						std::size_t cache_planes = 8, std::size_t prefetch_planes = 2)
+						: _fd(-1), _plans(z), _rows(y), _col(x), _plan_cells(0), _prefetch(prefetch_planes),
+						  _current_slot(none), _left_slot(none), _loads(0), _prefetched(0), _write_backs(0), _stop(false),
+						  _current(none), _current_cells(nullptr), _current_dirty(false), _previous(none), _step(0) {
+
+			_fd = open_file(path, O_RDWR | O_CREAT | O_TRUNC);
+
+			try {
+				_plan_cells = checked_extent(_rows, _col);
+				checked_extent(_plans, _plan_cells);
+				create_file();
+				setup(cache_planes);
+			}
+			catch(...) {
+				::close(_fd);
+				throw;
+			}
+		}
+
+		/**
+			@brief Opening constructor
+
+			Opens an existing matrix file, written with one plan per chunk in the native
+			byte order, for instance by a paged_matrix_3d or by save() with chunk_rows
+			equal to the number of rows. The plans are read, and their checksum verified,
+			when first accessed.
+
+			@param path path of the file
+			@param cache_planes number of plans kept in memory, at least 2
+			@param prefetch_planes number of plans read in advance during a sweep
+
+			@throw std::system_error if the file cannot be opened
+			@throw matrix_format_error if the file is not a matrix file of T with one plan per chunk
+		*/
+		explicit paged_matrix_3d(const std::string& path, std::size_t cache_planes = 8, std::size_t prefetch_planes = 2)
+								 : _fd(-1), _plans(0), _rows(0), _col(0), _plan_cells(0), _prefetch(prefetch_planes),
+								   _current_slot(none), _left_slot(none), _loads(0), _prefetched(0), _write_backs(0), _stop(false),
+								   _current(none), _current_cells(nullptr), _current_dirty(false), _previous(none), _step(0) {
+
+			_fd = open_file(path, O_RDWR);
+
+			try {
+				open_header();
+				setup(cache_planes);
+			}
+			catch(...) {
+				::close(_fd);
+				throw;
+			}
+		}
+
+		paged_matrix_3d(const paged_matrix_3d&) = delete;
+		paged_matrix_3d& operator=(const paged_matrix_3d&) = delete;
+
+		/**
+			@brief Destructor
+
+			Stops the prefetching thread and writes back the changed plans. Write
+			errors are lost at this point: call flush() first to be told about them.
+		*/
+		~paged_matrix_3d() {
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stop = true;
+			}
+
+			_wake.notify_one();
+			_prefetcher.join();
+
+			try {
+				flush();
+			}
+			catch(...) {}
+
+			::close(_fd);
+		}
+
+		/**
+			@brief Number of plans getter
+		*/
+		inline size_type plans() const {
+			return _plans;
+		}
+
+		/**
+			@brief Number of rows getter
+		*/
+		inline size_type rows() const {
+			return _rows;
+		}
+
+		/**
+			@brief Number of columns getter
+		*/
+		inline size_type columns() const {
+			return _col;
+		}
+
+		/**
+			@brief Total dimension getter
+		*/
+		inline size_type size() const {
+			return _plans * _plan_cells;
+		}
+
+		/**
+			@brief Number of plans kept in memory
+		*/
+		std::size_t cache_planes() const {
+			return _slots.size();
+		}
+
+		/**
+			@brief Cell access
+
+			@return proxy reference to the cell, which reads it like the read-only
+			operator() and marks its plan as changed only when assigned
+		*/
+		reference operator()(size_type z, size_type y, size_type x) {
+			assert(z < _plans && y < _rows && x < _col);
+			return reference(this, (std::size_t(z) * _rows + y) * _col + x);
+		}
+
+		/**
+			@brief Read-only cell access
+
+			Reads the plan z if it is not in the cache. The reference stays valid until
+			cells of two other plans are accessed.
+		*/
+		const T& operator()(size_type z, size_type y, size_type x) const {
+			assert(y < _rows && x < _col);
+			return plane_of(z, false)[y * _col + x];
+		}
+
+		iterator begin() {
+			return iterator(this, 0);
+		}
+
+		iterator end() {
+			return iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		const_iterator begin() const {
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		/**
+			@brief Plans traversal
+
+			Calls f on a matrix_2d_view of each plan, in order, so that the plans are
+			read in advance. If f returns a bool, returning false stops the traversal.
+			The view is valid during the call only. Every plan is marked as changed: use
+			the read-only traversal to only read them.
+
+			@pre F : matrix_2d_view<T> -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_plane(F f) {
+
+			for(std::size_t z = 0; z < _plans && _plan_cells > 0; ++z) {
+				matrix_2d_view<T> plan(plane_of(z, true), _rows, _col, static_cast<std::ptrdiff_t>(_col));
+
+				if constexpr (std::is_same<decltype(f(plan)), bool>::value) {
+					if(!f(plan))
+						return false;
+				}
+				else
+					f(plan);
+			}
+
+			return true;
+		}
+
+		/**
+			@brief Read-only plans traversal
+
+			@pre F : matrix_2d_view<const T> -> void or bool
+		*/
+		template <typename F>
+		bool for_each_plane(F f) const {
+
+			for(std::size_t z = 0; z < _plans && _plan_cells > 0; ++z) {
+				matrix_2d_view<const T> plan(plane_of(z, false), _rows, _col, static_cast<std::ptrdiff_t>(_col));
+
+				if constexpr (std::is_same<decltype(f(plan)), bool>::value) {
+					if(!f(plan))
+						return false;
+				}
+				else
+					f(plan);
+			}
+
+			return true;
+		}
+
+		/**
+			@brief Fill method
+
+			Fills the matrix, plan by plan, with the values obtained from two generic
+			iterators. If the iterator reaches the end before completely filling the
+			matrix, the remaining cells remain intact. If an exception is thrown, the
+			cells filled before stay filled.
+		*/
+		template <typename I>
+		void fill(I start, I end) {
+
+			for(std::size_t z = 0; z < _plans && _plan_cells > 0 && start != end; ++z) {
+				T* cells = plane_of(z, true);
+
+				for(std::size_t i = 0; i < _plan_cells && start != end; ++i, ++start)
+					cells[i] = static_cast<T>(*start);
+			}
+		}
+
+		/**
+		    @brief Comparison function
+
+		    Returns true if the two matrices have the same shape and equal cells
+		    according to equality. The plans are compared one at a time.
+
+			@pre E : T x T -> {0, 1}
+	  	*/
+		template <typename E>
+		bool equals(const paged_matrix_3d& other, const E equality) const {
+
+			if(_plans != other._plans || _rows != other._rows || _col != other._col)
+				return false;
+
+			for(std::size_t z = 0; z < _plans && _plan_cells > 0; ++z) {
+				const T* cells = plane_of(z, false);
+				const T* others = other.plane_of(z, false);
+
+				for(std::size_t i = 0; i < _plan_cells; ++i)
+					if(!equality(cells[i], others[i]))
+						return false;
+			}
+
+			return true;
+		}
+
+		bool operator==(const paged_matrix_3d& other) const {
+			return equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		bool operator!=(const paged_matrix_3d& other) const {
+			return !(*this == other);
+		}
+
+		/**
+			@brief Prefetching hint
+
+			Asks the background thread to read the plans z1 to z2 (inclusive) that are
+			not in the cache, as far as it has room for them.
+
+			@pre z1 <= z2 < plans()
+		*/
+		void prefetch(size_type z1, size_type z2) const {
+
+			assert(z1 <= z2 && z2 < _plans);
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				for(std::size_t z = z1; z <= z2; ++z)
+					if(_where[z] == none)
+						_requests.push_back(z);
+			}
+
+			_wake.notify_one();
+		}
+
+		/**
+			@brief Write back of the changed plans
+
+			@throw std::system_error if a write fails
+		*/
+		void flush() {
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			settle();
+
+			for(slot& s : _slots)
+				if(s.plan != none && !s.loading && s.dirty)
+					store(s);
+		}
+
+		/**
+			@brief Number of plans read on access
+		*/
+		std::size_t loads() const {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _loads;
+		}
+
+		/**
+			@brief Number of plans read in advance by the background thread
+		*/
+		std::size_t prefetched() const {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _prefetched;
+		}
+
+		/**
+			@brief Number of plans written back
+		*/
+		std::size_t write_backs() const {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _write_backs;
+		}
+};
+
+
+/**
+  @brief Transformation function for paged_matrix_3d
+
+  Creates the file at path holding the cells of source transformed by func, plan by
+  plan, so that neither matrix needs to fit in memory.
+
+  @param source source matrix
+  @param func transformation
+  @param path path of the result file
+  @param cache_planes number of plans of the result kept in memory
+  @param prefetch_planes number of plans of the result read in advance during a sweep
+
+  @pre F : W -> Q
+
+  @return the transformed matrix
+*/
+template <typename Q, typename W, typename F>
+paged_matrix_3d<Q> transform(const paged_matrix_3d<W>& source, const F func, const std::string& path,
+							 std::size_t cache_planes, std::size_t prefetch_planes) {
+	return paged_matrix_3d<Q>(source, func, path, cache_planes, prefetch_planes);
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef MATRIX_PARALLEL
+#define MATRIX_PARALLEL
+
+#include <cstddef> // std::size_t
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory> // std::shared_ptr
+#include <exception>
+#include <algorithm> // std::min
+
+/**
+  @file matrix_parallel.h
+  @brief thread_pool class, parallel_t policy and parallel_for declaration and implementation.
+*/
+
+
+/**
+  @brief Class for representing a pool of worker threads
+
+  Class that keeps a fixed set of worker threads waiting for tasks, so that parallel
+  algorithms do not pay the creation of threads at each call. The threads are
+  joined when the pool is destroyed, after the tasks already submitted have run.
+  All the methods are thread-safe.
+*/
+class thread_pool {
+
+	private:
+
+		std::vector<std::thread> _workers;
+		std::deque<std::function<void()>> _tasks;
+		std::mutex _mutex;
+		std::condition_variable _ready;
+		bool _stop;
+
+		/**
+			@brief Worker loop
+
+			Runs the submitted tasks until the pool is stopped and no task is left.
+		*/
+		void work() {
+
+			while(true) {
+				std::function<void()> task;
+
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_ready.wait(lock, [this] () {return _stop || !_tasks.empty();});
+
+					if(_tasks.empty())
+						return;
+
+					task = std::move(_tasks.front());
+					_tasks.pop_front();
+				}
+
+				task();
+			}
+		}
+
+	public:
+
+		/**
+			@brief Default number of workers
+
+			@return number of hardware threads minus one, since the thread calling a
+			parallel algorithm takes part in it
+		*/
+		static std::size_t default_workers() {
+			unsigned int threads = std::thread::hardware_concurrency();
+			return threads > 1 ? threads - 1 : 0;
+		}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a pool with the given number of workers. With no worker, the
+			parallel algorithms run sequentially in the calling thread.
+
+			@param workers number of worker threads
+		*/
+		explicit thread_pool(std::size_t workers = default_workers()) : _stop(false) {
+
+			_workers.reserve(workers);
+
+			try {
+				for(std::size_t i = 0; i < workers; ++i)
+					_workers.emplace_back(&thread_pool::work, this);
+			}
+			catch(...) {
+				shutdown();
+				throw;
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		/**
+			@brief Destructor
+
+			Runs the tasks still queued and joins the workers.
+		*/
+		~thread_pool() {
+			shutdown();
+		}
+
+		/**
+			@brief Workers getter
+
+			@return number of worker threads
+		*/
+		std::size_t size() const {
+			return _workers.size();
+		}
+
+		/**
+			@brief Submission method
+
+			Queues a task to be run by one of the workers.
+
+			@param task task to run
+		*/
+		void submit(std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_tasks.push_back(std::move(task));
+			}
+			_ready.notify_one();
+		}
+
+		/**
+			@brief Shared pool getter
+
+			Returns the pool used by the parallel algorithms when no pool is given,
+			created with default_workers() workers the first time it is requested.
+
+			@return reference to the shared pool
+		*/
+		static thread_pool& shared() {
+			static thread_pool pool;
+			return pool;
+		}
+
+	private:
+
+		void shutdown() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stop = true;
+			}
+			_ready.notify_all();
+
+			for(std::thread& worker : _workers)
+				worker.join();
+
+			_workers.clear();
+		}
+};
+
+
+/**
+  @brief Tag type selecting the parallel overloads
+
+  Passed as the last argument to the parallel overloads of transform(), fill() and
+  equals(). The work is split into tasks of at least grain cells run on a
+  thread_pool, the shared one by default. Inputs of at most grain cells, as well as
+  pools without workers, are processed sequentially in the calling thread.
+*/
+struct parallel_t {
+
+	/**
+		@brief Default minimum number of cells of a task
+	*/
+	static constexpr std::size_t default_grain = std::size_t(1) << 16;
+
+	std::size_t grain;
+	thread_pool* pool;
+
+	/**
+		@brief Parameterized constructor
+
+		@param grain minimum number of cells of a task
+		@param pool pool to run the tasks on, nullptr for thread_pool::shared()
+	*/
+	explicit constexpr parallel_t(std::size_t grain = default_grain, thread_pool* pool = nullptr)
+								  : grain(grain > 0 ? grain : 1), pool(pool) {}
+
+	/**
+		@brief Pool getter
+
+		@return pool to run the tasks on
+	*/
+	thread_pool& workers() const {
+		return pool != nullptr ? *pool : thread_pool::shared();
+	}
+};
+
+/**
+  @brief Tag value selecting the parallel overloads with the default settings
+*/
+constexpr parallel_t parallel{};
+
+
+/**
+  @brief Parallel loop
+
+  Splits the items [0, n) into chunks of per_chunk items and calls body(first, last)
+  once for each chunk, on the workers of policy and on the calling thread, which
+  returns when all the chunks are done. With a single chunk or no worker, body is
+  called once on the whole range in the calling thread. If body throws, the chunks
+  not yet started are skipped and the first exception is rethrown to the caller.
+
+  @param n number of items
+  @param per_chunk number of items of each chunk
+  @param policy parallel settings
+  @param body functor called on each chunk
+
+  @pre per_chunk > 0
+  @pre body : size_t x size_t -> void
+*/
+template <typename F>
+void parallel_for(std::size_t n, std::size_t per_chunk, const parallel_t& policy, const F& body) {
+
+	if(n == 0)
+		return;
+
+	thread_pool& pool = policy.workers();
+	const std::size_t chunks = (n + per_chunk - 1) / per_chunk;
+
+	if(chunks <= 1 || pool.size() == 0) {
+		body(0, n);
+		return;
+	}
+
+	struct state {
+		std::atomic<std::size_t> next{0};
+		std::size_t done = 0;
+		bool failed = false;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	std::shared_ptr<state> shared = std::make_shared<state>();
+
+	// Each runner claims chunks until none is left; body is only used while
+	// unclaimed chunks exist, i.e. before the caller can return.
+	auto runner = [shared, chunks, per_chunk, n, &body] () {
+		std::size_t c;
+
+		while((c = shared->next.fetch_add(1)) < chunks) {
+			std::exception_ptr error;
+
+			bool skip;
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				skip = shared->failed;
+			}
+
+			if(!skip) {
+				try {
+					body(c * per_chunk, std::min(n, (c + 1) * per_chunk));
+				}
+				catch(...) {
+					error = std::current_exception();
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			if(error && !shared->failed) {
+				shared->failed = true;
+				shared->error = error;
+			}
+			if(++shared->done == chunks)
+				shared->finished.notify_all();
+		}
+	};
+
+	const std::size_t helpers = std::min(pool.size(), chunks - 1);
+	for(std::size_t i = 0; i < helpers; ++i)
+		pool.submit(runner);
+
+	runner();
+
+	std::unique_lock<std::mutex> lock(shared->mutex);
+	shared->finished.wait(lock, [&] () {return shared->done == chunks;});
+
+	if(shared->error)
+		std::rethrow_exception(shared->error);
+}
+
+/**
+  @brief Optionally parallel loop
+
+  Same as parallel_for(n, per_chunk, *policy, body) when policy is not null; otherwise
+  body is called once on the whole range in the calling thread. Used by the algorithms
+  sharing one implementation between their sequential and parallel overloads.
+
+  @param n number of items
+  @param per_chunk number of items of each chunk, 0 is taken as 1
+  @param policy parallel settings, nullptr to run sequentially
+  @param body functor called on each chunk
+
+  @pre body : size_t x size_t -> void
+*/
+template <typename F>
+void parallel_for(std::size_t n, std::size_t per_chunk, const parallel_t* policy, const F& body) {
+
+	if(policy == nullptr) {
+		if(n > 0)
+			body(0, n);
+		return;
+	}
+
+	parallel_for(n, per_chunk > 0 ? per_chunk : 1, *policy, body);
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef MATRIX_PERMUTE
+#define MATRIX_PERMUTE
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <algorithm> // std::copy, std::min
+#include <array>
+#include "matrix_fwd.h"
+#include "matrix_simd.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_permute.h
+  @brief Axis permutation of matrix_3d and transposition of matrix_2d declaration and implementation.
+
+  permute_axes() reorders the axes of a matrix_3d, for example from ZYX to XZY to
+  process the volume along X, and transpose() swaps the rows and the columns of a
+  matrix_2d. Every permutation is either a copy of whole rows, when X stays the
+  innermost axis, or a set of 2D transpositions. These are split recursively into
+  halves until the blocks fit in the cache (cache-oblivious tiling), and the blocks
+  are transposed by transpose_cells(), in the vector registers for the cells of 4
+  and 8 bytes. Both functions also have a parallel overload taking a parallel_t.
+*/
+
+
+namespace permute_detail {
+
+	/**
+		@brief Side, in cells, under which the recursive transposition stops splitting
+	*/
+	constexpr std::size_t leaf = 32;
+
+	/**
+		@brief Number of source rows of the bands given to each task
+	*/
+	constexpr std::size_t band = 64;
+
+	/**
+		@brief Cache-oblivious transposition
+
+		Writes src[i * ss + j] into dst[j * ds + i] for i < rows and j < cols, halving
+		the longer side until both fit in a leaf. The halves are kept multiple of 8, so
+		that the leaves are made of whole tiles of transpose_cells().
+	*/
+	template <typename T>
+	void transpose(const T* src, std::size_t ss, T* dst, std::size_t ds, std::size_t rows, std::size_t cols) {
+
+		if(rows <= leaf && cols <= leaf) {
+			transpose_cells(src, ss, dst, ds, rows, cols);
+			return;
+		}
+
+		if(rows >= cols) {
+			const std::size_t half = (rows / 2 + 7) / 8 * 8;
+			transpose(src, ss, dst, ds, half, cols);
+			transpose(src + half * ss, ss, dst + half, ds, rows - half, cols);
+		}
+		else {
+			const std::size_t half = (cols / 2 + 7) / 8 * 8;
+			transpose(src, ss, dst, ds, rows, half);
+			transpose(src + half, ss, dst + half * ds, ds, rows, cols - half);
+		}
+	}
+
+	/**
+		@brief Transposition of count blocks of rows x cols cells
+
+		The t-th block starts at src + t * src_step and goes to dst + t * dst_step.
+		The blocks are cut into bands of source rows, which are the tasks given to
+		the workers.
+	*/
+	template <typename T>
+	void transpose_blocks(const T* src, std::size_t src_step, std::size_t ss, T* dst, std::size_t dst_step,
+						  std::size_t ds, std::size_t count, std::size_t rows, std::size_t cols,
+						  const parallel_t* policy) {
+
+		if(rows == 0 || cols == 0)
+			return;
+
+		const std::size_t bands = (rows + band - 1) / band;
+		const std::size_t per_chunk = policy == nullptr ? count * bands : policy->grain / (band * cols);
+
+		parallel_for(count * bands, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+			for(std::size_t item = first; item < last; ++item) {
+				const std::size_t t = item / bands;
+				const std::size_t i = item % bands * band;
+				transpose(src + t * src_step + i * ss, ss, dst + t * dst_step + i, ds, std::min(band, rows - i), cols);
+			}
+		});
+	}
+
+	template <typename T, typename A>
+	matrix_3d<T, A> permute(const matrix_3d<T, A>& source, const std::array<unsigned int, 3>& order,
+							const parallel_t* policy) {
+
+		assert(order[0] < 3 && order[1] < 3 && order[2] < 3);
+		assert(order[0] != order[1] && order[0] != order[2] && order[1] != order[2]);
+
+		const std::size_t n_src[3] = {source.plans(), source.rows(), source.columns()};
+		const std::size_t s_src[3] = {n_src[1] * source.pitch(), source.pitch(), 1};
+
+		matrix_3d<T, A> result(n_src[order[0]], n_src[order[1]], n_src[order[2]], source.get_allocator());
+
+		if(result.size() == 0)
+			return result;
+
+		const std::size_t n_dst[3] = {result.plans(), result.rows(), result.columns()};
+		const std::size_t s_dst[3] = {n_dst[1] * result.pitch(), result.pitch(), 1};
+		const T* src = source.data();
+		T* dst = result.data();
+
+		if(order[2] == 2) {
+			// X stays innermost: every row of the result is a row of the source.
+			const std::size_t rows = n_dst[0] * n_dst[1];
+			const std::size_t per_chunk = policy == nullptr ? rows : policy->grain / n_dst[2];
+
+			parallel_for(rows, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t r = first; r < last; ++r) {
+					const std::size_t i0 = r / n_dst[1], i1 = r % n_dst[1];
+					const T* row = src + i0 * s_src[order[0]] + i1 * s_src[order[1]];
+					std::copy(row, row + n_dst[2], dst + i0 * s_dst[0] + i1 * s_dst[1]);
+				}
+			});
+
+			return result;
+		}
+
+		// X of the source becomes the axis k of the result, and the innermost axis
+		// of the result comes from the axis a of the source: for each index along
+		// the remaining axis (m in the result, b in the source), the a x X blocks are
+		// transposed.
+		const std::size_t k = order[0] == 2 ? 0 : 1;
+		const std::size_t m = 1 - k;
+		const std::size_t a = order[2];
+		const std::size_t b = order[m];
+
+		transpose_blocks(src, s_src[b], s_src[a], dst, s_dst[m], s_dst[k], n_src[b], n_src[a], n_src[2], policy);
+
+		return result;
+	}
+
+	template <typename T, typename A>
+	matrix_2d<T, A> transpose(const matrix_2d<T, A>& source, const parallel_t* policy) {
+
+		matrix_2d<T, A> result(source.columns(), source.rows(), source.get_allocator());
+
+		transpose_blocks(source.data(), 0, source.pitch(), result.data(), 0, result.pitch(), 1,
+						 source.rows(), source.columns(), policy);
+
+		return result;
+	}
+}
+
+
+/**
+  @brief Axis permutation function
+
+  Returns a new matrix_3d holding the cells of source with its axes reordered: the
+  axis i of the result is the axis order[i] of source, where 0 is Z, 1 is Y and 2 is X.
+  For example order = {2, 0, 1} turns a ZYX volume into an XZY one:
+
+	result(x, z, y) = source(z, y, x)
+
+  @param source source matrix_3d
+  @param order source axis of each axis of the result
+  @param policy parallel settings
+
+  @pre order is a permutation of {0, 1, 2}
+
+  @return the permuted matrix_3d
+*/
+template <typename T, typename A>
+matrix_3d<T, A> permute_axes(const matrix_3d<T, A>& source, const std::array<unsigned int, 3>& order) {
+	return permute_detail::permute(source, order, nullptr);
+}
+
+template <typename T, typename A>
+matrix_3d<T, A> permute_axes(const matrix_3d<T, A>& source, const std::array<unsigned int, 3>& order,
+							 const parallel_t& policy) {
+	return permute_detail::permute(source, order, &policy);
+}
+
+/**
+  @brief Transposition function
+
+  @param source source matrix_2d
+  @param policy parallel settings
+
+  @return a new matrix_2d such that result(x, y) = source(y, x)
+*/
+template <typename T, typename A>
+matrix_2d<T, A> transpose(const matrix_2d<T, A>& source) {
+	return permute_detail::transpose(source, nullptr);
+}
+
+template <typename T, typename A>
+matrix_2d<T, A> transpose(const matrix_2d<T, A>& source, const parallel_t& policy) {
+	return permute_detail::transpose(source, &policy);
+}
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef MATRIX_PIPELINE
+#define MATRIX_PIPELINE
+
+#include <cstddef> // std::size_t
+#include <algorithm> // std::max
+#include <type_traits>
+#include <utility> // std::declval
+#include "matrix_fwd.h"
+#include "matrix_expr.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_pipeline.h
+  @brief Fused transformation pipelines on matrix_2d and matrix_3d declaration and implementation.
+
+  A pipeline chains functors on the cells of a matrix without materializing the
+  intermediate results:
+
+	pipeline(src) | map_cells(clamp) | map_cells(rescale) | cast<uint8_t>() | into(dst);
+
+  Every stage is a lazy expression (see matrix_expr.h), so the whole chain is computed
+  in a single pass, each cell going through all the functors before being stored, and
+  the only memory touched besides src is dst. A pipeline can also initialize a matrix
+  or be combined with the arithmetic operators. into(dst, parallel) splits the plans
+  among the workers of a thread_pool.
+*/
+
+
+/**
+  @brief Expression node applying a stored functor of type F to each cell of an expression
+*/
+template <typename E, typename F>
+class map_expr : public matrix_expr<map_expr<E, F>> {
+
+	private:
+
+		E _arg;
+		F _func;
+
+	public:
+
+		typedef typename std::decay<decltype(std::declval<const F&>()(
+										std::declval<typename E::value_type>()))>::type value_type;
+
+		static constexpr bool scalar = E::scalar;
+
+		struct cursor {
+			decltype(std::declval<const E&>().row(0)) arg;
+			const F& func;
+
+			value_type operator[](std::size_t j) const {
+				return func(arg[j]);
+			}
+		};
+
+		map_expr(const E& arg, const F& func) : _arg(arg), _func(func) {}
+
+		std::size_t plans() const {return _arg.plans();}
+		std::size_t rows() const {return _arg.rows();}
+		std::size_t columns() const {return _arg.columns();}
+
+		bool packed() const {return _arg.packed();}
+
+		cursor row(std::size_t r) const {
+			return cursor{_arg.row(r), _func};
+		}
+};
+
+
+/**
+  @brief Pipeline stage applying a functor to each cell
+*/
+template <typename F>
+struct map_stage {
+	F func;
+};
+
+/**
+  @brief Functor converting a cell to Q
+*/
+template <typename Q>
+struct cast_op {
+	template <typename U>
+	Q operator()(U v) const {return static_cast<Q>(v);}
+};
+
+/**
+  @brief Pipeline stage storing the cells into a matrix
+
+  With a policy, the plans are computed in parallel.
+*/
+template <typename M>
+struct into_stage {
+	M& dest;
+	parallel_t policy;
+	bool concurrent;
+};
+
+
+/**
+  @brief Pipeline source
+
+  @param source matrix or expression the pipeline reads
+
+  @return expression node reading source
+*/
+template <typename X>
+typename std::enable_if<expr_traits<X>::value, typename expr_traits<X>::type>::type pipeline(const X& source) {
+	return expr_traits<X>::wrap(source);
+}
+
+/**
+  @brief Mapping stage
+
+  @param func functor to apply to each cell
+
+  @pre func : value type of the previous stage -> any type, callable concurrently
+  from several threads if the pipeline runs in parallel
+*/
+template <typename F>
+map_stage<F> map_cells(F func) {
+	return map_stage<F>{func};
+}
+
+/**
+  @brief Conversion stage
+
+  Converts each cell to Q with static_cast.
+*/
+template <typename Q>
+map_stage<cast_op<Q>> cast() {
+	return map_stage<cast_op<Q>>{cast_op<Q>()};
+}
+
+/**
+  @brief Storing stage
+
+  Ends a pipeline by computing its cells into dest. If the shapes match, the cells
+  of dest are overwritten in place and nothing is allocated; otherwise dest is
+  rebuilt with the shape of the pipeline.
+
+  @param dest matrix_2d or matrix_3d receiving the cells
+*/
+template <typename M>
+into_stage<M> into(M& dest) {
+	return into_stage<M>{dest, parallel_t(), false};
+}
+
+/**
+  @brief Parallel storing stage
+
+  Same as into(dest), with the plans split among the workers of policy; pipelines
+  of at most policy.grain cells are computed in the calling thread.
+
+  @param dest matrix_2d or matrix_3d receiving the cells
+  @param policy parallel settings
+*/
+template <typename M>
+into_stage<M> into(M& dest, const parallel_t& policy) {
+	return into_stage<M>{dest, policy, true};
+}
+
+
+template <typename X, typename F>
+typename std::enable_if<expr_traits<X>::value, map_expr<typename expr_traits<X>::type, F>>::type
+operator|(const X& source, const map_stage<F>& stage) {
+	return map_expr<typename expr_traits<X>::type, F>(expr_traits<X>::wrap(source), stage.func);
+}
+
+
+/**
+  @brief Parallel evaluation function
+
+  Computes all the cells of expr into plans plans of rows rows of columns cells, each
+  row pitch cells apart, starting at data. Whole plans are given to the workers of
+  policy, at least policy.grain cells at a time (see evaluate_rows()).
+
+  @pre the destination has the shape of expr
+*/
+template <typename T, typename E>
+void evaluate_expression(const E& expr, T* data, std::size_t pitch, std::size_t plans, std::size_t rows,
+						 std::size_t columns, const parallel_t& policy) {
+
+	const std::size_t plan_cells = rows * columns;
+
+	if(plan_cells == 0)
+		return;
+
+	parallel_for(plans, std::max<std::size_t>(1, policy.grain / plan_cells), policy,
+				 [&expr, data, pitch, rows, columns] (std::size_t first, std::size_t last) {
+		evaluate_rows(expr, data, pitch, first * rows, last * rows, columns);
+	});
+}
+
+template <typename E, typename T, typename A>
+matrix_3d<T, A>& operator|(const matrix_expr<E>& expr, const into_stage<matrix_3d<T, A>>& stage) {
+
+	const E& e = expr.self();
+	matrix_3d<T, A>& dest = stage.dest;
+
+	if(!stage.concurrent)
+		return dest = e;
+
+	if(e.plans() != dest.plans() || e.rows() != dest.rows() || e.columns() != dest.columns())
+		dest = matrix_3d<T, A>(e.plans(), e.rows(), e.columns(), dest.get_allocator());
+
+	evaluate_expression(e, dest.data(), dest.pitch(), dest.plans(), dest.rows(), dest.columns(), stage.policy);
+
+	return dest;
+}
+
+template <typename E, typename T, typename A>
+matrix_2d<T, A>& operator|(const matrix_expr<E>& expr, const into_stage<matrix_2d<T, A>>& stage) {
+
+	const E& e = expr.self();
+	matrix_2d<T, A>& dest = stage.dest;
+
+	assert(e.plans() <= 1);
+
+	if(!stage.concurrent)
+		return dest = e;
+
+	if(e.rows() != dest.rows() || e.columns() != dest.columns())
+		dest = matrix_2d<T, A>(e.rows(), e.columns(), dest.get_allocator());
+
+	evaluate_expression(e, dest.data(), dest.pitch(), 1, dest.rows(), dest.columns(), stage.policy);
+
+	return dest;
+}
+
+#endif
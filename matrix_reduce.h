@@ -0,0 +1,539 @@
+#ifndef MATRIX_REDUCE
+#define MATRIX_REDUCE
+
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cassert>
+#include <algorithm> // std::max, std::find
+#include <vector>
+#include <type_traits>
+#include "matrix_fwd.h"
+#include "matrix_simd.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_reduce.h
+  @brief Reductions of matrix_3d over all the cells or along axes declaration and implementation.
+
+  sum(), min(), max() and mean() reduce all the cells of a matrix_3d to a scalar, or
+  only the axes given as an axis_set, for example:
+
+	double total = sum(volume);
+	matrix_2d<float> mip = max(volume, axis_z);			// [y, x]
+	std::vector<double> profile = mean(volume, axis_y | axis_x);	// one value per plan
+
+  argmin() and argmax() return the coordinates of the first minimum or maximum. Every
+  function also has a parallel overload taking a parallel_t.
+
+  The results are bit-reproducible: the cells are split into blocks that only depend
+  on the shape of the matrix, each block is reduced by reduce_cells(), and the
+  partial results are combined in the order of the blocks. Floating point sums are
+  therefore identical whatever the number of threads, the grain and the simd_level.
+*/
+
+
+/**
+  @brief Set of axes of a matrix_3d, as a bit mask of Z = 1, Y = 2, X = 4
+
+  The axes are combined with operator|, for example axis_z | axis_y.
+*/
+template <unsigned int Mask>
+struct axis_set {
+	static_assert(Mask > 0 && Mask < 8, "axis_set: invalid mask");
+
+	static constexpr unsigned int mask = Mask;
+	static constexpr unsigned int count = (Mask & 1) + ((Mask >> 1) & 1) + ((Mask >> 2) & 1);
+};
+
+constexpr axis_set<1> axis_z{};
+constexpr axis_set<2> axis_y{};
+constexpr axis_set<4> axis_x{};
+
+template <unsigned int M1, unsigned int M2>
+constexpr axis_set<M1 | M2> operator|(axis_set<M1>, axis_set<M2>) {
+	return axis_set<M1 | M2>{};
+}
+
+
+/**
+  @brief Coordinates of a cell of a matrix_3d
+*/
+struct cell_index {
+	std::size_t z;
+	std::size_t y;
+	std::size_t x;
+
+	bool operator==(const cell_index& other) const {
+		return z == other.z && y == other.y && x == other.x;
+	}
+};
+
+
+/**
+  @brief Result of a reduction along the axes of Axes
+
+  A matrix_2d for a single axis, holding the two remaining axes in their order
+  ([y, x], [z, x] or [z, y]), a std::vector for two axes, the value itself for three.
+*/
+template <typename R, typename Axes>
+using reduce_result = typename std::conditional<Axes::count == 1, matrix_2d<R>,
+						  typename std::conditional<Axes::count == 2, std::vector<R>, R>::type>::type;
+
+
+/**
+  @brief Reduction operations
+
+  Each operation gives the type S of its partial results, the associative functor
+  combining them, and finish(), which turns the combination of count cells into the
+  result of type result_type.
+*/
+namespace reduce_ops {
+
+	/**
+		@brief Accumulator type of the sums of T
+
+		64 bit integers for the integral types, double for float, T otherwise.
+	*/
+	template <typename T>
+	using sum_type = typename std::conditional<std::is_integral<T>::value,
+						 typename std::conditional<std::is_signed<T>::value, std::int64_t, std::uint64_t>::type,
+						 typename std::conditional<std::is_same<T, float>::value, double, T>::type>::type;
+
+	template <typename T>
+	struct sum {
+		typedef sum_type<T> accumulator_type;
+		typedef accumulator_type result_type;
+
+		accumulator_type operator()(accumulator_type a, accumulator_type b) const {return a + b;}
+
+		static result_type finish(accumulator_type s, std::size_t) {return s;}
+	};
+
+	template <typename T>
+	struct mean : sum<T> {
+		typedef sum_type<T> accumulator_type;
+		typedef typename std::conditional<std::is_same<accumulator_type, long double>::value,
+										  long double, double>::type result_type;
+
+		static result_type finish(accumulator_type s, std::size_t count) {
+			return static_cast<result_type>(s) / static_cast<result_type>(count);
+		}
+	};
+
+	template <typename T>
+	struct min {
+		typedef T accumulator_type;
+		typedef T result_type;
+
+		T operator()(T a, T b) const {return b < a ? b : a;}
+
+		static result_type finish(T s, std::size_t) {return s;}
+	};
+
+	template <typename T>
+	struct max {
+		typedef T accumulator_type;
+		typedef T result_type;
+
+		T operator()(T a, T b) const {return a < b ? b : a;}
+
+		static result_type finish(T s, std::size_t) {return s;}
+	};
+}
+
+
+/**
+  @brief Implementation of the reductions
+
+  The cells are addressed as in matrix_3d: plans plans of rows rows of columns cells,
+  the rows of the whole matrix being pitch cells apart. A null policy runs in the
+  calling thread (see parallel_for()).
+*/
+namespace reduce_detail {
+
+	/**
+		@brief Number of cells of the blocks of the reductions over all the cells
+	*/
+	constexpr std::size_t block_cells = std::size_t(1) << 14;
+
+	/**
+		@brief Reduction of all the cells
+
+		@pre plans * rows * columns > 0
+
+		@return combination of all the cells
+	*/
+	template <typename Op, typename W>
+	typename Op::accumulator_type all(const W* data, std::size_t pitch, std::size_t plans, std::size_t rows,
+									  std::size_t columns, const parallel_t* policy) {
+
+		typedef typename Op::accumulator_type S;
+
+		const std::size_t total_rows = plans * rows;
+		const std::size_t block_rows = std::max<std::size_t>(1, block_cells / columns);
+		const std::size_t blocks = (total_rows + block_rows - 1) / block_rows;
+		const Op op;
+
+		std::vector<S> partial(blocks);
+
+		const std::size_t per_chunk = policy == nullptr ? blocks : policy->grain / (block_rows * columns);
+
+		parallel_for(blocks, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+			for(std::size_t b = first; b < last; ++b) {
+				const std::size_t r1 = b * block_rows;
+				const std::size_t r2 = std::min(total_rows, r1 + block_rows);
+
+				if(pitch == columns)
+					partial[b] = reduce_cells<S>(data + r1 * pitch, (r2 - r1) * columns, op);
+				else {
+					S acc = reduce_cells<S>(data + r1 * pitch, columns, op);
+					for(std::size_t r = r1 + 1; r < r2; ++r)
+						acc = op(acc, reduce_cells<S>(data + r * pitch, columns, op));
+					partial[b] = acc;
+				}
+			}
+		});
+
+		S acc = partial[0];
+		for(std::size_t b = 1; b < blocks; ++b)
+			acc = op(acc, partial[b]);
+
+		return acc;
+	}
+
+	/**
+		@brief Reduction along a single axis
+
+		Writes into out, without padding, the plans x rows x columns cells with the
+		dimension of axis lowered to 1.
+
+		@pre plans * rows * columns > 0
+	*/
+	template <typename Op, typename W>
+	void along(const W* data, std::size_t pitch, std::size_t plans, std::size_t rows, std::size_t columns,
+			   unsigned int axis, typename Op::accumulator_type* out, const parallel_t* policy) {
+
+		typedef typename Op::accumulator_type S;
+
+		const Op op;
+		const std::size_t grain = policy == nullptr ? 0 : policy->grain;
+
+		auto init = [columns] (S* acc, const W* cells) {
+			transform_cells(cells, acc, columns, [] (W v) {return static_cast<S>(v);});
+		};
+
+		auto merge = [columns, &op] (S* acc, const W* cells) {
+			generate_cells(acc, columns, [acc, cells, &op] (std::size_t j) {return op(acc[j], static_cast<S>(cells[j]));});
+		};
+
+		if(axis == 1) {
+			// out[y, x]: the plans are merged one at a time into each row of out
+			parallel_for(rows, grain / (plans * columns), policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t y = first; y < last; ++y) {
+					init(out + y * columns, data + y * pitch);
+					for(std::size_t z = 1; z < plans; ++z)
+						merge(out + y * columns, data + (z * rows + y) * pitch);
+				}
+			});
+		}
+		else if(axis == 2) {
+			// out[z, x]: the rows of each plan are merged one at a time
+			parallel_for(plans, grain / (rows * columns), policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t z = first; z < last; ++z) {
+					init(out + z * columns, data + z * rows * pitch);
+					for(std::size_t y = 1; y < rows; ++y)
+						merge(out + z * columns, data + (z * rows + y) * pitch);
+				}
+			});
+		}
+		else {
+			// out[z, y]: each row is reduced on its own
+			parallel_for(plans * rows, grain / columns, policy, [&] (std::size_t first, std::size_t last) {
+				for(std::size_t r = first; r < last; ++r)
+					out[r] = reduce_cells<S>(data + r * pitch, columns, op);
+			});
+		}
+	}
+
+	/**
+		@brief Reduction along the axes of Axes
+
+		The axes are reduced one at a time, Z first, each step reading the smaller
+		result of the previous one.
+	*/
+	template <typename Op, typename Axes, typename T, typename A>
+	reduce_result<typename Op::result_type, Axes> axes(const matrix_3d<T, A>& m, Axes, const parallel_t* policy) {
+
+		typedef typename Op::accumulator_type S;
+		typedef typename Op::result_type R;
+
+		if constexpr (Axes::count == 3) {
+			assert((m.size() > 0 || std::is_same<Op, reduce_ops::sum<T>>::value));
+
+			if(m.size() == 0)
+				return R();
+
+			return Op::finish(all<Op>(m.data(), m.pitch(), m.plans(), m.rows(), m.columns(), policy), m.size());
+		}
+		else {
+			std::size_t shape[3] = {m.plans(), m.rows(), m.columns()};
+			std::size_t count = 1;
+			std::vector<S> buffer, next;
+
+			if(m.size() > 0) {
+				bool first = true;
+
+				for(unsigned int axis = 0; axis < 3; ++axis) {
+					if(!(Axes::mask & (1u << axis)))
+						continue;
+
+					next.resize(shape[0] * shape[1] * shape[2] / shape[axis]);
+
+					if(first)
+						along<Op>(m.data(), m.pitch(), shape[0], shape[1], shape[2], 1u << axis, next.data(), policy);
+					else
+						along<Op>(buffer.data(), shape[2], shape[0], shape[1], shape[2], 1u << axis, next.data(), policy);
+
+					count *= shape[axis];
+					shape[axis] = 1;
+					buffer.swap(next);
+					first = false;
+				}
+			}
+			else
+				for(unsigned int axis = 0; axis < 3; ++axis)
+					if(Axes::mask & (1u << axis))
+						shape[axis] = 0;
+
+			if constexpr (Axes::count == 1) {
+				const std::size_t y = Axes::mask == 1 ? shape[1] : shape[0];
+				const std::size_t x = Axes::mask == 4 ? shape[1] : shape[2];
+
+				matrix_2d<R> result(y, x);
+				for(std::size_t i = 0; i < y; ++i)
+					for(std::size_t j = 0; j < x; ++j)
+						result(i, j) = Op::finish(buffer[i * x + j], count);
+
+				return result;
+			}
+			else {
+				std::vector<R> result(buffer.size());
+				for(std::size_t i = 0; i < buffer.size(); ++i)
+					result[i] = Op::finish(buffer[i], count);
+
+				return result;
+			}
+		}
+	}
+
+	/**
+		@brief Search of the first extreme cell
+
+		@pre m.size() > 0
+	*/
+	template <typename Op, typename T, typename A>
+	cell_index extreme(const matrix_3d<T, A>& m, const parallel_t* policy) {
+
+		struct found {
+			T value;
+			std::size_t row;
+			std::size_t column;
+		};
+
+		assert(m.size() > 0);
+
+		const Op op;
+		const std::size_t columns = m.columns();
+		const std::size_t pitch = m.pitch();
+		const std::size_t total_rows = std::size_t(m.plans()) * m.rows();
+		const std::size_t block_rows = std::max<std::size_t>(1, block_cells / columns);
+		const std::size_t blocks = (total_rows + block_rows - 1) / block_rows;
+		const T* data = m.data();
+
+		std::vector<found> partial(blocks);
+
+		const std::size_t per_chunk = policy == nullptr ? blocks : policy->grain / (block_rows * columns);
+
+		// Each block finds its extreme value with the vectorized kernel, then the
+		// first row holding it.
+		parallel_for(blocks, per_chunk, policy, [&] (std::size_t first, std::size_t last) {
+			for(std::size_t b = first; b < last; ++b) {
+				const std::size_t r1 = b * block_rows;
+				const std::size_t r2 = std::min(total_rows, r1 + block_rows);
+
+				T best = reduce_cells<T>(data + r1 * pitch, columns, op);
+				for(std::size_t r = r1 + 1; r < r2; ++r)
+					best = op(best, reduce_cells<T>(data + r * pitch, columns, op));
+
+				partial[b] = found{best, r1, 0};
+				for(std::size_t r = r1; r < r2; ++r) {
+					const T* cell = std::find(data + r * pitch, data + r * pitch + columns, best);
+					if(cell != data + r * pitch + columns) {
+						partial[b] = found{best, r, static_cast<std::size_t>(cell - (data + r * pitch))};
+						break;
+					}
+				}
+			}
+		});
+
+		found best = partial[0];
+		for(std::size_t b = 1; b < blocks; ++b)
+			if(op(best.value, partial[b].value) != best.value)
+				best = partial[b];
+
+		return cell_index{best.row / m.rows(), best.row % m.rows(), best.column};
+	}
+}
+
+
+/**
+  @brief Sum of the cells
+
+  Sums all the cells of m, or only along the axes of Axes. The sums are accumulated
+  in int64_t or uint64_t for the integral types and in double for float.
+
+  @param m matrix_3d to reduce
+  @param axes axes to sum along
+  @param policy parallel settings
+*/
+template <typename T, typename A>
+reduce_ops::sum_type<T> sum(const matrix_3d<T, A>& m) {
+	return reduce_detail::axes<reduce_ops::sum<T>>(m, axis_set<7>(), nullptr);
+}
+
+template <typename T, typename A>
+reduce_ops::sum_type<T> sum(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::sum<T>>(m, axis_set<7>(), &policy);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<reduce_ops::sum_type<T>, axis_set<M>> sum(const matrix_3d<T, A>& m, axis_set<M> axes) {
+	return reduce_detail::axes<reduce_ops::sum<T>>(m, axes, nullptr);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<reduce_ops::sum_type<T>, axis_set<M>> sum(const matrix_3d<T, A>& m, axis_set<M> axes,
+														 const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::sum<T>>(m, axes, &policy);
+}
+
+/**
+  @brief Mean of the cells
+
+  Averages all the cells of m, or only along the axes of Axes, as double (long double
+  for long double cells).
+
+  @pre m.size() > 0 when reducing all the cells
+*/
+template <typename T, typename A>
+typename reduce_ops::mean<T>::result_type mean(const matrix_3d<T, A>& m) {
+	return reduce_detail::axes<reduce_ops::mean<T>>(m, axis_set<7>(), nullptr);
+}
+
+template <typename T, typename A>
+typename reduce_ops::mean<T>::result_type mean(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::mean<T>>(m, axis_set<7>(), &policy);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<typename reduce_ops::mean<T>::result_type, axis_set<M>> mean(const matrix_3d<T, A>& m, axis_set<M> axes) {
+	return reduce_detail::axes<reduce_ops::mean<T>>(m, axes, nullptr);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<typename reduce_ops::mean<T>::result_type, axis_set<M>> mean(const matrix_3d<T, A>& m, axis_set<M> axes,
+																	   const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::mean<T>>(m, axes, &policy);
+}
+
+/**
+  @brief Minimum of the cells
+
+  Smallest of all the cells of m, or only along the axes of Axes, according to
+  operator<.
+
+  @pre m.size() > 0 when reducing all the cells
+*/
+template <typename T, typename A>
+T min(const matrix_3d<T, A>& m) {
+	return reduce_detail::axes<reduce_ops::min<T>>(m, axis_set<7>(), nullptr);
+}
+
+template <typename T, typename A>
+T min(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::min<T>>(m, axis_set<7>(), &policy);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<T, axis_set<M>> min(const matrix_3d<T, A>& m, axis_set<M> axes) {
+	return reduce_detail::axes<reduce_ops::min<T>>(m, axes, nullptr);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<T, axis_set<M>> min(const matrix_3d<T, A>& m, axis_set<M> axes, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::min<T>>(m, axes, &policy);
+}
+
+/**
+  @brief Maximum of the cells
+
+  Largest of all the cells of m, or only along the axes of Axes, according to
+  operator<.
+
+  @pre m.size() > 0 when reducing all the cells
+*/
+template <typename T, typename A>
+T max(const matrix_3d<T, A>& m) {
+	return reduce_detail::axes<reduce_ops::max<T>>(m, axis_set<7>(), nullptr);
+}
+
+template <typename T, typename A>
+T max(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::max<T>>(m, axis_set<7>(), &policy);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<T, axis_set<M>> max(const matrix_3d<T, A>& m, axis_set<M> axes) {
+	return reduce_detail::axes<reduce_ops::max<T>>(m, axes, nullptr);
+}
+
+template <typename T, typename A, unsigned int M>
+reduce_result<T, axis_set<M>> max(const matrix_3d<T, A>& m, axis_set<M> axes, const parallel_t& policy) {
+	return reduce_detail::axes<reduce_ops::max<T>>(m, axes, &policy);
+}
+
+/**
+  @brief Position of the minimum
+
+  @pre m.size() > 0
+
+  @return coordinates of the first minimum cell, in the order of the iterators
+*/
+template <typename T, typename A>
+cell_index argmin(const matrix_3d<T, A>& m) {
+	return reduce_detail::extreme<reduce_ops::min<T>>(m, nullptr);
+}
+
+template <typename T, typename A>
+cell_index argmin(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::extreme<reduce_ops::min<T>>(m, &policy);
+}
+
+/**
+  @brief Position of the maximum
+
+  @pre m.size() > 0
+
+  @return coordinates of the first maximum cell, in the order of the iterators
+*/
+template <typename T, typename A>
+cell_index argmax(const matrix_3d<T, A>& m) {
+	return reduce_detail::extreme<reduce_ops::max<T>>(m, nullptr);
+}
+
+template <typename T, typename A>
+cell_index argmax(const matrix_3d<T, A>& m, const parallel_t& policy) {
+	return reduce_detail::extreme<reduce_ops::max<T>>(m, &policy);
+}
+
+#endif
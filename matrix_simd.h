@@ -0,0 +1,676 @@
+#ifndef MATRIX_SIMD
+#define MATRIX_SIMD
+
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <atomic>
+#include <type_traits>
+
+/**
+  @file matrix_simd.h
+  @brief Runtime SIMD dispatch and vectorized cell kernels declaration and implementation.
+*/
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_SIMD_X86
+#define MATRIX_SIMD_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#endif
+
+
+/**
+  @brief Instruction set extensions the kernels can be compiled for
+
+  avx2 stands for AVX2 and FMA, avx512 for AVX-512 F, BW and VL on top of them.
+*/
+enum class simd_level {
+	scalar = 0,
+	sse = 1,
+	avx2 = 2,
+	avx512 = 3
+};
+
+
+/**
+  @brief Detection function
+
+  Returns the widest instruction set extension supported by the running CPU. The
+  CPU is queried once, the first time the function is called.
+
+  @return detected simd_level
+*/
+inline simd_level detected_simd_level() {
+
+	static const simd_level level = [] () -> simd_level {
+		#ifdef MATRIX_SIMD_X86
+		__builtin_cpu_init();
+		// Each level requires every extension its kernels are compiled for.
+		const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		if(avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		   __builtin_cpu_supports("avx512vl"))
+			return simd_level::avx512;
+		if(avx2)
+			return simd_level::avx2;
+		if(__builtin_cpu_supports("sse4.2"))
+			return simd_level::sse;
+		#endif
+		return simd_level::scalar;
+	}();
+
+	return level;
+}
+
+/**
+  @brief Active level storage
+
+  @return reference to the level used by the kernels, the detected one by default
+*/
+inline std::atomic<simd_level>& simd_level_storage() {
+	static std::atomic<simd_level> level(detected_simd_level());
+	return level;
+}
+
+/**
+  @brief Active level getter
+
+  @return simd_level used by the kernels
+*/
+inline simd_level active_simd_level() {
+	return simd_level_storage().load(std::memory_order_relaxed);
+}
+
+/**
+  @brief Active level setter
+
+  Restricts the kernels to the given instruction set extension, for example to
+  compare the variants or to reproduce results of older CPUs. Levels wider than the
+  detected one are lowered to the detected one.
+
+  @param level simd_level to use
+
+  @return simd_level actually used from now on
+*/
+inline simd_level set_simd_level(simd_level level) {
+
+	if(level > detected_simd_level())
+		level = detected_simd_level();
+
+	simd_level_storage().store(level, std::memory_order_relaxed);
+
+	return level;
+}
+
+
+/**
+  @brief Cell types with a vectorized fast path
+
+  True for the arithmetic types the kernels are dispatched for: float, double,
+  int32_t, uint8_t and uint16_t.
+*/
+template <typename T>
+struct is_simd_cell : std::integral_constant<bool,
+	std::is_same<T, float>::value || std::is_same<T, double>::value ||
+	std::is_same<T, std::int32_t>::value || std::is_same<T, std::uint8_t>::value ||
+	std::is_same<T, std::uint16_t>::value> {};
+
+
+/**
+  @brief Kernels applying a functor to a run of contiguous cells
+
+  The transform kernels map each source cell to a destination cell, the generate
+  kernels compute each destination cell from its index. The cells are processed in
+  blocks as wide as the vector registers of each instruction set extension (16 bytes
+  for SSE, 32 for AVX2, 64 for AVX-512, measured on the wider of W and Q), so that
+  the compiler maps every block to whole vector instructions even at -O2. The functor
+  is inlined into each variant, and the remaining cells are processed one at a time.
+  The sources and the destinations of the transform kernels must not overlap.
+*/
+namespace simd_kernels {
+
+	#if defined(__GNUC__) || defined(__clang__)
+	#define MATRIX_SIMD_INLINE inline __attribute__((always_inline))
+	#else
+	#define MATRIX_SIMD_INLINE inline
+	#endif
+
+	template <std::size_t Bytes, typename Q, typename W, typename F>
+	MATRIX_SIMD_INLINE void transform_blocks(const W* __restrict src, Q* __restrict dest, 
+											 std::size_t n, const F& func) {
+
+		constexpr std::size_t lanes = Bytes / (sizeof(W) > sizeof(Q) ? sizeof(W) : sizeof(Q));
+
+		std::size_t i = 0;
+
+		for(; i + lanes <= n; i += lanes)
+			for(std::size_t l = 0; l < lanes; ++l)
+				dest[i + l] = func(src[i + l]);
+
+		for(; i < n; ++i)
+			dest[i] = func(src[i]);
+	}
+
+	template <std::size_t Bytes, typename Q, typename G>
+	MATRIX_SIMD_INLINE void generate_blocks(Q* dest, std::size_t n, const G& gen) {
+
+		constexpr std::size_t lanes = Bytes / sizeof(Q);
+
+		std::size_t i = 0;
+
+		// Each block is computed before being stored, so that gen may read the
+		// destination cells it is about to overwrite.
+		for(; i + lanes <= n; i += lanes) {
+			Q block[lanes];
+			for(std::size_t l = 0; l < lanes; ++l)
+				block[l] = gen(i + l);
+			for(std::size_t l = 0; l < lanes; ++l)
+				dest[i + l] = block[l];
+		}
+
+		for(; i < n; ++i)
+			dest[i] = gen(i);
+	}
+
+	/**
+		@brief Number of partial results kept by the reduction kernels
+	*/
+	constexpr std::size_t reduce_lanes = 16;
+
+	template <typename S, typename W, typename F>
+	MATRIX_SIMD_INLINE S reduce_blocks(const W* src, std::size_t n, const F& combine) {
+
+		S acc[reduce_lanes];
+		std::size_t used = n < reduce_lanes ? n : reduce_lanes;
+
+		for(std::size_t l = 0; l < used; ++l)
+			acc[l] = static_cast<S>(src[l]);
+
+		std::size_t i = used;
+
+		for(; i + reduce_lanes <= n; i += reduce_lanes)
+			for(std::size_t l = 0; l < reduce_lanes; ++l)
+				acc[l] = combine(acc[l], static_cast<S>(src[i + l]));
+
+		for(std::size_t l = 0; i < n; ++i, ++l)
+			acc[l] = combine(acc[l], static_cast<S>(src[i]));
+
+		// The lanes are always combined in the same tree, whatever the instruction set.
+		for(std::size_t width = reduce_lanes / 2; width > 0; width /= 2)
+			for(std::size_t l = 0; l < width && l + width < used; ++l)
+				acc[l] = combine(acc[l], acc[l + width]);
+
+		return acc[0];
+	}
+
+	/**
+		@brief Transposition of a block of cells, one cell at a time
+
+		Writes src[i * src_stride + j] into dst[j * dst_stride + i] for i < rows and
+		j < cols, starting from the row first.
+	*/
+	template <typename T>
+	MATRIX_SIMD_INLINE void transpose_rest(const T* src, std::size_t src_stride, T* dst, std::size_t dst_stride,
+										   std::size_t first, std::size_t rows, std::size_t cols) {
+		for(std::size_t i = first; i < rows; ++i)
+			for(std::size_t j = 0; j < cols; ++j)
+				dst[j * dst_stride + i] = src[i * src_stride + j];
+	}
+
+	/**
+		@brief Transposition of a block of cells by square tiles of B x B cells
+
+		Each full tile goes through tile(), the cells left on the right and at the
+		bottom are moved one at a time.
+	*/
+	template <std::size_t B, typename T, typename K>
+	MATRIX_SIMD_INLINE void transpose_tiles(const T* src, std::size_t src_stride, T* dst, std::size_t dst_stride,
+											std::size_t rows, std::size_t cols, const K& tile) {
+		std::size_t i = 0;
+
+		for(; i + B <= rows; i += B) {
+			std::size_t j = 0;
+			for(; j + B <= cols; j += B)
+				tile(src + i * src_stride + j, dst + j * dst_stride + i);
+			for(; j < cols; ++j)
+				for(std::size_t l = 0; l < B; ++l)
+					dst[j * dst_stride + i + l] = src[(i + l) * src_stride + j];
+		}
+
+		transpose_rest(src, src_stride, dst, dst_stride, i, rows, cols);
+	}
+
+	template <typename Q, typename W, typename F>
+	void transform_scalar(const W* __restrict src, Q* __restrict dest, std::size_t n, const F& func) {
+		for(std::size_t i = 0; i < n; ++i)
+			dest[i] = func(src[i]);
+	}
+
+	template <typename Q, typename G>
+	void generate_scalar(Q* dest, std::size_t n, const G& gen) {
+		for(std::size_t i = 0; i < n; ++i)
+			dest[i] = gen(i);
+	}
+
+	template <typename S, typename W, typename F>
+	S reduce_scalar(const W* src, std::size_t n, const F& combine) {
+		return reduce_blocks<S>(src, n, combine);
+	}
+
+	#ifdef MATRIX_SIMD_X86
+
+	template <typename Q, typename W, typename F>
+	MATRIX_SIMD_TARGET("sse4.2")
+	void transform_sse(const W* __restrict src, Q* __restrict dest, std::size_t n, const F& func) {
+		transform_blocks<16>(src, dest, n, func);
+	}
+
+	template <typename Q, typename W, typename F>
+	MATRIX_SIMD_TARGET("avx2,fma")
+	void transform_avx2(const W* __restrict src, Q* __restrict dest, std::size_t n, const F& func) {
+		transform_blocks<32>(src, dest, n, func);
+	}
+
+	template <typename Q, typename W, typename F>
+	MATRIX_SIMD_TARGET("avx512f,avx512bw,avx512vl,avx2,fma")
+	void transform_avx512(const W* __restrict src, Q* __restrict dest, std::size_t n, const F& func) {
+		transform_blocks<64>(src, dest, n, func);
+	}
+
+	template <typename Q, typename G>
+	MATRIX_SIMD_TARGET("sse4.2")
+	void generate_sse(Q* dest, std::size_t n, const G& gen) {
+		generate_blocks<16>(dest, n, gen);
+	}
+
+	template <typename Q, typename G>
+	MATRIX_SIMD_TARGET("avx2,fma")
+	void generate_avx2(Q* dest, std::size_t n, const G& gen) {
+		generate_blocks<32>(dest, n, gen);
+	}
+
+	template <typename Q, typename G>
+	MATRIX_SIMD_TARGET("avx512f,avx512bw,avx512vl,avx2,fma")
+	void generate_avx512(Q* dest, std::size_t n, const G& gen) {
+		generate_blocks<64>(dest, n, gen);
+	}
+
+	/**
+		@brief In-register transpositions of a single tile
+
+		Each functor moves one square tile from s, whose rows are ss cells apart, to
+		d, whose rows are ds cells apart.
+	*/
+	struct tile_4x4_sse {
+		std::size_t ss, ds;
+
+		MATRIX_SIMD_TARGET("sse4.2")
+		void operator()(const void* s, void* d) const {
+			const float* f = static_cast<const float*>(s);
+			float* g = static_cast<float*>(d);
+			__m128 r0 = _mm_loadu_ps(f), r1 = _mm_loadu_ps(f + ss);
+			__m128 r2 = _mm_loadu_ps(f + 2 * ss), r3 = _mm_loadu_ps(f + 3 * ss);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(g, r0);
+			_mm_storeu_ps(g + ds, r1);
+			_mm_storeu_ps(g + 2 * ds, r2);
+			_mm_storeu_ps(g + 3 * ds, r3);
+		}
+	};
+
+	struct tile_2x2_sse {
+		std::size_t ss, ds;
+
+		MATRIX_SIMD_TARGET("sse4.2")
+		void operator()(const void* s, void* d) const {
+			const double* f = static_cast<const double*>(s);
+			double* g = static_cast<double*>(d);
+			const __m128d r0 = _mm_loadu_pd(f), r1 = _mm_loadu_pd(f + ss);
+			_mm_storeu_pd(g, _mm_unpacklo_pd(r0, r1));
+			_mm_storeu_pd(g + ds, _mm_unpackhi_pd(r0, r1));
+		}
+	};
+
+	struct tile_8x8_avx2 {
+		std::size_t ss, ds;
+
+		MATRIX_SIMD_TARGET("avx2,fma")
+		void operator()(const void* s, void* d) const {
+			const float* f = static_cast<const float*>(s);
+			float* g = static_cast<float*>(d);
+			__m256 r[8], t[8];
+			for(int l = 0; l < 8; ++l)
+				r[l] = _mm256_loadu_ps(f + l * ss);
+			for(int l = 0; l < 8; l += 2) {
+				t[l] = _mm256_unpacklo_ps(r[l], r[l + 1]);
+				t[l + 1] = _mm256_unpackhi_ps(r[l], r[l + 1]);
+			}
+			for(int l = 0; l < 8; l += 4) {
+				r[l] = _mm256_shuffle_ps(t[l], t[l + 2], _MM_SHUFFLE(1, 0, 1, 0));
+				r[l + 1] = _mm256_shuffle_ps(t[l], t[l + 2], _MM_SHUFFLE(3, 2, 3, 2));
+				r[l + 2] = _mm256_shuffle_ps(t[l + 1], t[l + 3], _MM_SHUFFLE(1, 0, 1, 0));
+				r[l + 3] = _mm256_shuffle_ps(t[l + 1], t[l + 3], _MM_SHUFFLE(3, 2, 3, 2));
+			}
+			for(int l = 0; l < 4; ++l) {
+				_mm256_storeu_ps(g + l * ds, _mm256_permute2f128_ps(r[l], r[l + 4], 0x20));
+				_mm256_storeu_ps(g + (l + 4) * ds, _mm256_permute2f128_ps(r[l], r[l + 4], 0x31));
+			}
+		}
+	};
+
+	struct tile_4x4_avx2 {
+		std::size_t ss, ds;
+
+		MATRIX_SIMD_TARGET("avx2,fma")
+		void operator()(const void* s, void* d) const {
+			const double* f = static_cast<const double*>(s);
+			double* g = static_cast<double*>(d);
+			const __m256d r0 = _mm256_loadu_pd(f), r1 = _mm256_loadu_pd(f + ss);
+			const __m256d r2 = _mm256_loadu_pd(f + 2 * ss), r3 = _mm256_loadu_pd(f + 3 * ss);
+			const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+			const __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+			_mm256_storeu_pd(g, _mm256_permute2f128_pd(t0, t2, 0x20));
+			_mm256_storeu_pd(g + ds, _mm256_permute2f128_pd(t1, t3, 0x20));
+			_mm256_storeu_pd(g + 2 * ds, _mm256_permute2f128_pd(t0, t2, 0x31));
+			_mm256_storeu_pd(g + 3 * ds, _mm256_permute2f128_pd(t1, t3, 0x31));
+		}
+	};
+
+	template <typename T>
+	MATRIX_SIMD_TARGET("sse4.2")
+	void transpose_sse(const T* src, std::size_t ss, T* dst, std::size_t ds, std::size_t rows, std::size_t cols) {
+		if constexpr (sizeof(T) == 4)
+			transpose_tiles<4>(src, ss, dst, ds, rows, cols, tile_4x4_sse{ss, ds});
+		else
+			transpose_tiles<2>(src, ss, dst, ds, rows, cols, tile_2x2_sse{ss, ds});
+	}
+
+	template <typename T>
+	MATRIX_SIMD_TARGET("avx2,fma")
+	void transpose_avx2(const T* src, std::size_t ss, T* dst, std::size_t ds, std::size_t rows, std::size_t cols) {
+		if constexpr (sizeof(T) == 4)
+			transpose_tiles<8>(src, ss, dst, ds, rows, cols, tile_8x8_avx2{ss, ds});
+		else
+			transpose_tiles<4>(src, ss, dst, ds, rows, cols, tile_4x4_avx2{ss, ds});
+	}
+
+	template <typename S, typename W, typename F>
+	MATRIX_SIMD_TARGET("sse4.2")
+	S reduce_sse(const W* src, std::size_t n, const F& combine) {
+		return reduce_blocks<S>(src, n, combine);
+	}
+
+	template <typename S, typename W, typename F>
+	MATRIX_SIMD_TARGET("avx2,fma")
+	S reduce_avx2(const W* src, std::size_t n, const F& combine) {
+		return reduce_blocks<S>(src, n, combine);
+	}
+
+	template <typename S, typename W, typename F>
+	MATRIX_SIMD_TARGET("avx512f,avx512bw,avx512vl,avx2,fma")
+	S reduce_avx512(const W* src, std::size_t n, const F& combine) {
+		return reduce_blocks<S>(src, n, combine);
+	}
+
+	#endif
+}
+
+
+/**
+  @brief Transformation kernel
+
+  Writes func(src[i]) into dest[i] for the n contiguous cells starting at src and
+  dest. When both W and Q have a vectorized fast path, the variant matching the
+  active simd_level is used; otherwise the cells are transformed by a plain loop.
+
+  @param src first source cell
+  @param dest first destination cell
+  @param n number of cells
+  @param func functor to apply
+
+  @pre func : W -> Q
+  @pre [src, src + n) and [dest, dest + n) do not overlap
+*/
+template <typename Q, typename W, typename F>
+void transform_cells(const W* src, Q* dest, std::size_t n, const F& func) {
+
+	#ifdef MATRIX_SIMD_X86
+	if constexpr (is_simd_cell<W>::value && is_simd_cell<Q>::value) {
+		switch(active_simd_level()) {
+			case simd_level::avx512:
+				simd_kernels::transform_avx512(src, dest, n, func);
+				return;
+			case simd_level::avx2:
+				simd_kernels::transform_avx2(src, dest, n, func);
+				return;
+			case simd_level::sse:
+				simd_kernels::transform_sse(src, dest, n, func);
+				return;
+			default:
+				break;
+		}
+	}
+	#endif
+
+	simd_kernels::transform_scalar(src, dest, n, func);
+}
+
+
+/**
+  @brief Generation kernel
+
+  Writes gen(i) into dest[i] for the n contiguous cells starting at dest. When Q has
+  a vectorized fast path, the variant matching the active simd_level is used;
+  otherwise the cells are generated by a plain loop. gen(i) may read dest[i], which
+  makes the kernel suitable for in-place element-wise updates.
+
+  @param dest first destination cell
+  @param n number of cells
+  @param gen functor giving the value of each cell
+
+  @pre gen : size_t -> Q
+*/
+template <typename Q, typename G>
+void generate_cells(Q* dest, std::size_t n, const G& gen) {
+
+	#ifdef MATRIX_SIMD_X86
+	if constexpr (is_simd_cell<Q>::value) {
+		switch(active_simd_level()) {
+			case simd_level::avx512:
+				simd_kernels::generate_avx512(dest, n, gen);
+				return;
+			case simd_level::avx2:
+				simd_kernels::generate_avx2(dest, n, gen);
+				return;
+			case simd_level::sse:
+				simd_kernels::generate_sse(dest, n, gen);
+				return;
+			default:
+				break;
+		}
+	}
+	#endif
+
+	simd_kernels::generate_scalar(dest, n, gen);
+}
+
+
+/**
+  @brief Reduction kernel
+
+  Combines the n contiguous cells starting at src, each converted to S, with the
+  associative functor combine. The cells are spread over reduce_lanes partial results
+  which are then combined in a fixed tree, so the result, rounding included, is the
+  same for every simd_level. When W has a vectorized fast path, the variant matching
+  the active simd_level is used.
+
+  @param src first cell
+  @param n number of cells
+  @param combine functor combining two partial results
+
+  @pre n > 0
+  @pre combine : S x S -> S
+
+  @return combination of the cells
+*/
+template <typename S, typename W, typename F>
+S reduce_cells(const W* src, std::size_t n, const F& combine) {
+
+	#ifdef MATRIX_SIMD_X86
+	if constexpr (is_simd_cell<W>::value) {
+		switch(active_simd_level()) {
+			case simd_level::avx512:
+				return simd_kernels::reduce_avx512<S>(src, n, combine);
+			case simd_level::avx2:
+				return simd_kernels::reduce_avx2<S>(src, n, combine);
+			case simd_level::sse:
+				return simd_kernels::reduce_sse<S>(src, n, combine);
+			default:
+				break;
+		}
+	}
+	#endif
+
+	return simd_kernels::reduce_scalar<S>(src, n, combine);
+}
+
+
+/**
+  @brief Transposition kernel
+
+  Writes src[i * src_stride + j] into dst[j * dst_stride + i] for i < rows and j < cols.
+  Trivially copyable cells of 4 or 8 bytes are moved by square tiles transposed in
+  the vector registers, 8 x 8 or 4 x 4 with AVX2 (also used at the AVX-512 level)
+  and 4 x 4 or 2 x 2 with SSE; the other cells are copied one at a time.
+
+  @param src first source cell
+  @param src_stride distance in cells between two source rows
+  @param dst first destination cell
+  @param dst_stride distance in cells between two destination rows
+  @param rows number of source rows
+  @param cols number of source columns
+
+  @pre the source and destination blocks do not overlap
+*/
+template <typename T>
+void transpose_cells(const T* src, std::size_t src_stride, T* dst, std::size_t dst_stride,
+					 std::size_t rows, std::size_t cols) {
+
+	#ifdef MATRIX_SIMD_X86
+	if constexpr (std::is_trivially_copyable<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)) {
+		switch(active_simd_level()) {
+			case simd_level::avx512:
+			case simd_level::avx2:
+				simd_kernels::transpose_avx2(src, src_stride, dst, dst_stride, rows, cols);
+				return;
+			case simd_level::sse:
+				simd_kernels::transpose_sse(src, src_stride, dst, dst_stride, rows, cols);
+				return;
+			default:
+				break;
+		}
+	}
+	#endif
+
+	simd_kernels::transpose_rest(src, src_stride, dst, dst_stride, 0, rows, cols);
+}
+
+
+
+namespace simd_kernels {
+
+	/**
+		@brief Tables of the CRC-32C (Castagnoli polynomial, reflected), 8 bytes at a time
+
+		table[0] is the classic byte table; table[k][b] is the CRC of b followed by k
+		zero bytes, so that 8 bytes are folded with 8 independent lookups.
+	*/
+	inline const std::uint32_t (&crc32c_table())[8][256] {
+
+		static const struct tables {
+			std::uint32_t t[8][256];
+
+			tables() {
+				for(std::uint32_t b = 0; b < 256; ++b) {
+					std::uint32_t c = b;
+					for(int k = 0; k < 8; ++k)
+						c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1u)));
+					t[0][b] = c;
+				}
+
+				for(std::uint32_t b = 0; b < 256; ++b)
+					for(int k = 1; k < 8; ++k)
+						t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+			}
+		} tables;
+
+		return tables.t;
+	}
+
+	inline std::uint32_t crc32c_scalar(std::uint32_t crc, const unsigned char* p, std::size_t n) {
+
+		const std::uint32_t (&t)[8][256] = crc32c_table();
+
+		for(; n >= 8; n -= 8, p += 8) {
+			const std::uint32_t lo = crc ^ (std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 |
+											std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24);
+			crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+				  t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		}
+
+		for(; n > 0; --n, ++p)
+			crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+
+		return crc;
+	}
+
+	#ifdef MATRIX_SIMD_X86
+
+	MATRIX_SIMD_TARGET("sse4.2")
+	inline std::uint32_t crc32c_sse(std::uint32_t crc, const unsigned char* p, std::size_t n) {
+
+		#ifdef __x86_64__
+		std::uint64_t c = crc;
+		for(; n >= 8; n -= 8, p += 8) {
+			std::uint64_t word;
+			__builtin_memcpy(&word, p, 8);
+			c = _mm_crc32_u64(c, word);
+		}
+		crc = static_cast<std::uint32_t>(c);
+		#endif
+
+		for(; n > 0; --n, ++p)
+			crc = _mm_crc32_u8(crc, *p);
+
+		return crc;
+	}
+
+	#endif
+}
+
+
+/**
+  @brief Checksum kernel
+
+  Returns the CRC-32C of the n bytes starting at data, computed by the crc32
+  instruction of SSE 4.2 when the active simd_level allows it, 8 bytes at a time with
+  tables otherwise. A checksum can be extended: crc32c(b, nb, crc32c(a, na)) is the
+  checksum of a followed by b.
+
+  @param data first byte
+  @param n number of bytes
+  @param crc checksum of the preceding bytes, 0 for none
+
+  @return checksum of the bytes
+*/
+inline std::uint32_t crc32c(const void* data, std::size_t n, std::uint32_t crc = 0) {
+
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+
+	#ifdef MATRIX_SIMD_X86
+	if(active_simd_level() != simd_level::scalar)
+		return ~simd_kernels::crc32c_sse(~crc, p, n);
+	#endif
+
+	return ~simd_kernels::crc32c_scalar(~crc, p, n);
+}
+
+#endif
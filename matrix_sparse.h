@@ -0,0 +1,593 @@
+#ifndef MATRIX_SPARSE
+#define MATRIX_SPARSE
+
+#include <cstddef> // std::size_t
+#include <cassert>
+#include <algorithm> // std::copy, std::fill, std::all_of
+#include <unordered_map>
+#include <vector>
+#include <memory> // std::unique_ptr
+#include <utility> // std::move, std::swap
+#include <type_traits>
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_iterator.h"
+
+/**
+  @file matrix_sparse.h
+  @brief sparse_matrix_3d template class declaration and implementation.
+*/
+
+
+/**
+  @brief Class for representing a mostly empty matrix_3d
+
+  The cells are grouped in bricks of brick_edge^3 cells, and only the bricks holding
+  a cell different from T() are stored, in a hash map indexed by brick. The other
+  bricks are all represented by a single shared brick of T(), so that memory, and the
+  time of for_each_occupied(), grow with the occupied bricks and not with the extents.
+
+  The read-only accesses never allocate, and neither does a read through the
+  iterators, whose proxy reference allocates the brick of the cell only when it is
+  assigned a value different from T(), as set() does. The non-const operator()
+  allocates the brick of the cell on first access, since it hands out a reference
+  that may be written. compact() releases the bricks back to T().
+
+  A reference to a cell stays valid until the brick is released by compact(). Even
+  the read-only accesses update a one-brick lookup cache, so a sparse_matrix_3d must
+  not be accessed by several threads at a time.
+*/
+template <typename T> class sparse_matrix_3d {
+
+	public:
+
+		typedef T value_type;
+		typedef matrix_index size_type;
+		typedef indexed_iterator<sparse_matrix_3d, T> iterator;
+		typedef indexed_iterator<const sparse_matrix_3d, const T> const_iterator;
+
+		/**
+			@brief Number of cells of each side of the bricks
+		*/
+		static constexpr size_type brick_edge = 16;
+
+		/**
+			@brief Proxy reference to a cell, given by the iterators
+
+			Reads without allocating, and writes through set().
+		*/
+		class reference {
+
+			private:
+
+				sparse_matrix_3d* _matrix;
+				size_type _z;
+				size_type _y;
+				size_type _x;
+
+				friend class sparse_matrix_3d;
+
+				reference(sparse_matrix_3d* matrix, size_type z, size_type y, size_type x)
+						  : _matrix(matrix), _z(z), _y(y), _x(x) {}
+
+			public:
+
+				operator T() const {
+					return static_cast<const sparse_matrix_3d&>(*_matrix)(_z, _y, _x);
+				}
+
+				reference& operator=(const T& value) {
+					_matrix->set(_z, _y, _x, value);
+					return *this;
+				}
+
+				reference& operator=(const reference& other) {
+					return *this = static_cast<T>(other);
+				}
+
+				friend void swap(reference a, reference b) {
+					T value = a;
+					a = static_cast<T>(b);
+					b = value;
+				}
+		};
+
+	private:
+
+		static constexpr unsigned int shift = 4;
+		static constexpr std::size_t brick_cells = brick_edge * brick_edge * brick_edge;
+		static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+		static_assert(std::size_t(1) << shift == brick_edge, "brick_edge must be 2^shift");
+
+		size_type _plans;
+		size_type _rows;
+		size_type _col;
+		std::size_t _bricks_y;
+		std::size_t _bricks_x;
+		std::unordered_map<std::size_t, std::unique_ptr<T[]>> _bricks;
+
+		// Last brick looked up: its cells, or nullptr if not stored.
+		mutable std::size_t _last;
+		mutable T* _last_cells;
+
+		template <typename M, typename V> friend class indexed_iterator;
+
+		/**
+			@brief Shared brick of T()
+		*/
+		static const T* empty_brick() {
+			static const std::vector<T> cells(brick_cells, T());
+			return cells.data();
+		}
+
+		std::size_t brick_of(size_type z, size_type y, size_type x) const {
+			return ((std::size_t(z) >> shift) * _bricks_y + (y >> shift)) * _bricks_x + (x >> shift);
+		}
+
+		static std::size_t local(size_type z, size_type y, size_type x) {
+			return ((z & (brick_edge - 1)) * brick_edge + (y & (brick_edge - 1))) * brick_edge + (x & (brick_edge - 1));
+		}
+
+		/**
+			@brief Stored cells of the brick b, or nullptr
+		*/
+		T* find(std::size_t b) const {
+
+			if(b == _last)
+				return _last_cells;
+
+			auto found = _bricks.find(b);
+
+			_last = b;
+			_last_cells = found == _bricks.end() ? nullptr : found->second.get();
+
+			return _last_cells;
+		}
+
+		/**
+			@brief Cells of the brick b, allocated if not stored
+		*/
+		T* materialize(std::size_t b) {
+
+			T* cells = find(b);
+
+			if(cells == nullptr) {
+				std::unique_ptr<T[]> brick(new T[brick_cells]());
+				cells = brick.get();
+				_bricks.emplace(b, std::move(brick));
+				_last_cells = cells;
+			}
+
+			return cells;
+		}
+
+		void forget() const {
+			_last = none;
+			_last_cells = nullptr;
+		}
+
+		/**
+			@brief Origin of the brick b, plan, row and column
+		*/
+		void origin(std::size_t b, size_type& z, size_type& y, size_type& x) const {
+			z = static_cast<size_type>(b / (_bricks_x * _bricks_y) << shift);
+			y = static_cast<size_type>(b / _bricks_x % _bricks_y << shift);
+			x = static_cast<size_type>(b % _bricks_x << shift);
+		}
+
+		/**
+			@brief Visit of the occupied cells of a brick
+
+			@return false if f stopped the traversal
+		*/
+		template <typename E, typename F>
+		bool visit(std::size_t b, E* cells, F& f) const {
+
+			size_type z0, y0, x0;
+			origin(b, z0, y0, x0);
+
+			const size_type nz = std::min<size_type>(brick_edge, _plans - z0);
+			const size_type ny = std::min<size_type>(brick_edge, _rows - y0);
+			const size_type nx = std::min<size_type>(brick_edge, _col - x0);
+
+			for(size_type i = 0; i < nz; ++i)
+				for(size_type j = 0; j < ny; ++j) {
+					E* row = cells + (i * brick_edge + j) * brick_edge;
+
+					for(size_type k = 0; k < nx; ++k)
+						if(!(row[k] == T())) {
+							if constexpr (std::is_same<decltype(f(z0, y0, x0, row[k])), bool>::value) {
+								if(!f(z0 + i, y0 + j, x0 + k, row[k]))
+									return false;
+							}
+							else
+								f(z0 + i, y0 + j, x0 + k, row[k]);
+						}
+				}
+
+			return true;
+		}
+
+		/**
+			@brief Cell of linear index i, plan after plan and row after row
+		*/
+		reference cell(std::size_t i) {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			return reference(this, static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col));
+		}
+
+		const T& cell(std::size_t i) const {
+			const std::size_t plan = std::size_t(_rows) * _col;
+			return (*this)(static_cast<size_type>(i / plan), static_cast<size_type>(i % plan / _col), static_cast<size_type>(i % _col));
+		}
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Creates a null sparse_matrix_3d.
+		*/
+		sparse_matrix_3d() : sparse_matrix_3d(0, 0, 0) {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates an empty z x y x x matrix: all the cells are T() and no brick is
+			allocated.
+
+			@throw std::length_error if the extents overflow
+		*/
+		sparse_matrix_3d(size_type z, size_type y, size_type x)
+						 : _plans(z), _rows(y), _col(x), _bricks_y((std::size_t(y) + brick_edge - 1) >> shift),
+						   _bricks_x((std::size_t(x) + brick_edge - 1) >> shift), _bricks(), _last(none), _last_cells(nullptr) {
+			checked_extent(checked_extent(z, y), x);
+		}
+
+		/**
+			@brief Conversion from a dense matrix_3d
+
+			Stores the bricks of source holding a cell different from T().
+
+			@param source dense matrix_3d
+		*/
+		template <typename A>
+		explicit sparse_matrix_3d(const matrix_3d<T, A>& source)
+								  : sparse_matrix_3d(source.plans(), source.rows(), source.columns()) {
+
+			const T zero = T();
+
+			for(size_type z0 = 0; z0 < _plans; z0 += brick_edge)
+				for(size_type y0 = 0; y0 < _rows; y0 += brick_edge)
+					for(size_type x0 = 0; x0 < _col; x0 += brick_edge) {
+						const size_type nz = std::min<size_type>(brick_edge, _plans - z0);
+						const size_type ny = std::min<size_type>(brick_edge, _rows - y0);
+						const size_type nx = std::min<size_type>(brick_edge, _col - x0);
+						T* cells = nullptr;
+
+						for(size_type i = 0; i < nz; ++i)
+							for(size_type j = 0; j < ny; ++j) {
+								const T* row = source.data() + ((std::size_t(z0) + i) * _rows + y0 + j) * source.pitch() + x0;
+
+								if(cells == nullptr) {
+									if(std::all_of(row, row + nx, [zero] (const T& v) {return v == zero;}))
+										continue;
+									cells = materialize(brick_of(z0, y0, x0));
+								}
+
+								std::copy(row, row + nx, cells + (i * brick_edge + j) * brick_edge);
+							}
+					}
+		}
+
+		/**
+			@brief Copy constructor
+		*/
+		sparse_matrix_3d(const sparse_matrix_3d& other)
+						 : _plans(other._plans), _rows(other._rows), _col(other._col), _bricks_y(other._bricks_y),
+						   _bricks_x(other._bricks_x), _bricks(), _last(none), _last_cells(nullptr) {
+
+			_bricks.reserve(other._bricks.size());
+
+			for(const auto& brick : other._bricks) {
+				std::unique_ptr<T[]> cells(new T[brick_cells]);
+				std::copy(brick.second.get(), brick.second.get() + brick_cells, cells.get());
+				_bricks.emplace(brick.first, std::move(cells));
+			}
+		}
+
+		/**
+			@brief Move constructor
+		*/
+		sparse_matrix_3d(sparse_matrix_3d&& other) noexcept
+						 : _plans(other._plans), _rows(other._rows), _col(other._col), _bricks_y(other._bricks_y),
+						   _bricks_x(other._bricks_x), _bricks(std::move(other._bricks)), _last(none), _last_cells(nullptr) {
+			other._plans = other._rows = other._col = 0;
+			other._bricks_y = other._bricks_x = 0;
+			other._bricks.clear();
+			other.forget();
+		}
+
+		sparse_matrix_3d& operator=(const sparse_matrix_3d& other) {
+			if(this != &other) {
+				sparse_matrix_3d copy(other);
+				swap(copy);
+			}
+			return *this;
+		}
+
+		sparse_matrix_3d& operator=(sparse_matrix_3d&& other) noexcept {
+			if(this != &other) {
+				sparse_matrix_3d moved(std::move(other));
+				swap(moved);
+			}
+			return *this;
+		}
+
+		void swap(sparse_matrix_3d& other) noexcept {
+			std::swap(_plans, other._plans);
+			std::swap(_rows, other._rows);
+			std::swap(_col, other._col);
+			std::swap(_bricks_y, other._bricks_y);
+			std::swap(_bricks_x, other._bricks_x);
+			_bricks.swap(other._bricks);
+			forget();
+			other.forget();
+		}
+
+		inline size_type plans() const {
+			return _plans;
+		}
+
+		inline size_type rows() const {
+			return _rows;
+		}
+
+		inline size_type columns() const {
+			return _col;
+		}
+
+		/**
+			@brief Total dimension getter
+		*/
+		inline size_type size() const {
+			return _plans * _rows * _col;
+		}
+
+		/**
+			@brief Number of stored bricks
+		*/
+		std::size_t bricks() const {
+			return _bricks.size();
+		}
+
+		/**
+			@brief Memory taken by the stored bricks, in bytes
+		*/
+		std::size_t storage_bytes() const {
+			return _bricks.size() * brick_cells * sizeof(T);
+		}
+
+		/**
+			@brief Cell access
+
+			Allocates the brick of the cell if it is not stored, so that the reference
+			can be written.
+		*/
+		T& operator()(size_type z, size_type y, size_type x) {
+			assert(z < _plans && y < _rows && x < _col);
+			return materialize(brick_of(z, y, x))[local(z, y, x)];
+		}
+
+		/**
+			@brief Read-only cell access
+
+			Does not allocate: the cells of the bricks not stored are read from the
+			shared empty brick.
+		*/
+		const T& operator()(size_type z, size_type y, size_type x) const {
+			assert(z < _plans && y < _rows && x < _col);
+			const T* cells = find(brick_of(z, y, x));
+			return (cells != nullptr ? cells : empty_brick())[local(z, y, x)];
+		}
+
+		/**
+			@brief Cell setter
+
+			Same as operator()(z, y, x) = value, without allocating a brick to store T().
+		*/
+		void set(size_type z, size_type y, size_type x, const T& value) {
+
+			assert(z < _plans && y < _rows && x < _col);
+
+			T* cells = find(brick_of(z, y, x));
+
+			if(cells == nullptr) {
+				if(value == T())
+					return;
+				cells = materialize(brick_of(z, y, x));
+			}
+
+			cells[local(z, y, x)] = value;
+		}
+
+		iterator begin() {
+			return iterator(this, 0);
+		}
+
+		iterator end() {
+			return iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		const_iterator begin() const {
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		/**
+			@brief Traversal of the occupied cells
+
+			Calls f(z, y, x, cell) on each cell different from T(), brick after brick in
+			no particular order and in order inside a brick, looking only at the stored
+			bricks. If f returns a bool, returning false stops the traversal. f may
+			change the cells, but not add or release bricks.
+
+			@pre F : size_type x size_type x size_type x T& -> void or bool
+
+			@return false if f stopped the traversal, true otherwise
+		*/
+		template <typename F>
+		bool for_each_occupied(F f) {
+			for(auto& brick : _bricks)
+				if(!this->visit<T>(brick.first, brick.second.get(), f))
+					return false;
+			return true;
+		}
+
+		/**
+			@brief Read-only traversal of the occupied cells
+
+			@pre F : size_type x size_type x size_type x const T& -> void or bool
+		*/
+		template <typename F>
+		bool for_each_occupied(F f) const {
+			for(const auto& brick : _bricks)
+				if(!this->visit<const T>(brick.first, brick.second.get(), f))
+					return false;
+			return true;
+		}
+
+		/**
+			@brief Number of cells different from T()
+		*/
+		std::size_t occupied() const {
+			std::size_t count = 0;
+			for_each_occupied([&count] (size_type, size_type, size_type, const T&) {++count;});
+			return count;
+		}
+
+		/**
+			@brief Release of the bricks whose cells are all T() again
+
+			Invalidates the references to the cells of the released bricks.
+
+			@return number of bricks released
+		*/
+		std::size_t compact() {
+
+			const T* zero = empty_brick();
+			std::size_t released = 0;
+
+			for(auto it = _bricks.begin(); it != _bricks.end(); )
+				if(std::equal(it->second.get(), it->second.get() + brick_cells, zero)) {
+					it = _bricks.erase(it);
+					++released;
+				}
+				else
+					++it;
+
+			forget();
+
+			return released;
+		}
+
+		/**
+			@brief Fill method
+
+			Fills the matrix, plan after plan and row after row, with the values obtained
+			from two generic iterators, allocating only the bricks receiving a value
+			different from T(). If the iterator reaches the end before completely filling
+			the matrix, the remaining cells remain intact.
+		*/
+		template <typename I>
+		void fill(I start, I end) {
+			for(size_type z = 0; z < _plans; ++z)
+				for(size_type y = 0; y < _rows; ++y)
+					for(size_type x = 0; x < _col; ++x, ++start) {
+						if(start == end)
+							return;
+						set(z, y, x, static_cast<T>(*start));
+					}
+		}
+
+		/**
+		    @brief Comparison function
+
+		    Returns true if the two matrices have the same shape and equal cells
+		    according to equality. Only the bricks stored by either matrix are compared.
+
+			@pre E : T x T -> {0, 1}
+	  	*/
+		template <typename E>
+		bool equals(const sparse_matrix_3d& other, const E equality) const {
+
+			if(_plans != other._plans || _rows != other._rows || _col != other._col)
+				return false;
+
+			auto same = [&equality] (const T* a, const T* b) -> bool {
+				for(std::size_t i = 0; i < brick_cells; ++i)
+					if(!equality(a[i], b[i]))
+						return false;
+				return true;
+			};
+
+			for(const auto& brick : _bricks) {
+				const T* others = other.find(brick.first);
+				if(!same(brick.second.get(), others != nullptr ? others : empty_brick()))
+					return false;
+			}
+
+			for(const auto& brick : other._bricks)
+				if(find(brick.first) == nullptr && !same(empty_brick(), brick.second.get()))
+					return false;
+
+			return true;
+		}
+
+		bool operator==(const sparse_matrix_3d& other) const {
+			return equals(other, [] (const T& a, const T& b) -> bool {return a == b;});
+		}
+
+		bool operator!=(const sparse_matrix_3d& other) const {
+			return !(*this == other);
+		}
+
+		/**
+			@brief Conversion to a dense matrix_3d
+
+			Copies the stored bricks into a matrix_3d of T().
+
+			@param alloc allocator of the result
+		*/
+		template <typename A = std::allocator<T>>
+		matrix_3d<T, A> dense(const A& alloc = A()) const {
+
+			matrix_3d<T, A> result(_plans, _rows, _col, alloc);
+			const T zero = T();
+
+			std::fill(result.begin(), result.end(), zero);
+
+			for(const auto& brick : _bricks) {
+				size_type z0, y0, x0;
+				origin(brick.first, z0, y0, x0);
+
+				const size_type nz = std::min<size_type>(brick_edge, _plans - z0);
+				const size_type ny = std::min<size_type>(brick_edge, _rows - y0);
+				const size_type nx = std::min<size_type>(brick_edge, _col - x0);
+
+				for(size_type i = 0; i < nz; ++i)
+					for(size_type j = 0; j < ny; ++j) {
+						const T* row = brick.second.get() + (i * brick_edge + j) * brick_edge;
+						std::copy(row, row + nx, result.data() + ((std::size_t(z0) + i) * _rows + y0 + j) * result.pitch() + x0);
+					}
+			}
+
+			return result;
+		}
+};
+
+#endif
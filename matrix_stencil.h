@@ -0,0 +1,511 @@
+#ifndef MATRIX_STENCIL
+#define MATRIX_STENCIL
+
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cassert>
+#include <algorithm> // std::copy, std::fill, std::min
+#include <vector>
+#include <type_traits>
+#include <utility> // std::declval
+#include "matrix_fwd.h"
+#include "matrix_allocator.h"
+#include "matrix_simd.h"
+#include "matrix_parallel.h"
+
+/**
+  @file matrix_stencil.h
+  @brief Neighbourhood filters on matrix_3d declaration and implementation.
+
+  convolve() applies a small 3D kernel of weights to every cell of a matrix_3d,
+  convolve_separable() does the same for a kernel which is the product of three 1D
+  kernels, in three 1D passes, and erode() and dilate() take the minimum and the
+  maximum over a box. The neighbours falling outside the matrix are given by a
+  border_mode. Every function also has a parallel overload taking a parallel_t,
+  which splits the plans of the result among the workers; the results do not depend
+  on the number of threads.
+
+  The kernels are centered: a kernel of kz x ky x kx weights, all odd, reaches
+  kz / 2, ky / 2 and kx / 2 cells on each side. As in image processing libraries, the
+  kernel is not flipped, i.e. the result is a correlation:
+
+	result(z, y, x) = sum of kernel(i, j, k) * source(z + i - kz / 2, y + j - ky / 2, x + k - kx / 2)
+*/
+
+
+/**
+  @brief Values of the neighbours outside the matrix
+
+  - zero: 0;
+  - clamp: the nearest cell on the border (aaa|abcd|ddd);
+  - wrap: the cells on the opposite side, as if the matrix were periodic (bcd|abcd|abc);
+  - mirror: the cells reflected on the border, the border excluded (dcb|abcd|cba).
+*/
+enum class border_mode {
+	zero,
+	clamp,
+	wrap,
+	mirror
+};
+
+
+/**
+  @brief Cell type of the result of convolving cells of T with weights of W
+*/
+template <typename T, typename W>
+using stencil_result = decltype(std::declval<T>() * std::declval<W>());
+
+
+/**
+  @brief Implementation of the filters
+
+  Every filter works on z slabs of the result, each one filled by a single task with
+  its own buffers, and on rows of at most tile_columns cells, so that the
+  accumulators stay in the L1 cache while the kernel taps are applied. Each tap is
+  applied to a whole row through generate_cells(), and so vectorized along X.
+*/
+namespace stencil_detail {
+
+	/**
+		@brief Number of rows of the tiles of convolve()
+	*/
+	constexpr std::size_t tile_rows = 8;
+
+	/**
+		@brief Number of columns of the tiles of convolve()
+	*/
+	constexpr std::size_t tile_columns = 256;
+
+	/**
+		@brief Border mapping function
+
+		@param i coordinate, possibly outside [0, n)
+		@param n extent of the axis
+		@param mode border mode
+
+		@pre n > 0
+
+		@return coordinate inside [0, n) giving the value at i, -1 if it is 0
+	*/
+	inline std::ptrdiff_t map_index(std::ptrdiff_t i, std::ptrdiff_t n, border_mode mode) {
+
+		if(i >= 0 && i < n)
+			return i;
+
+		switch(mode) {
+			case border_mode::clamp:
+				return i < 0 ? 0 : n - 1;
+			case border_mode::wrap:
+				return ((i % n) + n) % n;
+			case border_mode::mirror: {
+				if(n == 1)
+					return 0;
+				const std::ptrdiff_t period = 2 * n - 2;
+				i = ((i % period) + period) % period;
+				return i < n ? i : period - i;
+			}
+			default:
+				return -1;
+		}
+	}
+
+	/**
+		@brief Padding function
+
+		Copies the n cells of src into line, preceded and followed by halo cells
+		given by the border mode.
+	*/
+	template <typename T>
+	void pad_line(const T* src, std::size_t n, std::size_t halo, border_mode mode, T* line) {
+
+		std::copy(src, src + n, line + halo);
+
+		for(std::size_t k = 0; k < halo; ++k) {
+			const std::ptrdiff_t left = map_index(static_cast<std::ptrdiff_t>(k) - static_cast<std::ptrdiff_t>(halo), n, mode);
+			const std::ptrdiff_t right = map_index(static_cast<std::ptrdiff_t>(n + k), n, mode);
+			line[k] = left < 0 ? T() : src[left];
+			line[halo + n + k] = right < 0 ? T() : src[right];
+		}
+	}
+
+	/**
+		@brief Weight of a kernel and its position, relative to the first neighbour
+	*/
+	template <typename W>
+	struct tap {
+		std::size_t z;
+		std::size_t y;
+		std::size_t x;
+		W weight;
+	};
+
+	/**
+		@brief Full kernel on the plans [z1, z2)
+
+		Keeps the kz padded plans the current plan needs in a ring, so that each plan
+		of source is padded once per slab, then accumulates every tap on tiles of
+		the result.
+	*/
+	template <typename R, typename T, typename A, typename W>
+	void convolve_slab(const matrix_3d<T, A>& source, const std::vector<tap<W>>& taps, std::size_t kz,
+					   std::size_t ky, std::size_t kx, border_mode mode, R* out, std::size_t out_pitch,
+					   std::size_t z1, std::size_t z2) {
+
+		const std::size_t plans = source.plans();
+		const std::size_t rows = source.rows();
+		const std::size_t columns = source.columns();
+		const std::size_t rz = kz / 2, ry = ky / 2, rx = kx / 2;
+		const std::size_t stride = columns + 2 * rx;
+		const std::size_t plan_cells = stride * (rows + 2 * ry);
+
+		std::vector<T> ring(kz * plan_cells);
+		std::vector<std::ptrdiff_t> loaded(kz, -static_cast<std::ptrdiff_t>(kz) - 1);
+		std::vector<const T*> window(kz);
+		std::vector<R> acc(tile_rows * tile_columns);
+
+		// Padded plan v - rz, where v = z + dz, kept in the slot v % kz.
+		auto load = [&] (std::size_t v) -> const T* {
+			const std::size_t slot = v % kz;
+			T* plan = ring.data() + slot * plan_cells;
+			const std::ptrdiff_t z = map_index(static_cast<std::ptrdiff_t>(v) - static_cast<std::ptrdiff_t>(rz), plans, mode);
+
+			if(z < 0)
+				return nullptr;
+
+			if(loaded[slot] != static_cast<std::ptrdiff_t>(v)) {
+				loaded[slot] = v;
+				for(std::size_t py = 0; py < rows + 2 * ry; ++py) {
+					const std::ptrdiff_t y = map_index(static_cast<std::ptrdiff_t>(py) - static_cast<std::ptrdiff_t>(ry), rows, mode);
+					if(y < 0)
+						std::fill(plan + py * stride, plan + (py + 1) * stride, T());
+					else
+						pad_line(source.data() + (z * rows + y) * source.pitch(), columns, rx, mode, plan + py * stride);
+				}
+			}
+
+			return plan;
+		};
+
+		for(std::size_t z = z1; z < z2; ++z) {
+			for(std::size_t dz = 0; dz < kz; ++dz)
+				window[dz] = load(z + dz);
+
+			for(std::size_t y0 = 0; y0 < rows; y0 += tile_rows) {
+				const std::size_t th = std::min(tile_rows, rows - y0);
+
+				for(std::size_t x0 = 0; x0 < columns; x0 += tile_columns) {
+					const std::size_t tw = std::min(tile_columns, columns - x0);
+
+					std::fill(acc.begin(), acc.end(), R());
+
+					for(const tap<W>& t : taps) {
+						if(window[t.z] == nullptr)
+							continue;
+
+						for(std::size_t ty = 0; ty < th; ++ty) {
+							const T* in = window[t.z] + (y0 + ty + t.y) * stride + x0 + t.x;
+							R* a = acc.data() + ty * tile_columns;
+							const W w = t.weight;
+							generate_cells(a, tw, [a, in, w] (std::size_t j) {return static_cast<R>(a[j] + w * in[j]);});
+						}
+					}
+
+					for(std::size_t ty = 0; ty < th; ++ty)
+						std::copy(acc.data() + ty * tile_columns, acc.data() + ty * tile_columns + tw,
+								  out + (z * rows + y0 + ty) * out_pitch + x0);
+				}
+			}
+		}
+	}
+
+	/**
+		@brief Weighted sum of the taps of a 1D pass
+	*/
+	template <typename W>
+	struct linear_pass {
+		const std::vector<W>& weights;
+
+		std::size_t size() const {return weights.size();}
+
+		template <typename R, typename T>
+		void first(R* out, const T* in, std::size_t n, std::size_t k) const {
+			const W w = weights[k];
+			if(in == nullptr)
+				std::fill(out, out + n, R());
+			else
+				generate_cells(out, n, [in, w] (std::size_t j) {return static_cast<R>(w * in[j]);});
+		}
+
+		template <typename R, typename T>
+		void next(R* out, const T* in, std::size_t n, std::size_t k) const {
+			const W w = weights[k];
+			if(in != nullptr && w != W(0))
+				generate_cells(out, n, [out, in, w] (std::size_t j) {return static_cast<R>(out[j] + w * in[j]);});
+		}
+	};
+
+	/**
+		@brief Minimum (Max = false) or maximum (Max = true) of the taps of a 1D pass
+	*/
+	template <bool Max>
+	struct extreme_pass {
+		std::size_t length;
+
+		std::size_t size() const {return length;}
+
+		template <typename R, typename T>
+		void first(R* out, const T* in, std::size_t n, std::size_t) const {
+			if(in == nullptr)
+				std::fill(out, out + n, R());
+			else
+				std::copy(in, in + n, out);
+		}
+
+		template <typename R, typename T>
+		void next(R* out, const T* in, std::size_t n, std::size_t) const {
+			if(in == nullptr)
+				generate_cells(out, n, [out] (std::size_t j) {return pick(out[j], R());});
+			else
+				generate_cells(out, n, [out, in] (std::size_t j) {return pick(out[j], static_cast<R>(in[j]));});
+		}
+
+		template <typename R>
+		static R pick(R a, R b) {return Max ? (a < b ? b : a) : (b < a ? b : a);}
+	};
+
+	/**
+		@brief 1D pass along X on the plans [z1, z2)
+	*/
+	template <typename R, typename T, typename P>
+	void pass_x(const T* in, std::size_t in_pitch, R* out, std::size_t out_pitch, std::size_t rows,
+				std::size_t columns, const P& pass, border_mode mode, std::size_t z1, std::size_t z2) {
+
+		const std::size_t halo = pass.size() / 2;
+		std::vector<T> line(columns + 2 * halo);
+
+		for(std::size_t r = z1 * rows; r < z2 * rows; ++r) {
+			pad_line(in + r * in_pitch, columns, halo, mode, line.data());
+			pass.first(out + r * out_pitch, line.data(), columns, 0);
+			for(std::size_t k = 1; k < pass.size(); ++k)
+				pass.next(out + r * out_pitch, line.data() + k, columns, k);
+		}
+	}
+
+	/**
+		@brief 1D pass along Y (along_z = false) or Z (along_z = true) on the plans [z1, z2)
+	*/
+	template <typename R, typename T, typename P>
+	void pass_rows(const T* in, std::size_t in_pitch, R* out, std::size_t out_pitch, std::size_t plans,
+				   std::size_t rows, std::size_t columns, bool along_z, const P& pass, border_mode mode,
+				   std::size_t z1, std::size_t z2) {
+
+		const std::ptrdiff_t halo = pass.size() / 2;
+
+		for(std::size_t z = z1; z < z2; ++z)
+			for(std::size_t y = 0; y < rows; ++y) {
+				R* o = out + (z * rows + y) * out_pitch;
+
+				for(std::size_t k = 0; k < pass.size(); ++k) {
+					const T* src = nullptr;
+
+					if(along_z) {
+						const std::ptrdiff_t s = map_index(static_cast<std::ptrdiff_t>(z + k) - halo, plans, mode);
+						if(s >= 0)
+							src = in + (s * rows + y) * in_pitch;
+					}
+					else {
+						const std::ptrdiff_t s = map_index(static_cast<std::ptrdiff_t>(y + k) - halo, rows, mode);
+						if(s >= 0)
+							src = in + (z * rows + s) * in_pitch;
+					}
+
+					if(k == 0)
+						pass.first(o, src, columns, k);
+					else
+						pass.next(o, src, columns, k);
+				}
+			}
+	}
+
+	/**
+		@brief Three 1D passes, X then Y then Z
+
+		The X pass writes into result, the Y pass into a scratch volume and the Z
+		pass back into result.
+	*/
+	template <typename R, typename B, typename T, typename A, typename PZ, typename PY, typename PX>
+	matrix_3d<R, B> separable(const matrix_3d<T, A>& source, const PZ& pz, const PY& py, const PX& px,
+							  border_mode mode, const parallel_t* policy) {
+
+		const std::size_t plans = source.plans();
+		const std::size_t rows = source.rows();
+		const std::size_t columns = source.columns();
+
+		assert(pz.size() % 2 == 1 && py.size() % 2 == 1 && px.size() % 2 == 1);
+
+		matrix_3d<R, B> result(plans, rows, columns, B(source.get_allocator()));
+
+		if(result.size() == 0)
+			return result;
+
+		std::vector<R> scratch(result.size());
+		const std::size_t per_chunk = policy == nullptr ? plans : policy->grain / (rows * columns);
+
+		parallel_for(plans, per_chunk, policy, [&] (std::size_t z1, std::size_t z2) {
+			pass_x(source.data(), source.pitch(), result.data(), result.pitch(), rows, columns, px, mode, z1, z2);
+			pass_rows(result.data(), result.pitch(), scratch.data(), columns, plans, rows, columns, false, py, mode, z1, z2);
+		});
+
+		parallel_for(plans, per_chunk, policy, [&] (std::size_t z1, std::size_t z2) {
+			pass_rows(scratch.data(), columns, result.data(), result.pitch(), plans, rows, columns, true, pz, mode, z1, z2);
+		});
+
+		return result;
+	}
+
+	template <typename R, typename B, typename T, typename A, typename W, typename K>
+	matrix_3d<R, B> convolve(const matrix_3d<T, A>& source, const matrix_3d<W, K>& kernel, border_mode mode,
+							 const parallel_t* policy) {
+
+		assert(kernel.plans() % 2 == 1 && kernel.rows() % 2 == 1 && kernel.columns() % 2 == 1);
+
+		matrix_3d<R, B> result(source.plans(), source.rows(), source.columns(), B(source.get_allocator()));
+
+		if(result.size() == 0)
+			return result;
+
+		std::vector<tap<W>> taps;
+		for(std::size_t z = 0; z < kernel.plans(); ++z)
+			for(std::size_t y = 0; y < kernel.rows(); ++y)
+				for(std::size_t x = 0; x < kernel.columns(); ++x)
+					if(kernel(z, y, x) != W(0))
+						taps.push_back(tap<W>{z, y, x, kernel(z, y, x)});
+
+		const std::size_t plan_cells = std::size_t(source.rows()) * source.columns();
+		const std::size_t per_chunk = policy == nullptr ? source.plans() : policy->grain / plan_cells;
+
+		parallel_for(source.plans(), per_chunk, policy, [&] (std::size_t z1, std::size_t z2) {
+			convolve_slab(source, taps, kernel.plans(), kernel.rows(), kernel.columns(), mode,
+						  result.data(), result.pitch(), z1, z2);
+		});
+
+		return result;
+	}
+}
+
+
+/**
+  @brief Convolution function
+
+  Returns a new matrix_3d with the shape of source, whose cells are the weighted sums
+  of the neighbours of the cells of source given by kernel. The zero weights are
+  skipped. The cells are obtained from a copy of the allocator of source, rebound to
+  the result type.
+
+  @param source source matrix_3d
+  @param kernel weights, of odd extents
+  @param border values of the neighbours outside source
+  @param policy parallel settings
+
+  @return the filtered matrix_3d
+*/
+template <typename T, typename A, typename W, typename K>
+matrix_3d<stencil_result<T, W>, rebind_allocator<A, stencil_result<T, W>>>
+convolve(const matrix_3d<T, A>& source, const matrix_3d<W, K>& kernel, border_mode border = border_mode::zero) {
+
+	typedef stencil_result<T, W> R;
+	return stencil_detail::convolve<R, rebind_allocator<A, R>>(source, kernel, border, nullptr);
+}
+
+template <typename T, typename A, typename W, typename K>
+matrix_3d<stencil_result<T, W>, rebind_allocator<A, stencil_result<T, W>>>
+convolve(const matrix_3d<T, A>& source, const matrix_3d<W, K>& kernel, border_mode border, const parallel_t& policy) {
+
+	typedef stencil_result<T, W> R;
+	return stencil_detail::convolve<R, rebind_allocator<A, R>>(source, kernel, border, &policy);
+}
+
+/**
+  @brief Separable convolution function
+
+  Same as convolve() with the kernel kernel(i, j, k) = kz[i] * ky[j] * kx[k], such as
+  a box or a Gaussian kernel, computed as three 1D passes: kz.size() + ky.size() +
+  kx.size() operations per cell instead of their product. The intermediate results
+  are kept in the result type, so rounding may differ slightly from convolve().
+
+  @param source source matrix_3d
+  @param kz weights along Z, of odd size
+  @param ky weights along Y, of odd size
+  @param kx weights along X, of odd size
+  @param border values of the neighbours outside source
+  @param policy parallel settings
+
+  @return the filtered matrix_3d
+*/
+template <typename T, typename A, typename W>
+matrix_3d<stencil_result<T, W>, rebind_allocator<A, stencil_result<T, W>>>
+convolve_separable(const matrix_3d<T, A>& source, const std::vector<W>& kz, const std::vector<W>& ky,
+				   const std::vector<W>& kx, border_mode border = border_mode::zero) {
+
+	typedef stencil_result<T, W> R;
+	return stencil_detail::separable<R, rebind_allocator<A, R>>(source, stencil_detail::linear_pass<W>{kz},
+								stencil_detail::linear_pass<W>{ky}, stencil_detail::linear_pass<W>{kx}, border, nullptr);
+}
+
+template <typename T, typename A, typename W>
+matrix_3d<stencil_result<T, W>, rebind_allocator<A, stencil_result<T, W>>>
+convolve_separable(const matrix_3d<T, A>& source, const std::vector<W>& kz, const std::vector<W>& ky,
+				   const std::vector<W>& kx, border_mode border, const parallel_t& policy) {
+
+	typedef stencil_result<T, W> R;
+	return stencil_detail::separable<R, rebind_allocator<A, R>>(source, stencil_detail::linear_pass<W>{kz},
+								stencil_detail::linear_pass<W>{ky}, stencil_detail::linear_pass<W>{kx}, border, &policy);
+}
+
+/**
+  @brief Erosion function
+
+  Returns a new matrix_3d whose cells are the minimum of the box of source of
+  (2 rz + 1) x (2 ry + 1) x (2 rx + 1) cells centered on them, computed as three 1D
+  passes.
+
+  @param source source matrix_3d
+  @param rz, ry, rx radius of the box along each axis
+  @param border values of the neighbours outside source
+  @param policy parallel settings
+
+  @return the eroded matrix_3d
+*/
+template <typename T, typename A>
+matrix_3d<T, A> erode(const matrix_3d<T, A>& source, std::size_t rz, std::size_t ry, std::size_t rx,
+					  border_mode border = border_mode::clamp) {
+	return stencil_detail::separable<T, A>(source, stencil_detail::extreme_pass<false>{2 * rz + 1},
+		stencil_detail::extreme_pass<false>{2 * ry + 1}, stencil_detail::extreme_pass<false>{2 * rx + 1}, border, nullptr);
+}
+
+template <typename T, typename A>
+matrix_3d<T, A> erode(const matrix_3d<T, A>& source, std::size_t rz, std::size_t ry, std::size_t rx,
+					  border_mode border, const parallel_t& policy) {
+	return stencil_detail::separable<T, A>(source, stencil_detail::extreme_pass<false>{2 * rz + 1},
+		stencil_detail::extreme_pass<false>{2 * ry + 1}, stencil_detail::extreme_pass<false>{2 * rx + 1}, border, &policy);
+}
+
+/**
+  @brief Dilation function
+
+  Same as erode(), with the maximum of the box.
+*/
+template <typename T, typename A>
+matrix_3d<T, A> dilate(const matrix_3d<T, A>& source, std::size_t rz, std::size_t ry, std::size_t rx,
+					   border_mode border = border_mode::clamp) {
+	return stencil_detail::separable<T, A>(source, stencil_detail::extreme_pass<true>{2 * rz + 1},
+		stencil_detail::extreme_pass<true>{2 * ry + 1}, stencil_detail::extreme_pass<true>{2 * rx + 1}, border, nullptr);
+}
+
+template <typename T, typename A>
+matrix_3d<T, A> dilate(const matrix_3d<T, A>& source, std::size_t rz, std::size_t ry, std::size_t rx,
+					   border_mode border, const parallel_t& policy) {
+	return stencil_detail::separable<T, A>(source, stencil_detail::extreme_pass<true>{2 * rz + 1},
+		stencil_detail::extreme_pass<true>{2 * ry + 1}, stencil_detail::extreme_pass<true>{2 * rx + 1}, border, &policy);
+}
+
+#endif
@@ -0,0 +1,604 @@
+#ifndef MATRIX_VIEW
+#define MATRIX_VIEW
+
+#include <iterator> // std::forward_iterator_tag
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cassert>
+#include <type_traits> // std::remove_const
+#include "matrix_fwd.h"
+
+/**
+  @file matrix_view.h
+  @brief matrix_2d_view and matrix_3d_view template classes declaration and implementation.
+*/
+
+/**
+  @brief Class for representing a view on a two-dimensional array
+
+  Class that refers to a two-dimensional region of cells owned by someone else,
+  without copying them. The region is described by a pointer to its first cell,
+  the number of rows and columns and the distance, in cells, between two consecutive
+  rows and between two consecutive columns. The view does not own the cells: it
+  stays valid as long as the storage it aliases. A view on const cells is obtained
+  with T = const U.
+*/
+template <typename T> class matrix_2d_view {
+
+	public:
+
+		/**
+			@brief Data type to represent the dimensions of the view
+		*/
+		typedef std::size_t size_type;
+
+		/**
+			@brief Data type to represent the distance between two cells
+		*/
+		typedef std::ptrdiff_t difference_type;
+
+		/**
+			@brief Data type of the cells, without const qualification
+		*/
+		typedef typename std::remove_const<T>::type value_type;
+
+	private:
+
+		T* _data;
+		size_type _rows;
+		size_type _col;
+		difference_type _row_stride;
+		difference_type _col_stride;
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Initialize the object to a null view.
+		*/
+		matrix_2d_view() : _data(nullptr), _rows(0), _col(0), _row_stride(0), _col_stride(0) {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a view of y rows and x columns starting at data. Cell [i, j] of the
+			view is data[i * row_stride + j * col_stride].
+
+			@param data first cell of the view
+			@param y number of rows
+			@param x number of columns
+			@param row_stride distance between two consecutive rows
+			@param col_stride distance between two consecutive columns
+		*/
+		matrix_2d_view(T* data, size_type y, size_type x,
+					   difference_type row_stride, difference_type col_stride = 1)
+					   : _data(data), _rows(y), _col(x),
+					     _row_stride(row_stride), _col_stride(col_stride) {
+
+			if(y == 0 || x == 0) {
+				_data = nullptr;
+				_rows = 0;
+				_col = 0;
+			}
+		}
+
+		/**
+			@brief Conversion to a read-only view
+		*/
+		operator matrix_2d_view<const T>() const {
+			return matrix_2d_view<const T>(_data, _rows, _col, _row_stride, _col_stride);
+		}
+
+		/**
+			@brief [y, x] cell getter/setter
+
+			@param y row of the cell
+			@param x column of the cell
+
+			@pre y < rows()
+			@pre x < columns()
+
+			@return reference to the aliased cell
+		*/
+		T& operator()(size_type y, size_type x) const {
+
+			assert(y < _rows);
+			assert(x < _col);
+
+			return _data[static_cast<difference_type>(y) * _row_stride +
+						 static_cast<difference_type>(x) * _col_stride];
+		}
+
+		/**
+			@brief Rows getter
+
+			@return number of rows
+		*/
+		inline size_type rows() const {return _rows;}
+
+		/**
+			@brief Columns getter
+
+			@return number of columns
+		*/
+		inline size_type columns() const {return _col;}
+
+		/**
+			@brief Total dimension getter
+
+			@return number of cells of the view
+		*/
+		inline size_type size() const {return _rows * _col;}
+
+		/**
+			@brief Row stride getter
+
+			@return distance between two consecutive rows
+		*/
+		inline difference_type row_stride() const {return _row_stride;}
+
+		/**
+			@brief Column stride getter
+
+			@return distance between two consecutive columns
+		*/
+		inline difference_type column_stride() const {return _col_stride;}
+
+		/**
+			@brief First cell getter
+
+			@return pointer to the first cell of the view
+		*/
+		inline T* data() const {return _data;}
+
+		/**
+			@brief 2-dimensional subview extraction
+
+			Returns a view on the cells [y1:y2, x1:x2] of the current view. Both lower
+			and upper limits are included. No cell is copied.
+
+			@pre y1 <= y2
+			@pre y2 < rows()
+			@pre x1 <= x2
+			@pre x2 < columns()
+
+			@return view on [y1:y2, x1:x2]
+		*/
+		matrix_2d_view view(size_type y1, size_type y2, size_type x1, size_type x2) const {
+
+			assert(y1 <= y2 && y2 < _rows);
+			assert(x1 <= x2 && x2 < _col);
+
+			return matrix_2d_view(&(*this)(y1, x1), y2 - y1 + 1, x2 - x1 + 1,
+								  _row_stride, _col_stride);
+		}
+
+		/**
+			@brief Materialization method
+
+			Copies the cells of the view into a new, independent matrix_2d.
+
+			@return matrix_2d holding a copy of the cells of the view
+		*/
+		matrix_2d<value_type> materialize() const {
+
+			matrix_2d<value_type> result(_rows, _col);
+			value_type* dest = result.data();
+
+			for(size_type i = 0; i < _rows; ++i) {
+				const T* row = _data + static_cast<difference_type>(i) * _row_stride;
+				for(size_type j = 0; j < _col; ++j)
+					*dest++ = row[static_cast<difference_type>(j) * _col_stride];
+			}
+
+			return result;
+		}
+
+		/**
+			@brief Class to represent a forward iterator
+
+			Class for representing a forward iterator on the cells of a matrix_2d_view,
+			visited row after row. The iterator keeps a copy of the shape of the view,
+			so it stays valid even if the view object is destroyed.
+		*/
+		class iterator {
+
+			private:
+
+				T* row;
+				size_type x;
+				size_type col;
+				std::ptrdiff_t row_stride;
+				std::ptrdiff_t col_stride;
+				size_type index;
+
+				friend class matrix_2d_view;
+
+				iterator(T* row, size_type col, std::ptrdiff_t row_stride,
+						 std::ptrdiff_t col_stride, size_type index)
+						 : row(row), x(0), col(col), row_stride(row_stride),
+						   col_stride(col_stride), index(index) {}
+
+			public:
+
+				typedef std::forward_iterator_tag iterator_category;
+				typedef typename matrix_2d_view::value_type value_type;
+				typedef std::ptrdiff_t           difference_type;
+				typedef T*                       pointer;
+				typedef T&                       reference;
+
+				iterator() : row(nullptr), x(0), col(0), row_stride(0), col_stride(0), index(0) {}
+
+				reference operator*() const {
+					return row[static_cast<std::ptrdiff_t>(x) * col_stride];
+				}
+
+				pointer operator->() const {
+					return row + static_cast<std::ptrdiff_t>(x) * col_stride;
+				}
+
+				iterator& operator++() {
+					++index;
+					if(++x == col) {
+						x = 0;
+						row += row_stride;
+					}
+					return *this;
+				}
+
+				iterator operator++(int) {
+					iterator tmp(*this);
+					++(*this);
+					return tmp;
+				}
+
+				bool operator==(const iterator& other) const {
+					return index == other.index;
+				}
+
+				bool operator!=(const iterator& other) const {
+					return !((*this) == other);
+				}
+		};
+
+		/**
+			@brief Sequence start iterator
+		*/
+		iterator begin() const {
+			return iterator(_data, _col, _row_stride, _col_stride, 0);
+		}
+
+		/**
+			@brief Sequence end iterator
+		*/
+		iterator end() const {
+			return iterator(nullptr, _col, _row_stride, _col_stride, size());
+		}
+};
+
+
+/**
+  @brief Class for representing a view on a three-dimensional array
+
+  Class that refers to a three-dimensional region of cells owned by someone else,
+  without copying them. The region is described by a pointer to its first cell,
+  the extent along each axis and the distance, in cells, between two consecutive
+  plans, rows and columns. The view does not own the cells: it stays valid as long
+  as the storage it aliases. A view on const cells is obtained with T = const U.
+*/
+template <typename T> class matrix_3d_view {
+
+	public:
+
+		/**
+			@brief Data type to represent the dimensions of the view
+		*/
+		typedef std::size_t size_type;
+
+		/**
+			@brief Data type to represent the distance between two cells
+		*/
+		typedef std::ptrdiff_t difference_type;
+
+		/**
+			@brief Data type of the cells, without const qualification
+		*/
+		typedef typename std::remove_const<T>::type value_type;
+
+	private:
+
+		T* _data;
+		size_type _size;
+		size_type _rows;
+		size_type _col;
+		difference_type _plan_stride;
+		difference_type _row_stride;
+		difference_type _col_stride;
+
+	public:
+
+		/**
+			@brief Default constructor
+
+			Initialize the object to a null view.
+		*/
+		matrix_3d_view() : _data(nullptr), _size(0), _rows(0), _col(0),
+						   _plan_stride(0), _row_stride(0), _col_stride(0) {}
+
+		/**
+			@brief Parameterized constructor
+
+			Creates a view of z plans, y rows and x columns starting at data. Cell
+			[k, i, j] of the view is data[k * plan_stride + i * row_stride + j * col_stride].
+
+			@param data first cell of the view
+			@param z number of plans
+			@param y number of rows
+			@param x number of columns
+			@param plan_stride distance between two consecutive plans
+			@param row_stride distance between two consecutive rows
+			@param col_stride distance between two consecutive columns
+		*/
+		matrix_3d_view(T* data, size_type z, size_type y, size_type x,
+					   difference_type plan_stride, difference_type row_stride,
+					   difference_type col_stride = 1)
+					   : _data(data), _size(z), _rows(y), _col(x), _plan_stride(plan_stride),
+					     _row_stride(row_stride), _col_stride(col_stride) {
+
+			if(z == 0 || y == 0 || x == 0) {
+				_data = nullptr;
+				_size = 0;
+				_rows = 0;
+				_col = 0;
+			}
+		}
+
+		/**
+			@brief Conversion to a read-only view
+		*/
+		operator matrix_3d_view<const T>() const {
+			return matrix_3d_view<const T>(_data, _size, _rows, _col,
+										   _plan_stride, _row_stride, _col_stride);
+		}
+
+		/**
+			@brief [z, y, x] cell getter/setter
+
+			@param z plan of the cell
+			@param y row of the cell
+			@param x column of the cell
+
+			@pre z < plans()
+			@pre y < rows()
+			@pre x < columns()
+
+			@return reference to the aliased cell
+		*/
+		T& operator()(size_type z, size_type y, size_type x) const {
+
+			assert(z < _size);
+			assert(y < _rows);
+			assert(x < _col);
+
+			return _data[static_cast<difference_type>(z) * _plan_stride +
+						 static_cast<difference_type>(y) * _row_stride +
+						 static_cast<difference_type>(x) * _col_stride];
+		}
+
+		/**
+			@brief z-th plan getter
+
+			@param z plan to view
+
+			@pre z < plans()
+
+			@return view on the z-th plan
+		*/
+		matrix_2d_view<T> operator[](size_type z) const {
+
+			assert(z < _size);
+
+			return matrix_2d_view<T>(_data + static_cast<difference_type>(z) * _plan_stride, _rows, _col,
+									 _row_stride, _col_stride);
+		}
+
+		/**
+			@brief Plans getter
+
+			@return number of plans
+		*/
+		inline size_type plans() const {return _size;}
+
+		/**
+			@brief Rows getter
+
+			@return number of rows
+		*/
+		inline size_type rows() const {return _rows;}
+
+		/**
+			@brief Columns getter
+
+			@return number of columns
+		*/
+		inline size_type columns() const {return _col;}
+
+		/**
+			@brief Total dimension getter
+
+			@return number of cells of the view
+		*/
+		inline size_type size() const {return _size * _rows * _col;}
+
+		/**
+			@brief Plan stride getter
+
+			@return distance between two consecutive plans
+		*/
+		inline difference_type plan_stride() const {return _plan_stride;}
+
+		/**
+			@brief Row stride getter
+
+			@return distance between two consecutive rows
+		*/
+		inline difference_type row_stride() const {return _row_stride;}
+
+		/**
+			@brief Column stride getter
+
+			@return distance between two consecutive columns
+		*/
+		inline difference_type column_stride() const {return _col_stride;}
+
+		/**
+			@brief First cell getter
+
+			@return pointer to the first cell of the view
+		*/
+		inline T* data() const {return _data;}
+
+		/**
+			@brief 3-dimensional subview extraction
+
+			Returns a view on the cells [z1:z2, y1:y2, x1:x2] of the current view. Both
+			lower and upper limits are included. No cell is copied.
+
+			@pre z1 <= z2
+			@pre z2 < plans()
+			@pre y1 <= y2
+			@pre y2 < rows()
+			@pre x1 <= x2
+			@pre x2 < columns()
+
+			@return view on [z1:z2, y1:y2, x1:x2]
+		*/
+		matrix_3d_view view(size_type z1, size_type z2, size_type y1, size_type y2,
+							size_type x1, size_type x2) const {
+
+			assert(z1 <= z2 && z2 < _size);
+			assert(y1 <= y2 && y2 < _rows);
+			assert(x1 <= x2 && x2 < _col);
+
+			return matrix_3d_view(&(*this)(z1, y1, x1), z2 - z1 + 1, y2 - y1 + 1, x2 - x1 + 1,
+								  _plan_stride, _row_stride, _col_stride);
+		}
+
+		/**
+			@brief Materialization method
+
+			Copies the cells of the view into a new, independent matrix_3d.
+
+			@return matrix_3d holding a copy of the cells of the view
+		*/
+		matrix_3d<value_type> materialize() const {
+
+			matrix_3d<value_type> result(_size, _rows, _col);
+			value_type* dest = result.data();
+
+			for(size_type k = 0; k < _size; ++k)
+				for(size_type i = 0; i < _rows; ++i) {
+					const T* row = _data + static_cast<difference_type>(k) * _plan_stride +
+								   static_cast<difference_type>(i) * _row_stride;
+					for(size_type j = 0; j < _col; ++j)
+						*dest++ = row[static_cast<difference_type>(j) * _col_stride];
+				}
+
+			return result;
+		}
+
+		/**
+			@brief Class to represent a forward iterator
+
+			Class for representing a forward iterator on the cells of a matrix_3d_view,
+			visited plan after plan and row after row. The iterator keeps a copy of the
+			shape of the view, so it stays valid even if the view object is destroyed.
+		*/
+		class iterator {
+
+			private:
+
+				T* plan;
+				T* row;
+				size_type y;
+				size_type x;
+				size_type rows;
+				size_type col;
+				std::ptrdiff_t plan_stride;
+				std::ptrdiff_t row_stride;
+				std::ptrdiff_t col_stride;
+				size_type index;
+
+				friend class matrix_3d_view;
+
+				iterator(T* plan, size_type rows, size_type col, std::ptrdiff_t plan_stride,
+						 std::ptrdiff_t row_stride, std::ptrdiff_t col_stride, size_type index)
+						 : plan(plan), row(plan), y(0), x(0), rows(rows), col(col),
+						   plan_stride(plan_stride), row_stride(row_stride),
+						   col_stride(col_stride), index(index) {}
+
+			public:
+
+				typedef std::forward_iterator_tag iterator_category;
+				typedef typename matrix_3d_view::value_type value_type;
+				typedef std::ptrdiff_t           difference_type;
+				typedef T*                       pointer;
+				typedef T&                       reference;
+
+				iterator() : plan(nullptr), row(nullptr), y(0), x(0), rows(0), col(0),
+							 plan_stride(0), row_stride(0), col_stride(0), index(0) {}
+
+				reference operator*() const {
+					return row[static_cast<std::ptrdiff_t>(x) * col_stride];
+				}
+
+				pointer operator->() const {
+					return row + static_cast<std::ptrdiff_t>(x) * col_stride;
+				}
+
+				iterator& operator++() {
+					++index;
+					if(++x == col) {
+						x = 0;
+						if(++y == rows) {
+							y = 0;
+							plan += plan_stride;
+							row = plan;
+						}
+						else
+							row += row_stride;
+					}
+					return *this;
+				}
+
+				iterator operator++(int) {
+					iterator tmp(*this);
+					++(*this);
+					return tmp;
+				}
+
+				bool operator==(const iterator& other) const {
+					return index == other.index;
+				}
+
+				bool operator!=(const iterator& other) const {
+					return !((*this) == other);
+				}
+		};
+
+		/**
+			@brief Sequence start iterator
+		*/
+		iterator begin() const {
+			return iterator(_data, _rows, _col, _plan_stride, _row_stride, _col_stride, 0);
+		}
+
+		/**
+			@brief Sequence end iterator
+		*/
+		iterator end() const {
+			return iterator(nullptr, _rows, _col, _plan_stride, _row_stride, _col_stride, size());
+		}
+};
+
+#endif